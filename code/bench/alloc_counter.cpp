@@ -0,0 +1,57 @@
+#include "bench/alloc_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> allocationCount{ 0 };
+static std::atomic<uint64_t> allocationBytes{ 0 };
+
+AllocationStats allocationStats() {
+    AllocationStats stats;
+    stats.count = allocationCount.load(std::memory_order_relaxed);
+    stats.bytes = allocationBytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+static void* countedAllocate(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new(std::size_t size) {
+    void* memory = countedAllocate(size);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new[](std::size_t size) {
+    void* memory = countedAllocate(size);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+// Counts every heap allocation made through operator new in this process
+// (any thread). The counting operators are defined in alloc_counter.cpp and
+// replace the global ones for whatever binary links that file.
+
+#include <cstdint>
+
+struct AllocationStats {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+// Function to read the totals so far; subtract two readings to get the
+// allocations made in between
+AllocationStats allocationStats();
@@ -0,0 +1,706 @@
+// Headless benchmarks for the engine's hot paths (no GPU or window needed).
+//
+// Usage: numbrainer_bench [--filter TEXT] [--json FILE] [--min-time SECONDS] [--list]
+//
+// Results go to stdout as a table and, with --json, to a file that can be
+// diffed between commits. Run it from the build directory so the feedback
+// table and opening book are found, or the table benchmarks are skipped.
+
+#include "bench/alloc_counter.h"
+#include "bench/harness.h"
+#include "engine/batch_scoring.h"
+#include "engine/candidate_set.h"
+#include "engine/computer_player.h"
+#include "engine/feedback_table.h"
+#include "engine/game_clock.h"
+#include "engine/game_record.h"
+#include "engine/game_engine.h"
+#include "engine/hint_engine.h"
+#include "engine/mapped_file.h"
+#include "engine/match_client.h"
+#include "engine/match_history.h"
+#include "engine/match_snapshot.h"
+#include "engine/player_store.h"
+#include "engine/rating.h"
+#if defined(NUMBRAINER_HAS_SERVER)
+#include "engine/match_server.h"
+#endif
+#include "engine/tournament.h"
+#include "engine/variant_analyzer.h"
+#include "engine/variant.h"
+#include "engine/variant_candidates.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <thread>
+
+using namespace std;
+
+static const int INPUT_COUNT = 1024;    // Power of two, so inputs are picked with a mask
+
+// Function to make typed-looking inputs: mostly valid numbers, with wrong
+// lengths, repeated digits and stray characters mixed in
+static vector<string> makeInputs(unsigned seed) {
+    vector<string> inputs;
+    for (int i = 0; i < INPUT_COUNT; i++) {
+        seed = seed * 1103515245u + 12345u;
+        string text = codeToString(codeAt((CodeIndex)((seed >> 8) % CODE_COUNT)));
+        switch ((seed >> 28) & 7) {
+        case 0:
+            text.pop_back();
+            break;
+        case 1:
+            text[1] = text[0];
+            break;
+        case 2:
+            text[2] = 'x';
+            break;
+        default:
+            break;
+        }
+        inputs.push_back(text);
+    }
+    return inputs;
+}
+
+// Scratch files too large for the working directory go to the build
+// directory (set by CMake)
+#ifndef NUMBRAINER_BENCH_DATA_DIR
+#define NUMBRAINER_BENCH_DATA_DIR "."
+#endif
+
+static const int BENCH_PLAYERS = 100000;
+static const int BENCH_MATCHES = 1000000;
+
+// Function to check that a store holds every benchmark match: each one is
+// counted once for each of its two players
+static bool holdsBenchMatches(PlayerStore& store) {
+    if (store.playerCount() > BENCH_PLAYERS) return false;
+    vector<PlayerProfile> everyone;
+    store.leaderboard(BENCH_PLAYERS, everyone);
+    long long matches = 0;
+    for (const PlayerProfile& profile : everyone) matches += profile.matches;
+    return matches == 2ll * BENCH_MATCHES;
+}
+
+// Function to get a player store with a million matches among 100000
+// players, written once, its index built, then reopened so queries go
+// through the mapped files
+static PlayerStore& benchPlayerStore() {
+    static const string LOG_PATH = string(NUMBRAINER_BENCH_DATA_DIR) + "/bench_players.nbp";
+    static const string INDEX_PATH = string(NUMBRAINER_BENCH_DATA_DIR) + "/bench_players.nbi";
+    static PlayerStore store;
+    if (store.isOpen()) return store;
+
+    if (store.open(LOG_PATH.c_str(), INDEX_PATH.c_str()) && holdsBenchMatches(store)) return store;
+    store.close();
+    remove(LOG_PATH.c_str());
+    remove(INDEX_PATH.c_str());
+    store.open(LOG_PATH.c_str(), INDEX_PATH.c_str());
+    unsigned seed = 11;
+    for (int match = 0; match < BENCH_MATCHES; match++) {
+        seed = seed * 1103515245u + 12345u;
+        // Two different players, or the store would not record the match
+        unsigned player1 = (seed >> 4) % BENCH_PLAYERS;
+        unsigned player2 = (player1 + 1 + (seed >> 12) % (BENCH_PLAYERS - 1)) % BENCH_PLAYERS;
+        PlayedMatch played;
+        played.player1Name = "player" + to_string(player1);
+        played.player2Name = "player" + to_string(player2);
+        played.result = (GameResult)(1 + (seed >> 29) % 3);
+        played.player1Guesses = 6;
+        played.player2Guesses = 5;
+        store.recordMatch(played);
+    }
+    store.close();
+    store.open(LOG_PATH.c_str(), INDEX_PATH.c_str());
+    return store;
+}
+
+static vector<Benchmark> makeBenchmarks() {
+    vector<Benchmark> benchmarks;
+    vector<string> inputs = makeInputs(1);
+    vector<string> codes;
+    vector<PackedCode> packed;
+    for (int i = 0; i < INPUT_COUNT; i++) {
+        PackedCode code = codeAt((CodeIndex)((i * 2654435761u) % CODE_COUNT));
+        packed.push_back(code);
+        codes.push_back(codeToString(code));
+    }
+
+    // Validation
+
+    benchmarks.push_back({ "validate/isValidNumber", [inputs](int64_t operations) {
+        for (int64_t i = 0; i < operations; i++) {
+            string message = isValidNumber(inputs[i & (INPUT_COUNT - 1)]);
+            keepAlive(message);
+        }
+    } });
+    benchmarks.push_back({ "validate/parseNumber", [inputs](int64_t operations) {
+        for (int64_t i = 0; i < operations; i++) {
+            PackedCode code = 0;
+            string message = parseNumber(inputs[i & (INPUT_COUNT - 1)], code);
+            keepAlive(code);
+        }
+    } });
+
+    benchmarks.push_back({ "validate/packNumber", [inputs](int64_t operations) {
+        GameVariant classic;
+        for (int64_t i = 0; i < operations; i++) {
+            PackedCode code = 0;
+            NumberStatus status = packNumber(inputs[i & (INPUT_COUNT - 1)], classic, code);
+            keepAlive(status);
+            keepAlive(code);
+        }
+    } });
+
+    // Scoring one pair: the string reference, the packed kernel, the table
+
+    benchmarks.push_back({ "score/string", [codes](int64_t operations) {
+        for (int64_t i = 0; i < operations; i++) {
+            const string& guess = codes[i & (INPUT_COUNT - 1)];
+            const string& target = codes[(i * 7 + 3) & (INPUT_COUNT - 1)];
+            int digits = countCorrectDigits(guess, target);
+            int positions = countCorrectPositions(guess, target);
+            keepAlive(digits);
+            keepAlive(positions);
+        }
+    } });
+    benchmarks.push_back({ "score/packed", [packed](int64_t operations) {
+        for (int64_t i = 0; i < operations; i++) {
+            Feedback feedback = scoreCodes(packed[i & (INPUT_COUNT - 1)], packed[(i * 7 + 3) & (INPUT_COUNT - 1)]);
+            keepAlive(feedback);
+        }
+    } });
+    if (sharedFeedbackTable().isMapped()) {
+        benchmarks.push_back({ "score/table", [](int64_t operations) {
+            const FeedbackTable& table = sharedFeedbackTable();
+            for (int64_t i = 0; i < operations; i++) {
+                Feedback feedback = table.score((CodeIndex)((i * 2654435761u) % CODE_COUNT),
+                    (CodeIndex)((i * 40503u) % CODE_COUNT));
+                keepAlive(feedback);
+            }
+        } });
+    }
+    GameVariant mastermind;
+    mastermind.length = 4;
+    mastermind.base = 6;
+    mastermind.repeats = true;
+    benchmarks.push_back({ "score/variant_repeats", [packed, mastermind](int64_t operations) {
+        for (int64_t i = 0; i < operations; i++) {
+            // Classic codes are valid Mastermind codes once the digit mask is dropped
+            // (digits above 5 just never match)
+            Feedback feedback = scoreVariantCodes(mastermind, packed[i & (INPUT_COUNT - 1)] & CODE_NIBBLE_MASK,
+                packed[(i * 7 + 3) & (INPUT_COUNT - 1)] & CODE_NIBBLE_MASK);
+            keepAlive(feedback);
+        }
+    } });
+
+    // One guess against the whole code space, per scoring path (ns/op is per candidate batch)
+
+    const ScoringPath paths[] = { ScoringPath::Scalar, ScoringPath::SSE2, ScoringPath::AVX2 };
+    for (ScoringPath path : paths) {
+        if (!isScoringPathSupported(path)) continue;
+        benchmarks.push_back({ string("score/batch5040_") + scoringPathName(path), [path](int64_t operations) {
+            static CandidateBuffer all;
+            if (all.empty()) all.fillAll();
+            uint32_t histogram[FEEDBACK_COUNT];
+            for (int64_t i = 0; i < operations; i++) {
+                scoreCandidatesWith(path, codeAt((CodeIndex)(i % CODE_COUNT)), all, nullptr, histogram);
+                keepAlive(histogram[0]);
+            }
+        } });
+    }
+
+    // Candidate tracking and search
+
+    benchmarks.push_back({ "candidates/applyGuess", [packed](int64_t operations) {
+        CandidateSet candidates;
+        for (int64_t i = 0; i < operations; i++) {
+            PackedCode secret = packed[(i * 5 + 1) & (INPUT_COUNT - 1)];
+            PackedCode guess = packed[i & (INPUT_COUNT - 1)];
+            candidates.reset();
+            candidates.applyGuess(guess, scoreCodes(guess, secret));
+            keepAlive(candidates.count());
+        }
+    } });
+    Benchmark search = { "hint/full_search_minimax", [](int64_t operations) {
+        static HintSearch hints;
+        CandidateSet candidates;
+        candidates.applyGuess(packDigits(0, 1, 2, 3), makeFeedback(1, 0));
+        for (int64_t i = 0; i < operations; i++) {
+            HintOptions options;
+            options.useBook = false;
+            hints.start(candidates, HintMode::Minimax, options);
+            hints.wait();
+            keepAlive(hints.best().guess);
+        }
+    } };
+    search.singleOperation = true;
+    benchmarks.push_back(search);
+
+    // Whole matches
+
+    benchmarks.push_back({ "match/random_simulation", [](int64_t operations) {
+        vector<MatchSummary> summaries = simulateRandomMatches((int)operations, 10, 12345);
+        keepAlive(summaries.size());
+    } });
+    // One operation is a full sweep: both plans and 4 x 5040 matches
+    Benchmark tournament = { "match/tournament_sweep", [](int64_t operations) {
+        vector<Strategy> strategies(2);
+        parseStrategy("random", strategies[0]);
+        parseStrategy("minimax", strategies[1]);
+        for (int64_t i = 0; i < operations; i++) {
+            TournamentResult result = runTournament(strategies, TournamentOptions());
+            keepAlive(result.pairings[1].player1Wins);
+        }
+    } };
+    tournament.singleOperation = true;
+    benchmarks.push_back(tournament);
+    // One operation is both exact searches for 3 digits from 0-8, memo cold
+    Benchmark analyzer = { "analyzer/variant_3x9", [](int64_t operations) {
+        GameVariant variant;
+        variant.length = 3;
+        variant.base = 9;
+        for (int64_t i = 0; i < operations; i++) {
+            VariantAnalysis analysis;
+            analyzeVariant(variant, VariantAnalysisOptions(), analysis);
+            keepAlive(analysis.totalGuesses);
+        }
+    } };
+    analyzer.singleOperation = true;
+    benchmarks.push_back(analyzer);
+    vector<GameEvent> script;
+    {
+        GameEvent event;
+        event.type = GameEventType::SetTurnLimit;
+        event.turnLimit = 10;
+        script.push_back(event);
+        event.type = GameEventType::SetNumber;
+        event.code = packDigits(1, 2, 3, 4);
+        script.push_back(event);
+        event.code = packDigits(5, 6, 7, 8);
+        script.push_back(event);
+        event.type = GameEventType::Guess;
+        for (int turn = 0; turn < 8; turn++) {
+            event.time = turn;
+            event.code = packed[turn];
+            script.push_back(event);
+            event.type = GameEventType::Tick;
+            script.push_back(event);
+            event.type = GameEventType::Guess;
+        }
+        event.code = packDigits(5, 6, 7, 8);
+        script.push_back(event);
+    }
+    benchmarks.push_back({ "match/scripted_replay", [script](int64_t operations) {
+        for (int64_t i = 0; i < operations; i++) {
+            MatchSummary summary = simulateMatch(script);
+            keepAlive(summary.eventsApplied);
+        }
+    } });
+
+    // What the GUI does when a guess is entered: validate and pack it, step
+    // the match, narrow the candidates, record and describe the row. Expected
+    // to report 0 allocs/op.
+    // One operation is one recorded event replayed through step(); the record
+    // (random matches, some turns timing out) is written to the working
+    // directory once and memory-mapped
+    benchmarks.push_back({ "record/replay", [](int64_t operations) {
+        static const char* RECORD_PATH = "bench_record.nbr";
+        static MappedFile file;
+        if (!file.isOpen()) {
+            remove(RECORD_PATH);
+            GameRecordWriter writer;
+            if (writer.open(RECORD_PATH)) {
+                unsigned seed = 7;
+                for (int match = 0; match < 256; match++) {
+                    MatchInfo info;
+                    info.startTime = match * 1000.0;
+                    writer.beginMatch(info);
+                    GameEvent event;
+                    event.type = GameEventType::SetTurnLimit;
+                    event.time = info.startTime;
+                    event.turnLimit = 20;
+                    GameState state = step(GameState(), event);
+                    writer.recordEvent(event);
+                    while (state.phase != GamePhase::GameOver) {
+                        seed = seed * 1103515245u + 12345u;
+                        event.time += (seed >> 28) == 0 ? state.timeLimitPerTurn : 1;
+                        event.type = state.phase == GamePhase::SettingNumbers ? GameEventType::SetNumber :
+                            (seed >> 28) == 0 ? GameEventType::Tick : GameEventType::Guess;
+                        event.code = codeAt((CodeIndex)((seed >> 8) % CODE_COUNT));
+                        state = step(state, event);
+                        writer.recordEvent(event);
+                    }
+                    writer.endMatch(event.time, MatchEnd::Finished);
+                }
+                writer.close();
+            }
+            if (!file.open(RECORD_PATH)) return;
+        }
+
+        // Read and applied one event at a time, starting over at the end
+        static GameRecordReader reader(file.data(), file.size());
+        static GameState state;
+        MatchInfo info;
+        GameEvent event;
+        for (int64_t i = 0; i < operations; i++) {
+            while (!reader.nextEvent(event)) {
+                if (!reader.nextMatch(info)) reader = GameRecordReader(file.data(), file.size());
+                state = GameState();
+            }
+            state = step(state, event);
+        }
+        keepAlive(state.player1Turns);
+    } });
+
+    // One operation is one save of a late-match snapshot (200 history rows)
+    // into the mapped file, as the game does after every event
+    benchmarks.push_back({ "snapshot/save", [packed](int64_t operations) {
+        static const char* SNAPSHOT_PATH = "bench_snapshot.bin";
+        static SnapshotFile file;
+        static MatchSnapshot snapshot;
+        if (!file.isOpen()) {
+            if (!file.open(SNAPSHOT_PATH)) return;
+            MatchHistory history;
+            for (int i = 0; i < 200; i++) {
+                HistoryEntry entry;
+                entry.code = packed[i];
+                entry.byPlayer1 = (i & 1) == 0;
+                history.push(entry);
+            }
+            GameState state;
+            state.phase = GamePhase::Guessing;
+            state.turnLimit = 99;
+            captureMatch(snapshot, state, 10, history);
+        }
+        for (int64_t i = 0; i < operations; i++) {
+            snapshot.turnElapsed = (double)(i & 31);
+            file.save(snapshot);
+        }
+    } });
+
+    // One operation is one profile looked up by name
+    benchmarks.push_back({ "players/lookup", [](int64_t operations) {
+        PlayerStore& store = benchPlayerStore();
+        static vector<string> names;
+        if (names.empty()) {
+            for (int i = 0; i < 1024; i++) names.push_back("player" + to_string(i * 97 % 100000));
+        }
+        PlayerProfile profile;
+        for (int64_t i = 0; i < operations; i++) {
+            store.find(names[i & 1023], profile);
+            keepAlive(profile.matches);
+        }
+    } });
+    // One operation is the top 10 of the leaderboard and one player's place
+    benchmarks.push_back({ "players/leaderboard_top10", [](int64_t operations) {
+        PlayerStore& store = benchPlayerStore();
+        vector<PlayerProfile> top;
+        for (int64_t i = 0; i < operations; i++) {
+            store.leaderboard(10, top);
+            keepAlive(store.rankOf("player42"));
+        }
+    } });
+
+    // Ratings. One operation is one match rated as it ends
+    benchmarks.push_back({ "rating/incremental_glicko2", [](int64_t operations) {
+        RatingOptions options;
+        Rating player1;
+        Rating player2;
+        for (int64_t i = 0; i < operations; i++) {
+            rateMatch(options, player1, player2, (GameResult)(1 + i % 3));
+            keepAlive(player1.value);
+        }
+    } });
+    // One operation is a million matches among 100000 players rated from
+    // scratch: in Glicko-2 periods of the default length, on every core, and
+    // match by match on one thread for comparison
+    static vector<RatedMatch> history;
+    if (history.empty()) {
+        unsigned seed = 17;
+        for (int match = 0; match < 1000000; match++) {
+            seed = seed * 1103515245u + 12345u;
+            history.push_back({ (seed >> 4) % 100000, (seed >> 12) % 100000, (GameResult)(1 + (seed >> 29) % 3) });
+        }
+    }
+    for (int periodMatches : { DEFAULT_PERIOD_MATCHES, 1 }) {
+        string name = periodMatches == 1 ? "rating/glicko2_serial_1m" : "rating/glicko2_batch_1m";
+        Benchmark glickoBatch = { name, [periodMatches](int64_t operations) {
+            RatingOptions options;
+            options.periodMatches = periodMatches;
+            for (int64_t i = 0; i < operations; i++) {
+                RatingBatch batch(options);
+                batch.add(history.data(), history.size());
+                batch.finish();
+                keepAlive(batch.ratings()[42].value);
+            }
+        } };
+        glickoBatch.singleOperation = true;
+        benchmarks.push_back(glickoBatch);
+    }
+
+#if defined(NUMBRAINER_HAS_SERVER)
+    // One operation is a guess sent over loopback, checked and scored by the
+    // server and its update received by both players, all on this thread
+    benchmarks.push_back({ "server/loopback_guess", [](int64_t operations) {
+        static SteadyClock clock;
+        static MatchServer server(clock);
+        static MatchClient players[2];
+        static bool player1Turn = true;
+        static int guessesLeft = 0;
+        NetMessage message;
+        // Function to run the server until a player gets a message of a type
+        auto await = [&](MatchClient& player, NetMessageType type) {
+            for (;;) {
+                while (player.receive(message)) {
+                    if (message.type == type) return true;
+                }
+                if (!player.isConnected()) return false;
+                server.poll(1);
+            }
+        };
+        if (!server.port()) {
+            if (!server.listen("127.0.0.1", 0)) return;
+            char address[32];
+            snprintf(address, sizeof(address), "127.0.0.1:%d", server.port());
+            for (MatchClient& player : players) {
+                if (!player.connect(address)) return;
+            }
+        }
+        for (int64_t i = 0; i < operations; i++) {
+            // A fresh match once the last one has used up its turns
+            if (guessesLeft == 0) {
+                // Players are seated in the order their Hellos are read
+                players[0].sendHello("Bench 1");
+                while (server.stats().waiting == 0) server.poll(1);
+                players[1].sendHello("Bench 2");
+                if (!await(players[1], NetMessageType::Matched)) return;
+                // The two sockets are read in no particular order, so player 2
+                // waits for player 1's number to go in before sending theirs
+                players[0].sendTurnLimit(99, GameVariant());
+                players[0].sendNumber(NetMessageType::SetNumber, "1234");
+                do {
+                    if (!await(players[1], NetMessageType::Update)) return;
+                } while (message.update.outcome != StepOutcome::NumberSet);
+                players[1].sendNumber(NetMessageType::SetNumber, "5678");
+                do {
+                    if (!await(players[0], NetMessageType::Update)) return;
+                } while (message.update.phase != GamePhase::Guessing);
+                if (!await(players[1], NetMessageType::Update)) return;
+                player1Turn = true;
+                guessesLeft = 2 * 99;
+            }
+            MatchClient& mover = players[player1Turn ? 0 : 1];
+            mover.sendNumber(NetMessageType::Guess, "9012");
+            if (!await(mover, NetMessageType::Update)) return;
+            keepAlive(message.update.correctDigits);
+            await(players[player1Turn ? 1 : 0], NetMessageType::Update);
+            player1Turn = !player1Turn;
+            guessesLeft--;
+        }
+    } });
+#endif
+
+    // One operation is one turn running out, on a virtual clock that jumps a
+    // few turns at a time the way a stalled or fast-forwarded loop would
+    benchmarks.push_back({ "timer/expire_turns_virtual", [](int64_t operations) {
+        VirtualClock clock;
+        TurnTimer timer(clock);
+        GameState game;
+        game.phase = GamePhase::Guessing;
+        game.turnLimit = 1000000;
+        game.player1Number = packDigits(1, 2, 3, 4);
+        game.player2Number = packDigits(5, 6, 7, 8);
+        GameEvent tick;
+        for (int64_t fired = 0; fired < operations;) {
+            clock.advance(game.timeLimitPerTurn * 3.5);
+            while (fired < operations && timer.nextExpiry(game, tick)) {
+                game = step(game, tick);
+                fired++;
+            }
+        }
+        keepAlive(game.player1Turns);
+    } });
+
+    benchmarks.push_back({ "match/submit_guess", [inputs](int64_t operations) {
+        static MatchHistory history;
+        static CandidateSet candidates;
+        GameVariant classic;
+        GameState start;
+        start.phase = GamePhase::Guessing;
+        start.turnLimit = 1000000;
+        start.player1Number = packDigits(1, 2, 3, 4);
+        start.player2Number = packDigits(5, 6, 7, 8);
+        GameState game = start;
+        StepResult result;
+        char message[128];
+        char guessText[MAX_VARIANT_LENGTH + 1];
+        candidates.reserveGuesses(64);
+        for (int64_t i = 0; i < operations; i++) {
+            GameEvent event;
+            event.type = GameEventType::Guess;
+            if (packNumber(inputs[i & (INPUT_COUNT - 1)], classic, event.code) != NumberStatus::Valid) {
+                keepAlive(numberStatusMessage(checkNumber(inputs[i & (INPUT_COUNT - 1)]), classic,
+                    message, sizeof(message)));
+                continue;
+            }
+            game = step(game, event, &result);
+            if (result.outcome == StepOutcome::Won) game = start;
+            if (candidates.guessCount() == 64) candidates.reset();
+            candidates.applyGuess(event.code, makeFeedback(result.correctDigits, result.correctPositions));
+
+            HistoryEntry entry;
+            entry.code = event.code;
+            entry.byPlayer1 = result.byPlayer1;
+            entry.correctDigits = (uint8_t)result.correctDigits;
+            entry.correctPositions = (uint8_t)result.correctPositions;
+            history.push(entry);
+            formatCode(event.code, classic, guessText);
+            keepAlive(describeGuess(message, sizeof(message), "Player 1", guessText,
+                result.correctDigits, result.correctPositions));
+        }
+    } });
+
+    // The same in a variant too large to list (8 digits in base 16): each
+    // guess walks the space under the work cap, and the computer's next guess
+    // takes another walk. Also expected to report 0 allocs/op.
+    benchmarks.push_back({ "match/submit_guess_large_variant", [](int64_t operations) {
+        static const GameVariant large = { 8, 16, false };
+        static VariantCandidates candidates;
+        static ComputerPlayer computer(3);
+        static vector<VariantCode> guesses;
+        if (guesses.empty()) {
+            candidates.reset(large);
+            candidates.reserveGuesses(8);
+            for (int i = 0; i < 64; i++) guesses.push_back(computer.chooseSecret(large));
+        }
+        GameState start;
+        start.phase = GamePhase::Guessing;
+        start.turnLimit = 1000000;
+        start.variant = large;
+        start.player1Number = packVariantCode("01234567");
+        start.player2Number = packVariantCode("89abcdef");
+        GameState game = start;
+        StepResult result;
+        for (int64_t i = 0; i < operations; i++) {
+            GameEvent event;
+            event.type = GameEventType::Guess;
+            event.code = guesses[i & 63];
+            game = step(game, event, &result);
+            if (result.outcome == StepOutcome::Won) game = start;
+            if (candidates.guessCount() == 8) candidates.reset(large);
+            candidates.applyGuess(event.code, result.correctDigits, result.correctPositions);
+            keepAlive(computer.chooseVariantGuess(candidates));
+        }
+    } });
+
+    // Feedback strings as the history shows them
+
+    benchmarks.push_back({ "format/describeGuess", [codes](int64_t operations) {
+        string name = "Player 1";
+        for (int64_t i = 0; i < operations; i++) {
+            string line = describeGuess(name, codes[i & (INPUT_COUNT - 1)], (int)(i & 3), (int)(i & 1));
+            keepAlive(line);
+        }
+    } });
+
+    // The rows of a full history that fit the history panel
+    benchmarks.push_back({ "format/history_visible_rows", [packed](int64_t operations) {
+        static MatchHistory history;
+        if (history.empty()) {
+            for (int i = 0; i < MatchHistory::CAPACITY; i++) {
+                HistoryEntry entry;
+                entry.code = packed[i & (INPUT_COUNT - 1)];
+                entry.byPlayer1 = (i & 1) == 0;
+                entry.correctDigits = (uint8_t)(i & 3);
+                history.push(entry);
+            }
+        }
+        GameVariant classic;
+        // Rows are formatted into a stack buffer, as the history view does
+        char line[128];
+        for (int64_t i = 0; i < operations; i++) {
+            HistoryWindow rows = visibleHistoryRows(history.size(), 35, (float)((i * 35) % 100000), 165);
+            for (int row = 0; row < rows.count; row++) {
+                const HistoryEntry& entry = history[rows.first + row];
+                keepAlive(describeHistoryEntry(entry, entry.byPlayer1 ? "Player 1" : "Player 2", classic,
+                    line, sizeof(line)));
+            }
+        }
+    } });
+
+    return benchmarks;
+}
+
+#ifndef NUMBRAINER_BUILD_TYPE
+#define NUMBRAINER_BUILD_TYPE "unknown"
+#endif
+
+// Function to describe what the numbers were measured on
+static vector<pair<string, string>> describeEnvironment() {
+    vector<pair<string, string>> environment;
+    char timestamp[32];
+    time_t now = time(nullptr);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    environment.push_back({ "timestamp", timestamp });
+#if defined(__clang__)
+    environment.push_back({ "compiler", string("clang ") + __clang_version__ });
+#elif defined(__GNUC__)
+    environment.push_back({ "compiler", string("gcc ") + __VERSION__ });
+#elif defined(_MSC_VER)
+    environment.push_back({ "compiler", "msvc " + to_string(_MSC_VER) });
+#endif
+    environment.push_back({ "build_type", NUMBRAINER_BUILD_TYPE });
+    environment.push_back({ "scoring_path", scoringPathName(activeScoringPath()) });
+    environment.push_back({ "feedback_table", sharedFeedbackTable().isMapped() ? "mapped" : "computed" });
+    environment.push_back({ "hardware_threads", to_string(thread::hardware_concurrency()) });
+    const char* commit = getenv("NUMBRAINER_COMMIT");
+    if (commit && *commit) environment.push_back({ "commit", commit });
+    return environment;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    const char* filter = nullptr;
+    const char* jsonPath = nullptr;
+    bool listOnly = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            options.minTime = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--list") == 0) {
+            listOnly = true;
+        }
+        else {
+            fprintf(stderr, "Usage: %s [--filter TEXT] [--json FILE] [--min-time SECONDS] [--list]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    vector<BenchReport> reports;
+    for (const Benchmark& benchmark : makeBenchmarks()) {
+        if (filter && benchmark.name.find(filter) == string::npos) continue;
+        if (listOnly) {
+            printf("%s\n", benchmark.name.c_str());
+            continue;
+        }
+        reports.push_back(runBenchmark(benchmark, options));
+        printReport(reports.back(), reports.size() == 1);
+        fflush(stdout);
+    }
+
+    if (jsonPath && !writeJsonReport(jsonPath, reports, describeEnvironment())) {
+        fprintf(stderr, "Error: could not write %s\n", jsonPath);
+        return 1;
+    }
+    return 0;
+}
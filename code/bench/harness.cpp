@@ -0,0 +1,121 @@
+#include "bench/harness.h"
+#include "bench/alloc_counter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+using namespace std;
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Function to get the value below which the given share of samples fall
+static double percentile(const vector<double>& sorted, double share) {
+    size_t index = (size_t)(share * (sorted.size() - 1) + 0.5);
+    return sorted[min(index, sorted.size() - 1)];
+}
+
+BenchReport runBenchmark(const Benchmark& benchmark, const BenchOptions& options) {
+    BenchReport report;
+    report.name = benchmark.name;
+
+    // Warm up caches and lazily built tables, then size the batch
+    benchmark.run(1);
+    int64_t batch = 1;
+    while (!benchmark.singleOperation && batch < (1 << 30)) {
+        auto start = chrono::steady_clock::now();
+        benchmark.run(batch);
+        if (secondsSince(start) >= options.sampleTime) break;
+        batch *= 2;
+    }
+
+    // Reserved up front so the harness itself allocates nothing while measuring
+    vector<double> samples;
+    samples.reserve(options.maxSamples);
+    AllocationStats before = allocationStats();
+    auto runStart = chrono::steady_clock::now();
+    double measured = 0;
+    while ((int)samples.size() < options.maxSamples &&
+        ((int)samples.size() < options.minSamples || secondsSince(runStart) < options.minTime)) {
+        auto start = chrono::steady_clock::now();
+        benchmark.run(batch);
+        double seconds = secondsSince(start);
+        measured += seconds;
+        samples.push_back(seconds * 1e9 / batch);
+    }
+    AllocationStats after = allocationStats();
+
+    report.batch = batch;
+    report.samples = (int)samples.size();
+    report.operations = batch * report.samples;
+    report.nsPerOp = measured * 1e9 / report.operations;
+    report.opsPerSecond = report.operations / measured;
+    report.allocationsPerOp = (double)(after.count - before.count) / report.operations;
+    report.bytesPerOp = (double)(after.bytes - before.bytes) / report.operations;
+
+    sort(samples.begin(), samples.end());
+    report.p50 = percentile(samples, 0.50);
+    report.p90 = percentile(samples, 0.90);
+    report.p99 = percentile(samples, 0.99);
+    report.min = samples.front();
+    report.max = samples.back();
+    return report;
+}
+
+void printReport(const BenchReport& report, bool header) {
+    if (header) {
+        printf("%-34s %12s %14s %10s %10s %10s %10s\n",
+            "benchmark", "ns/op", "ops/s", "allocs/op", "p50 ns", "p90 ns", "p99 ns");
+    }
+    printf("%-34s %12.2f %14.0f %10.3f %10.2f %10.2f %10.2f\n", report.name.c_str(), report.nsPerOp,
+        report.opsPerSecond, report.allocationsPerOp, report.p50, report.p90, report.p99);
+}
+
+// Function to write a string as a JSON string literal
+static void writeJsonString(FILE* file, const string& text) {
+    fputc('"', file);
+    for (char ch : text) {
+        if (ch == '"' || ch == '\\') {
+            fputc('\\', file);
+            fputc(ch, file);
+        }
+        else if ((unsigned char)ch < 0x20) {
+            fprintf(file, "\\u%04x", ch);
+        }
+        else {
+            fputc(ch, file);
+        }
+    }
+    fputc('"', file);
+}
+
+bool writeJsonReport(const char* path, const vector<BenchReport>& reports,
+    const vector<pair<string, string>>& environment) {
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+
+    fprintf(file, "{\n  \"environment\": {");
+    for (size_t i = 0; i < environment.size(); i++) {
+        fprintf(file, "%s\n    ", i ? "," : "");
+        writeJsonString(file, environment[i].first);
+        fprintf(file, ": ");
+        writeJsonString(file, environment[i].second);
+    }
+    fprintf(file, "\n  },\n  \"benchmarks\": [");
+    for (size_t i = 0; i < reports.size(); i++) {
+        const BenchReport& report = reports[i];
+        fprintf(file, "%s\n    {\"name\": ", i ? "," : "");
+        writeJsonString(file, report.name);
+        fprintf(file, ", \"operations\": %lld, \"batch\": %lld, \"samples\": %d,"
+            " \"ns_per_op\": %.3f, \"ops_per_sec\": %.1f,"
+            " \"allocs_per_op\": %.4f, \"bytes_per_op\": %.2f,"
+            " \"p50_ns\": %.3f, \"p90_ns\": %.3f, \"p99_ns\": %.3f, \"min_ns\": %.3f, \"max_ns\": %.3f}",
+            (long long)report.operations, (long long)report.batch, report.samples,
+            report.nsPerOp, report.opsPerSecond, report.allocationsPerOp, report.bytesPerOp,
+            report.p50, report.p90, report.p99, report.min, report.max);
+    }
+    fprintf(file, "\n  ]\n}\n");
+    return fclose(file) == 0;
+}
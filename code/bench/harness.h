@@ -0,0 +1,68 @@
+#pragma once
+
+// Minimal benchmark harness for numbrainer_bench.
+//
+// A benchmark is a function that performs a given number of operations. The
+// harness grows that number until one call (a sample) takes long enough to
+// time reliably, then keeps taking samples until the minimum run time is
+// reached. Reported latencies are per operation: the percentiles are taken
+// over the samples, each averaged over its batch, so for micro benchmarks
+// they describe batches of operations, and for macro benchmarks (batch 1)
+// single operations.
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct Benchmark {
+    std::string name;
+    std::function<void(int64_t operations)> run;
+    bool singleOperation = false;   // Never batch (each operation is already long)
+};
+
+struct BenchOptions {
+    double minTime = 0.5;           // Seconds of samples per benchmark
+    double sampleTime = 50e-6;      // Target length of one sample
+    int minSamples = 10;
+    int maxSamples = 100000;
+};
+
+struct BenchReport {
+    std::string name;
+    int64_t operations = 0;
+    int64_t batch = 0;
+    int samples = 0;
+    double nsPerOp = 0;
+    double opsPerSecond = 0;
+    double allocationsPerOp = 0;
+    double bytesPerOp = 0;
+    double p50 = 0;     // Percentile latencies in ns per operation
+    double p90 = 0;
+    double p99 = 0;
+    double min = 0;
+    double max = 0;
+};
+
+// Function to run one benchmark
+BenchReport runBenchmark(const Benchmark& benchmark, const BenchOptions& options);
+
+// Function to print a report as one table row (prints the header if asked)
+void printReport(const BenchReport& report, bool header);
+
+// Function to write every report as JSON, with enough about the build and
+// machine to tell runs apart when diffing them
+bool writeJsonReport(const char* path, const std::vector<BenchReport>& reports,
+    const std::vector<std::pair<std::string, std::string>>& environment);
+
+// Function to keep a value alive so the optimizer cannot drop the work
+// that produced it
+template <class T>
+inline void keepAlive(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
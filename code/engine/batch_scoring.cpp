@@ -0,0 +1,276 @@
+#include "engine/batch_scoring.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define NUMBRAINER_X86 1
+#endif
+
+#if defined(NUMBRAINER_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define NUMBRAINER_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// The AVX2 path is compiled with a per-function target attribute (MSVC needs
+// none), so the rest of the build keeps its baseline instruction set
+#if defined(NUMBRAINER_X86) && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+#define NUMBRAINER_HAVE_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+using namespace std;
+
+// Scalar reference: rebuild each packed code and run the packed_code.h kernel.
+// out (when not null) is indexed from outOffset so the SIMD paths can hand
+// over their tail. Four interleaved sub-histograms keep runs of equal
+// outcomes from serializing on the same counter.
+static void scoreRangeScalar(PackedCode guess, const uint16_t* nibbles, const uint16_t* masks,
+    size_t count, Feedback* out, uint32_t histogram[FEEDBACK_COUNT], size_t outOffset = 0) {
+    uint32_t counts[4][16] = {};
+    for (size_t i = 0; i < count; i++) {
+        PackedCode code = (PackedCode)nibbles[i] | ((PackedCode)masks[i] << CODE_DIGIT_SHIFT);
+        Feedback feedback = scoreCodes(guess, code);
+        if (out) out[outOffset + i] = feedback;
+        counts[i & 3][feedback]++;
+    }
+    for (int f = 0; f < FEEDBACK_COUNT; f++) {
+        histogram[f] += counts[0][f] + counts[1][f] + counts[2][f] + counts[3][f];
+    }
+}
+
+#if defined(NUMBRAINER_HAVE_SSE2)
+
+// Feedback of 8 candidates in 16-bit lanes: SWAR popcount of the common
+// digit mask, nibble-equality count of the positions, then makeFeedback()
+static inline __m128i feedback8SSE2(__m128i nibbles, __m128i masks, __m128i guessNibbles, __m128i guessMask) {
+    const __m128i m55 = _mm_set1_epi16(0x5555);
+    const __m128i m33 = _mm_set1_epi16(0x3333);
+    const __m128i m0F = _mm_set1_epi16(0x0F0F);
+
+    __m128i x = _mm_and_si128(masks, guessMask);
+    x = _mm_sub_epi16(x, _mm_and_si128(_mm_srli_epi16(x, 1), m55));
+    x = _mm_add_epi16(_mm_and_si128(x, m33), _mm_and_si128(_mm_srli_epi16(x, 2), m33));
+    x = _mm_and_si128(_mm_add_epi16(x, _mm_srli_epi16(x, 4)), m0F);
+    __m128i digits = _mm_and_si128(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), _mm_set1_epi16(0x1F));
+
+    __m128i diff = _mm_xor_si128(nibbles, guessNibbles);
+    diff = _mm_or_si128(diff, _mm_srli_epi16(diff, 1));
+    diff = _mm_or_si128(diff, _mm_srli_epi16(diff, 2));
+    diff = _mm_and_si128(diff, _mm_set1_epi16(0x1111));
+    diff = _mm_add_epi16(diff, _mm_srli_epi16(diff, 4));
+    diff = _mm_add_epi16(diff, _mm_srli_epi16(diff, 8));
+    __m128i positions = _mm_sub_epi16(_mm_set1_epi16(CODE_LENGTH), _mm_and_si128(diff, _mm_set1_epi16(7)));
+
+    __m128i triangle = _mm_srli_epi16(_mm_mullo_epi16(digits, _mm_add_epi16(digits, _mm_set1_epi16(1))), 1);
+    __m128i solved = _mm_srli_epi16(_mm_and_si128(digits, positions), 2);
+    return _mm_sub_epi16(_mm_add_epi16(triangle, positions), solved);
+}
+
+// Function to add per-byte outcome counters into the histogram
+static inline void flushCountersSSE2(__m128i counters[FEEDBACK_COUNT], uint32_t histogram[FEEDBACK_COUNT]) {
+    for (int f = 0; f < FEEDBACK_COUNT; f++) {
+        __m128i sums = _mm_sad_epu8(counters[f], _mm_setzero_si128());
+        histogram[f] += (uint32_t)(_mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+        counters[f] = _mm_setzero_si128();
+    }
+}
+
+// Scores 16 candidates per iteration. The histogram is kept in registers as
+// one byte counter per lane and outcome (compare + subtract), flushed before
+// a counter can wrap at 255.
+static void scoreRangeSSE2(PackedCode guess, const uint16_t* nibbles, const uint16_t* masks,
+    size_t count, Feedback* out, uint32_t histogram[FEEDBACK_COUNT]) {
+    const __m128i guessNibbles = _mm_set1_epi16((short)(guess & CODE_NIBBLE_MASK));
+    const __m128i guessMask = _mm_set1_epi16((short)(guess >> CODE_DIGIT_SHIFT));
+    __m128i counters[FEEDBACK_COUNT];
+    for (int f = 0; f < FEEDBACK_COUNT; f++) counters[f] = _mm_setzero_si128();
+
+    size_t i = 0;
+    int pending = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i low = feedback8SSE2(_mm_loadu_si128((const __m128i*)(nibbles + i)),
+            _mm_loadu_si128((const __m128i*)(masks + i)), guessNibbles, guessMask);
+        __m128i high = feedback8SSE2(_mm_loadu_si128((const __m128i*)(nibbles + i + 8)),
+            _mm_loadu_si128((const __m128i*)(masks + i + 8)), guessNibbles, guessMask);
+        __m128i feedback = _mm_packus_epi16(low, high);
+        if (out) _mm_storeu_si128((__m128i*)(out + i), feedback);
+        for (int f = 0; f < FEEDBACK_COUNT; f++) {
+            counters[f] = _mm_sub_epi8(counters[f], _mm_cmpeq_epi8(feedback, _mm_set1_epi8((char)f)));
+        }
+        if (++pending == 255) {
+            flushCountersSSE2(counters, histogram);
+            pending = 0;
+        }
+    }
+    flushCountersSSE2(counters, histogram);
+    scoreRangeScalar(guess, nibbles + i, masks + i, count - i, out, histogram, i);
+}
+
+#endif
+
+#if defined(NUMBRAINER_HAVE_AVX2)
+
+// Same kernel as feedback8SSE2, 16 candidates per register
+TARGET_AVX2 static inline __m256i feedback16AVX2(__m256i nibbles, __m256i masks, __m256i guessNibbles, __m256i guessMask) {
+    const __m256i m55 = _mm256_set1_epi16(0x5555);
+    const __m256i m33 = _mm256_set1_epi16(0x3333);
+    const __m256i m0F = _mm256_set1_epi16(0x0F0F);
+
+    __m256i x = _mm256_and_si256(masks, guessMask);
+    x = _mm256_sub_epi16(x, _mm256_and_si256(_mm256_srli_epi16(x, 1), m55));
+    x = _mm256_add_epi16(_mm256_and_si256(x, m33), _mm256_and_si256(_mm256_srli_epi16(x, 2), m33));
+    x = _mm256_and_si256(_mm256_add_epi16(x, _mm256_srli_epi16(x, 4)), m0F);
+    __m256i digits = _mm256_and_si256(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), _mm256_set1_epi16(0x1F));
+
+    __m256i diff = _mm256_xor_si256(nibbles, guessNibbles);
+    diff = _mm256_or_si256(diff, _mm256_srli_epi16(diff, 1));
+    diff = _mm256_or_si256(diff, _mm256_srli_epi16(diff, 2));
+    diff = _mm256_and_si256(diff, _mm256_set1_epi16(0x1111));
+    diff = _mm256_add_epi16(diff, _mm256_srli_epi16(diff, 4));
+    diff = _mm256_add_epi16(diff, _mm256_srli_epi16(diff, 8));
+    __m256i positions = _mm256_sub_epi16(_mm256_set1_epi16(CODE_LENGTH), _mm256_and_si256(diff, _mm256_set1_epi16(7)));
+
+    __m256i triangle = _mm256_srli_epi16(_mm256_mullo_epi16(digits, _mm256_add_epi16(digits, _mm256_set1_epi16(1))), 1);
+    __m256i solved = _mm256_srli_epi16(_mm256_and_si256(digits, positions), 2);
+    return _mm256_sub_epi16(_mm256_add_epi16(triangle, positions), solved);
+}
+
+TARGET_AVX2 static inline void flushCountersAVX2(__m256i counters[FEEDBACK_COUNT], uint32_t histogram[FEEDBACK_COUNT]) {
+    for (int f = 0; f < FEEDBACK_COUNT; f++) {
+        __m256i sums = _mm256_sad_epu8(counters[f], _mm256_setzero_si256());
+        __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+        histogram[f] += (uint32_t)(_mm_cvtsi128_si32(half) + _mm_cvtsi128_si32(_mm_srli_si128(half, 8)));
+        counters[f] = _mm256_setzero_si256();
+    }
+}
+
+// Scores 32 candidates per iteration, histogram as in scoreRangeSSE2
+TARGET_AVX2 static void scoreRangeAVX2(PackedCode guess, const uint16_t* nibbles, const uint16_t* masks,
+    size_t count, Feedback* out, uint32_t histogram[FEEDBACK_COUNT]) {
+    const __m256i guessNibbles = _mm256_set1_epi16((short)(guess & CODE_NIBBLE_MASK));
+    const __m256i guessMask = _mm256_set1_epi16((short)(guess >> CODE_DIGIT_SHIFT));
+    __m256i counters[FEEDBACK_COUNT];
+    for (int f = 0; f < FEEDBACK_COUNT; f++) counters[f] = _mm256_setzero_si256();
+
+    size_t i = 0;
+    int pending = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i low = feedback16AVX2(_mm256_loadu_si256((const __m256i*)(nibbles + i)),
+            _mm256_loadu_si256((const __m256i*)(masks + i)), guessNibbles, guessMask);
+        __m256i high = feedback16AVX2(_mm256_loadu_si256((const __m256i*)(nibbles + i + 16)),
+            _mm256_loadu_si256((const __m256i*)(masks + i + 16)), guessNibbles, guessMask);
+        // packus works per 128-bit half; put the four 8-byte groups back in order
+        __m256i feedback = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8);
+        if (out) _mm256_storeu_si256((__m256i*)(out + i), feedback);
+        for (int f = 0; f < FEEDBACK_COUNT; f++) {
+            counters[f] = _mm256_sub_epi8(counters[f], _mm256_cmpeq_epi8(feedback, _mm256_set1_epi8((char)f)));
+        }
+        if (++pending == 255) {
+            flushCountersAVX2(counters, histogram);
+            pending = 0;
+        }
+    }
+    flushCountersAVX2(counters, histogram);
+    scoreRangeScalar(guess, nibbles + i, masks + i, count - i, out, histogram, i);
+}
+
+#endif
+
+static bool cpuHasAVX2() {
+#if defined(NUMBRAINER_HAVE_AVX2) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28));
+    if (!osSavesYmm || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(NUMBRAINER_HAVE_AVX2)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+bool isScoringPathSupported(ScoringPath path) {
+    switch (path) {
+    case ScoringPath::Scalar:
+        return true;
+    case ScoringPath::SSE2:
+#if defined(NUMBRAINER_HAVE_SSE2)
+        return true;
+#else
+        return false;
+#endif
+    case ScoringPath::AVX2: {
+        static const bool hasAVX2 = cpuHasAVX2();
+        return hasAVX2;
+    }
+    }
+    return false;
+}
+
+const char* scoringPathName(ScoringPath path) {
+    switch (path) {
+    case ScoringPath::Scalar: return "scalar";
+    case ScoringPath::SSE2: return "sse2";
+    case ScoringPath::AVX2: return "avx2";
+    }
+    return "unknown";
+}
+
+static ScoringPath pickScoringPath() {
+    const char* forced = getenv("NUMBRAINER_SCORING");
+    if (forced && *forced) {
+        for (ScoringPath path : { ScoringPath::Scalar, ScoringPath::SSE2, ScoringPath::AVX2 }) {
+            if (strcmp(forced, scoringPathName(path)) == 0 && isScoringPathSupported(path)) return path;
+        }
+    }
+    if (isScoringPathSupported(ScoringPath::AVX2)) return ScoringPath::AVX2;
+    if (isScoringPathSupported(ScoringPath::SSE2)) return ScoringPath::SSE2;
+    return ScoringPath::Scalar;
+}
+
+ScoringPath activeScoringPath() {
+    static const ScoringPath path = pickScoringPath();
+    return path;
+}
+
+void scoreCandidatesWith(ScoringPath path, PackedCode guess, const CandidateBuffer& candidates,
+    Feedback* feedback, uint32_t histogram[FEEDBACK_COUNT]) {
+    if (!isScoringPathSupported(path)) path = ScoringPath::Scalar;
+    for (int f = 0; f < FEEDBACK_COUNT; f++) histogram[f] = 0;
+
+    const uint16_t* nibbles = candidates.nibbles.data();
+    const uint16_t* masks = candidates.masks.data();
+    const size_t count = candidates.size();
+    switch (path) {
+#if defined(NUMBRAINER_HAVE_AVX2)
+    case ScoringPath::AVX2:
+        scoreRangeAVX2(guess, nibbles, masks, count, feedback, histogram);
+        return;
+#endif
+#if defined(NUMBRAINER_HAVE_SSE2)
+    case ScoringPath::SSE2:
+        scoreRangeSSE2(guess, nibbles, masks, count, feedback, histogram);
+        return;
+#endif
+    default:
+        scoreRangeScalar(guess, nibbles, masks, count, feedback, histogram);
+        return;
+    }
+}
+
+void scoreCandidates(PackedCode guess, const CandidateBuffer& candidates,
+    Feedback* feedback, uint32_t histogram[FEEDBACK_COUNT]) {
+    scoreCandidatesWith(activeScoringPath(), guess, candidates, feedback, histogram);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+// Score one guess against a whole buffer of candidate secrets.
+//
+// Candidates are stored structure-of-arrays: the position nibbles and the
+// digit-presence masks of the packed codes live in two separate 16-bit
+// arrays, so a SIMD register holds 8 (SSE2) or 16 (AVX2) candidates and the
+// packed_code.h kernel runs on all of them at once. The best path the CPU
+// supports is picked at runtime; the scalar path is the reference.
+
+#include "engine/code_space.h"
+
+#include <cstddef>
+#include <vector>
+
+struct CandidateBuffer {
+    std::vector<uint16_t> nibbles;     // Bits 0..15 of each packed code
+    std::vector<uint16_t> masks;       // Digit-presence mask of each code
+    std::vector<CodeIndex> indices;    // Code space index of each candidate
+
+    size_t size() const { return indices.size(); }
+    bool empty() const { return indices.empty(); }
+
+    void clear() {
+        nibbles.clear();
+        masks.clear();
+        indices.clear();
+    }
+
+    void push(CodeIndex index) {
+        PackedCode code = codeAt(index);
+        nibbles.push_back((uint16_t)(code & CODE_NIBBLE_MASK));
+        masks.push_back((uint16_t)(code >> CODE_DIGIT_SHIFT));
+        indices.push_back(index);
+    }
+
+    // Function to fill the buffer with the whole code space
+    void fillAll() {
+        clear();
+        for (int i = 0; i < CODE_COUNT; i++) push((CodeIndex)i);
+    }
+};
+
+enum class ScoringPath {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+// Function to get the fastest path this CPU supports. NUMBRAINER_SCORING
+// (scalar, sse2 or avx2) can force a slower one for testing.
+ScoringPath activeScoringPath();
+
+const char* scoringPathName(ScoringPath path);
+
+// Function to check whether a path can run on this CPU
+bool isScoringPathSupported(ScoringPath path);
+
+// Function to score a guess against every candidate. feedback receives one
+// byte per candidate (it may be nullptr when only the histogram is wanted);
+// histogram receives how many candidates gave each of the FEEDBACK_COUNT
+// outcomes and is overwritten, not accumulated.
+void scoreCandidates(PackedCode guess, const CandidateBuffer& candidates,
+    Feedback* feedback, uint32_t histogram[FEEDBACK_COUNT]);
+
+// Same, on an explicit path (benchmarks and cross-checks). Falls back to the
+// scalar path when the requested one is not supported.
+void scoreCandidatesWith(ScoringPath path, PackedCode guess, const CandidateBuffer& candidates,
+    Feedback* feedback, uint32_t histogram[FEEDBACK_COUNT]);
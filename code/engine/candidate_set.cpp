@@ -0,0 +1,110 @@
+#include "engine/candidate_set.h"
+#include "engine/feedback_table.h"
+#include "engine/opening_book.h"
+
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+// Function to find the lowest set bit of a non-zero word
+static inline int lowestBit(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return (int)index;
+#else
+    int index = 0;
+    while (!(word & 1)) {
+        word >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+void CandidateSet::reset() {
+    memset(words_, 0xFF, sizeof(words_));
+    // Clear the padding bits past the last code
+    const int usedBits = CODE_COUNT - (WORD_COUNT - 1) * 64;
+    words_[WORD_COUNT - 1] = usedBits == 64 ? ~0ull : ((1ull << usedBits) - 1);
+    count_ = CODE_COUNT;
+    bookNode_ = BOOK_ROOT;
+    undo_.clear();
+}
+
+void CandidateSet::applyGuess(PackedCode guess, Feedback feedback) {
+    Snapshot snapshot;
+    memcpy(snapshot.words, words_, sizeof(words_));
+    snapshot.count = count_;
+    snapshot.bookNode = bookNode_;
+    undo_.push_back(snapshot);
+    bookNode_ = sharedOpeningBook().follow(bookNode_, codeIndex(guess), feedback);
+
+    // With the table mapped each candidate costs one load from the guess row
+    const Feedback* row = sharedFeedbackTable().row(codeIndex(guess));
+    int removed = 0;
+    for (int w = 0; w < WORD_COUNT; w++) {
+        uint64_t bits = words_[w];
+        uint64_t keep = bits;
+        while (bits) {
+            int bit = lowestBit(bits);
+            bits &= bits - 1;
+            int index = w * 64 + bit;
+            Feedback actual = row ? row[index] : scoreCodes(guess, codeAt((CodeIndex)index));
+            if (actual != feedback) {
+                keep &= ~(1ull << bit);
+                removed++;
+            }
+        }
+        words_[w] = keep;
+    }
+    count_ -= removed;
+}
+
+bool CandidateSet::undoLastGuess() {
+    if (undo_.empty()) return false;
+    const Snapshot& snapshot = undo_.back();
+    memcpy(words_, snapshot.words, sizeof(words_));
+    count_ = snapshot.count;
+    bookNode_ = snapshot.bookNode;
+    undo_.pop_back();
+    return true;
+}
+
+void CandidateSet::appendTo(CandidateBuffer& buffer) const {
+    for (int w = 0; w < WORD_COUNT; w++) {
+        uint64_t bits = words_[w];
+        while (bits) {
+            buffer.push((CodeIndex)(w * 64 + lowestBit(bits)));
+            bits &= bits - 1;
+        }
+    }
+}
+
+int CandidateSet::first() const {
+    for (int w = 0; w < WORD_COUNT; w++) {
+        if (words_[w]) return w * 64 + lowestBit(words_[w]);
+    }
+    return -1;
+}
+
+int CandidateSet::nth(int rank) const {
+    if (rank < 0 || rank >= count_) return -1;
+    for (int w = 0; w < WORD_COUNT; w++) {
+        uint64_t bits = words_[w];
+        int inWord = popCount((uint32_t)bits) + popCount((uint32_t)(bits >> 32));
+        if (rank >= inWord) {
+            rank -= inWord;
+            continue;
+        }
+        while (rank-- > 0) bits &= bits - 1;
+        return w * 64 + lowestBit(bits);
+    }
+    return -1;
+}
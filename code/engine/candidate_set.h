@@ -0,0 +1,66 @@
+#pragma once
+
+// Secrets a guesser could still be facing, as one bit per classic code.
+//
+// Each scored guess clears the codes that would have produced different
+// feedback. Only codes still in the set are rescored, so an update costs
+// O(remaining candidates) instead of replaying the whole history, and the
+// count is kept up to date so reading it is free. The state before every
+// guess is kept on a small stack so the last guess can be undone.
+
+#include "engine/batch_scoring.h"
+#include "engine/code_space.h"
+
+#include <vector>
+
+class CandidateSet {
+public:
+    static const int WORD_COUNT = (CODE_COUNT + 63) / 64;
+
+    CandidateSet() { reset(); }
+
+    // Function to go back to the full code space and forget all guesses
+    void reset();
+
+    int count() const { return count_; }
+    bool contains(CodeIndex index) const { return (words_[index >> 6] >> (index & 63)) & 1; }
+
+    // Number of guesses applied (and available to undo)
+    int guessCount() const { return (int)undo_.size(); }
+
+    // Function to make room for this many guesses, so applying them never allocates
+    void reserveGuesses(int count) { undo_.reserve(count); }
+
+    // Function to keep only the secrets that give this feedback for the guess
+    void applyGuess(PackedCode guess, Feedback feedback);
+
+    // Function to restore the set from before the last applied guess
+    bool undoLastGuess();
+
+    // Function to append every remaining code to a candidate buffer
+    void appendTo(CandidateBuffer& buffer) const;
+
+    // Function to get the remaining code with the lowest index (-1 when empty)
+    int first() const;
+
+    // Function to get the remaining code of the given rank, counting from the
+    // lowest index at 0 (-1 when rank >= count()); a random rank draws a
+    // uniformly random candidate without listing them
+    int nth(int rank) const;
+
+    // Opening book node reached by the guesses so far (BOOK_OUT once a guess
+    // has left the book)
+    uint32_t bookNode() const { return bookNode_; }
+
+private:
+    struct Snapshot {
+        uint64_t words[WORD_COUNT];
+        int count;
+        uint32_t bookNode;
+    };
+
+    uint64_t words_[WORD_COUNT];
+    int count_ = 0;
+    uint32_t bookNode_ = 0;
+    std::vector<Snapshot> undo_;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+// The classic code space: every 4-digit number without repeated digits,
+// numbered 0..5039 in increasing numeric order ("0123" is 0, "9876" is 5039).
+// Tables, candidate sets and bots index codes by this number.
+
+#include "engine/packed_code.h"
+
+#include <array>
+
+const int CODE_COUNT = 10 * 9 * 8 * 7;
+
+typedef uint16_t CodeIndex;
+
+// Function to list every valid code in index order (evaluated at compile time)
+constexpr std::array<PackedCode, CODE_COUNT> makeCodeList() {
+    std::array<PackedCode, CODE_COUNT> codes = {};
+    int count = 0;
+    for (int d0 = 0; d0 < 10; d0++) {
+        for (int d1 = 0; d1 < 10; d1++) {
+            if (d1 == d0) continue;
+            for (int d2 = 0; d2 < 10; d2++) {
+                if (d2 == d0 || d2 == d1) continue;
+                for (int d3 = 0; d3 < 10; d3++) {
+                    if (d3 == d0 || d3 == d1 || d3 == d2) continue;
+                    codes[count++] = packDigits(d0, d1, d2, d3);
+                }
+            }
+        }
+    }
+    return codes;
+}
+
+inline constexpr std::array<PackedCode, CODE_COUNT> ALL_CODES = makeCodeList();
+
+inline PackedCode codeAt(CodeIndex index) {
+    return ALL_CODES[index];
+}
+
+// Function to find a valid code's index. Each digit is ranked among the
+// digits not used by earlier positions (d - number of smaller used digits),
+// then the ranks are combined in the mixed radix 9*8*7, 8*7, 7, 1.
+inline CodeIndex codeIndex(PackedCode code) {
+    int d0 = codeDigit(code, 0);
+    int d1 = codeDigit(code, 1);
+    int d2 = codeDigit(code, 2);
+    int d3 = codeDigit(code, 3);
+    uint32_t used = 1u << d0;
+    int r1 = d1 - popCount(used & ((1u << d1) - 1));
+    used |= 1u << d1;
+    int r2 = d2 - popCount(used & ((1u << d2) - 1));
+    used |= 1u << d2;
+    int r3 = d3 - popCount(used & ((1u << d3) - 1));
+    return (CodeIndex)(d0 * 504 + r1 * 56 + r2 * 7 + r3);
+}
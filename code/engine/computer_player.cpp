@@ -0,0 +1,95 @@
+#include "engine/computer_player.h"
+
+#include <utility>
+
+using namespace std;
+
+// The computer never uses more than this share of the time left in a turn
+static const double MAX_TURN_SHARE = 0.25;
+
+DifficultySettings difficultySettings(Difficulty difficulty) {
+    switch (difficulty) {
+    case Difficulty::Easy:
+        return { 0.005, HintMode::Minimax, true, false };
+    case Difficulty::Hard:
+        return { 0.5, HintMode::Entropy, false, true };
+    default:
+        return { 0.05, HintMode::Minimax, false, false };
+    }
+}
+
+const char* difficultyName(Difficulty difficulty) {
+    switch (difficulty) {
+    case Difficulty::Easy:
+        return "Easy";
+    case Difficulty::Hard:
+        return "Hard";
+    default:
+        return "Normal";
+    }
+}
+
+ComputerPlayer::ComputerPlayer(unsigned seed) : random_(seed) {
+}
+
+PackedCode ComputerPlayer::chooseSecret(const GameVariant& variant) {
+    if (variant.isClassic()) {
+        uniform_int_distribution<int> pick(0, CODE_COUNT - 1);
+        return ALL_CODES[pick(random_)];
+    }
+
+    // Draw digits one position at a time; without repeats each draw is from
+    // the digits not used yet, which keeps every code equally likely
+    int digits[MAX_VARIANT_BASE];
+    for (int i = 0; i < variant.base; i++) digits[i] = i;
+    VariantCode code = 0;
+    for (int i = 0; i < variant.length; i++) {
+        int available = variant.repeats ? variant.base : variant.base - i;
+        int j = uniform_int_distribution<int>(0, available - 1)(random_);
+        code |= (VariantCode)digits[j] << (4 * i);
+        if (!variant.repeats) swap(digits[j], digits[available - 1]);
+    }
+    return code;
+}
+
+PackedCode ComputerPlayer::chooseVariantGuess(const VariantCandidates& candidates) {
+    VariantCode guess;
+    if (candidates.findConsistent((unsigned)random_(), guess)) return guess;
+    return chooseSecret(candidates.variant());
+}
+
+void ComputerPlayer::startThinking(const CandidateSet& candidates, double turnTimeLeft) {
+    DifficultySettings settings = difficultySettings(difficulty_);
+    double budget = settings.thinkBudget;
+    if (budget > turnTimeLeft * MAX_TURN_SHARE) budget = turnTimeLeft * MAX_TURN_SHARE;
+    // A zero budget would mean "no deadline", so keep a token one
+    if (budget < 0.001) budget = 0.001;
+
+    HintOptions options;
+    options.timeBudget = budget;
+    options.candidatesOnly = settings.candidatesOnly;
+    options.useBook = settings.useBook;
+    search_.start(candidates, settings.mode, options);
+    thinking_ = true;
+}
+
+bool ComputerPlayer::pollGuess(PackedCode& guess) {
+    if (!thinking_ || search_.isRunning()) return false;
+    thinking_ = false;
+
+    HintResult result = search_.best();
+    if (result.found) {
+        guess = codeAt(result.guess);
+    }
+    else {
+        // Only reachable if the feedback contradicted itself; any code will do
+        uniform_int_distribution<int> pick(0, CODE_COUNT - 1);
+        guess = ALL_CODES[pick(random_)];
+    }
+    return true;
+}
+
+void ComputerPlayer::stop() {
+    search_.cancel();
+    thinking_ = false;
+}
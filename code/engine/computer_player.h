@@ -0,0 +1,69 @@
+#pragma once
+
+// Computer opponent for single-player games.
+//
+// The secret is drawn uniformly from the whole code space. Each guess comes
+// from a HintSearch over the computer's own candidate set, cut off after the
+// difficulty's think budget; the search runs on the thread pool and is only
+// polled, so the render loop never waits for it.
+//
+// Other game variants have no search: the computer plays some code that
+// agrees with all the feedback it has had, whatever the difficulty.
+
+#include "engine/candidate_set.h"
+#include "engine/hint_engine.h"
+#include "engine/variant_candidates.h"
+
+#include <random>
+
+enum class Difficulty {
+    Easy,       // 5 ms, only guesses codes that could still be the secret
+    Normal,     // 50 ms, minimax over every code
+    Hard        // Opening book, then 500 ms of expected entropy over every code
+};
+
+struct DifficultySettings {
+    double thinkBudget;     // Seconds of search per move
+    HintMode mode;
+    bool candidatesOnly;    // Guess only among the remaining candidates
+    bool useBook;           // Play the opening book while the game stays in it
+};
+
+// Function to get the search settings behind a difficulty level
+DifficultySettings difficultySettings(Difficulty difficulty);
+
+const char* difficultyName(Difficulty difficulty);
+
+class ComputerPlayer {
+public:
+    explicit ComputerPlayer(unsigned seed = std::random_device{}());
+
+    void setDifficulty(Difficulty difficulty) { difficulty_ = difficulty; }
+    Difficulty difficulty() const { return difficulty_; }
+
+    // Function to pick a secret uniformly from every valid code
+    PackedCode chooseSecret(const GameVariant& variant = GameVariant());
+
+    // Function to pick the next guess in a non-classic variant (a random
+    // consistent code, or any code if none turns up quickly)
+    PackedCode chooseVariantGuess(const VariantCandidates& candidates);
+
+    // Function to start searching for the next guess. The budget is the
+    // difficulty's, capped to a fraction of the time left in the turn.
+    void startThinking(const CandidateSet& candidates, double turnTimeLeft);
+
+    bool isThinking() const { return thinking_; }
+
+    // Function to collect the guess once the search has stopped; returns
+    // false, without blocking, while it is still running
+    bool pollGuess(PackedCode& guess);
+
+    // Function to abandon the current search
+    void stop();
+
+private:
+    HintSearch search_;
+    std::mt19937 random_;
+    Difficulty difficulty_ = Difficulty::Normal;
+    bool thinking_ = false;
+};
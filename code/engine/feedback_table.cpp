@@ -0,0 +1,110 @@
+#include "engine/feedback_table.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const size_t TABLE_ENTRIES = (size_t)CODE_COUNT * CODE_COUNT;
+
+bool FeedbackTable::open(const char* path) {
+    entries_ = nullptr;
+    if (!file_.open(path)) return false;
+
+    FeedbackTableHeader header;
+    if (file_.size() < sizeof(header)) {
+        file_.close();
+        return false;
+    }
+    memcpy(&header, file_.data(), sizeof(header));
+    if (memcmp(header.magic, FEEDBACK_TABLE_MAGIC, 4) != 0 ||
+        header.version != FEEDBACK_TABLE_VERSION ||
+        header.codeCount != (uint32_t)CODE_COUNT ||
+        header.headerSize < sizeof(header) ||
+        file_.size() != header.headerSize + TABLE_ENTRIES) {
+        file_.close();
+        return false;
+    }
+    const Feedback* entries = file_.data() + header.headerSize;
+
+    // Spot-check a few pairs instead of hashing 25 MB at startup; a stale or
+    // foreign file almost surely fails one of these
+    unsigned seed = 2463534242u;
+    for (int i = 0; i < 16; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        CodeIndex guess = (CodeIndex)(seed % CODE_COUNT);
+        CodeIndex secret = (CodeIndex)((seed >> 16) % CODE_COUNT);
+        if (entries[(size_t)guess * CODE_COUNT + secret] != scoreCodes(codeAt(guess), codeAt(secret))) {
+            file_.close();
+            return false;
+        }
+    }
+
+    entries_ = entries;
+    return true;
+}
+
+static FeedbackTable* openSharedTable() {
+    static FeedbackTable table;
+    const char* path = getenv("NUMBRAINER_FEEDBACK_TABLE");
+    table.open(path && *path ? path : DEFAULT_FEEDBACK_TABLE_PATH);
+    return &table;
+}
+
+const FeedbackTable& sharedFeedbackTable() {
+    static const FeedbackTable* table = openSharedTable();  // Thread-safe one-time init
+    return *table;
+}
+
+bool writeFeedbackTable(const char* path) {
+    string tempPath = string(path) + ".tmp";
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file) return false;
+
+    FeedbackTableHeader header;
+    memcpy(header.magic, FEEDBACK_TABLE_MAGIC, 4);
+    header.version = FEEDBACK_TABLE_VERSION;
+    header.codeCount = CODE_COUNT;
+    header.headerSize = sizeof(header);
+    header.checksum = 0;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    // One guess row at a time keeps the generator's memory use small
+    vector<Feedback> row(CODE_COUNT);
+    uint64_t checksum = FNV_OFFSET;
+    for (int guess = 0; guess < CODE_COUNT && ok; guess++) {
+        PackedCode guessCode = codeAt((CodeIndex)guess);
+        for (int secret = 0; secret < CODE_COUNT; secret++) {
+            row[secret] = scoreCodes(guessCode, codeAt((CodeIndex)secret));
+        }
+        checksum = fnv1a(checksum, row.data(), row.size());
+        ok = fwrite(row.data(), 1, row.size(), file) == row.size();
+    }
+
+    header.checksum = checksum;
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        remove(tempPath.c_str());
+        return false;
+    }
+    remove(path);  // rename() does not replace an existing file on Windows
+    return rename(tempPath.c_str(), path) == 0;
+}
+
+bool verifyFeedbackTable(const FeedbackTable& table) {
+    if (!table.isMapped()) return false;
+    for (int guess = 0; guess < CODE_COUNT; guess++) {
+        const Feedback* row = table.row((CodeIndex)guess);
+        PackedCode guessCode = codeAt((CodeIndex)guess);
+        for (int secret = 0; secret < CODE_COUNT; secret++) {
+            if (row[secret] != scoreCodes(guessCode, codeAt((CodeIndex)secret))) return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+// All-pairs feedback table for the classic code space.
+//
+// Entry [guess * CODE_COUNT + secret] is the Feedback byte for that pair, so a
+// full table is 5040 * 5040 bytes (about 25 MB). The table is produced by the
+// numbrainer_tablegen build step and mapped read-only at runtime; when the
+// file is missing or does not match this build, score() computes the result
+// instead, so callers never have to care which path they are on.
+
+#include "engine/code_space.h"
+#include "engine/mapped_file.h"
+
+// On-disk layout: this header, then CODE_COUNT * CODE_COUNT feedback bytes.
+// Bump the version whenever the Feedback numbering or code order changes.
+const char FEEDBACK_TABLE_MAGIC[4] = { 'N', 'B', 'F', 'T' };
+const uint32_t FEEDBACK_TABLE_VERSION = 1;
+
+struct FeedbackTableHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t codeCount;
+    uint32_t headerSize;    // Offset of the first feedback byte
+    uint64_t checksum;      // FNV-1a over the feedback bytes
+};
+
+// File name used when no path is given; NUMBRAINER_FEEDBACK_TABLE overrides it
+const char DEFAULT_FEEDBACK_TABLE_PATH[] = "feedback_table.bin";
+
+class FeedbackTable {
+public:
+    // Function to map a table file; false means score() keeps computing
+    bool open(const char* path);
+
+    bool isMapped() const { return entries_ != nullptr; }
+
+    Feedback score(CodeIndex guess, CodeIndex secret) const {
+        if (entries_) return entries_[(size_t)guess * CODE_COUNT + secret];
+        return scoreCodes(codeAt(guess), codeAt(secret));
+    }
+
+    // Row of CODE_COUNT feedback bytes for one guess, or nullptr when unmapped
+    const Feedback* row(CodeIndex guess) const {
+        return entries_ ? entries_ + (size_t)guess * CODE_COUNT : nullptr;
+    }
+
+private:
+    MappedFile file_;
+    const Feedback* entries_ = nullptr;
+};
+
+// Function to get the process-wide table, mapped from the default path on
+// first use
+const FeedbackTable& sharedFeedbackTable();
+
+// Function to generate a table file (what the build step runs). Writes to a
+// temporary name and renames it, so readers never see a partial file.
+bool writeFeedbackTable(const char* path);
+
+// Function to check every entry of a mapped table against the scoring kernel
+bool verifyFeedbackTable(const FeedbackTable& table);
@@ -0,0 +1,38 @@
+#include "engine/frame_arena.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+
+using namespace std;
+
+FrameArena::FrameArena(size_t capacity) : buffer_(new char[capacity]), capacity_(capacity) {
+}
+
+FrameArena::~FrameArena() {
+    delete[] buffer_;
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+    uintptr_t base = (uintptr_t)buffer_;
+    uintptr_t start = (base + used_ + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    if (start + size > base + capacity_) return nullptr;
+    used_ = start + size - base;
+    highWater_ = max(highWater_, used_);
+    return (void*)start;
+}
+
+const char* FrameArena::format(const char* pattern, ...) {
+    va_list arguments;
+    va_start(arguments, pattern);
+    va_list copy;
+    va_copy(copy, arguments);
+    int length = vsnprintf(nullptr, 0, pattern, arguments);
+    va_end(arguments);
+
+    char* text = length < 0 ? nullptr : (char*)allocate((size_t)length + 1, 1);
+    if (text) vsnprintf(text, (size_t)length + 1, pattern, copy);
+    va_end(copy);
+    return text ? text : "";
+}
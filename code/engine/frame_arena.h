@@ -0,0 +1,42 @@
+#pragma once
+
+// Bump allocator for scratch memory that only lives for one frame.
+//
+// The buffer is allocated once; allocate() hands out the next aligned slice
+// and reset() at the start of each frame makes all of it free again, so
+// building per-frame text costs no heap allocation. When the buffer is full,
+// allocate() returns nullptr and format() returns "" rather than growing; the
+// high-water mark shows how close a frame came to that.
+
+#include <cstddef>
+
+class FrameArena {
+public:
+    explicit FrameArena(size_t capacity = 16 * 1024);
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void reset() { used_ = 0; }
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    // Function to format text (printf style) into the arena; the result is
+    // valid until the next reset()
+    const char* format(const char* pattern, ...)
+#if defined(__GNUC__) || defined(__clang__)
+        __attribute__((format(printf, 2, 3)))
+#endif
+        ;
+
+    size_t used() const { return used_; }
+    size_t capacity() const { return capacity_; }
+    size_t highWater() const { return highWater_; }
+
+private:
+    char* buffer_;
+    size_t capacity_;
+    size_t used_ = 0;
+    size_t highWater_ = 0;
+};
@@ -0,0 +1,154 @@
+#include "engine/frame_profiler.h"
+
+#include <algorithm>
+
+using namespace std;
+
+FrameProfiler::FrameProfiler() : origin_(Clock::now()), frameStart_(origin_) {
+}
+
+FrameProfiler::~FrameProfiler() {
+    stopTrace();
+}
+
+double FrameProfiler::microsecondsSince(Clock::time_point start, Clock::time_point end) const {
+    return chrono::duration<double, micro>(end - start).count();
+}
+
+void FrameProfiler::beginFrame() {
+    endFrame();
+    inFrame_ = true;
+    if (allocationCounter_) frameStartAllocations_ = allocationCounter_();
+    frameStart_ = Clock::now();
+}
+
+void FrameProfiler::endFrame() {
+    if (!inFrame_) return;
+    // Scopes left open (none, unless a caller forgot one) end with the frame
+    while (depth_ > 0) endScope();
+
+    Clock::time_point now = Clock::now();
+    inFrame_ = false;
+    frameMs_[frameCount_ % HISTORY_FRAMES] = microsecondsSince(frameStart_, now) / 1000.0;
+    frameCount_++;
+
+    copy(scopes_, scopes_ + scopeCount_, lastScopes_);
+    lastScopeCount_ = scopeCount_;
+    scopeCount_ = 0;
+    lastDrawCalls_ = drawCalls_;
+    drawCalls_ = 0;
+    if (allocationCounter_) {
+        lastAllocations_ = allocationCounter_() - frameStartAllocations_;
+        if (lastAllocations_ > 0) allocatingFrames_++;
+    }
+
+    if (trace_) {
+        writeTraceEvent("frame", frameStart_, now);
+        fprintf(trace_, ",\n{\"name\":\"draw calls\",\"ph\":\"C\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"args\":{\"calls\":%d}}",
+            microsecondsSince(origin_, frameStart_), lastDrawCalls_);
+        if (allocationCounter_) {
+            fprintf(trace_, ",\n{\"name\":\"allocations\",\"ph\":\"C\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"args\":{\"count\":%llu}}",
+                microsecondsSince(origin_, frameStart_), (unsigned long long)lastAllocations_);
+        }
+        // Flushed every frame so a killed game still leaves a readable trace
+        fflush(trace_);
+    }
+}
+
+void FrameProfiler::skipFrame() {
+    if (!inFrame_) return;
+    while (depth_ > 0) endScope();
+    inFrame_ = false;
+    scopeCount_ = 0;
+    drawCalls_ = 0;
+}
+
+void FrameProfiler::beginScope(const char* name) {
+    if (depth_ == MAX_DEPTH) {
+        depth_++;   // Too deep to time, but still balanced by endScope()
+        return;
+    }
+    openNames_[depth_] = name;
+    openStarts_[depth_] = Clock::now();
+    depth_++;
+}
+
+void FrameProfiler::endScope() {
+    if (depth_ == 0) return;
+    depth_--;
+    if (depth_ >= MAX_DEPTH) return;
+
+    Clock::time_point now = Clock::now();
+    const char* name = openNames_[depth_];
+    int index = 0;
+    while (index < scopeCount_ && scopes_[index].name != name) index++;
+    if (index == scopeCount_) {
+        if (scopeCount_ == MAX_SCOPES) return;
+        scopes_[scopeCount_++] = ScopeTotal{ name, 0, 0 };
+    }
+    scopes_[index].ms += microsecondsSince(openStarts_[depth_], now) / 1000.0;
+    scopes_[index].calls++;
+
+    if (trace_) writeTraceEvent(name, openStarts_[depth_], now);
+}
+
+// Complete events ("X") carry their own start and duration, so each scope is
+// written once, when it ends
+void FrameProfiler::writeTraceEvent(const char* name, Clock::time_point start, Clock::time_point end) {
+    fprintf(trace_, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+        firstTraceEvent_ ? "" : ",\n", name, microsecondsSince(origin_, start), microsecondsSince(start, end));
+    firstTraceEvent_ = false;
+}
+
+// The JSON array format may be left unterminated, which is what makes
+// streaming it safe; stopTrace() closes it when it gets the chance
+bool FrameProfiler::startTrace(const char* path) {
+    stopTrace();
+    trace_ = fopen(path, "w");
+    if (!trace_) return false;
+    firstTraceEvent_ = true;
+    fprintf(trace_, "[\n");
+    return true;
+}
+
+void FrameProfiler::stopTrace() {
+    if (!trace_) return;
+    fprintf(trace_, "\n]\n");
+    fclose(trace_);
+    trace_ = nullptr;
+}
+
+double FrameProfiler::lastFrameMs() const {
+    if (frameCount_ == 0) return 0;
+    return frameMs_[(frameCount_ - 1) % HISTORY_FRAMES];
+}
+
+// Function to pick a percentile out of a ring of recent times (count is how
+// many the ring holds, at most HISTORY_FRAMES)
+static_assert(FrameProfiler::HISTORY_INPUTS <= FrameProfiler::HISTORY_FRAMES, "ring too long to sort on the stack");
+static double ringPercentile(const double* ring, int count, double share) {
+    if (count == 0) return 0;
+    double sorted[FrameProfiler::HISTORY_FRAMES];
+    copy(ring, ring + count, sorted);
+    int index = min((int)(share * (count - 1) + 0.5), count - 1);
+    nth_element(sorted, sorted + index, sorted + count);
+    return sorted[index];
+}
+
+double FrameProfiler::percentileMs(double share) const {
+    return ringPercentile(frameMs_, min(frameCount_, HISTORY_FRAMES), share);
+}
+
+void FrameProfiler::recordInputLatency(double ms) {
+    inputMs_[inputCount_ % HISTORY_INPUTS] = ms;
+    inputCount_++;
+    if (trace_) {
+        fprintf(trace_, "%s{\"name\":\"input latency\",\"ph\":\"C\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"args\":{\"ms\":%.3f}}",
+            firstTraceEvent_ ? "" : ",\n", microsecondsSince(origin_, Clock::now()), ms);
+        firstTraceEvent_ = false;
+    }
+}
+
+double FrameProfiler::inputLatencyPercentileMs(double share) const {
+    return ringPercentile(inputMs_, min(inputCount_, HISTORY_INPUTS), share);
+}
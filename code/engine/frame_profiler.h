@@ -0,0 +1,133 @@
+#pragma once
+
+// Per-frame instrumentation for the render loop.
+//
+// The loop marks each frame with beginFrame() and wraps its phases in named
+// scopes (ProfileScope, or beginScope()/endScope() where a block would not
+// fit). The profiler keeps the recent frame times for percentiles, the time
+// spent in each scope during the last complete frame, a draw-call count, and
+// the recent input latencies (keystroke seen to keystroke on screen).
+// It can also stream every scope as a Chrome trace event, so a file written
+// on a kiosk opens in chrome://tracing or ui.perfetto.dev.
+//
+// Nothing here allocates once constructed; scope names must be string
+// literals (they are kept and compared by pointer, and written unescaped).
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+class FrameProfiler {
+public:
+    static const int HISTORY_FRAMES = 240;  // Four seconds at 60 fps
+    static const int HISTORY_INPUTS = 240;  // Keystrokes kept for latency percentiles
+    static const int MAX_SCOPES = 16;       // Distinct scope names per frame
+    static const int MAX_DEPTH = 8;         // Scopes open at once
+
+    struct ScopeTotal {
+        const char* name = nullptr;
+        double ms = 0;      // Summed over every time the scope ran in the frame
+        int calls = 0;
+    };
+
+    FrameProfiler();
+    ~FrameProfiler();
+
+    FrameProfiler(const FrameProfiler&) = delete;
+    FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+    // Function to start a frame; the previous one (if any) ends here, so a
+    // loop that leaves an iteration early with continue needs no end call
+    void beginFrame();
+    // Function to end the current frame without starting another
+    void endFrame();
+    // Function to drop the current frame from the statistics, for loop
+    // iterations that drew nothing (scopes already traced stay in the trace)
+    void skipFrame();
+
+    void beginScope(const char* name);
+    void endScope();
+    void countDrawCall() { drawCalls_++; }
+
+    // Function to report heap allocations per frame. The counter returns the
+    // process's running total (see bench/alloc_counter.h); builds without one
+    // leave it unset and report nothing.
+    void setAllocationCounter(uint64_t (*counter)()) { allocationCounter_ = counter; }
+    bool countsAllocations() const { return allocationCounter_ != nullptr; }
+
+    // Function to record the time from a keystroke first being seen to the
+    // end of presenting the frame that showed it
+    void recordInputLatency(double ms);
+
+    // Function to start streaming trace events to a file; returns false if it
+    // cannot be created. The file is a valid trace even if the game is killed.
+    bool startTrace(const char* path);
+    void stopTrace();
+    bool isTracing() const { return trace_ != nullptr; }
+
+    // Statistics of complete frames
+    int frameCount() const { return frameCount_; }
+    double lastFrameMs() const;
+    // Function to get the frame time below which the given share of the
+    // recent frames fall (0.5 for the median)
+    double percentileMs(double share) const;
+    int lastDrawCalls() const { return lastDrawCalls_; }
+    uint64_t lastAllocations() const { return lastAllocations_; }
+    // Frames so far that allocated at all
+    int allocatingFrames() const { return allocatingFrames_; }
+    int scopeCount() const { return lastScopeCount_; }
+    const ScopeTotal& scope(int index) const { return lastScopes_[index]; }
+
+    // Statistics of recorded keystrokes, the same way as frame times
+    int inputCount() const { return inputCount_; }
+    double inputLatencyPercentileMs(double share) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    double microsecondsSince(Clock::time_point start, Clock::time_point end) const;
+    void writeTraceEvent(const char* name, Clock::time_point start, Clock::time_point end);
+
+    Clock::time_point origin_;
+    Clock::time_point frameStart_;
+    bool inFrame_ = false;
+
+    const char* openNames_[MAX_DEPTH];
+    Clock::time_point openStarts_[MAX_DEPTH];
+    int depth_ = 0;
+
+    ScopeTotal scopes_[MAX_SCOPES];
+    int scopeCount_ = 0;
+    ScopeTotal lastScopes_[MAX_SCOPES];
+    int lastScopeCount_ = 0;
+    int drawCalls_ = 0;
+    int lastDrawCalls_ = 0;
+
+    uint64_t (*allocationCounter_)() = nullptr;
+    uint64_t frameStartAllocations_ = 0;
+    uint64_t lastAllocations_ = 0;
+    int allocatingFrames_ = 0;
+
+    double frameMs_[HISTORY_FRAMES] = {};
+    int frameCount_ = 0;
+    double inputMs_[HISTORY_INPUTS] = {};
+    int inputCount_ = 0;
+
+    FILE* trace_ = nullptr;
+    bool firstTraceEvent_ = true;
+};
+
+// Times the enclosing block as one scope
+class ProfileScope {
+public:
+    ProfileScope(FrameProfiler& profiler, const char* name) : profiler_(profiler) {
+        profiler_.beginScope(name);
+    }
+    ~ProfileScope() { profiler_.endScope(); }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    FrameProfiler& profiler_;
+};
@@ -0,0 +1,32 @@
+#include "engine/game_clock.h"
+
+#include <cmath>
+
+using namespace std;
+
+// Tick arithmetic tolerates this much rounding error in the seconds it is
+// given, so a time that is a whole tick in theory lands on that tick
+static const double TICK_EPSILON = 1e-6;
+
+double SteadyClock::now() const {
+    return chrono::duration<double>(chrono::steady_clock::now() - origin_).count();
+}
+
+long long TurnTimer::currentTick() const {
+    return (long long)floor(clock_.now() * ticksPerSecond_ + TICK_EPSILON);
+}
+
+long long TurnTimer::deadlineTick(const GameState& state) const {
+    if (state.phase != GamePhase::Guessing) return -1;
+    double deadline = state.startTime + state.timeLimitPerTurn;
+    return (long long)ceil(deadline * ticksPerSecond_ - TICK_EPSILON);
+}
+
+bool TurnTimer::nextExpiry(const GameState& state, GameEvent& tick) const {
+    long long deadline = deadlineTick(state);
+    if (deadline < 0 || deadline > currentTick()) return false;
+    tick = GameEvent();
+    tick.type = GameEventType::Tick;
+    tick.time = tickTime(deadline);
+    return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+// Clocks that drive a match, and the fixed-timestep timer that expires turns.
+//
+// The engine never reads a clock itself: every GameEvent carries its time.
+// TurnTimer is what decides those times. It quantizes the clock into fixed
+// ticks (60 a second by default) and stamps events with the time of the
+// current tick. A turn that runs out is expired at the first tick on or
+// after its deadline, not whenever the next frame happens to come round, so
+// a slow or stalled frame neither delays the next turn's clock nor skips an
+// expiry; a stall long enough to cover several turns expires each of them in
+// order.
+//
+// Any GameClock can drive the timer. SteadyClock is real time; VirtualClock
+// only moves when told to, so simulations can run thousands of expiring
+// turns at CPU speed and get the same result every time.
+
+#include "engine/game_engine.h"
+
+#include <chrono>
+
+class GameClock {
+public:
+    virtual ~GameClock() = default;
+
+    // Seconds since some fixed start; never goes backwards
+    virtual double now() const = 0;
+};
+
+// Real time, from std::chrono::steady_clock, starting at zero
+class SteadyClock : public GameClock {
+public:
+    SteadyClock() : origin_(std::chrono::steady_clock::now()) {}
+    double now() const override;
+
+private:
+    std::chrono::steady_clock::time_point origin_;
+};
+
+// Time that moves only when set or advanced
+class VirtualClock : public GameClock {
+public:
+    explicit VirtualClock(double start = 0) : now_(start) {}
+    double now() const override { return now_; }
+
+    void set(double time) { if (time > now_) now_ = time; }
+    void advance(double seconds) { if (seconds > 0) now_ += seconds; }
+
+private:
+    double now_;
+};
+
+class TurnTimer {
+public:
+    static const int DEFAULT_TICKS_PER_SECOND = 60;
+
+    explicit TurnTimer(const GameClock& clock, int ticksPerSecond = DEFAULT_TICKS_PER_SECOND)
+        : clock_(clock), ticksPerSecond_(ticksPerSecond) {}
+
+    int ticksPerSecond() const { return ticksPerSecond_; }
+
+    // Function to get the last tick the clock has reached
+    long long currentTick() const;
+    double tickTime(long long tick) const { return (double)tick / ticksPerSecond_; }
+
+    // Time of the current tick, for stamping events
+    double now() const { return tickTime(currentTick()); }
+
+    // Function to get the first tick on or after the current turn's deadline
+    // (-1 outside the guessing phase, where no turn is running)
+    long long deadlineTick(const GameState& state) const;
+
+    // Function to build the Tick event that expires the current turn, if its
+    // deadline tick has been reached; the event is stamped with that tick, so
+    // the next turn starts on time however late this is called. Apply the
+    // event with step() and call again until it returns false.
+    bool nextExpiry(const GameState& state, GameEvent& tick) const;
+
+private:
+    const GameClock& clock_;
+    int ticksPerSecond_;
+};
@@ -0,0 +1,307 @@
+#include "engine/game_engine.h"
+
+#include <cctype>
+#include <cstdio>
+
+using namespace std;
+
+// Function to count how many digits are correct
+int countCorrectDigits(const string& guess, const string& target) {
+    int correctCount = 0;
+    for (char ch : guess) {
+        if (target.find(ch) != string::npos) {
+            correctCount++;
+        }
+    }
+    return correctCount;
+}
+
+// Function to count how many digits are in the correct position
+int countCorrectPositions(const string& guess, const string& target) {
+    int correctPosCount = 0;
+    for (int i = 0; i < (int)guess.length(); i++) {
+        if (guess[i] == target[i]) {
+            correctPosCount++;
+        }
+    }
+    return correctPosCount;
+}
+
+// Function to check the number input (4 digits, no repeating digits)
+NumberStatus checkNumber(const string& number) {
+    return checkNumber(number.data(), number.size());
+}
+
+NumberStatus checkNumber(const char* number, size_t length) {
+    if (length != 4) {
+        return NumberStatus::WrongLength;
+    }
+
+    // One bit per digit seen so far
+    unsigned digits = 0;
+    for (size_t i = 0; i < length; i++) {
+        char ch = number[i];
+        if (!isdigit((unsigned char)ch)) {
+            return NumberStatus::BadDigit;
+        }
+        unsigned bit = 1u << (ch - '0');
+        if (digits & bit) {
+            return NumberStatus::RepeatedDigit;
+        }
+        digits |= bit;
+    }
+
+    return NumberStatus::Valid;
+}
+
+// Function to validate the number input (4 digits, no repeating digits)
+string isValidNumber(const string& number) {
+    char message[64];
+    return numberStatusMessage(checkNumber(number), GameVariant(), message, sizeof(message));
+}
+
+string parseNumber(const string& number, PackedCode& code) {
+    return parseNumber(number, GameVariant(), code);
+}
+
+string parseNumber(const string& number, const GameVariant& variant, PackedCode& code) {
+    char message[64];
+    return numberStatusMessage(packNumber(number, variant, code), variant, message, sizeof(message));
+}
+
+NumberStatus packNumber(const string& number, const GameVariant& variant, PackedCode& code) {
+    return packNumber(number.data(), number.size(), variant, code);
+}
+
+NumberStatus packNumber(const char* number, size_t length, const GameVariant& variant, PackedCode& code) {
+    NumberStatus status = checkVariantNumber(number, length, variant);
+    if (status == NumberStatus::Valid) {
+        code = variant.isClassic() ? packCode(number) : packVariantCode(number, length);
+    }
+    return status;
+}
+
+string formatCode(PackedCode code, const GameVariant& variant) {
+    return variant.isClassic() ? codeToString(code) : variantCodeToString(code, variant.length);
+}
+
+void formatCode(PackedCode code, const GameVariant& variant, char* text) {
+    if (variant.isClassic()) unpackCode(code, text);
+    else unpackVariantCode(code, variant.length, text);
+}
+
+int turnTimeRemaining(const GameState& state, double now) {
+    // The small allowance keeps an event stamped exactly on the deadline (see
+    // TurnTimer) from reading as a hair before it after rounding
+    return state.timeLimitPerTurn - (int)(now - state.startTime + 1e-6);
+}
+
+// Codes reaching step() were packed from validated input, so this only
+// fires for callers that build events by hand
+static const char* INVALID_CODE_MESSAGE = "Error: Number must be 4 distinct digits.";
+static const char* INVALID_VARIANT_CODE_MESSAGE = "Error: Number does not fit this game.";
+
+// Function to check an event's code against the match's variant
+static bool isValidGameCode(PackedCode code, const GameVariant& variant, StepResult& out) {
+    bool valid = variant.isClassic() ? isValidPackedCode(code) : isValidVariantCode(code, variant);
+    if (!valid) {
+        out.outcome = StepOutcome::Rejected;
+        out.error = variant.isClassic() ? INVALID_CODE_MESSAGE : INVALID_VARIANT_CODE_MESSAGE;
+    }
+    return valid;
+}
+
+// Function to end the match once both players have used all their turns
+static void checkTurnLimit(GameState& state) {
+    if (state.player1Turns >= state.turnLimit && state.player2Turns >= state.turnLimit) {
+        state.result = GameResult::Draw;
+        state.phase = GamePhase::GameOver;
+    }
+}
+
+GameState step(const GameState& state, const GameEvent& event, StepResult* result) {
+    GameState next = state;
+    StepResult local;
+    StepResult& out = result ? *result : local;
+    out = StepResult();
+    out.byPlayer1 = state.player1Turn;
+
+    switch (event.type) {
+    case GameEventType::SetTurnLimit: {
+        if (state.phase != GamePhase::SettingTurnLimit) break;
+        if (event.turnLimit < 1) {
+            out.outcome = StepOutcome::Rejected;
+            out.error = "Turn limit must be at least 1. Try again:";
+            break;
+        }
+        VariantStatus variantStatus = checkVariant(event.variant);
+        if (variantStatus != VariantStatus::Valid) {
+            out.outcome = StepOutcome::Rejected;
+            out.error = variantStatusMessage(variantStatus);
+            break;
+        }
+        next.turnLimit = event.turnLimit;
+        next.variant = event.variant;
+        next.phase = GamePhase::SettingNumbers;
+        out.outcome = StepOutcome::TurnLimitSet;
+        break;
+    }
+
+    case GameEventType::SetNumber:
+        if (state.phase != GamePhase::SettingNumbers) break;
+        if (!isValidGameCode(event.code, state.variant, out)) break;
+        if (state.player1Turn) {
+            next.player1Number = event.code;
+            next.player1Turn = false;
+        }
+        else {
+            next.player2Number = event.code;
+            next.phase = GamePhase::Guessing;
+            next.player1Turn = true;
+            next.startTime = event.time;
+        }
+        out.outcome = StepOutcome::NumberSet;
+        break;
+
+    case GameEventType::Guess: {
+        if (state.phase != GamePhase::Guessing) break;
+        if (!isValidGameCode(event.code, state.variant, out)) break;
+        PackedCode target = state.player1Turn ? state.player2Number : state.player1Number;
+        if (state.variant.isClassic()) {
+            out.correctDigits = packedCorrectDigits(event.code, target);
+            out.correctPositions = packedCorrectPositions(event.code, target);
+        }
+        else {
+            DynamicRules rules(state.variant);
+            out.correctDigits = rulesCorrectDigits(rules, digitCounts(event.code, state.variant.length),
+                digitCounts(target, state.variant.length));
+            out.correctPositions = rulesCorrectPositions(rules, event.code, target);
+        }
+
+        if (event.code == target) {
+            next.result = state.player1Turn ? GameResult::Player1Wins : GameResult::Player2Wins;
+            next.phase = GamePhase::GameOver;
+            out.outcome = StepOutcome::Won;
+            break;
+        }
+
+        if (state.player1Turn) next.player1Turns++;
+        else next.player2Turns++;
+
+        // The turn only passes while somebody still has turns left
+        if (next.player1Turns < next.turnLimit || next.player2Turns < next.turnLimit) {
+            next.player1Turn = !next.player1Turn;
+            next.startTime = event.time;
+        }
+        checkTurnLimit(next);
+        out.outcome = StepOutcome::Scored;
+        break;
+    }
+
+    case GameEventType::Tick:
+        if (state.phase != GamePhase::Guessing) break;
+        if (turnTimeRemaining(state, event.time) > 0) break;
+
+        if (state.player1Turn) next.player1Turns++;
+        else next.player2Turns++;
+
+        next.player1Turn = !next.player1Turn;
+        next.startTime = event.time;
+        checkTurnLimit(next);
+        out.outcome = StepOutcome::TimedOut;
+        break;
+    }
+
+    return next;
+}
+
+string describeGuess(const string& playerName, const string& guess, int correctDigits, int correctPositions) {
+    return playerName + " guessed " + guess + ": " +
+        to_string(correctDigits) + " correct digits, " +
+        to_string(correctPositions) + " in position.";
+}
+
+const char* describeGuess(char* buffer, size_t size, const char* playerName, const char* guess,
+    int correctDigits, int correctPositions) {
+    snprintf(buffer, size, "%s guessed %s: %d correct digits, %d in position.",
+        playerName, guess, correctDigits, correctPositions);
+    return buffer;
+}
+
+MatchSummary simulateMatch(const vector<GameEvent>& events, GameState state) {
+    MatchSummary summary;
+    for (const GameEvent& event : events) {
+        if (state.phase == GamePhase::GameOver) break;
+        state = step(state, event);
+        summary.eventsApplied++;
+    }
+    summary.result = state.result;
+    summary.player1Turns = state.player1Turns;
+    summary.player2Turns = state.player2Turns;
+    return summary;
+}
+
+vector<MatchSummary> simulateMatches(const vector<vector<GameEvent>>& scripts) {
+    vector<MatchSummary> summaries;
+    summaries.reserve(scripts.size());
+    for (const vector<GameEvent>& script : scripts) {
+        summaries.push_back(simulateMatch(script));
+    }
+    return summaries;
+}
+
+// Small xorshift generator so simulations are reproducible across platforms
+static unsigned nextRandom(unsigned& seed) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+// Function to draw a uniformly random valid number
+static PackedCode randomNumber(unsigned& seed) {
+    int digits[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    for (int i = 0; i < CODE_LENGTH; i++) {
+        int j = i + (int)(nextRandom(seed) % (10 - i));
+        swap(digits[i], digits[j]);
+    }
+    return packDigits(digits[0], digits[1], digits[2], digits[3]);
+}
+
+vector<MatchSummary> simulateRandomMatches(int matchCount, int turnLimit, unsigned seed) {
+    vector<MatchSummary> summaries;
+    summaries.reserve(matchCount);
+    if (seed == 0) seed = 1;
+
+    GameEvent event;
+    for (int match = 0; match < matchCount; match++) {
+        GameState state;
+        double now = 0;
+
+        event.type = GameEventType::SetTurnLimit;
+        event.turnLimit = turnLimit;
+        state = step(state, event);
+
+        event.type = GameEventType::SetNumber;
+        for (int player = 0; player < 2; player++) {
+            event.code = randomNumber(seed);
+            state = step(state, event);
+        }
+
+        MatchSummary summary;
+        summary.eventsApplied = 3;
+        event.type = GameEventType::Guess;
+        while (state.phase == GamePhase::Guessing) {
+            now += 1;
+            event.time = now;
+            event.code = randomNumber(seed);
+            state = step(state, event);
+            summary.eventsApplied++;
+        }
+        summary.result = state.result;
+        summary.player1Turns = state.player1Turns;
+        summary.player2Turns = state.player2Turns;
+        summaries.push_back(summary);
+    }
+    return summaries;
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+// Headless NumBrainer rules engine.
+//
+// Everything that decides how a match plays out lives here: number validation,
+// scoring, turn order, the per-turn timer and the win/draw checks. Nothing in
+// this file knows about raylib, so matches can be played without a window
+// (server-side simulation, balancing and regression runs) and the GUI simply
+// feeds events into step() and draws whatever state comes back.
+
+#include "engine/packed_code.h"
+#include "engine/variant.h"
+
+#include <string>
+#include <vector>
+
+// Phases of a match, in the order they are played
+enum class GamePhase {
+    SettingTurnLimit,   // Waiting for the number of turns per player
+    SettingNumbers,     // Player 1, then player 2, pick their secret numbers
+    Guessing,           // Players take turns guessing each other's number
+    GameOver
+};
+
+enum class GameResult {
+    None,
+    Player1Wins,
+    Player2Wins,
+    Draw
+};
+
+enum class GameEventType {
+    SetTurnLimit,   // turnLimit and variant
+    SetNumber,      // code: secret number of the player whose turn it is
+    Guess,          // code: guess of the player whose turn it is
+    Tick            // Clock update; expires the current turn when time is up
+};
+
+// Input to the engine. The time stamp is in seconds on whatever clock drives
+// the match (see TurnTimer in game_clock.h: real time in the GUI, a virtual
+// clock in simulations). Codes are packed once at entry, see parseNumber():
+// a classic PackedCode in the classic game, a VariantCode in every other
+// variant.
+struct GameEvent {
+    GameEventType type = GameEventType::Tick;
+    double time = 0;
+    int turnLimit = 0;
+    GameVariant variant;
+    PackedCode code = 0;
+};
+
+// Complete rules state of one match. Plain value type: copy it, compare it,
+// keep as many as you like.
+struct GameState {
+    GamePhase phase = GamePhase::SettingTurnLimit;
+    GameResult result = GameResult::None;
+    int turnLimit = 0;                 // Number of turns for the round
+    GameVariant variant;               // Code length, digits and repeat rule
+    int timeLimitPerTurn = 30;         // Seconds per turn
+    PackedCode player1Number = 0;
+    PackedCode player2Number = 0;
+    bool player1Turn = true;
+    int player1Turns = 0;
+    int player2Turns = 0;
+    double startTime = 0;              // When the current turn started
+};
+
+// What a single step() did, for the caller to turn into UI feedback
+enum class StepOutcome {
+    Ignored,        // Event does not apply in the current phase
+    Rejected,       // Invalid input, see StepResult::error
+    TurnLimitSet,
+    NumberSet,
+    Scored,         // Wrong guess, see correctDigits/correctPositions
+    Won,            // Guess matched the opponent's number
+    TimedOut        // Current player ran out of time
+};
+
+struct StepResult {
+    StepOutcome outcome = StepOutcome::Ignored;
+    const char* error = "";    // Set when the outcome is Rejected (static text)
+    bool byPlayer1 = true;     // Player who set the number, guessed or timed out
+    int correctDigits = 0;
+    int correctPositions = 0;
+};
+
+// Function to count how many digits are correct
+int countCorrectDigits(const std::string& guess, const std::string& target);
+
+// Function to count how many digits are in the correct position
+int countCorrectPositions(const std::string& guess, const std::string& target);
+
+// Function to check the number input (4 digits, no repeating digits)
+// without allocating; see numberStatusMessage() for the text
+NumberStatus checkNumber(const std::string& number);
+NumberStatus checkNumber(const char* number, size_t length);
+
+// Function to validate the number input (4 digits, no repeating digits)
+std::string isValidNumber(const std::string& number);
+
+// Function to validate typed input and pack it for the engine. Returns the
+// isValidNumber() message; code is only written when that is "Valid".
+std::string parseNumber(const std::string& number, PackedCode& code);
+
+// Function to validate and pack typed input for any variant (see
+// isValidVariantNumber() for the messages)
+std::string parseNumber(const std::string& number, const GameVariant& variant, PackedCode& code);
+
+// Function to check and pack typed input for any variant without allocating;
+// code is only written when the status is Valid
+NumberStatus packNumber(const std::string& number, const GameVariant& variant, PackedCode& code);
+// The same for text that is not in a std::string (a network message)
+NumberStatus packNumber(const char* number, size_t length, const GameVariant& variant, PackedCode& code);
+
+// Function to write a code of the given variant back out as text
+std::string formatCode(PackedCode code, const GameVariant& variant);
+
+// The same into a buffer of at least MAX_VARIANT_LENGTH + 1 chars
+void formatCode(PackedCode code, const GameVariant& variant, char* text);
+
+// Function to get the seconds left in the current turn
+int turnTimeRemaining(const GameState& state, double now);
+
+// Function to apply one event to a match and return the resulting state
+GameState step(const GameState& state, const GameEvent& event, StepResult* result = nullptr);
+
+// Function to build the history line for a scored guess
+std::string describeGuess(const std::string& playerName, const std::string& guess,
+    int correctDigits, int correctPositions);
+
+// The same into a buffer (truncated to fit); returns the buffer
+const char* describeGuess(char* buffer, size_t size, const char* playerName, const char* guess,
+    int correctDigits, int correctPositions);
+
+// Batch simulation
+
+struct MatchSummary {
+    GameResult result = GameResult::None;
+    int player1Turns = 0;
+    int player2Turns = 0;
+    int eventsApplied = 0;     // Events consumed before the match ended
+};
+
+// Function to play one scripted match; events after the game ends are skipped
+MatchSummary simulateMatch(const std::vector<GameEvent>& events, GameState state = GameState());
+
+// Function to play a batch of scripted matches
+std::vector<MatchSummary> simulateMatches(const std::vector<std::vector<GameEvent>>& scripts);
+
+// Function to play matches between two players who guess uniformly random
+// valid numbers (a baseline for balancing runs). Deterministic for a seed.
+std::vector<MatchSummary> simulateRandomMatches(int matchCount, int turnLimit, unsigned seed);
@@ -0,0 +1,330 @@
+#include "engine/game_record.h"
+#include "engine/mapped_file.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+static const unsigned char RECORD_MAGIC[4] = { 'N', 'B', 'R', 'C' };
+
+// One byte at the start of every record
+enum RecordTag : unsigned char {
+    TAG_MATCH = 1,        // ticksPerSecond, timeLimitPerTurn, flags, start tick, two names
+    TAG_TURN_LIMIT = 2,   // dt, turnLimit, length, base, repeats
+    TAG_NUMBER = 3,       // dt, code
+    TAG_GUESS = 4,        // dt, code
+    TAG_TIMEOUT = 5,      // dt
+    TAG_END = 6           // dt, MatchEnd
+};
+
+static const size_t MAX_NAME_BYTES = 255;
+
+GameRecordWriter::~GameRecordWriter() {
+    close();
+}
+
+// Function to cut an existing record back to its last complete record. A
+// record torn by a crash would otherwise read the first bytes of whatever is
+// appended after it as its own, and the reader would stop there for good.
+static bool trimTornTail(const char* path) {
+    uint64_t keep;
+    {
+        MappedFile existing;
+        if (!existing.open(path)) return true;     // Missing or empty: nothing to trim
+        GameRecordReader reader(existing.data(), existing.size());
+        if (reader.valid()) {
+            MatchInfo info;
+            GameEvent event;
+            while (reader.nextMatch(info)) {
+                while (reader.nextEvent(event)) {}
+            }
+            keep = reader.completeBytes();
+        }
+        else {
+            // Only a file header cut short is started over; anything else is
+            // some other file, or another version, and is left alone
+            size_t magicBytes = min(existing.size(), sizeof(RECORD_MAGIC));
+            if (existing.size() > sizeof(RECORD_MAGIC) || memcmp(existing.data(), RECORD_MAGIC, magicBytes) != 0) {
+                return false;
+            }
+            keep = 0;
+        }
+        if (keep == existing.size()) return true;
+    }
+    return truncateFile(path, keep);
+}
+
+bool GameRecordWriter::open(const char* path) {
+    close();
+    if (!trimTornTail(path)) return false;
+    file_ = fopen(path, "ab");
+    if (!file_) return false;
+    fseek(file_, 0, SEEK_END);
+    if (ftell(file_) == 0) {
+        pending_.insert(pending_.end(), RECORD_MAGIC, RECORD_MAGIC + 4);
+        putVarint(GAME_RECORD_VERSION);
+    }
+    stopping_ = false;
+    thread_ = thread(&GameRecordWriter::run, this);
+    return true;
+}
+
+void GameRecordWriter::close() {
+    if (!file_) return;
+    handOff();
+    {
+        lock_guard<mutex> guard(lock_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+    fclose(file_);
+    file_ = nullptr;
+    inMatch_ = false;
+}
+
+long long GameRecordWriter::toTick(double time) const {
+    return llround(time * ticksPerSecond_);
+}
+
+void GameRecordWriter::putVarint(uint64_t value) {
+    while (value >= 0x80) {
+        pending_.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    pending_.push_back((unsigned char)value);
+}
+
+// Times only move forward within a match; anything earlier is stored as no delay
+void GameRecordWriter::putTime(double time) {
+    long long tick = toTick(time);
+    putVarint(tick > lastTick_ ? (uint64_t)(tick - lastTick_) : 0);
+    if (tick > lastTick_) lastTick_ = tick;
+}
+
+void GameRecordWriter::putString(const string& text) {
+    size_t length = min(text.size(), MAX_NAME_BYTES);
+    putVarint(length);
+    pending_.insert(pending_.end(), text.begin(), text.begin() + length);
+}
+
+void GameRecordWriter::beginMatch(const MatchInfo& info) {
+    if (!file_) return;
+    if (inMatch_) endMatch(info.startTime, MatchEnd::Reset);
+    ticksPerSecond_ = info.ticksPerSecond > 0 ? info.ticksPerSecond : 60;
+    lastTick_ = max(toTick(info.startTime), 0LL);
+
+    pending_.push_back(TAG_MATCH);
+    putVarint((uint64_t)ticksPerSecond_);
+    putVarint((uint64_t)max(info.timeLimitPerTurn, 0));
+    putVarint(info.vsComputer ? 1 : 0);
+    putVarint((uint64_t)lastTick_);
+    putString(info.player1Name);
+    putString(info.player2Name);
+    inMatch_ = true;
+}
+
+void GameRecordWriter::recordEvent(const GameEvent& event) {
+    if (!file_ || !inMatch_) return;
+    switch (event.type) {
+    case GameEventType::SetTurnLimit:
+        pending_.push_back(TAG_TURN_LIMIT);
+        putTime(event.time);
+        putVarint((uint64_t)max(event.turnLimit, 0));
+        putVarint((uint64_t)event.variant.length);
+        putVarint((uint64_t)event.variant.base);
+        putVarint(event.variant.repeats ? 1 : 0);
+        break;
+    case GameEventType::SetNumber:
+    case GameEventType::Guess:
+        pending_.push_back(event.type == GameEventType::SetNumber ? TAG_NUMBER : TAG_GUESS);
+        putTime(event.time);
+        putVarint(event.code);
+        break;
+    case GameEventType::Tick:
+        pending_.push_back(TAG_TIMEOUT);
+        putTime(event.time);
+        break;
+    }
+    if (pending_.size() >= FLUSH_BYTES) handOff();
+}
+
+void GameRecordWriter::endMatch(double time, MatchEnd how) {
+    if (!file_ || !inMatch_) return;
+    pending_.push_back(TAG_END);
+    putTime(time);
+    putVarint((uint64_t)how);
+    inMatch_ = false;
+    handOff();
+}
+
+uint64_t GameRecordWriter::bytesWritten() const {
+    lock_guard<mutex> guard(lock_);
+    return handedOff_;
+}
+
+// Function to pass the encoded bytes to the writer thread; only a buffer
+// append happens under the lock, never a file write
+void GameRecordWriter::handOff() {
+    if (pending_.empty()) return;
+    {
+        lock_guard<mutex> guard(lock_);
+        outgoing_.insert(outgoing_.end(), pending_.begin(), pending_.end());
+        handedOff_ += pending_.size();
+    }
+    pending_.clear();
+    wake_.notify_one();
+}
+
+void GameRecordWriter::run() {
+    vector<unsigned char> writing;
+    unique_lock<mutex> guard(lock_);
+    for (;;) {
+        wake_.wait(guard, [this]() { return stopping_ || !outgoing_.empty(); });
+        if (outgoing_.empty() && stopping_) return;
+        writing.swap(outgoing_);
+        guard.unlock();
+        fwrite(writing.data(), 1, writing.size(), file_);
+        fflush(file_);
+        writing.clear();
+        guard.lock();
+    }
+}
+
+GameRecordReader::GameRecordReader(const unsigned char* data, size_t size) : data_(data), size_(size) {
+    uint64_t version = 0;
+    if (size_ >= 4 && memcmp(data_, RECORD_MAGIC, 4) == 0) {
+        offset_ = 4;
+        valid_ = getVarint(version) && version == GAME_RECORD_VERSION;
+        if (valid_) complete_ = offset_;
+    }
+}
+
+bool GameRecordReader::getVarint(uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && offset_ < size_; shift += 7) {
+        unsigned char byte = data_[offset_++];
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    offset_ = size_;    // Cut short or corrupt: nothing after this can be trusted
+    return false;
+}
+
+bool GameRecordReader::getTime(double& time) {
+    uint64_t delta;
+    if (!getVarint(delta)) return false;
+    tick_ += (long long)delta;
+    time = (double)tick_ / ticksPerSecond_;
+    return true;
+}
+
+bool GameRecordReader::getString(string& text) {
+    uint64_t length;
+    if (!getVarint(length) || length > size_ - offset_) {
+        offset_ = size_;
+        return false;
+    }
+    text.assign((const char*)data_ + offset_, (size_t)length);
+    offset_ += (size_t)length;
+    return true;
+}
+
+bool GameRecordReader::nextMatch(MatchInfo& info) {
+    if (!valid_) return false;
+    GameEvent skipped;
+    while (inMatch_ && nextEvent(skipped)) {}
+    if (offset_ >= size_ || data_[offset_] != TAG_MATCH) return false;
+    offset_++;
+
+    uint64_t ticksPerSecond, timeLimit, flags, startTick;
+    if (!getVarint(ticksPerSecond) || !getVarint(timeLimit) || !getVarint(flags) || !getVarint(startTick) ||
+        !getString(info.player1Name) || !getString(info.player2Name) || ticksPerSecond == 0) {
+        offset_ = size_;
+        return false;
+    }
+    ticksPerSecond_ = (int)ticksPerSecond;
+    tick_ = (long long)startTick;
+    info.ticksPerSecond = ticksPerSecond_;
+    info.timeLimitPerTurn = (int)timeLimit;
+    info.vsComputer = (flags & 1) != 0;
+    info.startTime = (double)tick_ / ticksPerSecond_;
+    inMatch_ = true;
+    end_ = MatchEnd::Reset;
+    complete_ = offset_;
+    return true;
+}
+
+bool GameRecordReader::nextEvent(GameEvent& event) {
+    if (!inMatch_) return false;
+    // A new match header (or the end of the data) also ends the match
+    if (offset_ >= size_ || data_[offset_] == TAG_MATCH) {
+        inMatch_ = false;
+        return false;
+    }
+    unsigned char tag = data_[offset_++];
+    event = GameEvent();
+    uint64_t value = 0;
+    bool ok = getTime(event.time);
+    switch (tag) {
+    case TAG_TURN_LIMIT: {
+        uint64_t length = 0, base = 0, repeats = 0;
+        event.type = GameEventType::SetTurnLimit;
+        ok = ok && getVarint(value) && getVarint(length) && getVarint(base) && getVarint(repeats);
+        event.turnLimit = (int)value;
+        event.variant.length = (int)length;
+        event.variant.base = (int)base;
+        event.variant.repeats = repeats != 0;
+        break;
+    }
+    case TAG_NUMBER:
+    case TAG_GUESS:
+        event.type = tag == TAG_NUMBER ? GameEventType::SetNumber : GameEventType::Guess;
+        ok = ok && getVarint(value);
+        event.code = (PackedCode)value;
+        break;
+    case TAG_TIMEOUT:
+        event.type = GameEventType::Tick;
+        break;
+    case TAG_END:
+        ok = ok && getVarint(value);
+        end_ = ok && value == (uint64_t)MatchEnd::Finished ? MatchEnd::Finished : MatchEnd::Reset;
+        if (ok) complete_ = offset_;
+        inMatch_ = false;
+        return false;
+    default:
+        ok = false;
+        break;
+    }
+    if (!ok) {
+        offset_ = size_;
+        inMatch_ = false;
+    }
+    else {
+        complete_ = offset_;
+    }
+    return ok;
+}
+
+vector<MatchSummary> replayRecord(const unsigned char* data, size_t size) {
+    vector<MatchSummary> summaries;
+    GameRecordReader reader(data, size);
+    MatchInfo info;
+    GameEvent event;
+    while (reader.nextMatch(info)) {
+        GameState state;
+        state.timeLimitPerTurn = info.timeLimitPerTurn;
+        MatchSummary summary;
+        while (reader.nextEvent(event)) {
+            state = step(state, event);
+            summary.eventsApplied++;
+        }
+        summary.result = state.result;
+        summary.player1Turns = state.player1Turns;
+        summary.player2Turns = state.player2Turns;
+        summaries.push_back(summary);
+    }
+    return summaries;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+// Append-only binary record of played matches, and replay from it.
+//
+// A record file is "NBRC", a format version, then matches back to back. Each
+// match opens with a header record (player names, settings and the tick it
+// started on) and is followed by one record per event the engine accepted:
+// the turn limit, both secrets, every guess and every turn that ran out. An
+// end record says whether the match finished or was reset. Every integer is
+// an LEB128 varint and times are tick deltas from the previous record, so a
+// guess costs 7 bytes or so.
+//
+// The writer only encodes into memory on the caller's thread; a background
+// thread does the file writes, so a slow disk never stalls the frame loop. A
+// file cut short by a crash still reads up to the last complete record, and
+// open() cuts such a file back to that record before appending, so a torn
+// tail cannot swallow the matches written after it.
+//
+// GameRecordReader walks a record in memory (typically a MappedFile), and
+// replayRecord() re-drives step() through every match in it as fast as the
+// engine goes, for regression and analytics runs.
+
+#include "engine/game_engine.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+const uint32_t GAME_RECORD_VERSION = 1;
+
+// Everything a match needs before its first event
+struct MatchInfo {
+    std::string player1Name;
+    std::string player2Name;
+    bool vsComputer = false;
+    int ticksPerSecond = 60;       // Event times are whole ticks of this clock
+    int timeLimitPerTurn = 30;
+    double startTime = 0;          // Time of the header, on the match clock
+};
+
+enum class MatchEnd : uint8_t {
+    Finished,   // Reached game over
+    Reset       // Abandoned (reset or back to the menu) before game over
+};
+
+class GameRecordWriter {
+public:
+    static const size_t FLUSH_BYTES = 4096;   // Handed to the writer thread at this size
+
+    GameRecordWriter() = default;
+    ~GameRecordWriter();
+
+    GameRecordWriter(const GameRecordWriter&) = delete;
+    GameRecordWriter& operator=(const GameRecordWriter&) = delete;
+
+    // Function to open a record file for appending (the file header is
+    // written if it is new, a torn tail cut off); returns false if it cannot
+    // be opened or is not a record of this version
+    bool open(const char* path);
+    // Function to write out everything recorded so far and close the file
+    void close();
+    bool isOpen() const { return file_ != nullptr; }
+
+    // Function to start a match; any match still open is ended as Reset
+    void beginMatch(const MatchInfo& info);
+    // Function to append an event the engine accepted (not Ignored or Rejected)
+    void recordEvent(const GameEvent& event);
+    // Function to end the open match; the bytes go to disk right after
+    void endMatch(double time, MatchEnd how);
+    bool inMatch() const { return inMatch_; }
+
+    // Bytes handed to the writer thread so far
+    uint64_t bytesWritten() const;
+
+private:
+    long long toTick(double time) const;
+    void putVarint(uint64_t value);
+    void putTime(double time);
+    void putString(const std::string& text);
+    void handOff();
+    void run();
+
+    FILE* file_ = nullptr;
+    bool inMatch_ = false;
+    int ticksPerSecond_ = 60;
+    long long lastTick_ = 0;
+    std::vector<unsigned char> pending_;   // Encoded, not yet handed off
+
+    std::thread thread_;
+    mutable std::mutex lock_;
+    std::condition_variable wake_;
+    std::vector<unsigned char> outgoing_;  // Handed off, waiting for the thread
+    bool stopping_ = false;
+    uint64_t handedOff_ = 0;
+};
+
+class GameRecordReader {
+public:
+    GameRecordReader(const unsigned char* data, size_t size);
+
+    // False when the data does not start with a record header of this version
+    bool valid() const { return valid_; }
+
+    // Function to move to the next match header, skipping whatever is left
+    // of the current match; false at the end of the record
+    bool nextMatch(MatchInfo& info);
+    // Function to read the current match's next event; false at its end
+    // record, at the next match, or where the data stops
+    bool nextEvent(GameEvent& event);
+    // How the current match ended, once nextEvent() has returned false
+    // (Reset as well when the record stops before an end record)
+    MatchEnd matchEnd() const { return end_; }
+    // Bytes up to the end of the last complete record read so far
+    size_t completeBytes() const { return complete_; }
+
+private:
+    bool getVarint(uint64_t& value);
+    bool getTime(double& time);
+    bool getString(std::string& text);
+
+    const unsigned char* data_;
+    size_t size_;
+    size_t offset_ = 0;
+    size_t complete_ = 0;
+    bool valid_ = false;
+    bool inMatch_ = false;
+    int ticksPerSecond_ = 60;
+    long long tick_ = 0;
+    MatchEnd end_ = MatchEnd::Reset;
+};
+
+// Function to play every match of a record through step() at full speed;
+// one summary per match, eventsApplied counting the recorded events
+std::vector<MatchSummary> replayRecord(const unsigned char* data, size_t size);
@@ -0,0 +1,153 @@
+#include "engine/hint_engine.h"
+#include "engine/opening_book.h"
+
+#include <cmath>
+#include <cstdint>
+
+using namespace std;
+
+static const uint64_t NO_GUESS = UINT64_MAX;
+static const int GUESSES_PER_CHUNK = 64;
+
+// Function to get c * log2(c) in fixed point for every possible bucket size,
+// so ranking by entropy needs no floating point in the inner loop
+static const uint32_t* bucketEntropyTable() {
+    static const vector<uint32_t> table = [] {
+        vector<uint32_t> values(CODE_COUNT + 1, 0);
+        for (int c = 2; c <= CODE_COUNT; c++) {
+            values[c] = (uint32_t)llround(c * log2((double)c) * 1024.0);
+        }
+        return values;
+    }();
+    return table.data();
+}
+
+// Keys order guesses by their split quality first, then prefer guesses that
+// could win outright, then the lowest code index (so results are repeatable)
+uint64_t rankGuess(HintMode mode, const uint32_t histogram[FEEDBACK_COUNT], bool consistent, CodeIndex guess) {
+    uint64_t quality = 0;
+    if (mode == HintMode::Minimax) {
+        for (int f = 0; f < FEEDBACK_COUNT; f++) {
+            if (histogram[f] > quality) quality = histogram[f];
+        }
+    }
+    else {
+        // Entropy is log2(n) - sum(c * log2(c)) / n; n is fixed, so a smaller sum is better
+        const uint32_t* entropy = bucketEntropyTable();
+        for (int f = 0; f < FEEDBACK_COUNT; f++) {
+            quality += entropy[histogram[f]];
+        }
+    }
+    return (quality << 24) | ((uint64_t)(consistent ? 0 : 1) << 16) | guess;
+}
+
+HintSearch::HintSearch(ThreadPool& pool) : pool_(pool) {
+}
+
+HintSearch::~HintSearch() {
+    cancel();
+    wait();
+}
+
+void HintSearch::start(const CandidateSet& candidates, HintMode mode, const HintOptions& options) {
+    cancel();
+    wait();
+
+    mode_ = mode;
+    candidateSet_ = candidates;
+    candidates_.clear();
+    candidateSet_.appendTo(candidates_);
+    cancelled_ = false;
+    evaluated_ = 0;
+    bestKey_ = NO_GUESS;
+    hasDeadline_ = options.timeBudget > 0;
+    if (hasDeadline_) {
+        deadline_ = chrono::steady_clock::now() +
+            chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(options.timeBudget));
+    }
+    started_ = true;
+    fromBook_ = false;
+
+    order_.clear();
+    CodeIndex bookGuess;
+    if (options.useBook && sharedOpeningBook().guessAt(candidates.bookNode(), bookGuess) &&
+        (!options.candidatesOnly || candidateSet_.contains(bookGuess))) {
+        bestKey_ = bookGuess;
+        fromBook_ = true;
+        return;
+    }
+    if (candidates_.size() <= 2) {
+        // Guessing a candidate is already optimal: it wins or leaves one code
+        if (!candidates_.empty()) bestKey_ = candidates_.indices[0];
+        return;
+    }
+
+    // Candidates first: they are the likeliest winners and give a good
+    // answer early if the search is cut short
+    order_.reserve(CODE_COUNT);
+    order_.insert(order_.end(), candidates_.indices.begin(), candidates_.indices.end());
+    for (int index = 0; index < CODE_COUNT && !options.candidatesOnly; index++) {
+        if (!candidateSet_.contains((CodeIndex)index)) order_.push_back((CodeIndex)index);
+    }
+
+    for (int begin = 0; begin < (int)order_.size(); begin += GUESSES_PER_CHUNK) {
+        int end = begin + GUESSES_PER_CHUNK < (int)order_.size() ? begin + GUESSES_PER_CHUNK : (int)order_.size();
+        tasks_.add();
+        pool_.submit([this, begin, end] { searchChunk(begin, end); });
+    }
+}
+
+void HintSearch::cancel() {
+    cancelled_ = true;
+}
+
+void HintSearch::wait() {
+    tasks_.wait();
+}
+
+bool HintSearch::shouldStop() const {
+    if (cancelled_.load(memory_order_relaxed)) return true;
+    return hasDeadline_ && chrono::steady_clock::now() >= deadline_;
+}
+
+void HintSearch::searchChunk(int begin, int end) {
+    uint32_t histogram[FEEDBACK_COUNT];
+    uint64_t localBest = NO_GUESS;
+    int evaluated = 0;
+    for (int i = begin; i < end && !shouldStop(); i++) {
+        CodeIndex guess = order_[i];
+        scoreCandidates(codeAt(guess), candidates_, nullptr, histogram);
+        uint64_t key = rankGuess(mode_, histogram, candidateSet_.contains(guess), guess);
+        if (key < localBest) localBest = key;
+        evaluated++;
+    }
+
+    uint64_t current = bestKey_.load();
+    while (localBest < current && !bestKey_.compare_exchange_weak(current, localBest)) {
+    }
+    evaluated_ += evaluated;
+    tasks_.done();
+}
+
+HintResult HintSearch::best() const {
+    HintResult result;
+    uint64_t key = bestKey_.load();
+    result.evaluated = evaluated_.load();
+    result.complete = started_ && (order_.empty() || result.evaluated == (int)order_.size());
+    result.fromBook = fromBook_;
+    if (key == NO_GUESS) return result;
+
+    result.found = true;
+    result.guess = (CodeIndex)(key & 0xFFFF);
+    result.consistent = candidateSet_.contains(result.guess);
+
+    uint32_t histogram[FEEDBACK_COUNT];
+    scoreCandidates(codeAt(result.guess), candidates_, nullptr, histogram);
+    double sumSquares = 0;
+    for (int f = 0; f < FEEDBACK_COUNT; f++) {
+        if ((int)histogram[f] > result.worstCase) result.worstCase = histogram[f];
+        sumSquares += (double)histogram[f] * histogram[f];
+    }
+    result.expectedLeft = candidates_.empty() ? 0 : sumSquares / candidates_.size();
+    return result;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+// Background search for the next guess to suggest.
+//
+// Every code is tried as a guess against the remaining candidates (up to
+// 5040 x 5040 scorings) and ranked by how well it splits them: Knuth-style
+// minimax (smallest worst-case bucket) or expected entropy (most information
+// on average). The guesses are cut into chunks and spread over a thread pool,
+// so the caller never blocks; best() can be read at any time and always
+// holds the best guess found so far, which is what a cancelled or
+// out-of-time search returns. While the guesses so far follow the opening
+// book, the answer is a lookup and no search runs at all.
+
+#include "engine/batch_scoring.h"
+#include "engine/candidate_set.h"
+#include "engine/thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+
+enum class HintMode {
+    Minimax,    // Minimize the largest group of candidates left after the guess
+    Entropy     // Maximize the expected information of the feedback
+};
+
+struct HintResult {
+    bool found = false;
+    CodeIndex guess = 0;
+    bool consistent = false;    // The guess could itself be the secret
+    int worstCase = 0;          // Candidates left in the largest feedback group
+    double expectedLeft = 0;    // Average candidates left after the feedback
+    int evaluated = 0;          // Guesses scored when this result was read
+    bool complete = false;      // Every guess was scored
+    bool fromBook = false;      // Looked up in the opening book
+};
+
+struct HintOptions {
+    double timeBudget = 0;          // > 0 stops the search by itself after that many seconds
+    bool candidatesOnly = false;    // Only try the candidates themselves as guesses
+    bool useBook = true;            // Answer from the opening book while still in it
+};
+
+class HintSearch {
+public:
+    explicit HintSearch(ThreadPool& pool = sharedThreadPool());
+    ~HintSearch();
+
+    HintSearch(const HintSearch&) = delete;
+    HintSearch& operator=(const HintSearch&) = delete;
+
+    // Function to start a search over a candidate set (it is copied, so the
+    // caller may keep updating its own). A running search is cancelled first.
+    void start(const CandidateSet& candidates, HintMode mode, const HintOptions& options = HintOptions());
+
+    // Function to stop the search early; best() keeps the best guess so far
+    void cancel();
+
+    // Function to block until every chunk has stopped
+    void wait();
+
+    bool isRunning() const { return started_ && !tasks_.idle(); }
+    bool isStarted() const { return started_; }
+
+    HintResult best() const;
+
+private:
+    void searchChunk(int begin, int end);
+    bool shouldStop() const;
+
+    ThreadPool& pool_;
+    TaskGroup tasks_;
+    bool started_ = false;
+    bool fromBook_ = false;
+    HintMode mode_ = HintMode::Minimax;
+    CandidateBuffer candidates_;
+    CandidateSet candidateSet_;
+    std::vector<CodeIndex> order_;    // Guesses in the order they are tried
+    std::atomic<bool> cancelled_{ false };
+    std::atomic<uint64_t> bestKey_{ 0 };
+    std::atomic<int> evaluated_{ 0 };
+    std::chrono::steady_clock::time_point deadline_;
+    bool hasDeadline_ = false;
+};
+
+// Function to rank a single guess's feedback histogram; smaller is better.
+// Exposed so bots and analysis tools rank guesses exactly like the hints.
+uint64_t rankGuess(HintMode mode, const uint32_t histogram[FEEDBACK_COUNT], bool consistent, CodeIndex guess);
@@ -0,0 +1,13 @@
+#include "engine/input_queue.h"
+
+bool InputQueue::push(int key, int text, double time) {
+    if (size_ == CAPACITY) {
+        dropped_++;
+        return false;
+    }
+    Event& event = events_[size_++];
+    event.key = key;
+    event.text = text;
+    event.time = time;
+    return true;
+}
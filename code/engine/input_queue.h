@@ -0,0 +1,42 @@
+#pragma once
+
+// Keyboard input of one frame, as an ordered list of typed events.
+//
+// The window's key and character queues are drained completely at the start
+// of every frame (see DrainInput() in main.cpp), so keys typed faster than
+// the frame rate all arrive in the same frame instead of being dropped or
+// trickling in one per frame. Events are then handed, in order, to whichever
+// screen is active when each one is reached, so the keys after an ENTER that
+// changes screens go to the new screen.
+//
+// Each event keeps the time the game first saw it, which the loop uses to
+// measure how long a keystroke takes to reach the screen.
+
+class InputQueue {
+public:
+    // Twice the window's own queues (16 keys and 16 characters a frame)
+    static const int CAPACITY = 64;
+
+    struct Event {
+        int key = 0;        // Key code, or 0 for text with no key of its own
+        int text = 0;       // Unicode code point the key typed, or 0
+        double time = 0;    // Seconds, on the clock the window reports
+    };
+
+    void clear() { size_ = 0; }
+
+    // Function to add an event; returns false (and drops it) when full
+    bool push(int key, int text, double time);
+
+    int size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const Event& operator[](int index) const { return events_[index]; }
+
+    // Events dropped because the queue was full, since construction
+    long long dropped() const { return dropped_; }
+
+private:
+    Event events_[CAPACITY];
+    int size_ = 0;
+    long long dropped_ = 0;
+};
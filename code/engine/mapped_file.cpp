@@ -0,0 +1,110 @@
+#include "engine/mapped_file.h"
+
+#if defined(_WIN32)
+#define NOGDI
+#define NOUSER
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::open(const char* path) {
+    close();
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    file_ = file;
+    mapping_ = mapping;
+    data_ = (const unsigned char*)view;
+    size_ = (size_t)fileSize.QuadPart;
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle((HANDLE)mapping_);
+    if (file_) CloseHandle((HANDLE)file_);
+    data_ = nullptr;
+    mapping_ = nullptr;
+    file_ = nullptr;
+    size_ = 0;
+}
+
+bool truncateFile(const char* path, uint64_t size) {
+    HANDLE file = CreateFileA(path, GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER end;
+    end.QuadPart = (LONGLONG)size;
+    bool ok = SetFilePointerEx(file, end, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+    CloseHandle(file);
+    return ok;
+}
+
+#else
+
+bool MappedFile::open(const char* path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // The mapping keeps the file alive
+    if (view == MAP_FAILED) return false;
+
+    data_ = (const unsigned char*)view;
+    size_ = (size_t)info.st_size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) munmap((void*)data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+}
+
+bool truncateFile(const char* path, uint64_t size) {
+    return truncate(path, (off_t)size) == 0;
+}
+
+#endif
+
+uint64_t fnv1a(uint64_t hash, const unsigned char* bytes, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+// Read-only memory mapping of a whole file. Several processes mapping the same
+// file share one page-cache copy, and nothing is read until it is touched.
+
+#include <cstddef>
+#include <cstdint>
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Function to map a file; returns false (and stays closed) on any failure
+    bool open(const char* path);
+    void close();
+
+    bool isOpen() const { return data_ != nullptr; }
+    const unsigned char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+#if defined(_WIN32)
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
+
+// Function to cut a file down to size bytes; false if it cannot be
+bool truncateFile(const char* path, uint64_t size);
+
+// Checksum used by the mapped file formats: 64-bit FNV-1a, continued over
+// each block of bytes starting from FNV_OFFSET
+const uint64_t FNV_OFFSET = 14695981039346656037ull;
+
+uint64_t fnv1a(uint64_t hash, const unsigned char* bytes, size_t count);
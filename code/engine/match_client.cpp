@@ -0,0 +1,193 @@
+#include "engine/match_client.h"
+
+#include <cstring>
+
+#if defined(_WIN32)
+#define NOGDI
+#define NOUSER
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// A server that has gone away must not kill the game with SIGPIPE
+#if defined(MSG_NOSIGNAL)
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+#if defined(_WIN32)
+
+static bool startSockets() {
+    static bool started = false;
+    WSADATA data;
+    if (!started) started = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    return started;
+}
+
+static void closeSocket(intptr_t socket) {
+    closesocket((SOCKET)socket);
+}
+
+static bool makeNonBlocking(intptr_t socket) {
+    u_long on = 1;
+    return ioctlsocket((SOCKET)socket, FIONBIO, &on) == 0;
+}
+
+static bool wouldBlock() {
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+
+#else
+
+static bool startSockets() {
+    return true;
+}
+
+static void closeSocket(intptr_t socket) {
+    ::close((int)socket);
+}
+
+static bool makeNonBlocking(intptr_t socket) {
+    int flags = fcntl((int)socket, F_GETFL, 0);
+    return flags >= 0 && fcntl((int)socket, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static bool wouldBlock() {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+#endif
+
+MatchClient::~MatchClient() {
+    close();
+}
+
+bool MatchClient::connect(const char* server) {
+    close();
+    const char* colon = strrchr(server, ':');
+    if (!colon || colon == server || !startSockets()) return false;
+    char host[256];
+    size_t hostLength = (size_t)(colon - server);
+    if (hostLength >= sizeof(host)) return false;
+    memcpy(host, server, hostLength);
+    host[hostLength] = '\0';
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    if (getaddrinfo(host, colon + 1, &hints, &found) != 0) return false;
+
+    for (addrinfo* address = found; address && socket_ == INVALID; address = address->ai_next) {
+        intptr_t candidate = (intptr_t)::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (candidate == INVALID) continue;
+        if (::connect(candidate, address->ai_addr, (int)address->ai_addrlen) != 0 || !makeNonBlocking(candidate)) {
+            closeSocket(candidate);
+            continue;
+        }
+        // Moves are a few bytes each and should leave at once
+        int on = 1;
+        setsockopt(candidate, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+        socket_ = candidate;
+    }
+    freeaddrinfo(found);
+    readUsed_ = 0;
+    readOffset_ = 0;
+    writeUsed_ = 0;
+    return socket_ != INVALID;
+}
+
+void MatchClient::close() {
+    if (socket_ == INVALID) return;
+    closeSocket(socket_);
+    socket_ = INVALID;
+}
+
+bool MatchClient::flush() {
+    size_t sent = 0;
+    while (sent < writeUsed_) {
+        int result = (int)::send(socket_, (const char*)writeBuffer_ + sent, (int)(writeUsed_ - sent), SEND_FLAGS);
+        if (result < 0 && wouldBlock()) break;
+        if (result <= 0) {
+            close();
+            return false;
+        }
+        sent += (size_t)result;
+    }
+    memmove(writeBuffer_, writeBuffer_ + sent, writeUsed_ - sent);
+    writeUsed_ -= sent;
+    return true;
+}
+
+bool MatchClient::send(const NetMessage& message) {
+    if (socket_ == INVALID) return false;
+    // Whatever the socket would not take stays queued behind earlier frames
+    if (writeUsed_ + NET_MAX_FRAME > WRITE_BUFFER && !(flush() && writeUsed_ + NET_MAX_FRAME <= WRITE_BUFFER)) {
+        close();
+        return false;
+    }
+    writeUsed_ += encodeMessage(message, writeBuffer_ + writeUsed_);
+    return flush();
+}
+
+bool MatchClient::sendHello(const char* name) {
+    NetMessage message;
+    message.type = NetMessageType::Hello;
+    setMessageText(message, name);
+    return send(message);
+}
+
+bool MatchClient::sendTurnLimit(int turnLimit, const GameVariant& variant) {
+    NetMessage message;
+    message.type = NetMessageType::SetTurnLimit;
+    message.turnLimit = turnLimit;
+    message.variant = variant;
+    return send(message);
+}
+
+bool MatchClient::sendNumber(NetMessageType type, const char* text) {
+    NetMessage message;
+    message.type = type;
+    setMessageText(message, text);
+    return send(message);
+}
+
+bool MatchClient::receive(NetMessage& message) {
+    if (socket_ != INVALID && writeUsed_ > 0 && !flush()) return false;
+    for (;;) {
+        int length = decodeMessage(readBuffer_ + readOffset_, readUsed_ - readOffset_, message);
+        if (length > 0) {
+            readOffset_ += (size_t)length;
+            return true;
+        }
+        if (length < 0 || socket_ == INVALID) {
+            close();
+            return false;
+        }
+
+        // Keep the partial frame and read whatever else has arrived
+        memmove(readBuffer_, readBuffer_ + readOffset_, readUsed_ - readOffset_);
+        readUsed_ -= readOffset_;
+        readOffset_ = 0;
+        int received = (int)recv(socket_, (char*)readBuffer_ + readUsed_, (int)(READ_BUFFER - readUsed_), 0);
+        if (received < 0 && wouldBlock()) return false;
+        if (received <= 0) {
+            close();
+            return false;
+        }
+        readUsed_ += (size_t)received;
+    }
+}
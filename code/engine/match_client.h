@@ -0,0 +1,59 @@
+#pragma once
+
+// Client end of the match server's protocol (engine/match_protocol.h): a
+// TCP connection that sends intents and hands back whatever messages have
+// arrived, never waiting for more. Frames the socket will not take yet wait
+// in a write buffer that every send() and receive() pushes on, so a server
+// that stops reading never stalls the caller. Works with POSIX sockets and
+// Winsock.
+
+#include "engine/match_protocol.h"
+
+#include <cstddef>
+#include <cstdint>
+
+class MatchClient {
+public:
+    static const size_t READ_BUFFER = 1024;
+    static const size_t WRITE_BUFFER = 16 * NET_MAX_FRAME;   // A server this far behind is gone
+
+    MatchClient() = default;
+    ~MatchClient();
+
+    MatchClient(const MatchClient&) = delete;
+    MatchClient& operator=(const MatchClient&) = delete;
+
+    // Function to connect to a server given as "host:port" (an IPv4 address
+    // or a name). Connecting waits for the server to answer; everything
+    // after it is non-blocking. Returns false on any failure.
+    bool connect(const char* server);
+    void close();
+    bool isConnected() const { return socket_ != INVALID; }
+    // The socket, for waiting on many clients at once (epoll, select)
+    intptr_t handle() const { return socket_; }
+
+    // Function to send one message; a failed send, or one the write buffer
+    // has no room left for, closes the connection
+    bool send(const NetMessage& message);
+    bool sendHello(const char* name);
+    bool sendTurnLimit(int turnLimit, const GameVariant& variant);
+    // type is SetNumber or Guess; text is the number as typed
+    bool sendNumber(NetMessageType type, const char* text);
+
+    // Function to take the next message that has arrived; false when there
+    // is none yet, or when the connection has dropped (see isConnected())
+    bool receive(NetMessage& message);
+
+private:
+    static const intptr_t INVALID = -1;
+
+    // Function to write out as much of the write buffer as the socket takes
+    bool flush();
+
+    intptr_t socket_ = INVALID;
+    size_t readUsed_ = 0;
+    size_t readOffset_ = 0;
+    unsigned char readBuffer_[READ_BUFFER];
+    size_t writeUsed_ = 0;
+    unsigned char writeBuffer_[WRITE_BUFFER];
+};
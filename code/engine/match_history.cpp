@@ -0,0 +1,74 @@
+#include "engine/match_history.h"
+#include "engine/game_engine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace std;
+
+void MatchHistory::clear() {
+    rows_.clear();
+    oldest_ = 0;
+    total_ = 0;
+}
+
+void MatchHistory::push(const HistoryEntry& entry) {
+    if ((int)rows_.size() < CAPACITY) {
+        rows_.push_back(entry);
+    }
+    else {
+        rows_[oldest_] = entry;
+        oldest_ = (oldest_ + 1) % CAPACITY;
+    }
+    total_++;
+}
+
+const HistoryEntry& MatchHistory::operator[](int index) const {
+    int slot = oldest_ + index;
+    if (slot >= CAPACITY) slot -= CAPACITY;
+    return rows_[slot];
+}
+
+string describeHistoryEntry(const HistoryEntry& entry, const string& playerName, const GameVariant& variant) {
+    char line[128];
+    return describeHistoryEntry(entry, playerName.c_str(), variant, line, sizeof(line));
+}
+
+const char* describeHistoryEntry(const HistoryEntry& entry, const char* playerName,
+    const GameVariant& variant, char* buffer, size_t size) {
+    switch (entry.kind) {
+    case HistoryKind::Win:
+        snprintf(buffer, size, "%s", entry.byPlayer1 ? "Player 1 wins!" : "Player 2 wins!");
+        break;
+    case HistoryKind::TimedOut:
+        snprintf(buffer, size, "%s ran out of time!", playerName);
+        break;
+    case HistoryKind::Draw:
+        snprintf(buffer, size, "Turn limit reached! It's a draw.");
+        break;
+    default: {
+        char guess[MAX_VARIANT_LENGTH + 1];
+        formatCode(entry.code, variant, guess);
+        describeGuess(buffer, size, playerName, guess, entry.correctDigits, entry.correctPositions);
+        break;
+    }
+    }
+    return buffer;
+}
+
+HistoryWindow visibleHistoryRows(int rowCount, float rowHeight, float scrollOffset, float viewHeight) {
+    HistoryWindow window;
+    if (rowCount <= 0 || rowHeight <= 0) return window;
+
+    int first = (int)floor(scrollOffset / rowHeight);
+    int last = (int)ceil((scrollOffset + viewHeight) / rowHeight);   // One past the last
+    first = max(first, 0);
+    last = min(last, rowCount);
+    if (last <= first) return window;
+
+    window.first = first;
+    window.count = last - first;
+    window.firstY = first * rowHeight - scrollOffset;
+    return window;
+}
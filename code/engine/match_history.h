@@ -0,0 +1,75 @@
+#pragma once
+
+// Feedback history of a match, as fixed-size records instead of text.
+//
+// Rows live in a ring that stops growing at CAPACITY, after which the oldest
+// rows are overwritten, so an endless match uses bounded memory. Text is only
+// built for the rows being drawn (describeHistoryEntry()), and the rows that
+// fall inside a scrolled view are found by arithmetic (visibleHistoryRows()),
+// so drawing costs the same however long the history grows.
+
+#include "engine/packed_code.h"
+#include "engine/variant.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class HistoryKind : uint8_t {
+    Guess,      // Scored guess that did not win
+    Win,        // Guess that matched the opponent's number
+    TimedOut,   // Player ran out of time (code and counts unused)
+    Draw        // Scored guess that used up the last turn
+};
+
+struct HistoryEntry {
+    PackedCode code = 0;        // Guess, packed for the match's variant
+    float time = 0;             // Seconds on the clock that drives the match
+    HistoryKind kind = HistoryKind::Guess;
+    bool byPlayer1 = true;
+    uint8_t correctDigits = 0;
+    uint8_t correctPositions = 0;
+};
+
+class MatchHistory {
+public:
+    static const int CAPACITY = 4096;
+
+    // The ring is allocated up front, so pushing a row never allocates
+    MatchHistory() { rows_.reserve(CAPACITY); }
+
+    void clear();
+    void push(const HistoryEntry& entry);
+
+    // Rows kept, at most CAPACITY; index 0 is the oldest of them
+    int size() const { return (int)rows_.size(); }
+    bool empty() const { return rows_.empty(); }
+    const HistoryEntry& operator[](int index) const;
+
+    // Rows ever pushed since the last clear(), including overwritten ones
+    long long total() const { return total_; }
+
+private:
+    std::vector<HistoryEntry> rows_;
+    int oldest_ = 0;
+    long long total_ = 0;
+};
+
+// Function to write a row the way the history shows it
+std::string describeHistoryEntry(const HistoryEntry& entry, const std::string& playerName,
+    const GameVariant& variant);
+
+// The same into a buffer (truncated to fit); returns the buffer
+const char* describeHistoryEntry(const HistoryEntry& entry, const char* playerName,
+    const GameVariant& variant, char* buffer, size_t size);
+
+// Rows of a list that are at least partly inside a scrolled view
+struct HistoryWindow {
+    int first = 0;          // Index of the first visible row
+    int count = 0;          // Number of visible rows
+    float firstY = 0;       // Top of the first row, relative to the top of the view
+};
+
+// Function to find the rows of rowCount equal-height rows that show in a view
+// of viewHeight scrolled down by scrollOffset
+HistoryWindow visibleHistoryRows(int rowCount, float rowHeight, float scrollOffset, float viewHeight);
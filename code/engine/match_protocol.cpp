@@ -0,0 +1,193 @@
+#include "engine/match_protocol.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+static const size_t TURN_LIMIT_BYTES = 4;
+static const size_t UPDATE_BYTES = 23;
+
+static void putU16(unsigned char* out, unsigned value) {
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+}
+
+static void putU32(unsigned char* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out[i] = (unsigned char)(value >> (8 * i));
+}
+
+static unsigned getU16(const unsigned char* data) {
+    return data[0] | (unsigned)data[1] << 8;
+}
+
+static uint32_t getU32(const unsigned char* data) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) value |= (uint32_t)data[i] << (8 * i);
+    return value;
+}
+
+static size_t putText(unsigned char* out, const char* text) {
+    size_t length = strnlen(text, NET_TEXT_BYTES - 1);
+    memcpy(out, text, length);
+    return length;
+}
+
+// Text must fit NET_TEXT_BYTES with its terminator; longer is a bad frame
+static bool getText(const unsigned char* data, size_t length, char* text) {
+    if (length >= (size_t)NET_TEXT_BYTES) return false;
+    memcpy(text, data, length);
+    text[length] = '\0';
+    return true;
+}
+
+static void putUpdate(unsigned char* out, const MatchUpdate& update) {
+    out[0] = (unsigned char)update.outcome;
+    out[1] = update.byPlayer1 ? 1 : 0;
+    out[2] = (unsigned char)update.correctDigits;
+    out[3] = (unsigned char)update.correctPositions;
+    putU32(out + 4, update.code);
+    out[8] = (unsigned char)update.phase;
+    out[9] = (unsigned char)update.result;
+    out[10] = update.player1Turn ? 1 : 0;
+    out[11] = (unsigned char)update.turnLimit;
+    out[12] = (unsigned char)update.variant.length;
+    out[13] = (unsigned char)update.variant.base;
+    out[14] = update.variant.repeats ? 1 : 0;
+    putU16(out + 15, (unsigned)update.timeLimitPerTurn);
+    out[17] = (unsigned char)update.player1Turns;
+    out[18] = (unsigned char)update.player2Turns;
+    putU32(out + 19, (uint32_t)llround(max(update.turnElapsed, 0.0) * 1000));
+}
+
+static bool getUpdate(const unsigned char* data, MatchUpdate& update) {
+    if (data[0] > (unsigned char)StepOutcome::TimedOut || data[8] > (unsigned char)GamePhase::GameOver ||
+        data[9] > (unsigned char)GameResult::Draw) {
+        return false;
+    }
+    update.outcome = (StepOutcome)data[0];
+    update.byPlayer1 = data[1] != 0;
+    update.correctDigits = data[2];
+    update.correctPositions = data[3];
+    update.code = getU32(data + 4);
+    update.phase = (GamePhase)data[8];
+    update.result = (GameResult)data[9];
+    update.player1Turn = data[10] != 0;
+    update.turnLimit = data[11];
+    update.variant.length = data[12];
+    update.variant.base = data[13];
+    update.variant.repeats = data[14] != 0;
+    update.timeLimitPerTurn = (int)getU16(data + 15);
+    update.player1Turns = data[17];
+    update.player2Turns = data[18];
+    update.turnElapsed = getU32(data + 19) / 1000.0;
+    return true;
+}
+
+size_t encodeMessage(const NetMessage& message, unsigned char* out) {
+    unsigned char* payload = out + 2;
+    size_t length = 0;
+    switch (message.type) {
+    case NetMessageType::Hello:
+    case NetMessageType::SetNumber:
+    case NetMessageType::Guess:
+    case NetMessageType::Rejected:
+        length = putText(payload, message.text);
+        break;
+    case NetMessageType::SetTurnLimit:
+        payload[0] = (unsigned char)min(max(message.turnLimit, 0), 255);
+        payload[1] = (unsigned char)message.variant.length;
+        payload[2] = (unsigned char)message.variant.base;
+        payload[3] = message.variant.repeats ? 1 : 0;
+        length = TURN_LIMIT_BYTES;
+        break;
+    case NetMessageType::Matched:
+        payload[0] = (unsigned char)message.seat;
+        length = 1 + putText(payload + 1, message.text);
+        break;
+    case NetMessageType::Update:
+        putUpdate(payload, message.update);
+        length = UPDATE_BYTES;
+        break;
+    case NetMessageType::OpponentLeft:
+        break;
+    }
+    out[0] = (unsigned char)length;
+    out[1] = (unsigned char)message.type;
+    return 2 + length;
+}
+
+int decodeMessage(const unsigned char* data, size_t size, NetMessage& message) {
+    if (size < 2 || size < 2 + (size_t)data[0]) return 0;
+    size_t length = data[0];
+    const unsigned char* payload = data + 2;
+    message.type = (NetMessageType)data[1];
+    bool ok = false;
+    switch (message.type) {
+    case NetMessageType::Hello:
+    case NetMessageType::SetNumber:
+    case NetMessageType::Guess:
+    case NetMessageType::Rejected:
+        ok = getText(payload, length, message.text);
+        break;
+    case NetMessageType::SetTurnLimit:
+        ok = length == TURN_LIMIT_BYTES;
+        if (ok) {
+            message.turnLimit = payload[0];
+            message.variant.length = payload[1];
+            message.variant.base = payload[2];
+            message.variant.repeats = payload[3] != 0;
+        }
+        break;
+    case NetMessageType::Matched:
+        ok = length >= 1 && payload[0] <= 1 && getText(payload + 1, length - 1, message.text);
+        if (ok) message.seat = payload[0];
+        break;
+    case NetMessageType::Update:
+        ok = length == UPDATE_BYTES && getUpdate(payload, message.update);
+        break;
+    case NetMessageType::OpponentLeft:
+        ok = length == 0;
+        break;
+    }
+    return ok ? (int)(2 + length) : -1;
+}
+
+void setMessageText(NetMessage& message, const char* text) {
+    strncpy(message.text, text, NET_TEXT_BYTES - 1);
+    message.text[NET_TEXT_BYTES - 1] = '\0';
+}
+
+MatchUpdate publicUpdate(const GameState& state, const StepResult& result, PackedCode guess, double now) {
+    MatchUpdate update;
+    update.outcome = result.outcome;
+    update.byPlayer1 = result.byPlayer1;
+    update.correctDigits = result.correctDigits;
+    update.correctPositions = result.correctPositions;
+    if (result.outcome == StepOutcome::Scored || result.outcome == StepOutcome::Won) {
+        update.code = guess;
+    }
+    update.phase = state.phase;
+    update.result = state.result;
+    update.player1Turn = state.player1Turn;
+    update.turnLimit = state.turnLimit;
+    update.variant = state.variant;
+    update.timeLimitPerTurn = state.timeLimitPerTurn;
+    update.player1Turns = state.player1Turns;
+    update.player2Turns = state.player2Turns;
+    update.turnElapsed = state.phase == GamePhase::Guessing ? max(now - state.startTime, 0.0) : 0;
+    return update;
+}
+
+void applyUpdate(GameState& state, const MatchUpdate& update, double now) {
+    state.phase = update.phase;
+    state.result = update.result;
+    state.player1Turn = update.player1Turn;
+    state.turnLimit = update.turnLimit;
+    state.variant = update.variant;
+    state.timeLimitPerTurn = update.timeLimitPerTurn;
+    state.player1Turns = update.player1Turns;
+    state.player2Turns = update.player2Turns;
+    state.startTime = now - update.turnElapsed;
+}
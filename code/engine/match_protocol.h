@@ -0,0 +1,86 @@
+#pragma once
+
+// Binary protocol between the match server (engine/match_server.h) and its
+// clients.
+//
+// Every message is one frame: a payload length byte, a type byte, then the
+// payload, so the largest frame is 257 bytes and a guess is 6. Integers are
+// little-endian and text is raw bytes up to the end of the payload.
+//
+// Clients only send intents (a name, the rules, a typed number); the server
+// validates them and answers with MatchUpdates. An update carries what step()
+// did and the public part of the match state: whose turn it is, the turn
+// counts and how much of the current turn has been used, but never either
+// player's secret number. A guess is public once it is made, so scored and
+// winning guesses carry their code.
+
+#include "engine/game_engine.h"
+
+#include <cstddef>
+#include <cstdint>
+
+const int NET_TEXT_BYTES = 32;         // Names, typed numbers and errors, terminated
+const size_t NET_MAX_FRAME = 2 + 255;
+
+enum class NetMessageType : uint8_t {
+    // Client to server
+    Hello = 1,          // text: player name; joins the queue for the next match
+    SetTurnLimit = 2,   // turnLimit and variant (player 1 only)
+    SetNumber = 3,      // text: the secret number as typed
+    Guess = 4,          // text: the guess as typed
+
+    // Server to client
+    Matched = 16,       // seat, text: the opponent's name
+    Update = 17,        // update
+    Rejected = 18,      // text: why the last message was not applied
+    OpponentLeft = 19   // The match is over; send Hello to play again
+};
+
+// What a step() did and the state it left, minus the secrets
+struct MatchUpdate {
+    StepOutcome outcome = StepOutcome::Ignored;   // Ignored for the opening update
+    bool byPlayer1 = true;
+    int correctDigits = 0;
+    int correctPositions = 0;
+    PackedCode code = 0;            // The guess, for Scored and Won only
+    GamePhase phase = GamePhase::SettingTurnLimit;
+    GameResult result = GameResult::None;
+    bool player1Turn = true;
+    int turnLimit = 0;
+    GameVariant variant;
+    int timeLimitPerTurn = 30;
+    int player1Turns = 0;
+    int player2Turns = 0;
+    double turnElapsed = 0;         // Seconds of the current turn used (ms precision)
+};
+
+// One decoded message; only the fields of its type are meaningful
+struct NetMessage {
+    NetMessageType type = NetMessageType::Hello;
+    char text[NET_TEXT_BYTES] = {};
+    int seat = 0;                   // Matched: 0 plays as player 1, 1 as player 2
+    int turnLimit = 0;
+    GameVariant variant;
+    MatchUpdate update;
+};
+
+// Function to encode a message into out (at least NET_MAX_FRAME bytes);
+// returns the frame length
+size_t encodeMessage(const NetMessage& message, unsigned char* out);
+
+// Function to decode the frame at the start of data; returns its length, 0
+// when the frame is not complete yet, or -1 when the data is not a valid
+// frame (the connection should be dropped)
+int decodeMessage(const unsigned char* data, size_t size, NetMessage& message);
+
+// Function to copy text into a message (truncated, always terminated)
+void setMessageText(NetMessage& message, const char* text);
+
+// Function to describe a step() for the players: the outcome and the state
+// it left, with both secret numbers left out. now is the match clock's time.
+MatchUpdate publicUpdate(const GameState& state, const StepResult& result, PackedCode guess, double now);
+
+// Function to bring a client's copy of the match up to date; now is the
+// client's clock, from which the current turn's start is worked out. The
+// secret numbers in state are left as they are.
+void applyUpdate(GameState& state, const MatchUpdate& update, double now);
@@ -0,0 +1,516 @@
+#include "engine/match_server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+// epoll tag of the listening socket; connections are tagged with their
+// generation and slot
+static const uint64_t LISTENER_TAG = ~0ull;
+
+static uint64_t connectionTag(int index, uint32_t generation) {
+    return (uint64_t)generation << 32 | (uint32_t)index;
+}
+
+// Earliest deadline on top
+bool MatchServer::laterDeadline(const Deadline& a, const Deadline& b) {
+    return a.tick > b.tick;
+}
+
+MatchServer::MatchServer(const GameClock& clock, int ticksPerSecond) : timer_(clock, ticksPerSecond) {
+    epoll_ = epoll_create1(0);
+}
+
+MatchServer::~MatchServer() {
+    for (int i = 0; i < (int)connections_.size(); i++) {
+        if (connections_[i].fd >= 0) ::close(connections_[i].fd);
+    }
+    if (listener_ >= 0) ::close(listener_);
+    if (epoll_ >= 0) ::close(epoll_);
+}
+
+bool MatchServer::listen(const char* address, int port) {
+    if (epoll_ < 0 || listener_ >= 0) return false;
+    sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, address, &local.sin_addr) != 1) return false;
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    socklen_t length = sizeof(local);
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u64 = LISTENER_TAG;
+    if (::bind(fd, (sockaddr*)&local, sizeof(local)) != 0 || ::listen(fd, SOMAXCONN) != 0 ||
+        getsockname(fd, (sockaddr*)&local, &length) != 0 || epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event) != 0) {
+        ::close(fd);
+        return false;
+    }
+    listener_ = fd;
+    port_ = ntohs(local.sin_port);
+    return true;
+}
+
+ServerStats MatchServer::stats() const {
+    ServerStats stats = stats_;
+    stats.connections = (int)(connections_.size() - freeConnections_.size());
+    stats.matches = (int)(matches_.size() - freeMatches_.size());
+    stats.waiting = (int)waiting_.size();
+    return stats;
+}
+
+int MatchServer::waitTimeout(int maxWaitMs) const {
+    // Waiting players' windows widen with time, so they are looked at again
+    // (and results held back for the store are tried again)
+    if (waiting_.size() >= 2 || !unrecorded_.empty()) maxWaitMs = min(maxWaitMs, QUEUE_SWEEP_MS);
+    if (deadlines_.empty()) return maxWaitMs;
+    double wait = timer_.tickTime(deadlines_.front().tick) - timer_.tickTime(timer_.currentTick());
+    int waitMs = (int)ceil(wait * 1000);
+    return max(0, min(waitMs, maxWaitMs));
+}
+
+void MatchServer::poll(int maxWaitMs) {
+    epoll_event events[MAX_EVENTS];
+    int count = epoll_wait(epoll_, events, MAX_EVENTS, waitTimeout(maxWaitMs));
+    for (int i = 0; i < count; i++) {
+        if (events[i].data.u64 == LISTENER_TAG) {
+            acceptConnections();
+            continue;
+        }
+        int index = (int)(uint32_t)events[i].data.u64;
+        uint32_t generation = (uint32_t)(events[i].data.u64 >> 32);
+        // Closed (and maybe reused) earlier in this batch
+        if (connections_[index].fd < 0 || connections_[index].generation != generation) continue;
+
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+            closeConnection(index);
+            continue;
+        }
+        if (events[i].events & EPOLLOUT) flushConnection(index);
+        if (connections_[index].fd >= 0 && (events[i].events & EPOLLIN)) readConnection(index);
+    }
+    expireDue();
+    if (waiting_.size() >= 2) pairWaiting();
+    if (!unrecorded_.empty()) recordPending();
+}
+
+void MatchServer::acceptConnections() {
+    for (;;) {
+        int fd = accept4(listener_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;     // EAGAIN once the queue is drained, or out of descriptors
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        int index;
+        if (!freeConnections_.empty()) {
+            index = freeConnections_.back();
+            freeConnections_.pop_back();
+        }
+        else {
+            index = (int)connections_.size();
+            connections_.emplace_back();
+        }
+        Connection& connection = connections_[index];
+        connection.fd = fd;
+        connection.match = -1;
+        connection.readUsed = 0;
+        connection.writeArmed = false;
+        connection.backlog.clear();
+        connection.name[0] = '\0';
+
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u64 = connectionTag(index, connection.generation);
+        if (epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event) != 0) closeConnection(index);
+    }
+}
+
+void MatchServer::readConnection(int index) {
+    for (;;) {
+        Connection& connection = connections_[index];
+        ssize_t received = recv(connection.fd, connection.readBuffer + connection.readUsed,
+            READ_BUFFER - connection.readUsed, 0);
+        if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            closeConnection(index);
+            return;
+        }
+        if (received < 0) return;
+        connection.readUsed += (size_t)received;
+
+        // Handle every complete frame, then keep the partial one at the front
+        size_t offset = 0;
+        NetMessage message;
+        for (;;) {
+            int length = decodeMessage(connections_[index].readBuffer + offset,
+                connections_[index].readUsed - offset, message);
+            if (length < 0) {
+                closeConnection(index);
+                return;
+            }
+            if (length == 0) break;
+            offset += (size_t)length;
+            stats_.messages++;
+            handleMessage(index, message);
+            if (connections_[index].fd < 0) return;
+        }
+        Connection& current = connections_[index];
+        memmove(current.readBuffer, current.readBuffer + offset, current.readUsed - offset);
+        current.readUsed -= offset;
+    }
+}
+
+void MatchServer::send(int index, const NetMessage& message) {
+    Connection& connection = connections_[index];
+    if (connection.fd < 0) return;
+    unsigned char frame[NET_MAX_FRAME];
+    size_t length = encodeMessage(message, frame);
+    size_t sent = 0;
+    // Behind a backlog, new frames queue up so they stay in order
+    if (connection.backlog.empty()) {
+        ssize_t result = ::send(connection.fd, frame, length, MSG_NOSIGNAL);
+        if (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) return;
+        sent = result > 0 ? (size_t)result : 0;
+    }
+    if (sent == length) return;
+    connection.backlog.insert(connection.backlog.end(), frame + sent, frame + length);
+    if (!connection.writeArmed) {
+        epoll_event event;
+        event.events = EPOLLIN | EPOLLOUT;
+        event.data.u64 = connectionTag(index, connection.generation);
+        epoll_ctl(epoll_, EPOLL_CTL_MOD, connection.fd, &event);
+        connection.writeArmed = true;
+    }
+}
+
+void MatchServer::flushConnection(int index) {
+    Connection& connection = connections_[index];
+    while (!connection.backlog.empty()) {
+        ssize_t sent = ::send(connection.fd, connection.backlog.data(), connection.backlog.size(), MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            if (errno == EINTR) continue;
+            closeConnection(index);
+            return;
+        }
+        connection.backlog.erase(connection.backlog.begin(), connection.backlog.begin() + sent);
+    }
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u64 = connectionTag(index, connection.generation);
+    epoll_ctl(epoll_, EPOLL_CTL_MOD, connection.fd, &event);
+    connection.writeArmed = false;
+}
+
+// A player who leaves mid-match ends it; the opponent is told and can queue again
+void MatchServer::closeConnection(int index) {
+    Connection& connection = connections_[index];
+    if (connection.fd < 0) return;
+    ::close(connection.fd);     // Also takes it out of the epoll set
+    connection.fd = -1;
+    connection.generation++;
+    connection.backlog.clear();
+    auto queued = find(waiting_.begin(), waiting_.end(), index);
+    if (queued != waiting_.end()) waiting_.erase(queued);
+
+    int matchIndex = connection.match;
+    connection.match = -1;
+    if (matchIndex >= 0) {
+        int opponent = matches_[matchIndex].connections[1 - connection.seat];
+        matches_[matchIndex].connections[connection.seat] = -1;
+        if (opponent >= 0) {
+            NetMessage left;
+            left.type = NetMessageType::OpponentLeft;
+            send(opponent, left);
+        }
+        endMatch(matchIndex);
+    }
+    freeConnections_.push_back(index);
+}
+
+void MatchServer::handleMessage(int index, const NetMessage& message) {
+    switch (message.type) {
+    case NetMessageType::Hello:
+        joinQueue(index, message.text);
+        break;
+    case NetMessageType::SetTurnLimit:
+    case NetMessageType::SetNumber:
+    case NetMessageType::Guess:
+        handleMove(index, message);
+        break;
+    default:
+        // Server-to-client messages have no business arriving here
+        closeConnection(index);
+        break;
+    }
+}
+
+// The name is only taken once the player is known to be free: a Hello in
+// the middle of a match must not rename whoever the result is credited to
+void MatchServer::joinQueue(int index, const char* name) {
+    Connection& connection = connections_[index];
+    if (connection.match >= 0) {
+        reject(index, "Already in a match.");
+        return;
+    }
+    if (find(waiting_.begin(), waiting_.end(), index) != waiting_.end()) return;
+    memcpy(connection.name, name, NET_TEXT_BYTES);
+    connection.name[NET_TEXT_BYTES - 1] = '\0';
+    // A name the store has never seen starts at the initial rating, and so
+    // does everyone while the store is still reading its log
+    PlayerProfile profile;
+    connection.rating = players_ && players_->ready() && players_->find(connection.name, profile) ?
+        profile.rating.value : INITIAL_RATING;
+    connection.queuedTick = timer_.currentTick();
+
+    // The closest rating within reach; on a tie, whoever has waited longest
+    int partner = -1;
+    for (size_t i = 0; i < waiting_.size(); i++) {
+        int other = waiting_[i];
+        if (!canPair(other, index, connection.queuedTick)) continue;
+        if (partner < 0 || fabs(connections_[other].rating - connection.rating) <
+            fabs(connections_[partner].rating - connection.rating)) {
+            partner = other;
+        }
+    }
+    if (partner < 0) {
+        waiting_.push_back(index);
+        return;
+    }
+    waiting_.erase(find(waiting_.begin(), waiting_.end(), partner));
+    startMatch(partner, index);
+}
+
+// The rating gap a waiting player accepts now
+double MatchServer::ratingWindow(int index, long long now) const {
+    double waited = timer_.tickTime(now) - timer_.tickTime(connections_[index].queuedTick);
+    return RATING_WINDOW + RATING_WINDOW_PER_SECOND * max(0.0, waited);
+}
+
+// Whichever of the two has the wider window decides
+bool MatchServer::canPair(int first, int second, long long now) const {
+    double gap = fabs(connections_[first].rating - connections_[second].rating);
+    return gap <= max(ratingWindow(first, now), ratingWindow(second, now));
+}
+
+// Function to pair up waiting players whose windows have widened enough.
+// Sorted by rating, the closest partner of each is a neighbour, so one pass
+// pairs every neighbour pair in reach.
+void MatchServer::pairWaiting() {
+    long long now = timer_.currentTick();
+    sweep_ = waiting_;
+    sort(sweep_.begin(), sweep_.end(), [this](int a, int b) {
+        return connections_[a].rating < connections_[b].rating;
+    });
+    for (size_t i = 0; i + 1 < sweep_.size(); i++) {
+        int first = sweep_[i];
+        int second = sweep_[i + 1];
+        if (!canPair(first, second, now)) continue;
+        if (connections_[second].queuedTick < connections_[first].queuedTick) swap(first, second);
+        startMatch(first, second);
+        i++;
+    }
+    // Those paired leave the queue; the rest keep their places
+    waiting_.erase(remove_if(waiting_.begin(), waiting_.end(), [this](int index) {
+        return connections_[index].match >= 0;
+    }), waiting_.end());
+}
+
+void MatchServer::startMatch(int player1, int player2) {
+    int matchIndex;
+    if (!freeMatches_.empty()) {
+        matchIndex = freeMatches_.back();
+        freeMatches_.pop_back();
+    }
+    else {
+        matchIndex = (int)matches_.size();
+        matches_.emplace_back();
+    }
+    Match& match = matches_[matchIndex];
+    match.state = GameState();
+    match.state.timeLimitPerTurn = timeLimitPerTurn_;
+    match.connections[0] = player1;
+    match.connections[1] = player2;
+    match.timeouts[0] = 0;
+    match.timeouts[1] = 0;
+    memcpy(match.names[0], connections_[player1].name, NET_TEXT_BYTES);
+    memcpy(match.names[1], connections_[player2].name, NET_TEXT_BYTES);
+    match.serial++;
+    match.active = true;
+    stats_.matchesStarted++;
+
+    // Each player learns their seat and the other's name, then the rules state
+    MatchUpdate opening = publicUpdate(match.state, StepResult(), 0, timer_.now());
+    for (int seat = 0; seat < 2; seat++) {
+        Connection& connection = connections_[match.connections[seat]];
+        connection.match = matchIndex;
+        connection.seat = seat;
+
+        NetMessage matched;
+        matched.type = NetMessageType::Matched;
+        matched.seat = seat;
+        setMessageText(matched, connections_[match.connections[1 - seat]].name);
+        send(match.connections[seat], matched);
+
+        NetMessage update;
+        update.type = NetMessageType::Update;
+        update.update = opening;
+        send(match.connections[seat], update);
+    }
+}
+
+void MatchServer::reject(int index, const char* reason) {
+    stats_.rejected++;
+    NetMessage message;
+    message.type = NetMessageType::Rejected;
+    setMessageText(message, reason);
+    send(index, message);
+}
+
+void MatchServer::handleMove(int index, const NetMessage& message) {
+    int matchIndex = connections_[index].match;
+    if (matchIndex < 0) {
+        reject(index, "Not in a match.");
+        return;
+    }
+    // A move that arrives after the deadline is too late for the turn it
+    // was meant for, whenever the heap would have got round to it
+    expireTurns(matchIndex);
+    if (connections_[index].match < 0) return;
+
+    const GameState& state = matches_[matchIndex].state;
+    bool player1 = connections_[index].seat == 0;
+    GameEvent event;
+    event.time = timer_.now();
+    if (message.type == NetMessageType::SetTurnLimit) {
+        if (!player1) {
+            reject(index, "Player 1 picks the rules.");
+            return;
+        }
+        event.type = GameEventType::SetTurnLimit;
+        event.turnLimit = message.turnLimit;
+        event.variant = message.variant;
+    }
+    else {
+        if (state.player1Turn != player1) {
+            reject(index, "Not your turn.");
+            return;
+        }
+        event.type = message.type == NetMessageType::SetNumber ? GameEventType::SetNumber : GameEventType::Guess;
+        NumberStatus status = packNumber(message.text, strnlen(message.text, NET_TEXT_BYTES), state.variant, event.code);
+        if (status != NumberStatus::Valid) {
+            char reason[64];
+            reject(index, numberStatusMessage(status, state.variant, reason, sizeof(reason)));
+            return;
+        }
+    }
+    applyEvent(matchIndex, event, index);
+}
+
+void MatchServer::applyEvent(int matchIndex, const GameEvent& event, int sender) {
+    Match& match = matches_[matchIndex];
+    StepResult result;
+    match.state = step(match.state, event, &result);
+    if (result.outcome == StepOutcome::Ignored) {
+        if (sender >= 0) reject(sender, "Not now.");
+        return;
+    }
+    if (result.outcome == StepOutcome::Rejected) {
+        if (sender >= 0) reject(sender, result.error);
+        return;
+    }
+    stats_.moves++;
+    if (result.outcome == StepOutcome::TimedOut) {
+        stats_.timeouts++;
+        match.timeouts[result.byPlayer1 ? 0 : 1]++;
+    }
+    match.serial++;
+
+    NetMessage update;
+    update.type = NetMessageType::Update;
+    update.update = publicUpdate(match.state, result, event.code, event.time);
+    for (int seat = 0; seat < 2; seat++) {
+        if (match.connections[seat] >= 0) send(match.connections[seat], update);
+    }
+
+    if (match.state.phase == GamePhase::GameOver) {
+        stats_.matchesFinished++;
+        if (players_) recordResult(match);
+        endMatch(matchIndex);
+    }
+    else {
+        scheduleDeadline(matchIndex);
+    }
+}
+
+void MatchServer::scheduleDeadline(int matchIndex) {
+    const Match& match = matches_[matchIndex];
+    long long tick = timer_.deadlineTick(match.state);
+    if (tick < 0) return;
+    deadlines_.push_back({ tick, matchIndex, match.serial });
+    push_heap(deadlines_.begin(), deadlines_.end(), laterDeadline);
+}
+
+// Each expired turn is stamped with its own deadline tick (see TurnTimer), so
+// a match that was not looked at for a while still times out turn by turn
+void MatchServer::expireTurns(int matchIndex) {
+    GameEvent tick;
+    while (matches_[matchIndex].active && timer_.nextExpiry(matches_[matchIndex].state, tick)) {
+        applyEvent(matchIndex, tick, -1);
+    }
+}
+
+void MatchServer::expireDue() {
+    long long now = timer_.currentTick();
+    while (!deadlines_.empty() && deadlines_.front().tick <= now) {
+        Deadline due = deadlines_.front();
+        pop_heap(deadlines_.begin(), deadlines_.end(), laterDeadline);
+        deadlines_.pop_back();
+        // Matches that moved on since (or ended) left this entry behind
+        if (!matches_[due.match].active || matches_[due.match].serial != due.serial) continue;
+        expireTurns(due.match);
+    }
+}
+
+// Function to record a finished match. The store appends and flushes two
+// records, on this thread; the players' new ratings are read when they
+// queue again.
+void MatchServer::recordResult(const Match& match) {
+    unrecorded_.push_back(makePlayedMatch(match.state, match.names[0], match.names[1], match.timeouts[0],
+        match.timeouts[1]));
+    recordPending();
+}
+
+// Function to hand finished matches to the store. Until it has read its log
+// they wait here, rather than the loop waiting for it.
+void MatchServer::recordPending() {
+    if (!players_->ready()) return;
+    for (const PlayedMatch& played : unrecorded_) players_->recordMatch(played);
+    unrecorded_.clear();
+}
+
+void MatchServer::endMatch(int matchIndex) {
+    Match& match = matches_[matchIndex];
+    if (!match.active) return;
+    for (int seat = 0; seat < 2; seat++) {
+        if (match.connections[seat] >= 0) connections_[match.connections[seat]].match = -1;
+        match.connections[seat] = -1;
+    }
+    match.active = false;
+    match.serial++;
+    freeMatches_.push_back(matchIndex);
+}
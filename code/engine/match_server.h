@@ -0,0 +1,151 @@
+#pragma once
+
+// Authoritative match server: thousands of concurrent two-player matches in
+// one process, all driven by a single epoll loop (Linux only).
+//
+// Clients connect over TCP and speak engine/match_protocol.h. Each Hello
+// queues a player, who is paired with the waiting player of the closest
+// rating, if that is within a window that widens the longer either has
+// waited; the one who waited longer plays as player 1 and picks the rules.
+// Without a player store (setPlayerStore()) everyone is rated alike, so
+// players are paired in the order they arrive. Every move is
+// checked here and nowhere else: only the player whose turn it is may move,
+// typed numbers are checked and packed with packNumber() (the rules of
+// isValidNumber() and its variants), and turns are expired by the server's
+// own TurnTimer, so a client cannot stretch its time or see a secret.
+//
+// A match is a small fixed record (the GameState, its two connections and a
+// serial number) in a slab, a vector whose free slots are reused, and so is
+// each connection. Turn deadlines sit in a min-heap keyed by tick, and the
+// loop sleeps in epoll_wait until the next message or the earliest deadline.
+// Heap entries of a match that has moved on are dropped when they surface,
+// rather than searched for. Handling a message is a decode, a step() and an
+// encode into the sockets' buffers, with no allocation in the steady state.
+// Players left waiting are swept for pairs, sorted by rating, at least once
+// a second.
+//
+// With a store, every match that reaches game over is recorded in it
+// (engine/player_store.h), updating both players' profiles and ratings;
+// one abandoned by a disconnect is not.
+
+#include "engine/game_clock.h"
+#include "engine/match_protocol.h"
+#include "engine/player_store.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct ServerStats {
+    int connections = 0;
+    int matches = 0;                // In progress
+    int waiting = 0;                // Queued for an opponent
+    uint64_t matchesStarted = 0;
+    uint64_t matchesFinished = 0;   // Reached game over
+    uint64_t messages = 0;          // Frames received
+    uint64_t moves = 0;             // Events step() accepted, timeouts included
+    uint64_t timeouts = 0;
+    uint64_t rejected = 0;
+};
+
+class MatchServer {
+public:
+    static const int MAX_EVENTS = 256;           // Per epoll_wait
+    static const size_t READ_BUFFER = 512;       // Per connection; holds at least one frame
+    static const int QUEUE_SWEEP_MS = 1000;      // Longest the waiting players go unpaired
+    static constexpr double RATING_WINDOW = 100;           // Rating gap paired at once
+    static constexpr double RATING_WINDOW_PER_SECOND = 50; // Its widening while waiting
+
+    explicit MatchServer(const GameClock& clock, int ticksPerSecond = TurnTimer::DEFAULT_TICKS_PER_SECOND);
+    ~MatchServer();
+
+    MatchServer(const MatchServer&) = delete;
+    MatchServer& operator=(const MatchServer&) = delete;
+
+    // Function to start listening; port 0 picks a free port (see port()).
+    // Returns false if the socket cannot be set up.
+    bool listen(const char* address, int port);
+    int port() const { return port_; }
+
+    // Seconds per turn in matches started from now on
+    void setTimeLimitPerTurn(int seconds) { timeLimitPerTurn_ = seconds; }
+    // Function to rate players from a store, and record their matches in it
+    // (nullptr for none; it must stay open while the server uses it)
+    void setPlayerStore(PlayerStore* players) { players_ = players; }
+
+    // Function to wait up to maxWaitMs for messages or the next turn
+    // deadline, then handle everything that is ready
+    void poll(int maxWaitMs);
+
+    ServerStats stats() const;
+
+private:
+    struct Connection {
+        int fd = -1;
+        uint32_t generation = 0;    // Bumped on close, so stale epoll events are ignored
+        int match = -1;
+        int seat = 0;
+        bool writeArmed = false;    // EPOLLOUT requested for a backlog
+        size_t readUsed = 0;
+        unsigned char readBuffer[READ_BUFFER];
+        std::vector<unsigned char> backlog;   // What the socket would not take yet
+        char name[NET_TEXT_BYTES] = {};
+        double rating = INITIAL_RATING;
+        long long queuedTick = 0;   // When it joined the queue
+    };
+
+    struct Match {
+        GameState state;
+        int connections[2] = { -1, -1 };
+        uint32_t serial = 0;        // Bumped on every step, so stale deadlines are ignored
+        bool active = false;
+        int timeouts[2] = { 0, 0 }; // Turns each seat let run out
+        char names[2][NET_TEXT_BYTES] = {};     // As they were when it started; results go to these
+    };
+
+    struct Deadline {
+        long long tick;
+        int match;
+        uint32_t serial;
+    };
+
+    static bool laterDeadline(const Deadline& a, const Deadline& b);
+
+    void acceptConnections();
+    void readConnection(int index);
+    void flushConnection(int index);
+    void closeConnection(int index);
+    void handleMessage(int index, const NetMessage& message);
+    void joinQueue(int index, const char* name);
+    double ratingWindow(int index, long long now) const;
+    bool canPair(int first, int second, long long now) const;
+    void startMatch(int player1, int player2);
+    void pairWaiting();
+    void recordResult(const Match& match);
+    void recordPending();
+    void handleMove(int index, const NetMessage& message);
+    void applyEvent(int matchIndex, const GameEvent& event, int sender);
+    void expireTurns(int matchIndex);
+    void expireDue();
+    void scheduleDeadline(int matchIndex);
+    void endMatch(int matchIndex);
+    void send(int index, const NetMessage& message);
+    void reject(int index, const char* reason);
+    int waitTimeout(int maxWaitMs) const;
+
+    TurnTimer timer_;
+    int timeLimitPerTurn_ = 30;
+    int epoll_ = -1;
+    int listener_ = -1;
+    int port_ = 0;
+    std::vector<Connection> connections_;
+    std::vector<int> freeConnections_;
+    std::vector<Match> matches_;
+    std::vector<int> freeMatches_;
+    std::vector<Deadline> deadlines_;   // Min-heap on tick
+    std::vector<int> waiting_;          // Connections queued for an opponent, oldest first
+    std::vector<int> sweep_;            // pairWaiting()'s scratch
+    PlayerStore* players_ = nullptr;
+    std::vector<PlayedMatch> unrecorded_;   // Finished before the store was ready
+    ServerStats stats_;
+};
@@ -0,0 +1,277 @@
+#include "engine/match_snapshot.h"
+#include "engine/mapped_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#if defined(_WIN32)
+#define NOGDI
+#define NOUSER
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static_assert(is_trivially_copyable<MatchSnapshot>::value, "snapshots are copied as bytes");
+
+static const unsigned char SNAPSHOT_MAGIC[4] = { 'N', 'B', 'S', 'S' };
+
+struct SnapshotFileHeader {
+    unsigned char magic[4];
+    uint32_t version;
+    uint32_t slotBytes;
+    uint32_t reserved;
+};
+
+struct SnapshotSlotHeader {
+    uint64_t sequence;      // 0 for a slot never written
+    uint64_t checksum;      // Over the sequence and the used part of the snapshot
+    uint32_t bytes;         // Length of that used part
+    uint32_t reserved;
+};
+
+static const size_t SLOT_BYTES = sizeof(SnapshotSlotHeader) + sizeof(MatchSnapshot);
+static const size_t SNAPSHOT_FILE_BYTES = sizeof(SnapshotFileHeader) + 2 * SLOT_BYTES;
+
+bool MatchSnapshot::isUnfinished() const {
+    return phase == (uint8_t)GamePhase::SettingNumbers || phase == (uint8_t)GamePhase::Guessing;
+}
+
+void setSnapshotName(char* field, const char* name) {
+    strncpy(field, name, MatchSnapshot::NAME_BYTES - 1);
+    field[MatchSnapshot::NAME_BYTES - 1] = '\0';
+}
+
+void captureMatch(MatchSnapshot& snapshot, const GameState& state, double now, const MatchHistory& history) {
+    snapshot.phase = (uint8_t)state.phase;
+    snapshot.result = (uint8_t)state.result;
+    snapshot.player1Turn = state.player1Turn ? 1 : 0;
+    snapshot.variantLength = (uint8_t)state.variant.length;
+    snapshot.variantBase = (uint8_t)state.variant.base;
+    snapshot.variantRepeats = state.variant.repeats ? 1 : 0;
+    snapshot.turnLimit = state.turnLimit;
+    snapshot.timeLimitPerTurn = state.timeLimitPerTurn;
+    snapshot.player1Turns = state.player1Turns;
+    snapshot.player2Turns = state.player2Turns;
+    snapshot.player1Number = state.player1Number;
+    snapshot.player2Number = state.player2Number;
+    snapshot.turnElapsed = state.phase == GamePhase::Guessing ? max(now - state.startTime, 0.0) : 0;
+
+    int count = min(history.size(), MatchSnapshot::HISTORY_ROWS);
+    int first = history.size() - count;
+    snapshot.historyCount = (uint32_t)count;
+    for (int i = 0; i < count; i++) {
+        const HistoryEntry& entry = history[first + i];
+        SnapshotHistoryRow& row = snapshot.history[i];
+        row.code = entry.code;
+        row.time = entry.time;
+        row.kind = (uint8_t)entry.kind;
+        row.byPlayer1 = entry.byPlayer1 ? 1 : 0;
+        row.correctDigits = entry.correctDigits;
+        row.correctPositions = entry.correctPositions;
+    }
+}
+
+GameState restoreMatch(const MatchSnapshot& snapshot, double now, MatchHistory& history) {
+    GameState state;
+    state.phase = (GamePhase)snapshot.phase;
+    state.result = (GameResult)snapshot.result;
+    state.player1Turn = snapshot.player1Turn != 0;
+    state.variant.length = snapshot.variantLength;
+    state.variant.base = snapshot.variantBase;
+    state.variant.repeats = snapshot.variantRepeats != 0;
+    state.turnLimit = snapshot.turnLimit;
+    state.timeLimitPerTurn = snapshot.timeLimitPerTurn;
+    state.player1Turns = snapshot.player1Turns;
+    state.player2Turns = snapshot.player2Turns;
+    state.player1Number = snapshot.player1Number;
+    state.player2Number = snapshot.player2Number;
+    state.startTime = now - snapshot.turnElapsed;
+
+    history.clear();
+    int count = min((int)snapshot.historyCount, MatchSnapshot::HISTORY_ROWS);
+    for (int i = 0; i < count; i++) {
+        const SnapshotHistoryRow& row = snapshot.history[i];
+        HistoryEntry entry;
+        entry.code = row.code;
+        entry.time = row.time;
+        entry.kind = (HistoryKind)row.kind;
+        entry.byPlayer1 = row.byPlayer1 != 0;
+        entry.correctDigits = row.correctDigits;
+        entry.correctPositions = row.correctPositions;
+        history.push(entry);
+    }
+    return state;
+}
+
+// Function to get the checksummed length of a snapshot: everything up to and
+// including the history rows in use
+static size_t usedBytes(const MatchSnapshot& snapshot) {
+    uint32_t rows = min(snapshot.historyCount, (uint32_t)MatchSnapshot::HISTORY_ROWS);
+    return offsetof(MatchSnapshot, history) + rows * sizeof(SnapshotHistoryRow);
+}
+
+static uint64_t slotChecksum(uint64_t sequence, const unsigned char* bytes, size_t count) {
+    uint64_t hash = fnv1a(FNV_OFFSET, (const unsigned char*)&sequence, sizeof(sequence));
+    return fnv1a(hash, bytes, count);
+}
+
+SnapshotFile::~SnapshotFile() {
+    close();
+}
+
+unsigned char* SnapshotFile::slot(int index) const {
+    return data_ + sizeof(SnapshotFileHeader) + index * SLOT_BYTES;
+}
+
+bool SnapshotFile::slotIntact(int index, uint64_t& sequence) const {
+    SnapshotSlotHeader header;
+    memcpy(&header, slot(index), sizeof(header));
+    if (header.sequence == 0 || header.bytes < offsetof(MatchSnapshot, history) ||
+        header.bytes > sizeof(MatchSnapshot)) {
+        return false;
+    }
+    if (slotChecksum(header.sequence, slot(index) + sizeof(header), header.bytes) != header.checksum) return false;
+    sequence = header.sequence;
+    return true;
+}
+
+// A file of the wrong size or layout is wiped and given a fresh header
+static void prepareSnapshotFile(unsigned char* data, bool fresh) {
+    SnapshotFileHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (!fresh && memcmp(header.magic, SNAPSHOT_MAGIC, 4) == 0 && header.version == SNAPSHOT_VERSION &&
+        header.slotBytes == SLOT_BYTES) {
+        return;
+    }
+    memset(data, 0, SNAPSHOT_FILE_BYTES);
+    memcpy(header.magic, SNAPSHOT_MAGIC, 4);
+    header.version = SNAPSHOT_VERSION;
+    header.slotBytes = (uint32_t)SLOT_BYTES;
+    header.reserved = 0;
+    memcpy(data, &header, sizeof(header));
+}
+
+#if defined(_WIN32)
+
+bool SnapshotFile::open(const char* path) {
+    close();
+    HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    bool fresh = !GetFileSizeEx(file, &fileSize) || fileSize.QuadPart != (LONGLONG)SNAPSHOT_FILE_BYTES;
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, 0, (DWORD)SNAPSHOT_FILE_BYTES, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, SNAPSHOT_FILE_BYTES);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    file_ = file;
+    mapping_ = mapping;
+    data_ = (unsigned char*)view;
+    size_ = SNAPSHOT_FILE_BYTES;
+    prepareSnapshotFile(data_, fresh);
+    return true;
+}
+
+void SnapshotFile::close() {
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle((HANDLE)mapping_);
+    if (file_) CloseHandle((HANDLE)file_);
+    data_ = nullptr;
+    mapping_ = nullptr;
+    file_ = nullptr;
+    size_ = 0;
+}
+
+#else
+
+bool SnapshotFile::open(const char* path) {
+    close();
+    int fd = ::open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return false;
+
+    struct stat info;
+    bool fresh = fstat(fd, &info) != 0 || info.st_size != (off_t)SNAPSHOT_FILE_BYTES;
+    if (fresh && ftruncate(fd, (off_t)SNAPSHOT_FILE_BYTES) != 0) {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, SNAPSHOT_FILE_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);  // The mapping keeps the file alive
+    if (view == MAP_FAILED) return false;
+
+    data_ = (unsigned char*)view;
+    size_ = SNAPSHOT_FILE_BYTES;
+    prepareSnapshotFile(data_, fresh);
+    return true;
+}
+
+void SnapshotFile::close() {
+    if (data_) munmap(data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+}
+
+#endif
+
+bool SnapshotFile::load(MatchSnapshot& snapshot) const {
+    if (!data_) return false;
+    uint64_t sequences[2] = { 0, 0 };
+    bool intact[2] = { slotIntact(0, sequences[0]), slotIntact(1, sequences[1]) };
+    if (!intact[0] && !intact[1]) return false;
+    int index = !intact[0] || (intact[1] && sequences[1] > sequences[0]) ? 1 : 0;
+
+    SnapshotSlotHeader header;
+    memcpy(&header, slot(index), sizeof(header));
+    snapshot = MatchSnapshot();
+    memcpy(&snapshot, slot(index) + sizeof(header), header.bytes);
+    snapshot.historyCount = min(snapshot.historyCount, (uint32_t)MatchSnapshot::HISTORY_ROWS);
+    return true;
+}
+
+void SnapshotFile::save(const MatchSnapshot& snapshot) {
+    if (!data_) return;
+    // The first save after opening carries on from whatever the file holds.
+    // Only intact slots count: a torn one is overwritten, never the other.
+    if (sequence_ == 0) {
+        uint64_t sequences[2] = { 0, 0 };
+        bool intact[2] = { slotIntact(0, sequences[0]), slotIntact(1, sequences[1]) };
+        if (intact[0] || intact[1]) newest_ = !intact[0] || (intact[1] && sequences[1] > sequences[0]) ? 1 : 0;
+        sequence_ = max(sequences[0], sequences[1]);
+    }
+
+    int index = 1 - newest_;
+    unsigned char* target = slot(index);
+    size_t bytes = usedBytes(snapshot);
+    memcpy(target + sizeof(SnapshotSlotHeader), &snapshot, bytes);
+
+    SnapshotSlotHeader header;
+    header.sequence = sequence_ + 1;
+    header.bytes = (uint32_t)bytes;
+    header.reserved = 0;
+    header.checksum = slotChecksum(header.sequence, target + sizeof(SnapshotSlotHeader), bytes);
+    memcpy(target, &header, sizeof(header));
+
+    sequence_ = header.sequence;
+    newest_ = index;
+}
+
+void SnapshotFile::clear() {
+    save(MatchSnapshot());
+}
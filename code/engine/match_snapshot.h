@@ -0,0 +1,106 @@
+#pragma once
+
+// Crash-safe snapshot of the match in progress, kept in a small memory-mapped
+// file so a match survives the game being killed.
+//
+// The file holds a header and two slots. Each save fills the slot not holding
+// the newest snapshot, stamps it with the next sequence number and an FNV-1a
+// checksum, and leaves the other slot alone; a save torn by a crash fails its
+// checksum and the previous slot is used instead. Saving is a copy into the
+// mapping (a few kilobytes at most, no system call), and the kernel writes the
+// pages back on its own, so it costs microseconds and never waits on the disk.
+//
+// Everything in a snapshot is fixed-width and laid out explicitly, so the file
+// does not depend on how the compiler lays out GameState.
+
+#include "engine/game_engine.h"
+#include "engine/match_history.h"
+
+#include <cstddef>
+#include <cstdint>
+
+const uint32_t SNAPSHOT_VERSION = 1;
+
+struct SnapshotHistoryRow {
+    uint32_t code;
+    float time;
+    uint8_t kind;
+    uint8_t byPlayer1;
+    uint8_t correctDigits;
+    uint8_t correctPositions;
+};
+
+struct MatchSnapshot {
+    // A 99-turn match has at most 198 scored guesses and timeouts, plus the win
+    static const int HISTORY_ROWS = 256;
+    static const int NAME_BYTES = 32;
+
+    uint8_t phase = 0;                 // GamePhase
+    uint8_t result = 0;                // GameResult
+    uint8_t player1Turn = 1;
+    uint8_t vsComputer = 0;
+    uint8_t variantLength = 0;
+    uint8_t variantBase = 0;
+    uint8_t variantRepeats = 0;
+    uint8_t difficulty = 0;            // Difficulty of the computer player
+    int32_t turnLimit = 0;
+    int32_t timeLimitPerTurn = 0;
+    int32_t player1Turns = 0;
+    int32_t player2Turns = 0;
+    uint32_t player1Number = 0;
+    uint32_t player2Number = 0;
+    double turnElapsed = 0;            // Seconds of the current turn used when saved
+    char player1Name[NAME_BYTES] = {};
+    char player2Name[NAME_BYTES] = {};
+    uint32_t historyCount = 0;         // Rows used, the newest of the match's history
+    SnapshotHistoryRow history[HISTORY_ROWS] = {};
+
+    // A match worth resuming: numbers are being set or guesses made
+    bool isUnfinished() const;
+};
+
+// Function to fill a snapshot from the rules state and history; now is the
+// match clock's time, from which the time used in the current turn is kept
+void captureMatch(MatchSnapshot& snapshot, const GameState& state, double now, const MatchHistory& history);
+
+// Function to rebuild the rules state and history from a snapshot; the
+// current turn gets back the time it had left when it was saved
+GameState restoreMatch(const MatchSnapshot& snapshot, double now, MatchHistory& history);
+
+// Function to copy a name into a snapshot field (truncated, always terminated)
+void setSnapshotName(char* field, const char* name);
+
+class SnapshotFile {
+public:
+    SnapshotFile() = default;
+    ~SnapshotFile();
+
+    SnapshotFile(const SnapshotFile&) = delete;
+    SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+    // Function to map the snapshot file read-write, creating it (or
+    // replacing one of another layout) as needed; false on any failure
+    bool open(const char* path);
+    void close();
+    bool isOpen() const { return data_ != nullptr; }
+
+    // Function to read the newest intact snapshot; false if there is none
+    bool load(MatchSnapshot& snapshot) const;
+    // Function to save a snapshot into the slot the newest one is not in
+    void save(const MatchSnapshot& snapshot);
+    // Function to save an empty snapshot, so nothing is offered for resuming
+    void clear();
+
+private:
+    unsigned char* slot(int index) const;
+    bool slotIntact(int index, uint64_t& sequence) const;
+
+    unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+    uint64_t sequence_ = 0;     // Of the newest slot
+    int newest_ = 1;            // Slot saved last; with no intact slot, 1 so the first save goes to 0
+#if defined(_WIN32)
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
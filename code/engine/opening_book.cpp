@@ -0,0 +1,220 @@
+#include "engine/opening_book.h"
+#include "engine/game_engine.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+bool OpeningBook::open(const char* path) {
+    nodes_ = nullptr;
+    header_ = OpeningBookHeader();
+    if (!file_.open(path)) return false;
+
+    OpeningBookHeader header;
+    if (file_.size() < sizeof(header)) {
+        file_.close();
+        return false;
+    }
+    memcpy(&header, file_.data(), sizeof(header));
+    if (memcmp(header.magic, OPENING_BOOK_MAGIC, 4) != 0 ||
+        header.version != OPENING_BOOK_VERSION ||
+        header.codeCount != (uint32_t)CODE_COUNT ||
+        header.headerSize < sizeof(header) || header.headerSize % sizeof(BookNode) != 0 ||
+        header.nodeCount == 0 ||
+        file_.size() != header.headerSize + (size_t)header.nodeCount * sizeof(BookNode)) {
+        file_.close();
+        return false;
+    }
+    const BookNode* nodes = (const BookNode*)(file_.data() + header.headerSize);
+
+    // The book is small, so check all of it: after this, follow() can never
+    // index past the end whatever the file holds
+    bool ok = fnv1a(FNV_OFFSET, (const unsigned char*)nodes,
+        (size_t)header.nodeCount * sizeof(BookNode)) == header.checksum;
+    for (uint32_t i = 0; i < header.nodeCount && ok; i++) {
+        ok = nodes[i].guess < CODE_COUNT && !((nodes[i].childMask >> FEEDBACK_SOLVED) & 1) &&
+            (uint64_t)nodes[i].firstChild + popCount(nodes[i].childMask) <= header.nodeCount;
+    }
+    if (!ok) {
+        file_.close();
+        return false;
+    }
+
+    header_ = header;
+    nodes_ = nodes;
+    return true;
+}
+
+static OpeningBook* openSharedBook() {
+    static OpeningBook book;
+    const char* path = getenv("NUMBRAINER_OPENING_BOOK");
+    book.open(path && *path ? path : DEFAULT_OPENING_BOOK_PATH);
+    return &book;
+}
+
+const OpeningBook& sharedOpeningBook() {
+    static const OpeningBook* book = openSharedBook();  // Thread-safe one-time init
+    return *book;
+}
+
+// Decision tree while it is being built; flattened into BookNodes on write
+struct TreeNode {
+    CodeIndex guess = 0;
+    unique_ptr<TreeNode> children[FEEDBACK_COUNT];
+};
+
+// Function to build the subtree that finds any of the candidates. cost
+// receives the guesses it needs summed over the candidates, this one included.
+static unique_ptr<TreeNode> buildTree(const vector<CodeIndex>& candidates,
+    const OpeningBookOptions& options, long& cost) {
+    unique_ptr<TreeNode> node(new TreeNode);
+    if (candidates.size() <= 2) {
+        // Guess the first; if that misses, the other is all that is left
+        node->guess = candidates[0];
+        cost = (long)candidates.size() * 2 - 1;
+        if (candidates.size() == 2) {
+            TreeNode* last = new TreeNode;
+            last->guess = candidates[1];
+            node->children[scoreCodes(codeAt(candidates[0]), codeAt(candidates[1]))].reset(last);
+        }
+        return node;
+    }
+
+    CandidateBuffer buffer;
+    for (CodeIndex index : candidates) buffer.push(index);
+    vector<bool> consistent(CODE_COUNT, false);
+    for (CodeIndex index : candidates) consistent[index] = true;
+
+    // Rank every code as the guess here; one that cannot split the
+    // candidates at all would recurse forever, so it is never a choice
+    vector<uint64_t> keys;
+    keys.reserve(CODE_COUNT);
+    uint32_t histogram[FEEDBACK_COUNT];
+    for (int guess = 0; guess < CODE_COUNT; guess++) {
+        scoreCandidates(codeAt((CodeIndex)guess), buffer, nullptr, histogram);
+        bool splits = true;
+        for (int f = 0; f < FEEDBACK_SOLVED; f++) {
+            if (histogram[f] == candidates.size()) splits = false;
+        }
+        if (splits) keys.push_back(rankGuess(options.mode, histogram, consistent[guess], (CodeIndex)guess));
+    }
+
+    int tries = (int)candidates.size() <= options.lookaheadLimit ? options.lookaheadWidth : 1;
+    if (tries < 1) tries = 1;
+    if (tries > (int)keys.size()) tries = (int)keys.size();
+    partial_sort(keys.begin(), keys.begin() + tries, keys.end());
+
+    vector<Feedback> feedback(candidates.size());
+    cost = -1;
+    for (int t = 0; t < tries; t++) {
+        unique_ptr<TreeNode> option(new TreeNode);
+        option->guess = (CodeIndex)(keys[t] & 0xFFFF);
+        scoreCandidates(codeAt(option->guess), buffer, feedback.data(), histogram);
+
+        long optionCost = (long)candidates.size();
+        for (int f = 0; f < FEEDBACK_SOLVED && (cost < 0 || optionCost < cost); f++) {
+            if (histogram[f] == 0) continue;
+            vector<CodeIndex> group;
+            group.reserve(histogram[f]);
+            for (size_t i = 0; i < candidates.size(); i++) {
+                if (feedback[i] == f) group.push_back(candidates[i]);
+            }
+            long groupCost = 0;
+            option->children[f] = buildTree(group, options, groupCost);
+            optionCost += groupCost;
+        }
+        if (cost < 0 || optionCost < cost) {
+            cost = optionCost;
+            node = move(option);
+        }
+    }
+    return node;
+}
+
+bool writeOpeningBook(const char* path, const OpeningBookOptions& options) {
+    vector<CodeIndex> all(CODE_COUNT);
+    for (int i = 0; i < CODE_COUNT; i++) all[i] = (CodeIndex)i;
+    long totalGuesses = 0;
+    unique_ptr<TreeNode> root = buildTree(all, options, totalGuesses);
+
+    // Breadth-first: the queue order is the node order, so each node's
+    // children get the next free indices as it is reached
+    vector<const TreeNode*> queue(1, root.get());
+    vector<int> depths(1, 1);
+    vector<BookNode> nodes;
+    int maxDepth = 0;
+    for (size_t i = 0; i < queue.size(); i++) {
+        BookNode node;
+        node.guess = queue[i]->guess;
+        node.childMask = 0;
+        node.firstChild = (uint32_t)queue.size();
+        for (int f = 0; f < FEEDBACK_SOLVED; f++) {
+            if (!queue[i]->children[f]) continue;
+            node.childMask |= (uint16_t)(1u << f);
+            queue.push_back(queue[i]->children[f].get());
+            depths.push_back(depths[i] + 1);
+        }
+        nodes.push_back(node);
+        if (depths[i] > maxDepth) maxDepth = depths[i];
+    }
+
+    OpeningBookHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, OPENING_BOOK_MAGIC, 4);
+    header.version = OPENING_BOOK_VERSION;
+    header.codeCount = CODE_COUNT;
+    header.headerSize = sizeof(header);
+    header.nodeCount = (uint32_t)nodes.size();
+    header.maxDepth = (uint32_t)maxDepth;
+    header.totalGuesses = (uint32_t)totalGuesses;
+    header.checksum = fnv1a(FNV_OFFSET, (const unsigned char*)nodes.data(), nodes.size() * sizeof(BookNode));
+
+    string tempPath = string(path) + ".tmp";
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file) return false;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(nodes.data(), sizeof(BookNode), nodes.size(), file) == nodes.size();
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        remove(tempPath.c_str());
+        return false;
+    }
+    remove(path);  // rename() does not replace an existing file on Windows
+    return rename(tempPath.c_str(), path) == 0;
+}
+
+bool verifyOpeningBook(const OpeningBook& book) {
+    if (!book.isMapped()) return false;
+
+    // The secrets come from the string rules too, not from ALL_CODES
+    long totalGuesses = 0;
+    int secrets = 0;
+    for (int n = 0; n < 10000; n++) {
+        char digits[8];
+        snprintf(digits, sizeof(digits), "%04d", n);
+        string secret = digits;
+        if (checkNumber(secret) != NumberStatus::Valid) continue;
+        secrets++;
+
+        uint32_t node = BOOK_ROOT;
+        for (uint32_t guesses = 1;; guesses++) {
+            CodeIndex guess;
+            if (guesses > book.header().maxDepth || !book.guessAt(node, guess)) return false;
+            string guessText = codeToString(codeAt(guess));
+            int digitsRight = countCorrectDigits(guessText, secret);
+            int positionsRight = countCorrectPositions(guessText, secret);
+            if (positionsRight == CODE_LENGTH) {
+                totalGuesses += guesses;
+                break;
+            }
+            node = book.follow(node, guess, makeFeedback(digitsRight, positionsRight));
+        }
+    }
+    return secrets == CODE_COUNT && totalGuesses == (long)book.header().totalGuesses;
+}
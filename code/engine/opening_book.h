@@ -0,0 +1,101 @@
+#pragma once
+
+// Precomputed decision tree for the classic game (the "opening book").
+//
+// Every node holds the guess to play and, for each feedback that does not
+// solve the game, the node to continue from. The tree covers every secret,
+// so a player who follows it never has to search; one who plays anything
+// else leaves the book and falls back to live search.
+//
+// The file is a header followed by a flat array of 8-byte nodes in
+// breadth-first order. Children are found by index, not pointer: a node's
+// children sit next to each other starting at firstChild, one per set bit of
+// childMask in feedback order. So the file is mapped as-is and each move is
+// a popcount and a load. numbrainer_bookgen writes it as a build step.
+
+#include "engine/code_space.h"
+#include "engine/hint_engine.h"
+#include "engine/mapped_file.h"
+
+// Bump the version whenever the node layout, Feedback numbering or code order changes
+const char OPENING_BOOK_MAGIC[4] = { 'N', 'B', 'O', 'B' };
+const uint32_t OPENING_BOOK_VERSION = 1;
+
+// Cursor values: the first move of a game, and "no longer in the book"
+const uint32_t BOOK_ROOT = 0;
+const uint32_t BOOK_OUT = UINT32_MAX;
+
+struct OpeningBookHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t codeCount;
+    uint32_t headerSize;    // Offset of the first node
+    uint32_t nodeCount;
+    uint32_t maxDepth;      // Most guesses the book needs for any secret
+    uint32_t totalGuesses;  // Guesses needed summed over every secret
+    uint32_t reserved;
+    uint64_t checksum;      // FNV-1a over the nodes
+};
+
+struct BookNode {
+    uint16_t guess;         // CodeIndex to play
+    uint16_t childMask;     // Bit f set when feedback f has a child
+    uint32_t firstChild;    // Index of the child for the lowest set bit
+};
+static_assert(sizeof(BookNode) == 8, "BookNode is part of the file format");
+
+// File name used when no path is given; NUMBRAINER_OPENING_BOOK overrides it
+const char DEFAULT_OPENING_BOOK_PATH[] = "opening_book.bin";
+
+class OpeningBook {
+public:
+    // Function to map a book file; false leaves the book empty (every
+    // lookup then misses)
+    bool open(const char* path);
+
+    bool isMapped() const { return nodes_ != nullptr; }
+    const OpeningBookHeader& header() const { return header_; }
+
+    // Function to get the book's guess at a node; false outside the book
+    bool guessAt(uint32_t node, CodeIndex& guess) const {
+        if (node >= header_.nodeCount || !nodes_) return false;
+        guess = nodes_[node].guess;
+        return true;
+    }
+
+    // Function to move on after a guess and its feedback. Playing anything
+    // but the book's guess, or a feedback the book never sees, leaves it.
+    uint32_t follow(uint32_t node, CodeIndex guess, Feedback feedback) const {
+        if (node >= header_.nodeCount || !nodes_) return BOOK_OUT;
+        const BookNode& current = nodes_[node];
+        if (current.guess != guess || !((current.childMask >> feedback) & 1)) return BOOK_OUT;
+        return current.firstChild + popCount(current.childMask & ((1u << feedback) - 1));
+    }
+
+private:
+    MappedFile file_;
+    OpeningBookHeader header_ = {};
+    const BookNode* nodes_ = nullptr;
+};
+
+// Function to get the process-wide book, mapped from the default path on first use
+const OpeningBook& sharedOpeningBook();
+
+struct OpeningBookOptions {
+    HintMode mode = HintMode::Entropy;  // Ranks the guesses tried at each node
+    int lookaheadWidth = 3;     // Best-ranked guesses built out in full at small nodes
+    int lookaheadLimit = 200;   // Nodes with at most this many candidates get the lookahead
+};
+
+// Function to build the decision tree and write it (what the build step
+// runs). Greedy by the ranking, except that at nodes with few candidates the
+// best few guesses are each built into full subtrees and the one needing the
+// fewest guesses in total is kept. (Near the root the top-ranked guesses are
+// mostly symmetric twins, so lookahead there buys nothing.) Writes to a
+// temporary name and renames it.
+bool writeOpeningBook(const char* path, const OpeningBookOptions& options);
+
+// Function to play every secret through a mapped book, scoring with the
+// string reference rules, and check that each one is solved within the
+// header's maxDepth and the totals match the header
+bool verifyOpeningBook(const OpeningBook& book);
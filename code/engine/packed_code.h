@@ -0,0 +1,134 @@
+#pragma once
+
+// Packed representation of a NumBrainer code and the scoring kernel built on it.
+//
+// A valid number (4 distinct digits) is converted once, when it enters the
+// engine, into a single 32-bit word:
+//
+//   bits  0..15   one nibble per position, position 0 in the lowest nibble
+//   bits 16..25   digit-presence mask, bit 16 + d set when digit d appears
+//
+// Scoring two packed codes is then a popcount of the ANDed masks (correct
+// digits) plus a nibble-wise equality count (correct positions): no
+// allocation, no loops and no branches.
+
+#include <cstdint>
+#include <string>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+typedef uint32_t PackedCode;
+
+const int CODE_LENGTH = 4;
+const PackedCode CODE_NIBBLE_MASK = 0x0000FFFF;
+const PackedCode CODE_DIGIT_MASK = 0x03FF0000;
+const int CODE_DIGIT_SHIFT = 16;
+
+// Function to count set bits in a 32-bit word
+inline int popCount(uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcount(x);
+#elif defined(_MSC_VER)
+    return (int)__popcnt(x);
+#else
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    x = (x + (x >> 4)) & 0x0F0F0F0Fu;
+    return (int)((x * 0x01010101u) >> 24);
+#endif
+}
+
+// Function to pack 4 digits (0-9), position 0 first
+constexpr PackedCode packDigits(int d0, int d1, int d2, int d3) {
+    return (PackedCode)(d0 | (d1 << 4) | (d2 << 8) | (d3 << 12)) |
+        (1u << (CODE_DIGIT_SHIFT + d0)) | (1u << (CODE_DIGIT_SHIFT + d1)) |
+        (1u << (CODE_DIGIT_SHIFT + d2)) | (1u << (CODE_DIGIT_SHIFT + d3));
+}
+
+// Function to pack a number that already passed validation ("0123")
+inline PackedCode packCode(const char* number) {
+    return packDigits(number[0] - '0', number[1] - '0', number[2] - '0', number[3] - '0');
+}
+
+inline PackedCode packCode(const std::string& number) {
+    return packCode(number.c_str());
+}
+
+// Function to read the digit at a position
+inline int codeDigit(PackedCode code, int position) {
+    return (int)((code >> (4 * position)) & 0xF);
+}
+
+// Function to write a packed code back out as text; out needs 5 chars
+inline void unpackCode(PackedCode code, char* out) {
+    for (int i = 0; i < CODE_LENGTH; i++) {
+        out[i] = (char)('0' + codeDigit(code, i));
+    }
+    out[CODE_LENGTH] = '\0';
+}
+
+inline std::string codeToString(PackedCode code) {
+    char text[CODE_LENGTH + 1];
+    unpackCode(code, text);
+    return std::string(text);
+}
+
+// Function to check that a packed word is a valid code: every nibble is a
+// digit and the presence mask holds exactly those 4 distinct digits
+inline bool isValidPackedCode(PackedCode code) {
+    PackedCode mask = 0;
+    for (int i = 0; i < CODE_LENGTH; i++) {
+        int digit = codeDigit(code, i);
+        if (digit > 9) return false;
+        mask |= 1u << (CODE_DIGIT_SHIFT + digit);
+    }
+    return (code & ~(CODE_NIBBLE_MASK | CODE_DIGIT_MASK)) == 0 &&
+        (code & CODE_DIGIT_MASK) == mask && popCount(mask) == CODE_LENGTH;
+}
+
+// Function to count how many digits of the guess appear in the target
+inline int packedCorrectDigits(PackedCode guess, PackedCode target) {
+    return popCount((guess & target) >> CODE_DIGIT_SHIFT);
+}
+
+// Function to count how many positions hold the same digit. A nibble of
+// guess ^ target is zero exactly where the digits match; fold each nibble's
+// bits into its low bit and count the nibbles that are left non-zero.
+inline int packedCorrectPositions(PackedCode guess, PackedCode target) {
+    uint32_t diff = (guess ^ target) & CODE_NIBBLE_MASK;
+    diff |= diff >> 1;
+    diff |= diff >> 2;
+    return CODE_LENGTH - popCount(diff & 0x1111);
+}
+
+// Scoring result packed into a byte. The (correct digits, correct positions)
+// pairs with positions <= digits are numbered densely; (4, 3) cannot happen,
+// which leaves 14 possible outcomes.
+typedef uint8_t Feedback;
+
+const int FEEDBACK_COUNT = 14;
+const Feedback FEEDBACK_SOLVED = 13;    // 4 digits, 4 in position
+
+// Function to number a (digits, positions) pair: digits*(digits+1)/2 + positions,
+// with (4, 4) moved down into the unused (4, 3) slot
+inline Feedback makeFeedback(int correctDigits, int correctPositions) {
+    return (Feedback)(((correctDigits * (correctDigits + 1)) >> 1) + correctPositions -
+        ((correctDigits & correctPositions) >> 2));
+}
+
+inline int feedbackDigits(Feedback feedback) {
+    static const uint8_t digits[FEEDBACK_COUNT] = { 0, 1, 1, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4 };
+    return digits[feedback];
+}
+
+inline int feedbackPositions(Feedback feedback) {
+    static const uint8_t positions[FEEDBACK_COUNT] = { 0, 0, 1, 0, 1, 2, 0, 1, 2, 3, 0, 1, 2, 4 };
+    return positions[feedback];
+}
+
+// Function to score a guess against a target in one step
+inline Feedback scoreCodes(PackedCode guess, PackedCode target) {
+    return makeFeedback(packedCorrectDigits(guess, target), packedCorrectPositions(guess, target));
+}
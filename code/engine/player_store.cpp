@@ -0,0 +1,789 @@
+#include "engine/player_store.h"
+
+#include "engine/game_record.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+
+using namespace std;
+
+static const char PLAYER_LOG_MAGIC[4] = { 'N', 'B', 'P', 'L' };
+static const char PLAYER_INDEX_MAGIC[4] = { 'N', 'B', 'P', 'I' };
+static const uint64_t LOG_HEADER_BYTES = 8;     // Magic and version
+static const size_t REPLAY_CHUNK_MATCHES = 1 << 16;
+
+// One profile in the log; every field is fixed-width and naturally aligned,
+// so the layout does not depend on the compiler
+struct PlayerRecord {
+    char name[PLAYER_NAME_BYTES];   // Zero-filled after the name
+    uint32_t matches;
+    uint32_t wins;
+    uint32_t draws;
+    uint32_t timeouts;
+    uint64_t guesses;
+    double rating;
+    double deviation;
+    double volatility;
+    uint64_t checksum;              // FNV-1a of everything above
+};
+static_assert(sizeof(PlayerRecord) == 88, "player records are laid out by hand");
+
+static const uint64_t RECORD_BYTES = sizeof(PlayerRecord);
+
+// A version 1 record: the same without the Glicko-2 fields
+struct PlayerRecordV1 {
+    char name[PLAYER_NAME_BYTES];
+    uint32_t matches;
+    uint32_t wins;
+    uint32_t draws;
+    uint32_t timeouts;
+    uint64_t guesses;
+    double rating;
+    uint64_t checksum;
+};
+static_assert(sizeof(PlayerRecordV1) == 72, "player records are laid out by hand");
+
+struct PlayerIndexHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t bucketCount;           // A power of two, at least twice playerCount
+    uint32_t playerCount;
+    uint64_t logBytes;              // Length of the log the index covers
+    uint64_t lastChecksum;          // Of the record ending there, to tell logs apart
+};
+
+// Hash table slot; offset 0 (inside the log header) marks it empty
+struct IndexBucket {
+    uint64_t nameHash;
+    uint64_t offset;
+};
+
+// Leaderboard entry, sorted best rating first
+struct RankedPlayer {
+    double rating;
+    uint64_t offset;
+    uint64_t nameHash;
+};
+
+static uint64_t nameHash(const string& name) {
+    return fnv1a(FNV_OFFSET, (const unsigned char*)name.data(), name.size());
+}
+
+string storedPlayerName(const string& name) {
+    return name.substr(0, PLAYER_NAME_BYTES - 1);
+}
+
+PlayedMatch makePlayedMatch(const GameState& state, const string& player1Name, const string& player2Name,
+    int player1Timeouts, int player2Timeouts) {
+    PlayedMatch played;
+    played.player1Name = player1Name;
+    played.player2Name = player2Name;
+    played.result = state.result;
+    played.player1Timeouts = player1Timeouts;
+    played.player2Timeouts = player2Timeouts;
+    played.player1Guesses = state.player1Turns - player1Timeouts + (state.result == GameResult::Player1Wins);
+    played.player2Guesses = state.player2Turns - player2Timeouts + (state.result == GameResult::Player2Wins);
+    return played;
+}
+
+static PlayerRecord encodeProfile(const PlayerProfile& profile) {
+    PlayerRecord record;
+    memset(&record, 0, sizeof(record));
+    string name = storedPlayerName(profile.name);
+    memcpy(record.name, name.data(), name.size());
+    record.matches = (uint32_t)profile.matches;
+    record.wins = (uint32_t)profile.wins;
+    record.draws = (uint32_t)profile.draws;
+    record.timeouts = (uint32_t)profile.timeouts;
+    record.guesses = (uint64_t)profile.guesses;
+    record.rating = profile.rating.value;
+    record.deviation = profile.rating.deviation;
+    record.volatility = profile.rating.volatility;
+    record.checksum = fnv1a(FNV_OFFSET, (const unsigned char*)&record, offsetof(PlayerRecord, checksum));
+    return record;
+}
+
+static bool decodeProfile(const PlayerRecord& record, PlayerProfile& profile) {
+    if (record.checksum != fnv1a(FNV_OFFSET, (const unsigned char*)&record, offsetof(PlayerRecord, checksum)) ||
+        record.name[PLAYER_NAME_BYTES - 1] != 0) {
+        return false;
+    }
+    profile.name = record.name;
+    profile.matches = (int)record.matches;
+    profile.wins = (int)record.wins;
+    profile.draws = (int)record.draws;
+    profile.timeouts = (int)record.timeouts;
+    profile.guesses = (long long)record.guesses;
+    profile.rating.value = record.rating;
+    profile.rating.deviation = record.deviation;
+    profile.rating.volatility = record.volatility;
+    return true;
+}
+
+static bool readLogRecord(const MappedFile& log, uint64_t offset, PlayerProfile& profile) {
+    if (offset < LOG_HEADER_BYTES || offset + RECORD_BYTES > log.size()) return false;
+    PlayerRecord record;
+    memcpy(&record, log.data() + offset, sizeof(record));
+    return decodeProfile(record, profile);
+}
+
+// Function to rewrite a version 1 log as this version, its players at the
+// initial deviation and volatility. Records are upgraded in log order, so
+// the newest under each name stays the newest; torn ones are dropped. The
+// old index goes too, as its offsets no longer fit. True when the log is
+// upgraded or was not a version 1 log to begin with.
+static bool upgradeLog(const string& logPath, const string& indexPath) {
+    string tempPath = logPath + ".tmp";
+    {
+        MappedFile old;
+        if (!old.open(logPath.c_str()) || old.size() < LOG_HEADER_BYTES) return true;
+        uint32_t version;
+        memcpy(&version, old.data() + 4, sizeof(version));
+        if (memcmp(old.data(), PLAYER_LOG_MAGIC, 4) != 0 || version != 1) return true;
+
+        FILE* file = fopen(tempPath.c_str(), "wb");
+        if (!file) return false;
+        bool ok = fwrite(PLAYER_LOG_MAGIC, 4, 1, file) == 1 &&
+            fwrite(&PLAYER_LOG_VERSION, sizeof(PLAYER_LOG_VERSION), 1, file) == 1;
+        for (uint64_t offset = LOG_HEADER_BYTES; ok && offset + sizeof(PlayerRecordV1) <= old.size();
+            offset += sizeof(PlayerRecordV1)) {
+            PlayerRecordV1 record;
+            memcpy(&record, old.data() + offset, sizeof(record));
+            if (record.checksum != fnv1a(FNV_OFFSET, (const unsigned char*)&record, offsetof(PlayerRecordV1, checksum)) ||
+                record.name[PLAYER_NAME_BYTES - 1] != 0) {
+                continue;
+            }
+            PlayerProfile profile;
+            profile.name = record.name;
+            profile.matches = (int)record.matches;
+            profile.wins = (int)record.wins;
+            profile.draws = (int)record.draws;
+            profile.timeouts = (int)record.timeouts;
+            profile.guesses = (long long)record.guesses;
+            profile.rating.value = record.rating;
+            PlayerRecord upgraded = encodeProfile(profile);
+            ok = fwrite(&upgraded, sizeof(upgraded), 1, file) == 1;
+        }
+        ok = (fclose(file) == 0) && ok;
+        if (!ok) {
+            remove(tempPath.c_str());
+            return false;
+        }
+    }
+    // The mapping is gone by now (Windows cannot replace a mapped file)
+    remove(indexPath.c_str());
+    remove(logPath.c_str());
+    return rename(tempPath.c_str(), logPath.c_str()) == 0;
+}
+
+PlayerStore::~PlayerStore() {
+    close();
+}
+
+bool PlayerStore::open(const char* logPath, const char* indexPath) {
+    close();
+    logPath_ = logPath;
+    indexPath_ = indexPath;
+    if (!upgradeLog(logPath_, indexPath_) || !mapFiles()) {
+        logPath_.clear();
+        indexPath_.clear();
+        return false;
+    }
+    loaded_ = false;
+    loader_ = thread([this] {
+        scanTail();
+        // A long log the index fell behind on (a crash before close) is
+        // indexed here, before the first query sees the overlay
+        if (overlay_.size() >= OVERLAY_LIMIT) rebuildIndex();
+        loaded_ = true;
+    });
+    return true;
+}
+
+void PlayerStore::close() {
+    if (!isOpen()) return;
+    waitUntilLoaded();
+    finishIndexer();
+    if (dirty_) saveIndex();
+    if (writer_) {
+        fclose(writer_);
+        writer_ = nullptr;
+    }
+    log_.close();
+    index_.close();
+    overlay_.clear();
+    logPath_.clear();
+    indexPath_.clear();
+    indexedBytes_ = 0;
+    logEnd_ = 0;
+    lastChecksum_ = 0;
+    dirty_ = false;
+    loaded_ = false;
+}
+
+void PlayerStore::waitUntilLoaded() {
+    if (loader_.joinable()) loader_.join();
+}
+
+// Function to map the log and, if it matches the log, the index; a missing
+// log is a store with no players yet
+bool PlayerStore::mapFiles() {
+    log_.close();
+    index_.close();
+    indexedBytes_ = LOG_HEADER_BYTES;
+    if (log_.open(logPath_.c_str())) {
+        uint32_t version = 0;
+        if (log_.size() >= LOG_HEADER_BYTES) memcpy(&version, log_.data() + 4, sizeof(version));
+        if (log_.size() < LOG_HEADER_BYTES || memcmp(log_.data(), PLAYER_LOG_MAGIC, 4) != 0 ||
+            version != PLAYER_LOG_VERSION) {
+            log_.close();
+            return false;
+        }
+    }
+    if (index_.open(indexPath_.c_str())) {
+        if (indexValid()) {
+            PlayerIndexHeader header;
+            memcpy(&header, index_.data(), sizeof(header));
+            indexedBytes_ = header.logBytes;
+        }
+        else {
+            index_.close();     // Stale or damaged: the whole log goes to the overlay
+        }
+    }
+    return true;
+}
+
+bool PlayerStore::indexValid() const {
+    PlayerIndexHeader header;
+    if (index_.size() < sizeof(header)) return false;
+    memcpy(&header, index_.data(), sizeof(header));
+    if (memcmp(header.magic, PLAYER_INDEX_MAGIC, 4) != 0 || header.version != PLAYER_INDEX_VERSION ||
+        header.bucketCount == 0 || (header.bucketCount & (header.bucketCount - 1)) != 0 ||
+        header.bucketCount < (uint64_t)header.playerCount * 2 ||
+        index_.size() != sizeof(header) + (uint64_t)header.bucketCount * sizeof(IndexBucket) +
+            (uint64_t)header.playerCount * sizeof(RankedPlayer)) {
+        return false;
+    }
+    // It must describe this log, as it was when the index was written
+    if (header.logBytes < LOG_HEADER_BYTES || (header.logBytes - LOG_HEADER_BYTES) % RECORD_BYTES != 0) return false;
+    if (header.logBytes == LOG_HEADER_BYTES) return header.playerCount == 0;
+    if (!log_.isOpen() || header.logBytes > log_.size()) return false;
+    uint64_t checksum;
+    memcpy(&checksum, log_.data() + header.logBytes - sizeof(checksum), sizeof(checksum));
+    return checksum == header.lastChecksum;
+}
+
+bool PlayerStore::readRecord(uint64_t offset, PlayerProfile& profile) const {
+    return readLogRecord(log_, offset, profile);
+}
+
+bool PlayerStore::findIndexed(const string& name, uint64_t hash, PlayerProfile& profile, uint64_t& offset) const {
+    if (!index_.isOpen()) return false;
+    PlayerIndexHeader header;
+    memcpy(&header, index_.data(), sizeof(header));
+    const unsigned char* buckets = index_.data() + sizeof(header);
+    uint32_t mask = header.bucketCount - 1;
+    // Linear probing; the table is at most half full, so an empty slot ends every search
+    for (uint32_t slot = (uint32_t)hash & mask, probes = 0; probes < header.bucketCount;
+        slot = (slot + 1) & mask, probes++) {
+        IndexBucket bucket;
+        memcpy(&bucket, buckets + (size_t)slot * sizeof(bucket), sizeof(bucket));
+        if (bucket.offset == 0) return false;
+        if (bucket.nameHash == hash && readRecord(bucket.offset, profile) && profile.name == name) {
+            offset = bucket.offset;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Function to take a profile newer than the index into the overlay
+void PlayerStore::remember(const PlayerProfile& profile, uint64_t offset) {
+    auto found = overlay_.find(profile.name);
+    if (found == overlay_.end()) {
+        OverlayEntry entry;
+        PlayerProfile indexed;
+        uint64_t indexedOffset;
+        entry.indexed = findIndexed(profile.name, nameHash(profile.name), indexed, indexedOffset);
+        entry.indexedRating = indexed.rating.value;
+        found = overlay_.emplace(profile.name, entry).first;
+    }
+    found->second.profile = profile;
+    found->second.offset = offset;
+}
+
+// Function to read the records the index does not cover (on the loader thread)
+void PlayerStore::scanTail() {
+    uint64_t end = log_.isOpen() ? log_.size() : 0;
+    for (uint64_t offset = indexedBytes_; offset + RECORD_BYTES <= end; offset += RECORD_BYTES) {
+        PlayerProfile profile;
+        if (readRecord(offset, profile)) remember(profile, offset);
+    }
+    dirty_ = !overlay_.empty();
+}
+
+bool PlayerStore::find(const string& name, PlayerProfile& profile) {
+    waitUntilLoaded();
+    string key = storedPlayerName(name);
+    auto found = overlay_.find(key);
+    if (found != overlay_.end()) {
+        profile = found->second.profile;
+        return true;
+    }
+    uint64_t offset;
+    return findIndexed(key, nameHash(key), profile, offset);
+}
+
+void PlayerStore::leaderboard(int count, vector<PlayerProfile>& top) {
+    waitUntilLoaded();
+    top.clear();
+
+    // Newer profiles, best first, and the names whose index entries they replace
+    vector<const OverlayEntry*> recent;
+    unordered_set<uint64_t> replaced;
+    for (const auto& item : overlay_) {
+        recent.push_back(&item.second);
+        if (item.second.indexed) replaced.insert(nameHash(item.first));
+    }
+    sort(recent.begin(), recent.end(), [](const OverlayEntry* a, const OverlayEntry* b) {
+        if (a->profile.rating.value != b->profile.rating.value) return a->profile.rating.value > b->profile.rating.value;
+        return a->profile.name < b->profile.name;
+    });
+
+    PlayerIndexHeader header = {};
+    if (index_.isOpen()) memcpy(&header, index_.data(), sizeof(header));
+    const unsigned char* ranking = index_.isOpen() ?
+        index_.data() + sizeof(header) + (size_t)header.bucketCount * sizeof(IndexBucket) : nullptr;
+
+    // Merge the two, skipping index entries that a newer profile replaces
+    uint32_t next = 0;
+    size_t nextRecent = 0;
+    while ((int)top.size() < count) {
+        RankedPlayer ranked = {};
+        PlayerProfile profile;
+        bool fromIndex = false;
+        while (next < header.playerCount && !fromIndex) {
+            memcpy(&ranked, ranking + (size_t)next * sizeof(ranked), sizeof(ranked));
+            fromIndex = readRecord(ranked.offset, profile) &&
+                !(replaced.count(ranked.nameHash) && overlay_.count(profile.name));
+            if (!fromIndex) next++;
+        }
+        bool fromOverlay = nextRecent < recent.size();
+        if (!fromIndex && !fromOverlay) break;
+        if (fromIndex && (!fromOverlay || ranked.rating >= recent[nextRecent]->profile.rating.value)) {
+            top.push_back(profile);
+            next++;
+        }
+        else {
+            top.push_back(recent[nextRecent++]->profile);
+        }
+    }
+}
+
+int PlayerStore::rankOf(const string& name) {
+    PlayerProfile profile;
+    if (!find(name, profile)) return 0;
+
+    // Indexed players rated higher: a binary search of the sorted ratings
+    uint32_t above = 0;
+    if (index_.isOpen()) {
+        PlayerIndexHeader header;
+        memcpy(&header, index_.data(), sizeof(header));
+        const unsigned char* ranking = index_.data() + sizeof(header) + (size_t)header.bucketCount * sizeof(IndexBucket);
+        uint32_t low = 0;
+        uint32_t high = header.playerCount;
+        while (low < high) {
+            uint32_t middle = low + (high - low) / 2;
+            double rating;
+            memcpy(&rating, ranking + (size_t)middle * sizeof(RankedPlayer), sizeof(rating));
+            if (rating > profile.rating.value) low = middle + 1;
+            else high = middle;
+        }
+        above = low;
+    }
+
+    // Then the overlay: ratings the index has out of date, and players it lacks
+    long long rank = (long long)above + 1;
+    for (const auto& item : overlay_) {
+        const OverlayEntry& entry = item.second;
+        if (entry.indexed && entry.indexedRating > profile.rating.value) rank--;
+        if (entry.profile.name != profile.name && entry.profile.rating.value > profile.rating.value) rank++;
+    }
+    return (int)rank;
+}
+
+int PlayerStore::playerCount() {
+    waitUntilLoaded();
+    int count = 0;
+    if (index_.isOpen()) {
+        PlayerIndexHeader header;
+        memcpy(&header, index_.data(), sizeof(header));
+        count = (int)header.playerCount;
+    }
+    for (const auto& item : overlay_) {
+        if (!item.second.indexed) count++;
+    }
+    return count;
+}
+
+bool PlayerStore::appendProfile(const PlayerProfile& profile, uint64_t& offset) {
+    if (!writer_) {
+        writer_ = fopen(logPath_.c_str(), "ab");
+        if (!writer_) return false;
+        fseek(writer_, 0, SEEK_END);
+        long size = ftell(writer_);
+        bool ok = size >= (long)LOG_HEADER_BYTES;
+        if (size == 0) {
+            ok = fwrite(PLAYER_LOG_MAGIC, 4, 1, writer_) == 1 &&
+                fwrite(&PLAYER_LOG_VERSION, sizeof(PLAYER_LOG_VERSION), 1, writer_) == 1;
+            size = (long)LOG_HEADER_BYTES;
+        }
+        // A record cut short by a crash is padded out (and then fails its
+        // checksum), so the next one starts on a record boundary
+        uint64_t torn = ok ? ((uint64_t)size - LOG_HEADER_BYTES) % RECORD_BYTES : 0;
+        if (torn) {
+            unsigned char zeros[sizeof(PlayerRecord)] = {};
+            ok = fwrite(zeros, RECORD_BYTES - torn, 1, writer_) == 1;
+            size += (long)(RECORD_BYTES - torn);
+        }
+        if (!ok) {
+            fclose(writer_);
+            writer_ = nullptr;
+            return false;
+        }
+        logEnd_ = (uint64_t)size;
+    }
+
+    PlayerRecord record = encodeProfile(profile);
+    if (fwrite(&record, sizeof(record), 1, writer_) != 1) return false;
+    offset = logEnd_;
+    logEnd_ += RECORD_BYTES;
+    lastChecksum_ = record.checksum;
+    return true;
+}
+
+void PlayerStore::recordMatch(const PlayedMatch& match, const RatingOptions& options) {
+    string name1 = storedPlayerName(match.player1Name);
+    string name2 = storedPlayerName(match.player2Name);
+    if (!isOpen() || name1.empty() || name2.empty() || name1 == name2 || match.result == GameResult::None) return;
+    waitUntilLoaded();
+
+    PlayerProfile player1;
+    PlayerProfile player2;
+    if (!find(name1, player1)) player1.name = name1;
+    if (!find(name2, player2)) player2.name = name2;
+
+    rateMatch(options, player1.rating, player2.rating, match.result);
+    player1.matches++;
+    player2.matches++;
+    player1.wins += match.result == GameResult::Player1Wins;
+    player2.wins += match.result == GameResult::Player2Wins;
+    player1.draws += match.result == GameResult::Draw;
+    player2.draws += match.result == GameResult::Draw;
+    player1.guesses += match.player1Guesses;
+    player2.guesses += match.player2Guesses;
+    player1.timeouts += match.player1Timeouts;
+    player2.timeouts += match.player2Timeouts;
+
+    uint64_t offset1;
+    uint64_t offset2;
+    if (!appendProfile(player1, offset1) || !appendProfile(player2, offset2)) return;
+    fflush(writer_);
+    remember(player1, offset1);
+    remember(player2, offset2);
+    dirty_ = true;
+    reindexIfLarge();
+}
+
+void PlayerStore::recordProfile(const PlayerProfile& profile) {
+    PlayerProfile stored = profile;
+    stored.name = storedPlayerName(profile.name);
+    if (!isOpen() || stored.name.empty()) return;
+    waitUntilLoaded();
+    uint64_t offset;
+    if (!appendProfile(stored, offset)) return;
+    remember(stored, offset);
+    dirty_ = true;
+    reindexIfLarge();
+}
+
+// Everything an index is written from, taken on the thread that owns the
+// overlay so the writing can happen on another
+struct PlayerIndexPlan {
+    vector<RankedPlayer> recent;            // The overlay's newest profiles
+    unordered_set<uint64_t> replacedHashes; // Of overlay names the old index has
+    unordered_set<string> replacedNames;
+    uint64_t logBytes = 0;
+    uint64_t lastChecksum = 0;
+};
+
+// Function to write an index from the old one and a plan to path. It reads
+// only the two mappings and the plan, so it can run beside queries.
+static bool writeIndexFile(const string& path, const MappedFile& index, const MappedFile& log, const PlayerIndexPlan& plan) {
+    // Every player's newest rating: the old index's own unless a newer
+    // profile replaces it, then the overlay
+    vector<RankedPlayer> ranking;
+    if (index.isOpen()) {
+        PlayerIndexHeader header;
+        memcpy(&header, index.data(), sizeof(header));
+        const unsigned char* entries = index.data() + sizeof(header) + (size_t)header.bucketCount * sizeof(IndexBucket);
+        ranking.reserve(header.playerCount + plan.recent.size());
+        for (uint32_t i = 0; i < header.playerCount; i++) {
+            RankedPlayer entry;
+            memcpy(&entry, entries + (size_t)i * sizeof(entry), sizeof(entry));
+            PlayerProfile profile;
+            if (plan.replacedHashes.count(entry.nameHash) && readLogRecord(log, entry.offset, profile) &&
+                plan.replacedNames.count(profile.name)) {
+                continue;
+            }
+            ranking.push_back(entry);
+        }
+    }
+    ranking.insert(ranking.end(), plan.recent.begin(), plan.recent.end());
+    sort(ranking.begin(), ranking.end(), [](const RankedPlayer& a, const RankedPlayer& b) {
+        if (a.rating != b.rating) return a.rating > b.rating;
+        return a.offset < b.offset;
+    });
+
+    PlayerIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PLAYER_INDEX_MAGIC, 4);
+    header.version = PLAYER_INDEX_VERSION;
+    header.playerCount = (uint32_t)ranking.size();
+    header.bucketCount = 16;
+    while (header.bucketCount < 2 * ranking.size()) header.bucketCount *= 2;
+    header.logBytes = plan.logBytes;
+    header.lastChecksum = plan.lastChecksum;
+    vector<IndexBucket> buckets(header.bucketCount, IndexBucket{ 0, 0 });
+    uint32_t mask = header.bucketCount - 1;
+    for (const RankedPlayer& entry : ranking) {
+        uint32_t slot = (uint32_t)entry.nameHash & mask;
+        while (buckets[slot].offset != 0) slot = (slot + 1) & mask;
+        buckets[slot] = { entry.nameHash, entry.offset };
+    }
+
+    FILE* file = fopen(path.c_str(), "wb");
+    bool ok = file != nullptr;
+    if (ok) {
+        ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(buckets.data(), sizeof(IndexBucket), buckets.size(), file) == buckets.size() &&
+            (ranking.empty() || fwrite(ranking.data(), sizeof(RankedPlayer), ranking.size(), file) == ranking.size());
+        ok = (fclose(file) == 0) && ok;
+    }
+    if (!ok) remove(path.c_str());
+    return ok;
+}
+
+// Function to describe the index as it should be now
+void PlayerStore::planIndex(PlayerIndexPlan& plan) {
+    if (writer_) fflush(writer_);
+    for (const auto& item : overlay_) {
+        uint64_t hash = nameHash(item.first);
+        plan.recent.push_back({ item.second.profile.rating.value, item.second.offset, hash });
+        if (item.second.indexed) {
+            plan.replacedHashes.insert(hash);
+            plan.replacedNames.insert(item.first);
+        }
+    }
+    // The log as far as it goes now: appended records end at logEnd_, and a
+    // torn one the writer never padded is left out
+    if (writer_) {
+        plan.logBytes = logEnd_;
+        plan.lastChecksum = lastChecksum_;
+    }
+    else {
+        uint64_t size = log_.isOpen() ? log_.size() : LOG_HEADER_BYTES;
+        plan.logBytes = size - (size - LOG_HEADER_BYTES) % RECORD_BYTES;
+        if (plan.logBytes > LOG_HEADER_BYTES) {
+            memcpy(&plan.lastChecksum, log_.data() + plan.logBytes - sizeof(uint64_t), sizeof(uint64_t));
+        }
+    }
+}
+
+// Function to put a written index in place and drop the overlay entries it
+// covers; those recorded since it was planned stay, checked against it
+bool PlayerStore::installIndex(const string& tempPath, bool written, uint64_t logBytes) {
+    // The old mapping goes first (Windows cannot replace a mapped file)
+    index_.close();
+    bool ok = written;
+    if (ok) {
+        remove(indexPath_.c_str());     // rename() does not replace an existing file on Windows
+        ok = rename(tempPath.c_str(), indexPath_.c_str()) == 0;
+    }
+    else {
+        remove(tempPath.c_str());
+    }
+
+    // Remapped either way, the log too, so records appended since can be read
+    mapFiles();
+    if (!ok || indexedBytes_ != logBytes) return false;
+    for (auto item = overlay_.begin(); item != overlay_.end();) {
+        OverlayEntry& entry = item->second;
+        if (entry.offset < logBytes) {
+            item = overlay_.erase(item);
+            continue;
+        }
+        PlayerProfile indexed;
+        uint64_t indexedOffset;
+        entry.indexed = findIndexed(item->first, nameHash(item->first), indexed, indexedOffset);
+        entry.indexedRating = indexed.rating.value;
+        ++item;
+    }
+    dirty_ = !overlay_.empty();
+    return true;
+}
+
+bool PlayerStore::rebuildIndex() {
+    PlayerIndexPlan plan;
+    planIndex(plan);
+    string tempPath = indexPath_ + ".tmp";
+    bool written = writeIndexFile(tempPath, index_, log_, plan);
+    return installIndex(tempPath, written, plan.logBytes);
+}
+
+bool PlayerStore::saveIndex() {
+    if (!isOpen()) return false;
+    waitUntilLoaded();
+    finishIndexer();
+    return rebuildIndex();
+}
+
+// Function to start writing an index in the background once the overlay
+// has grown past OVERLAY_LIMIT, and to put the last one written in place.
+// Queries go on meanwhile: the writer only reads the mappings, which are
+// not remapped until it is done.
+void PlayerStore::reindexIfLarge() {
+    if (indexer_.joinable() && indexerDone_.load()) finishIndexer();
+    if (indexer_.joinable() || overlay_.size() < OVERLAY_LIMIT) return;
+    auto plan = make_shared<PlayerIndexPlan>();
+    planIndex(*plan);
+    indexerLogBytes_ = plan->logBytes;
+    indexerDone_ = false;
+    indexer_ = thread([this, plan] {
+        indexerWritten_ = writeIndexFile(indexPath_ + ".tmp", index_, log_, *plan);
+        indexerDone_ = true;
+    });
+}
+
+// Function to wait for the background index writer, if any, and install
+// what it wrote
+void PlayerStore::finishIndexer() {
+    if (!indexer_.joinable()) return;
+    indexer_.join();
+    installIndex(indexPath_ + ".tmp", indexerWritten_, indexerLogBytes_);
+}
+
+// One chunk of a replayed history: the matches for the rating batch, and the
+// statistics each match adds to its two players
+struct ReplayChunk {
+    vector<RatedMatch> matches;
+    vector<PlayedMatch> played;         // Names left empty; the ids are in matches
+};
+
+bool replayPlayerHistory(const unsigned char* data, size_t size, const RatingOptions& options,
+    vector<PlayerProfile>& profiles, ThreadPool& pool) {
+    profiles.clear();
+    GameRecordReader reader(data, size);
+    if (!reader.valid()) return false;
+
+    // The reader thread fills chunks while the caller rates the one before;
+    // it hands them over through ready, at most two ahead
+    mutex lock;
+    condition_variable changed;
+    vector<ReplayChunk> ready;
+    bool finished = false;
+    unordered_map<string, uint32_t> ids;
+
+    thread parser([&] {
+        ReplayChunk chunk;
+        MatchInfo info;
+        GameEvent event;
+        auto handOff = [&] {
+            unique_lock<mutex> guard(lock);
+            changed.wait(guard, [&] { return ready.size() < 2; });
+            ready.push_back(move(chunk));
+            chunk = ReplayChunk();
+            changed.notify_all();
+        };
+        while (reader.nextMatch(info)) {
+            // The match as the game played it: every recorded event through step()
+            GameState state;
+            state.timeLimitPerTurn = info.timeLimitPerTurn;
+            int timeouts[2] = { 0, 0 };
+            while (reader.nextEvent(event)) {
+                StepResult result;
+                state = step(state, event, &result);
+                if (result.outcome == StepOutcome::TimedOut) timeouts[result.byPlayer1 ? 0 : 1]++;
+            }
+            string name1 = storedPlayerName(info.player1Name);
+            string name2 = storedPlayerName(info.player2Name);
+            if (reader.matchEnd() != MatchEnd::Finished || state.result == GameResult::None ||
+                name1.empty() || name2.empty() || name1 == name2) {
+                continue;
+            }
+            PlayedMatch played = makePlayedMatch(state, name1, name2, timeouts[0], timeouts[1]);
+
+            // Only this thread touches ids until it is done
+            uint32_t id1 = ids.emplace(name1, (uint32_t)ids.size()).first->second;
+            uint32_t id2 = ids.emplace(name2, (uint32_t)ids.size()).first->second;
+            chunk.matches.push_back({ id1, id2, played.result });
+            chunk.played.push_back(played);
+            if (chunk.matches.size() >= REPLAY_CHUNK_MATCHES) handOff();
+        }
+        if (!chunk.matches.empty()) handOff();
+        lock_guard<mutex> guard(lock);
+        finished = true;
+        changed.notify_all();
+    });
+
+    RatingBatch batch(options, pool);
+    vector<PlayerProfile> counted;
+    while (true) {
+        ReplayChunk chunk;
+        {
+            unique_lock<mutex> guard(lock);
+            changed.wait(guard, [&] { return !ready.empty() || finished; });
+            if (ready.empty()) break;
+            chunk = move(ready.front());
+            ready.erase(ready.begin());
+            changed.notify_all();
+        }
+        batch.add(chunk.matches.data(), chunk.matches.size());
+        for (size_t i = 0; i < chunk.matches.size(); i++) {
+            const RatedMatch& match = chunk.matches[i];
+            const PlayedMatch& played = chunk.played[i];
+            size_t needed = (size_t)max(match.player1, match.player2) + 1;
+            if (counted.size() < needed) counted.resize(needed);
+            PlayerProfile& player1 = counted[match.player1];
+            PlayerProfile& player2 = counted[match.player2];
+            player1.matches++;
+            player2.matches++;
+            player1.wins += played.result == GameResult::Player1Wins;
+            player2.wins += played.result == GameResult::Player2Wins;
+            player1.draws += played.result == GameResult::Draw;
+            player2.draws += played.result == GameResult::Draw;
+            player1.guesses += played.player1Guesses;
+            player2.guesses += played.player2Guesses;
+            player1.timeouts += played.player1Timeouts;
+            player2.timeouts += played.player2Timeouts;
+        }
+    }
+    parser.join();
+    batch.finish();
+
+    const vector<Rating>& ratings = batch.ratings();
+    for (const auto& item : ids) {
+        counted[item.second].name = item.first;
+        counted[item.second].rating = ratings[item.second];
+    }
+    profiles = move(counted);
+    sort(profiles.begin(), profiles.end(), [](const PlayerProfile& a, const PlayerProfile& b) {
+        if (a.rating.value != b.rating.value) return a.rating.value > b.rating.value;
+        return a.name < b.name;
+    });
+    return true;
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+// Persistent player profiles and the leaderboard.
+//
+// Profiles live in an append-only log. After every match each player's
+// whole profile is appended as one fixed-size record with an FNV-1a
+// checksum, and the newest record under a name is that player's profile.
+// A record torn by a crash fails its checksum and is skipped, and the next
+// append pads the log back to a record boundary, so nothing is rewritten.
+//
+// Beside the log sits an index file: an open-addressing hash table from
+// the name's hash to the offset of its newest record, and every player's
+// rating and offset sorted best first. Both files are memory-mapped, so a
+// lookup is a probe or two plus one log record, and the top of the
+// leaderboard is the front of the sorted array, however long the log has
+// grown; nothing is read until it is asked for.
+//
+// The index covers the log up to a length it records. Records past it
+// (matches played since it was written, by this run or by one that crashed
+// before writing it) are read into a small in-memory overlay that queries
+// consult first. open() leaves that scan to a background thread, so it
+// never blocks the first frame, and close() writes an index covering the
+// whole log. Once the overlay holds OVERLAY_LIMIT players a fresh index is
+// written on another thread while queries go on, so a store that is never
+// closed (a server) keeps its queries as cheap as one that is.
+//
+// Ratings are updated match by match (engine/rating.h). The game record
+// holds the full history, so replayPlayerHistory() can rebuild every
+// profile from it, e.g. after a formula change, into a fresh log.
+
+#include "engine/game_engine.h"
+#include "engine/mapped_file.h"
+#include "engine/rating.h"
+#include "engine/thread_pool.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct PlayerIndexPlan;
+
+// Version 2 added the Glicko-2 deviation and volatility to the records;
+// open() upgrades a version 1 log in place
+const uint32_t PLAYER_LOG_VERSION = 2;
+const uint32_t PLAYER_INDEX_VERSION = 1;
+
+// Overlay size at which the index is rewritten
+const size_t OVERLAY_LIMIT = 4096;
+
+// Names are stored in this many bytes, terminator included
+const int PLAYER_NAME_BYTES = 32;
+
+struct PlayerProfile {
+    std::string name;
+    int matches = 0;
+    int wins = 0;
+    int draws = 0;
+    int timeouts = 0;           // Turns left to run out
+    long long guesses = 0;      // Guesses made, over every match
+    Rating rating;
+
+    int losses() const { return matches - wins - draws; }
+    double averageGuesses() const { return matches ? (double)guesses / matches : 0; }
+};
+
+// A finished match, as the store needs it
+struct PlayedMatch {
+    std::string player1Name;
+    std::string player2Name;
+    GameResult result = GameResult::None;
+    int player1Guesses = 0;
+    int player2Guesses = 0;
+    int player1Timeouts = 0;
+    int player2Timeouts = 0;
+};
+
+// Function to shorten a name to what the store keeps (at most
+// PLAYER_NAME_BYTES - 1 bytes)
+std::string storedPlayerName(const std::string& name);
+
+// Function to describe a finished match from the state step() left it in and
+// the turns each player let run out. step() does not count the winning guess
+// as a turn, so the winner is given it back here.
+PlayedMatch makePlayedMatch(const GameState& state, const std::string& player1Name,
+    const std::string& player2Name, int player1Timeouts, int player2Timeouts);
+
+class PlayerStore {
+public:
+    PlayerStore() = default;
+    ~PlayerStore();
+
+    PlayerStore(const PlayerStore&) = delete;
+    PlayerStore& operator=(const PlayerStore&) = delete;
+
+    // Function to map the log and its index (either may be missing) and
+    // start reading what the index does not cover; false when the log exists
+    // but is not a player log of this version (or of version 1, which is
+    // upgraded here, once, before anything else)
+    bool open(const char* logPath, const char* indexPath);
+    // Function to write a fresh index if anything was recorded, and close
+    void close();
+    bool isOpen() const { return !logPath_.empty(); }
+
+    // True once the background scan is done; until then every query below
+    // waits for it (a caller that must not block checks this first)
+    bool ready() const { return loaded_.load(); }
+
+    // Function to get a player's profile; false for a name never recorded
+    bool find(const std::string& name, PlayerProfile& profile);
+    // Function to list up to count players, best rated first
+    void leaderboard(int count, std::vector<PlayerProfile>& top);
+    // Function to get a player's place on the leaderboard (1 for the best;
+    // equal ratings share a place); 0 for a name never recorded
+    int rankOf(const std::string& name);
+    int playerCount();
+
+    // Function to update both players' profiles and ratings from a match and
+    // append them to the log. A match between two players of the same name
+    // is not recorded.
+    void recordMatch(const PlayedMatch& match, const RatingOptions& options = RatingOptions());
+    // Function to append a profile as it is, replacing any under its name
+    void recordProfile(const PlayerProfile& profile);
+
+    // Function to rewrite the index so it covers the whole log
+    bool saveIndex();
+
+private:
+    // A profile newer than the index, and what the index says about its player
+    struct OverlayEntry {
+        PlayerProfile profile;
+        uint64_t offset = 0;            // Of its newest log record
+        bool indexed = false;           // The index has an older record
+        double indexedRating = 0;
+    };
+
+    void waitUntilLoaded();
+    void scanTail();
+    void remember(const PlayerProfile& profile, uint64_t offset);
+    bool mapFiles();
+    bool indexValid() const;
+    bool findIndexed(const std::string& name, uint64_t hash, PlayerProfile& profile, uint64_t& offset) const;
+    bool readRecord(uint64_t offset, PlayerProfile& profile) const;
+    bool appendProfile(const PlayerProfile& profile, uint64_t& offset);
+    void planIndex(PlayerIndexPlan& plan);
+    bool installIndex(const std::string& tempPath, bool written, uint64_t logBytes);
+    bool rebuildIndex();
+    void reindexIfLarge();
+    void finishIndexer();
+
+    std::string logPath_;
+    std::string indexPath_;
+    MappedFile log_;
+    MappedFile index_;
+    uint64_t indexedBytes_ = 0;     // Log bytes the index covers
+    uint64_t logEnd_ = 0;           // Where the next record goes
+    uint64_t lastChecksum_ = 0;     // Of the last record appended
+    FILE* writer_ = nullptr;        // Opened on the first append
+    bool dirty_ = false;            // Recorded since the index was written
+
+    std::unordered_map<std::string, OverlayEntry> overlay_;
+    std::thread loader_;
+    std::atomic<bool> loaded_{ false };
+
+    std::thread indexer_;               // Writes an index while queries go on
+    std::atomic<bool> indexerDone_{ false };
+    bool indexerWritten_ = false;       // Set by the indexer before it is done
+    uint64_t indexerLogBytes_ = 0;      // Log bytes its index covers
+};
+
+// Function to rebuild every player's profile from a game record
+// (engine/game_record.h): statistics counted over the finished matches,
+// ratings by a RatingBatch. A reader thread decodes the record a chunk of
+// matches at a time while the previous chunk is rated. Profiles come out
+// best rated first; false if the data is not a game record.
+bool replayPlayerHistory(const unsigned char* data, size_t size, const RatingOptions& options,
+    std::vector<PlayerProfile>& profiles, ThreadPool& pool = sharedThreadPool());
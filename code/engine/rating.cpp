@@ -0,0 +1,234 @@
+#include "engine/rating.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+using namespace std;
+
+static const double PI = 3.14159265358979323846;
+static const double GLICKO_SCALE = 173.7178;        // Glicko-2 works on ratings divided by this
+static const double VOLATILITY_TOLERANCE = 1e-6;
+static const size_t PLAYERS_PER_TASK = 1024;        // Periods with fewer players are rated on fewer tasks
+static const uint32_t NO_SLOT = UINT32_MAX;
+
+bool parseRatingFormula(const char* text, RatingFormula& formula) {
+    if (strcmp(text, "elo") == 0) formula = RatingFormula::Elo;
+    else if (strcmp(text, "glicko2") == 0) formula = RatingFormula::Glicko2;
+    else return false;
+    return true;
+}
+
+const char* ratingFormulaName(RatingFormula formula) {
+    return formula == RatingFormula::Elo ? "elo" : "glicko2";
+}
+
+static double player1Score(GameResult result) {
+    return result == GameResult::Player1Wins ? 1 : result == GameResult::Draw ? 0.5 : 0;
+}
+
+// Function to weigh an opponent by how unsure their rating is (Glickman's g)
+static double glickoWeight(double phi) {
+    return 1 / sqrt(1 + 3 * phi * phi / (PI * PI));
+}
+
+// Function to find a player's new volatility by the Illinois iteration
+// (step 5 of Glickman's "Example of the Glicko-2 system")
+static double newVolatility(double phi, double volatility, double variance, double delta, double tau) {
+    double a = log(volatility * volatility);
+    auto f = [&](double x) {
+        double ex = exp(x);
+        double d = phi * phi + variance + ex;
+        return ex * (delta * delta - phi * phi - variance - ex) / (2 * d * d) - (x - a) / (tau * tau);
+    };
+    double low = a;
+    double high;
+    if (delta * delta > phi * phi + variance) {
+        high = log(delta * delta - phi * phi - variance);
+    }
+    else {
+        int k = 1;
+        while (f(a - k * tau) < 0) k++;
+        high = a - k * tau;
+    }
+    double fLow = f(low);
+    double fHigh = f(high);
+    while (fabs(high - low) > VOLATILITY_TOLERANCE) {
+        double middle = low + (low - high) * fLow / (fHigh - fLow);
+        double fMiddle = f(middle);
+        if (fMiddle * fHigh <= 0) {
+            low = high;
+            fLow = fHigh;
+        }
+        else {
+            fLow /= 2;
+        }
+        high = middle;
+        fHigh = fMiddle;
+    }
+    return exp(low / 2);
+}
+
+// Function to add one game; mu is the player's scaled rating, the opponent's
+// is given with its weight g
+static void addGame(PeriodSums& sums, double mu, double opponentMu, double opponentWeight, double score) {
+    double expected = 1 / (1 + exp(-opponentWeight * (mu - opponentMu)));
+    sums.inverseVariance += opponentWeight * opponentWeight * expected * (1 - expected);
+    sums.improvement += opponentWeight * (score - expected);
+}
+
+// Function to widen a player's deviation for rating periods they sat out;
+// each one adds the volatility in quadrature, up to the initial deviation
+static void sitOut(Rating& rating, uint32_t periods) {
+    if (periods == 0) return;
+    double phi = rating.deviation / GLICKO_SCALE;
+    double widened = sqrt(phi * phi + periods * rating.volatility * rating.volatility) * GLICKO_SCALE;
+    rating.deviation = min(widened, INITIAL_DEVIATION);
+}
+
+// Function to rate a player who played in a period at its end
+static Rating endPeriod(const Rating& rating, const PeriodSums& sums, double tau) {
+    Rating next = rating;
+    double phi = rating.deviation / GLICKO_SCALE;
+    double variance = 1 / sums.inverseVariance;
+    double volatility = newVolatility(phi, rating.volatility, variance, variance * sums.improvement, tau);
+    double phiStar = sqrt(phi * phi + volatility * volatility);
+    double newPhi = 1 / sqrt(1 / (phiStar * phiStar) + 1 / variance);
+    double mu = (rating.value - INITIAL_RATING) / GLICKO_SCALE + newPhi * newPhi * sums.improvement;
+    next.value = INITIAL_RATING + GLICKO_SCALE * mu;
+    next.deviation = GLICKO_SCALE * newPhi;
+    next.volatility = volatility;
+    return next;
+}
+
+void rateMatch(const RatingOptions& options, Rating& player1, Rating& player2, GameResult result) {
+    if (result == GameResult::None) return;
+    double score = player1Score(result);
+    if (options.formula == RatingFormula::Elo) {
+        // The winner takes from the loser what the result beat expectations by
+        double expected = 1 / (1 + pow(10.0, (player2.value - player1.value) / 400));
+        double change = options.eloK * (score - expected);
+        player1.value += change;
+        player2.value -= change;
+        return;
+    }
+
+    double mu1 = (player1.value - INITIAL_RATING) / GLICKO_SCALE;
+    double mu2 = (player2.value - INITIAL_RATING) / GLICKO_SCALE;
+    PeriodSums sums1;
+    PeriodSums sums2;
+    addGame(sums1, mu1, mu2, glickoWeight(player2.deviation / GLICKO_SCALE), score);
+    addGame(sums2, mu2, mu1, glickoWeight(player1.deviation / GLICKO_SCALE), 1 - score);
+    Rating next1 = endPeriod(player1, sums1, options.tau);
+    player2 = endPeriod(player2, sums2, options.tau);
+    player1 = next1;
+}
+
+RatingBatch::RatingBatch(const RatingOptions& options, ThreadPool& pool) : options_(options), pool_(pool) {
+    options_.periodMatches = max(1, options_.periodMatches);
+}
+
+void RatingBatch::add(const RatedMatch* matches, size_t count) {
+    bool matchByMatch = options_.formula == RatingFormula::Elo || options_.periodMatches == 1;
+    for (size_t i = 0; i < count; i++) {
+        const RatedMatch& match = matches[i];
+        if (match.result == GameResult::None || match.player1 == match.player2) continue;
+        size_t needed = (size_t)max(match.player1, match.player2) + 1;
+        if (ratings_.size() < needed) {
+            ratings_.resize(needed);
+            if (!matchByMatch) {
+                // A new player's deviation is already as wide as it gets
+                periodsApplied_.resize(needed, periodsRated_);
+                slots_.resize(needed, NO_SLOT);
+            }
+        }
+
+        if (matchByMatch) {
+            rateMatch(options_, ratings_[match.player1], ratings_[match.player2], match.result);
+            matchesRated_++;
+            continue;
+        }
+        period_.push_back(match);
+        if ((int)period_.size() >= options_.periodMatches) ratePeriod();
+    }
+}
+
+void RatingBatch::finish() {
+    if (!period_.empty()) ratePeriod();
+    for (size_t p = 0; p < periodsApplied_.size(); p++) {
+        sitOut(ratings_[p], periodsRated_ - periodsApplied_[p]);
+        periodsApplied_[p] = periodsRated_;
+    }
+}
+
+// Every player's update reads only the ratings from before the period, so
+// the period's players are cut into ranges of slots, one task each. A task
+// walks the period for the games its players were in: repeated reading, but
+// the only writes are to its own slots and players, so nothing is shared or
+// locked. Players who sat the period out are not touched.
+void RatingBatch::ratePeriod() {
+    players_.clear();
+    for (const RatedMatch& match : period_) {
+        for (uint32_t player : { match.player1, match.player2 }) {
+            if (slots_[player] != NO_SLOT) continue;
+            slots_[player] = (uint32_t)players_.size();
+            players_.push_back(player);
+        }
+    }
+    size_t count = players_.size();
+    mu_.resize(count);
+    weight_.resize(count);
+    sums_.resize(count);
+    size_t tasksWanted = min((size_t)pool_.threadCount(), (count + PLAYERS_PER_TASK - 1) / PLAYERS_PER_TASK);
+    size_t taskCount = max((size_t)1, tasksWanted);
+    size_t perTask = (count + taskCount - 1) / taskCount;
+
+    // Function to run one task per slot range and wait for them all
+    auto forEachRange = [&](const function<void(size_t, size_t)>& body) {
+        TaskGroup tasks;
+        for (size_t begin = 0; begin < count; begin += perTask) {
+            size_t end = min(count, begin + perTask);
+            tasks.add();
+            pool_.submit([&tasks, &body, begin, end] {
+                body(begin, end);
+                tasks.done();
+            });
+        }
+        tasks.wait();
+    };
+
+    // Periods sat out since a player last played widen their deviation first
+    forEachRange([&](size_t begin, size_t end) {
+        for (size_t slot = begin; slot < end; slot++) {
+            uint32_t player = players_[slot];
+            Rating& rating = ratings_[player];
+            sitOut(rating, periodsRated_ - periodsApplied_[player]);
+            mu_[slot] = (rating.value - INITIAL_RATING) / GLICKO_SCALE;
+            weight_[slot] = glickoWeight(rating.deviation / GLICKO_SCALE);
+            sums_[slot] = PeriodSums();
+        }
+    });
+    forEachRange([&](size_t begin, size_t end) {
+        for (const RatedMatch& match : period_) {
+            double score = player1Score(match.result);
+            size_t slot1 = slots_[match.player1];
+            size_t slot2 = slots_[match.player2];
+            if (slot1 >= begin && slot1 < end) addGame(sums_[slot1], mu_[slot1], mu_[slot2], weight_[slot2], score);
+            if (slot2 >= begin && slot2 < end) {
+                addGame(sums_[slot2], mu_[slot2], mu_[slot1], weight_[slot1], 1 - score);
+            }
+        }
+        for (size_t slot = begin; slot < end; slot++) {
+            uint32_t player = players_[slot];
+            ratings_[player] = endPeriod(ratings_[player], sums_[slot], options_.tau);
+            periodsApplied_[player] = periodsRated_ + 1;
+        }
+    });
+    // Not in the tasks: every one of them reads every slot
+    for (uint32_t player : players_) slots_[player] = NO_SLOT;
+
+    periodsRated_++;
+    matchesRated_ += period_.size();
+    period_.clear();
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+// Player ratings: Elo and Glicko-2, one match at a time or over a whole
+// history.
+//
+// rateMatch() is the incremental update the game and the server apply when
+// a match ends. Under Glicko-2 it treats the match as a rating period of its
+// own for both players, so it needs nothing but their two ratings.
+//
+// RatingBatch recomputes ratings from scratch over a history, for instance
+// after a formula change. Matches are fed in chunks, in the order they were
+// played, and never held all at once. Elo is a chain (every update reads the
+// ratings the last one wrote), so it runs match by match on one thread; it
+// is a few nanoseconds a match anyway. Glicko-2 as Glickman defines it rates
+// in periods: every player's update in a period reads only the ratings from
+// before it, so the players of a period are split across the ThreadPool and
+// rated at once. A period costs what its matches cost, however many players
+// the history has: a player who sits periods out is only brought up to date
+// (their deviation widened once for all of them) when they next play, or at
+// finish(). A period of one match gives exactly what rateMatch() gives, and
+// is rated that way.
+
+#include "engine/game_engine.h"
+#include "engine/thread_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const double INITIAL_RATING = 1500;
+const double INITIAL_DEVIATION = 350;       // Glicko-2: how unsure a new rating is
+const double INITIAL_VOLATILITY = 0.06;     // Glicko-2: how erratic a player's results are
+
+// Glicko-2 batches: matches per rating period unless told otherwise; large
+// enough that a period's players keep every core busy
+const int DEFAULT_PERIOD_MATCHES = 4096;
+
+enum class RatingFormula {
+    Elo,
+    Glicko2
+};
+
+struct Rating {
+    double value = INITIAL_RATING;
+    double deviation = INITIAL_DEVIATION;   // Unused by Elo
+    double volatility = INITIAL_VOLATILITY; // Unused by Elo
+};
+
+struct RatingOptions {
+    RatingFormula formula = RatingFormula::Glicko2;
+    double eloK = 32;           // Elo: most a rating moves in one match
+    double tau = 0.5;           // Glicko-2: how fast volatility may change
+    int periodMatches = DEFAULT_PERIOD_MATCHES;    // Glicko-2 batches: matches per rating period
+};
+
+// Function to parse "elo" or "glicko2"
+bool parseRatingFormula(const char* text, RatingFormula& formula);
+const char* ratingFormulaName(RatingFormula formula);
+
+// Function to update both players after one match; result is the match's
+// (None leaves both alone)
+void rateMatch(const RatingOptions& options, Rating& player1, Rating& player2, GameResult result);
+
+// A match as the batch sees it: players are indices into its ratings
+struct RatedMatch {
+    uint32_t player1;
+    uint32_t player2;
+    GameResult result;
+};
+
+// One player's games in a rating period, summed as Glicko-2 needs them
+struct PeriodSums {
+    double inverseVariance = 0;     // Sum of g^2 E (1 - E)
+    double improvement = 0;         // Sum of g (s - E)
+};
+
+class RatingBatch {
+public:
+    explicit RatingBatch(const RatingOptions& options, ThreadPool& pool = sharedThreadPool());
+
+    // Function to rate the next matches of the history; players not seen
+    // before start at the initial rating
+    void add(const RatedMatch* matches, size_t count);
+    // Function to rate the last, partial rating period and bring every
+    // player's deviation up to date
+    void finish();
+
+    // By player index; complete once finish() has returned
+    const std::vector<Rating>& ratings() const { return ratings_; }
+    uint64_t matchesRated() const { return matchesRated_; }
+
+private:
+    void ratePeriod();
+
+    RatingOptions options_;
+    ThreadPool& pool_;
+    std::vector<Rating> ratings_;
+    std::vector<uint32_t> periodsApplied_;  // By player: periods their rating has been through
+    uint32_t periodsRated_ = 0;
+    std::vector<RatedMatch> period_;    // Glicko-2 matches of the open period
+    uint64_t matchesRated_ = 0;
+
+    // Scratch of ratePeriod(), kept so a period does not allocate
+    std::vector<uint32_t> slots_;       // By player: place among the period's players, or NO_SLOT
+    std::vector<uint32_t> players_;     // The period's players, by slot
+    std::vector<double> mu_;            // By slot: scaled rating before the period
+    std::vector<double> weight_;        // By slot: Glickman's g of the deviation before it
+    std::vector<PeriodSums> sums_;      // By slot
+};
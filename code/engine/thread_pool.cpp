@@ -0,0 +1,104 @@
+#include "engine/thread_pool.h"
+
+using namespace std;
+
+// Worker index of the current thread within its pool (-1 outside any pool)
+static thread_local const ThreadPool* currentPool = nullptr;
+static thread_local int currentWorker = -1;
+
+ThreadPool::ThreadPool(int threadCount) {
+    if (threadCount <= 0) threadCount = (int)thread::hardware_concurrency();
+    if (threadCount <= 0) threadCount = 1;
+
+    for (int i = 0; i < threadCount; i++) {
+        workers_.push_back(make_unique<Worker>());
+    }
+    for (int i = 0; i < threadCount; i++) {
+        threads_.emplace_back([this, i] { run(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> guard(sleepLock_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (thread& worker : threads_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(function<void()> task) {
+    int target = currentPool == this ? currentWorker :
+        (int)(nextWorker_.fetch_add(1, memory_order_relaxed) % workers_.size());
+    {
+        lock_guard<mutex> guard(workers_[target]->lock);
+        workers_[target]->tasks.push_back(move(task));
+    }
+    // Counting under the sleep lock means a worker can never miss the wakeup
+    {
+        lock_guard<mutex> guard(sleepLock_);
+        pending_++;
+    }
+    wake_.notify_one();
+}
+
+bool ThreadPool::popLocal(int self, function<void()>& task) {
+    Worker& worker = *workers_[self];
+    lock_guard<mutex> guard(worker.lock);
+    if (worker.tasks.empty()) return false;
+    task = move(worker.tasks.back());
+    worker.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(int self, function<void()>& task) {
+    int count = (int)workers_.size();
+    for (int offset = 1; offset < count; offset++) {
+        Worker& victim = *workers_[(self + offset) % count];
+        lock_guard<mutex> guard(victim.lock);
+        if (victim.tasks.empty()) continue;
+        task = move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::run(int self) {
+    currentPool = this;
+    currentWorker = self;
+
+    function<void()> task;
+    while (true) {
+        if (popLocal(self, task) || steal(self, task)) {
+            pending_--;
+            task();
+            task = nullptr;
+            continue;
+        }
+        unique_lock<mutex> guard(sleepLock_);
+        wake_.wait(guard, [this] { return stopping_ || pending_.load() > 0; });
+        if (stopping_ && pending_.load() == 0) return;
+    }
+}
+
+void TaskGroup::done() {
+    // Decrement under the lock so wait() cannot return, and the group be
+    // destroyed, while this call is still using it
+    lock_guard<mutex> guard(lock_);
+    if (--outstanding_ == 0) {
+        finished_.notify_all();
+    }
+}
+
+void TaskGroup::wait() {
+    unique_lock<mutex> guard(lock_);
+    finished_.wait(guard, [this] { return outstanding_.load() == 0; });
+}
+
+ThreadPool& sharedThreadPool() {
+    static ThreadPool pool(thread::hardware_concurrency() > 1 ? (int)thread::hardware_concurrency() - 1 : 1);
+    return pool;
+}
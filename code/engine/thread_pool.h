@@ -0,0 +1,68 @@
+#pragma once
+
+// Work-stealing thread pool for the search and analysis code.
+//
+// Every worker owns a deque: it pushes and pops its own tasks at the back
+// and, when that runs dry, steals from the front of the other workers'
+// deques. Tasks submitted from outside the pool are spread round-robin.
+// Idle workers sleep on a condition variable, so an idle pool costs nothing.
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    // threadCount 0 means one worker per hardware thread
+    explicit ThreadPool(int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int threadCount() const { return (int)threads_.size(); }
+
+    // Function to queue a task; from inside a worker it goes to that worker's deque
+    void submit(std::function<void()> task);
+
+private:
+    struct Worker {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void run(int self);
+    bool popLocal(int self, std::function<void()>& task);
+    bool steal(int self, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::mutex sleepLock_;
+    std::condition_variable wake_;
+    std::atomic<int> pending_{ 0 };
+    std::atomic<unsigned> nextWorker_{ 0 };
+    bool stopping_ = false;
+};
+
+// Counts the outstanding tasks of one batch so the submitter can wait for them
+class TaskGroup {
+public:
+    void add(int count = 1) { outstanding_ += count; }
+    void done();
+    void wait();
+    bool idle() const { return outstanding_.load() == 0; }
+
+private:
+    std::atomic<int> outstanding_{ 0 };
+    std::mutex lock_;
+    std::condition_variable finished_;
+};
+
+// Function to get the process-wide pool. It leaves one hardware thread free
+// for the render loop.
+ThreadPool& sharedThreadPool();
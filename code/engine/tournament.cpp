@@ -0,0 +1,424 @@
+#include "engine/tournament.h"
+#include "engine/batch_scoring.h"
+#include "engine/candidate_set.h"
+#include "engine/game_engine.h"
+#include "engine/game_record.h"
+#include "engine/hint_engine.h"
+#include "engine/opening_book.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <utility>
+
+using namespace std;
+
+// In a plan: the turn is left to run out instead of guessed
+static const CodeIndex TIMED_OUT = 0xFFFF;
+// Subtrees with more candidates than this are searched as tasks of their own
+static const int TREE_TASK_CANDIDATES = 64;
+static const int SECRETS_PER_TASK = 64;
+static const int MATCHES_PER_TASK = 256;
+
+// Every move of one strategy against every secret
+struct Plan {
+    int turnLimit = 0;
+    vector<CodeIndex> moves;        // CODE_COUNT rows of turnLimit moves
+    vector<uint8_t> length;         // Turns used per secret
+
+    void resize(int turns) {
+        turnLimit = turns;
+        moves.assign((size_t)CODE_COUNT * turns, TIMED_OUT);
+        length.assign(CODE_COUNT, 0);
+    }
+    CodeIndex* row(CodeIndex secret) { return moves.data() + (size_t)secret * turnLimit; }
+    const CodeIndex* row(CodeIndex secret) const { return moves.data() + (size_t)secret * turnLimit; }
+    bool solved(CodeIndex secret) const { return length[secret] > 0 && row(secret)[length[secret] - 1] == secret; }
+};
+
+// Small xorshift generator so tournaments are reproducible across platforms
+static unsigned nextRandom(unsigned& seed) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+static double randomShare(unsigned& seed) {
+    return (nextRandom(seed) >> 8) / 16777216.0;
+}
+
+// Function to derive the seed of one strategy against one secret
+static unsigned planSeed(unsigned seed, int strategy, CodeIndex secret) {
+    unsigned mixed = (seed * 2654435761u) ^ ((unsigned)strategy * 40503u + secret + 1) * 2246822519u;
+    return mixed ? mixed : 1;
+}
+
+bool parseStrategy(const string& text, Strategy& strategy) {
+    strategy = Strategy();
+    strategy.name = text;
+    if (text == "random") strategy.kind = StrategyKind::RandomConsistent;
+    else if (text == "minimax") strategy.kind = StrategyKind::Minimax;
+    else if (text == "entropy") strategy.kind = StrategyKind::Entropy;
+    else if (text == "book") strategy.kind = StrategyKind::Book;
+    else if (text.compare(0, 5, "human") == 0) {
+        strategy.kind = StrategyKind::HumanLike;
+        strategy.mistakeRate = DEFAULT_HUMAN_MISTAKE_RATE;
+        strategy.timeoutRate = DEFAULT_HUMAN_TIMEOUT_RATE;
+        if (text.size() == 5) return true;
+        if (text[5] != ':') return false;
+
+        const char* rest = text.c_str() + 6;
+        char* end = nullptr;
+        strategy.mistakeRate = strtod(rest, &end);
+        if (end == rest) return false;
+        if (*end == ':') {
+            rest = end + 1;
+            strategy.timeoutRate = strtod(rest, &end);
+            if (end == rest) return false;
+        }
+        return *end == '\0' && strategy.mistakeRate >= 0 && strategy.mistakeRate <= 1 &&
+            strategy.timeoutRate >= 0 && strategy.timeoutRate < 1;
+    }
+    else return false;
+    return true;
+}
+
+HumanProfile measureHumanPlay(const unsigned char* data, size_t size) {
+    HumanProfile profile;
+    GameRecordReader reader(data, size);
+    if (!reader.valid()) return profile;
+
+    MatchInfo info;
+    GameEvent event;
+    CandidateSet candidates[2];
+    while (reader.nextMatch(info)) {
+        GameState state;
+        candidates[0].reset();
+        candidates[1].reset();
+        while (reader.nextEvent(event)) {
+            StepResult result;
+            GameState next = step(state, event, &result);
+            int guesser = state.player1Turn ? 0 : 1;
+            bool human = state.player1Turn || !info.vsComputer;
+            if (result.outcome == StepOutcome::TurnLimitSet && state.variant.isClassic()) {
+                profile.matches++;
+            }
+            if (state.phase == GamePhase::Guessing && state.variant.isClassic() && human) {
+                if (result.outcome == StepOutcome::Scored || result.outcome == StepOutcome::Won) {
+                    profile.turns++;
+                    if (!candidates[guesser].contains(codeIndex(event.code))) profile.mistakes++;
+                }
+                else if (result.outcome == StepOutcome::TimedOut) {
+                    profile.turns++;
+                    profile.timeouts++;
+                }
+            }
+            if (result.outcome == StepOutcome::Scored && state.variant.isClassic()) {
+                candidates[guesser].applyGuess(event.code,
+                    makeFeedback(result.correctDigits, result.correctPositions));
+            }
+            state = next;
+        }
+    }
+    return profile;
+}
+
+// What a deterministic tree search shares between its tasks
+struct TreeBuild {
+    HintMode mode = HintMode::Minimax;
+    Plan* plan = nullptr;
+    ThreadPool* pool = nullptr;
+    TaskGroup* tasks = nullptr;
+};
+
+// Function to pick the guess the hint search would pick for these candidates
+static CodeIndex bestTreeGuess(HintMode mode, const vector<CodeIndex>& candidates, const CandidateBuffer& buffer) {
+    // Guessing a candidate is already optimal: it wins or leaves one code
+    if (candidates.size() <= 2) return candidates[0];
+
+    vector<bool> consistent(CODE_COUNT, false);
+    for (CodeIndex index : candidates) consistent[index] = true;
+    uint64_t best = UINT64_MAX;
+    uint32_t histogram[FEEDBACK_COUNT];
+    for (int guess = 0; guess < CODE_COUNT; guess++) {
+        scoreCandidates(codeAt((CodeIndex)guess), buffer, nullptr, histogram);
+        // A guess that cannot split the candidates would never end
+        bool splits = true;
+        for (int f = 0; f < FEEDBACK_SOLVED; f++) {
+            if (histogram[f] == candidates.size()) splits = false;
+        }
+        if (!splits) continue;
+        uint64_t key = rankGuess(mode, histogram, consistent[guess], (CodeIndex)guess);
+        if (key < best) best = key;
+    }
+    return (CodeIndex)(best & 0xFFFF);
+}
+
+// Function to fill in the plan for every candidate: the guess at this depth,
+// then each feedback group's subtree (large ones as tasks of their own)
+static void buildPlanTree(const TreeBuild& build, const vector<CodeIndex>& candidates, int depth, int knownGuess) {
+    Plan& plan = *build.plan;
+    if (depth >= plan.turnLimit) {
+        for (CodeIndex secret : candidates) plan.length[secret] = (uint8_t)plan.turnLimit;
+        return;
+    }
+
+    CandidateBuffer buffer;
+    for (CodeIndex index : candidates) buffer.push(index);
+    CodeIndex guess = knownGuess >= 0 ? (CodeIndex)knownGuess : bestTreeGuess(build.mode, candidates, buffer);
+
+    vector<Feedback> feedback(candidates.size());
+    uint32_t histogram[FEEDBACK_COUNT];
+    scoreCandidates(codeAt(guess), buffer, feedback.data(), histogram);
+    for (size_t i = 0; i < candidates.size(); i++) {
+        plan.row(candidates[i])[depth] = guess;
+        if (feedback[i] == FEEDBACK_SOLVED) plan.length[candidates[i]] = (uint8_t)(depth + 1);
+    }
+
+    for (int f = 0; f < FEEDBACK_SOLVED; f++) {
+        if (histogram[f] == 0) continue;
+        vector<CodeIndex> group;
+        group.reserve(histogram[f]);
+        for (size_t i = 0; i < candidates.size(); i++) {
+            if (feedback[i] == f) group.push_back(candidates[i]);
+        }
+        if ((int)group.size() <= TREE_TASK_CANDIDATES) {
+            buildPlanTree(build, group, depth + 1, -1);
+            continue;
+        }
+        build.tasks->add();
+        const TreeBuild* shared = &build;
+        build.pool->submit([shared, group = move(group), depth] {
+            buildPlanTree(*shared, group, depth + 1, -1);
+            shared->tasks->done();
+        });
+    }
+}
+
+// Function to fill in the plan for one secret by playing it out
+static void playPlan(const Strategy& strategy, StrategyKind kind, Plan& plan, CodeIndex secret, unsigned seed,
+    CandidateSet& candidates) {
+    CodeIndex* moves = plan.row(secret);
+    const OpeningBook& book = sharedOpeningBook();
+    bool human = kind == StrategyKind::HumanLike;
+    candidates.reset();
+    for (int turn = 0; turn < plan.turnLimit; turn++) {
+        if (human && randomShare(seed) < strategy.timeoutRate) {
+            moves[turn] = TIMED_OUT;
+            continue;
+        }
+
+        CodeIndex guess;
+        int slip = -1;
+        if (human && candidates.count() < CODE_COUNT && randomShare(seed) < strategy.mistakeRate) {
+            // A slip: some code the feedback so far already rules out
+            for (int tries = 0; tries < 16 && slip < 0; tries++) {
+                int index = (int)(nextRandom(seed) % CODE_COUNT);
+                if (!candidates.contains((CodeIndex)index)) slip = index;
+            }
+        }
+        if (slip >= 0) {
+            guess = (CodeIndex)slip;
+        }
+        else if (kind == StrategyKind::Book) {
+            // The book covers every secret, so leaving it means it is stale
+            if (!book.guessAt(candidates.bookNode(), guess)) guess = (CodeIndex)candidates.first();
+        }
+        else {
+            guess = (CodeIndex)candidates.nth((int)(nextRandom(seed) % (unsigned)candidates.count()));
+        }
+
+        moves[turn] = guess;
+        Feedback feedback = scoreCodes(codeAt(guess), codeAt(secret));
+        if (feedback == FEEDBACK_SOLVED) {
+            plan.length[secret] = (uint8_t)(turn + 1);
+            return;
+        }
+        candidates.applyGuess(codeAt(guess), feedback);
+    }
+    plan.length[secret] = (uint8_t)plan.turnLimit;
+}
+
+// Function to play matches [begin, end) of a pairing through the rules engine
+static void playMatches(const Plan& first, const Plan& second, const vector<CodeIndex>& secrets,
+    int begin, int end, PairingStats& stats) {
+    int count = (int)secrets.size();
+    GameEvent event;
+    StepResult result;
+    for (int i = begin; i < end; i++) {
+        // Each player faces every secret once over the pairing, and the two
+        // secrets of a match differ, so a mirror pair is not one game twice
+        CodeIndex player1Secret = secrets[(i + count / 2) % count];   // Player 1's, for player 2 to find
+        CodeIndex player2Secret = secrets[i];
+
+        GameState state;
+        event.type = GameEventType::SetTurnLimit;
+        event.time = 0;
+        event.turnLimit = first.turnLimit;
+        state = step(state, event);
+        event.type = GameEventType::SetNumber;
+        event.code = codeAt(player1Secret);
+        state = step(state, event);
+        event.code = codeAt(player2Secret);
+        state = step(state, event);
+
+        while (state.phase == GamePhase::Guessing) {
+            const Plan& plan = state.player1Turn ? first : second;
+            CodeIndex secret = state.player1Turn ? player2Secret : player1Secret;
+            int turn = state.player1Turn ? state.player1Turns : state.player2Turns;
+            if (turn >= plan.turnLimit) break;
+            CodeIndex move = plan.row(secret)[turn];
+            if (move == TIMED_OUT) {
+                event.type = GameEventType::Tick;
+                event.time = state.startTime + state.timeLimitPerTurn;
+            }
+            else {
+                event.type = GameEventType::Guess;
+                event.time = state.startTime + 1;
+                event.code = codeAt(move);
+            }
+            state = step(state, event, &result);
+            if (result.outcome == StepOutcome::Ignored || result.outcome == StepOutcome::Rejected) break;
+        }
+
+        stats.matches++;
+        stats.turns += state.player1Turns + state.player2Turns;
+        if (state.result == GameResult::Player1Wins) {
+            stats.player1Wins++;
+            stats.turns++;
+            stats.wonOnTurn[state.player1Turns + 1]++;
+        }
+        else if (state.result == GameResult::Player2Wins) {
+            stats.player2Wins++;
+            stats.turns++;
+            stats.wonOnTurn[state.player2Turns + 1]++;
+        }
+        else {
+            stats.draws++;
+        }
+    }
+}
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+TournamentResult runTournament(const vector<Strategy>& strategies, const TournamentOptions& options,
+    ThreadPool& pool) {
+    TournamentResult result;
+    int turnLimit = options.turnLimit < 1 ? 1 :
+        options.turnLimit > MAX_TOURNAMENT_TURNS ? MAX_TOURNAMENT_TURNS : options.turnLimit;
+    int strategyCount = (int)strategies.size();
+
+    // A sample is the front of a seeded shuffle of the code space
+    vector<CodeIndex> secrets(CODE_COUNT);
+    for (int i = 0; i < CODE_COUNT; i++) secrets[i] = (CodeIndex)i;
+    if (options.secrets > 0 && options.secrets < CODE_COUNT) {
+        unsigned seed = options.seed ? options.seed : 1;
+        for (int i = 0; i < options.secrets; i++) {
+            int j = i + (int)(nextRandom(seed) % (unsigned)(CODE_COUNT - i));
+            swap(secrets[i], secrets[j]);
+        }
+        secrets.resize(options.secrets);
+    }
+    result.secretCount = (int)secrets.size();
+
+    // Pass 1: every strategy against every secret
+    auto start = chrono::steady_clock::now();
+    vector<Plan> plans(strategyCount);
+    vector<TreeBuild> builds(strategyCount);
+    vector<CodeIndex> everyCode(CODE_COUNT);
+    for (int i = 0; i < CODE_COUNT; i++) everyCode[i] = (CodeIndex)i;
+    TaskGroup tasks;
+    for (int s = 0; s < strategyCount; s++) {
+        plans[s].resize(turnLimit);
+        StrategyKind kind = strategies[s].kind;
+        if (kind == StrategyKind::Book && !sharedOpeningBook().isMapped()) kind = StrategyKind::Entropy;
+
+        if (kind == StrategyKind::Minimax || kind == StrategyKind::Entropy) {
+            // The tree covers the whole code space, as the search would. The
+            // first guess needs no search: every code splits the full space
+            // the same way, so the ranking's tie-break picks code 0.
+            builds[s].mode = kind == StrategyKind::Minimax ? HintMode::Minimax : HintMode::Entropy;
+            builds[s].plan = &plans[s];
+            builds[s].pool = &pool;
+            builds[s].tasks = &tasks;
+            const TreeBuild* build = &builds[s];
+            tasks.add();
+            pool.submit([build, &everyCode] {
+                buildPlanTree(*build, everyCode, 0, 0);
+                build->tasks->done();
+            });
+            continue;
+        }
+
+        for (int begin = 0; begin < (int)secrets.size(); begin += SECRETS_PER_TASK) {
+            int end = min(begin + SECRETS_PER_TASK, (int)secrets.size());
+            tasks.add();
+            pool.submit([&, s, kind, begin, end] {
+                CandidateSet candidates;
+                candidates.reserveGuesses(turnLimit);
+                for (int i = begin; i < end; i++) {
+                    playPlan(strategies[s], kind, plans[s], secrets[i], planSeed(options.seed, s, secrets[i]),
+                        candidates);
+                }
+                tasks.done();
+            });
+        }
+    }
+    tasks.wait();
+    result.planSeconds = secondsSince(start);
+
+    for (int s = 0; s < strategyCount; s++) {
+        StrategyStats stats;
+        long long solvedTurns = 0;
+        int solved = 0;
+        for (CodeIndex secret : secrets) {
+            if (!plans[s].solved(secret)) {
+                stats.solvedIn[0]++;
+                continue;
+            }
+            int turns = plans[s].length[secret];
+            stats.solvedIn[turns]++;
+            solvedTurns += turns;
+            solved++;
+            if (turns > stats.worstTurns) stats.worstTurns = turns;
+        }
+        stats.meanTurns = solved ? (double)solvedTurns / solved : 0;
+        result.strategies.push_back(stats);
+    }
+
+    // Pass 2: every ordered pairing, one match per secret
+    start = chrono::steady_clock::now();
+    result.pairings.resize((size_t)strategyCount * strategyCount);
+    mutex merge;
+    for (int first = 0; first < strategyCount; first++) {
+        for (int second = 0; second < strategyCount; second++) {
+            PairingStats& pairing = result.pairings[(size_t)first * strategyCount + second];
+            pairing.player1 = first;
+            pairing.player2 = second;
+            for (int begin = 0; begin < (int)secrets.size(); begin += MATCHES_PER_TASK) {
+                int end = min(begin + MATCHES_PER_TASK, (int)secrets.size());
+                tasks.add();
+                pool.submit([&, first, second, begin, end] {
+                    PairingStats local;
+                    playMatches(plans[first], plans[second], secrets, begin, end, local);
+                    {
+                        lock_guard<mutex> guard(merge);
+                        pairing.matches += local.matches;
+                        pairing.player1Wins += local.player1Wins;
+                        pairing.player2Wins += local.player2Wins;
+                        pairing.draws += local.draws;
+                        pairing.turns += local.turns;
+                        for (int t = 0; t <= MAX_TOURNAMENT_TURNS; t++) pairing.wonOnTurn[t] += local.wonOnTurn[t];
+                    }
+                    tasks.done();
+                });
+            }
+        }
+    }
+    tasks.wait();
+    result.matchSeconds = secondsSince(start);
+    return result;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+// Round-robin tournaments between guessing strategies, for tuning turn
+// limits and difficulty.
+//
+// A guesser's moves depend only on the feedback it gets, never on what its
+// opponent does, so a tournament runs in two passes. First each strategy
+// plays every secret on its own, up to the turn limit, and its moves are
+// kept as a plan (a few bytes per secret). Then every ordered pair of
+// strategies, mirror pairs included, plays one match per secret through
+// step(), replaying the two plans as events: turn order, timeouts and the
+// draw once both players are out of turns are the game's own rules. Both
+// passes are cut into tasks on the work-stealing ThreadPool.
+//
+// Minimax and entropy are deterministic, so their plans for every secret
+// come out of one decision tree built top-down: the search HintSearch does
+// for a single move, done once per node, with every large subtree a task of
+// its own. Random strategies draw their moves from a seed per strategy and
+// secret, so every pairing sees the same moves from them and the pairings
+// compare like with like.
+
+#include "engine/code_space.h"
+#include "engine/thread_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class StrategyKind {
+    RandomConsistent,   // A random code that could still be the secret
+    Minimax,            // Smallest worst case over every code (the Normal computer, unhurried)
+    Entropy,            // Most expected information over every code
+    Book,               // The opening book (the Hard computer); entropy when it is missing
+    HumanLike           // Random consistent, but with slips and timeouts as logged players make them
+};
+
+struct Strategy {
+    StrategyKind kind = StrategyKind::RandomConsistent;
+    double mistakeRate = 0;     // HumanLike: share of guesses that ignore the feedback so far
+    double timeoutRate = 0;     // HumanLike: share of turns left to run out
+    std::string name;
+};
+
+// Rates of a "human" strategy given without any
+const double DEFAULT_HUMAN_MISTAKE_RATE = 0.15;
+const double DEFAULT_HUMAN_TIMEOUT_RATE = 0.03;
+
+// Function to parse "random", "minimax", "entropy", "book" or
+// "human[:MISTAKES[:TIMEOUTS]]" (rates as fractions, e.g. human:0.2:0.05)
+bool parseStrategy(const std::string& text, Strategy& strategy);
+
+// How players in a game record actually guess
+struct HumanProfile {
+    int matches = 0;
+    int turns = 0;              // Guesses and timeouts by human players
+    int mistakes = 0;           // Guesses that could not have been the secret
+    int timeouts = 0;
+    double mistakeRate() const { return turns > timeouts ? (double)mistakes / (turns - timeouts) : 0; }
+    double timeoutRate() const { return turns ? (double)timeouts / turns : 0; }
+};
+
+// Function to measure the players of a game record (engine/game_record.h),
+// replaying each classic match; the computer's moves are left out
+HumanProfile measureHumanPlay(const unsigned char* data, size_t size);
+
+const int MAX_TOURNAMENT_TURNS = 99;
+
+struct TournamentOptions {
+    int turnLimit = 10;         // Turns per player, 1..MAX_TOURNAMENT_TURNS
+    int secrets = 0;            // Secrets sampled per pairing; 0 for all CODE_COUNT
+    unsigned seed = 1;
+};
+
+// One strategy alone against the sampled secrets
+struct StrategyStats {
+    int solvedIn[MAX_TOURNAMENT_TURNS + 1] = {};   // [n]: solved with the nth turn; [0]: not within the limit
+    double meanTurns = 0;       // Over the solved secrets
+    int worstTurns = 0;
+};
+
+// Matches with one strategy as player 1 and another as player 2
+struct PairingStats {
+    int player1 = 0;            // Index into the strategy list
+    int player2 = 0;
+    int matches = 0;
+    int player1Wins = 0;
+    int player2Wins = 0;
+    int draws = 0;
+    long long turns = 0;        // Turns played by both players, summed over the matches
+    int wonOnTurn[MAX_TOURNAMENT_TURNS + 1] = {};   // Matches the winner finished on its nth turn
+};
+
+struct TournamentResult {
+    int secretCount = 0;
+    std::vector<StrategyStats> strategies;
+    std::vector<PairingStats> pairings;     // Player 1 major, player 2 minor
+    double planSeconds = 0;
+    double matchSeconds = 0;
+};
+
+// Function to play a round robin between the strategies
+TournamentResult runTournament(const std::vector<Strategy>& strategies, const TournamentOptions& options,
+    ThreadPool& pool = sharedThreadPool());
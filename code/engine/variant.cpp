@@ -0,0 +1,125 @@
+#include "engine/variant.h"
+#include "engine/game_engine.h"
+
+#include <cstdio>
+
+using namespace std;
+
+VariantStatus checkVariant(const GameVariant& variant) {
+    if (variant.length < MIN_VARIANT_LENGTH || variant.length > MAX_VARIANT_LENGTH) {
+        return VariantStatus::BadLength;
+    }
+    if (variant.base < MIN_VARIANT_BASE || variant.base > MAX_VARIANT_BASE) {
+        return VariantStatus::BadBase;
+    }
+    if (!variant.repeats && variant.length > variant.base) {
+        return VariantStatus::TooFewDigits;
+    }
+    return VariantStatus::Valid;
+}
+
+const char* variantStatusMessage(VariantStatus status) {
+    static const string badLength = "Error: Code length must be between " + to_string(MIN_VARIANT_LENGTH) +
+        " and " + to_string(MAX_VARIANT_LENGTH) + ".";
+    static const string badBase = "Error: Number of digits must be between " + to_string(MIN_VARIANT_BASE) +
+        " and " + to_string(MAX_VARIANT_BASE) + ".";
+    switch (status) {
+    case VariantStatus::BadLength:
+        return badLength.c_str();
+    case VariantStatus::BadBase:
+        return badBase.c_str();
+    case VariantStatus::TooFewDigits:
+        return "Error: Not enough digits for a code without repeats.";
+    default:
+        return "Valid";
+    }
+}
+
+string isValidVariant(const GameVariant& variant) {
+    return variantStatusMessage(checkVariant(variant));
+}
+
+uint64_t variantCodeCount(const GameVariant& variant) {
+    uint64_t count = 1;
+    for (int i = 0; i < variant.length; i++) {
+        count *= variant.repeats ? variant.base : variant.base - i;
+    }
+    return count;
+}
+
+string describeVariant(const GameVariant& variant) {
+    char text[64];
+    return describeVariant(variant, text, sizeof(text));
+}
+
+const char* describeVariant(const GameVariant& variant, char* buffer, size_t size) {
+    snprintf(buffer, size, "%d digits, 0-%c%s", variant.length, digitChar(variant.base - 1),
+        variant.repeats ? ", repeats allowed" : ", no repeats");
+    return buffer;
+}
+
+NumberStatus checkVariantNumber(const string& number, const GameVariant& variant) {
+    return checkVariantNumber(number.data(), number.size(), variant);
+}
+
+NumberStatus checkVariantNumber(const char* number, size_t length, const GameVariant& variant) {
+    if (variant.isClassic()) return checkNumber(number, length);
+
+    if (length != (size_t)variant.length) {
+        return NumberStatus::WrongLength;
+    }
+    uint32_t seen = 0;
+    for (size_t i = 0; i < length; i++) {
+        int digit = digitValue(number[i]);
+        if (digit < 0 || digit >= variant.base) {
+            return NumberStatus::BadDigit;
+        }
+        if (!variant.repeats && (seen >> digit) & 1) {
+            return NumberStatus::RepeatedDigit;
+        }
+        seen |= 1u << digit;
+    }
+    return NumberStatus::Valid;
+}
+
+const char* numberStatusMessage(NumberStatus status, const GameVariant& variant, char* buffer, size_t size) {
+    switch (status) {
+    case NumberStatus::WrongLength:
+        snprintf(buffer, size, "Error: Number must be exactly %d digits long.", variant.length);
+        break;
+    case NumberStatus::BadDigit:
+        if (variant.isClassic()) {
+            snprintf(buffer, size, "Error: Only numeric digits (0-9) are allowed.");
+        }
+        else {
+            snprintf(buffer, size, "Error: Only the digits 0-%c are allowed.", digitChar(variant.base - 1));
+        }
+        break;
+    case NumberStatus::RepeatedDigit:
+        snprintf(buffer, size, "Error: Digits must not repeat.");
+        break;
+    default:
+        snprintf(buffer, size, "Valid");
+        break;
+    }
+    return buffer;
+}
+
+string isValidVariantNumber(const string& number, const GameVariant& variant) {
+    char message[64];
+    return numberStatusMessage(checkVariantNumber(number, variant), variant, message, sizeof(message));
+}
+
+bool isValidVariantCode(VariantCode code, const GameVariant& variant) {
+    if (checkVariant(variant) != VariantStatus::Valid) return false;
+    if (variant.length < 8 && (code >> (4 * variant.length)) != 0) return false;
+
+    uint32_t seen = 0;
+    for (int i = 0; i < variant.length; i++) {
+        int digit = (code >> (4 * i)) & 0xF;
+        if (digit >= variant.base) return false;
+        if (!variant.repeats && (seen >> digit) & 1) return false;
+        seen |= 1u << digit;
+    }
+    return true;
+}
@@ -0,0 +1,240 @@
+#pragma once
+
+// Game variants: code length, alphabet size and whether digits may repeat.
+//
+// The classic game (4 distinct decimal digits) keeps its own packed format,
+// tables and book. Every other variant packs a code as one nibble per
+// position in a 32-bit word (up to 8 positions, digits 0..15 shown as 0-9
+// and A-F) plus, for scoring, a 64-bit word holding how often each digit
+// occurs (one nibble per digit).
+//
+// Scoring is written once against a "rules" type. CodeRules<Length, Base,
+// Repeats> makes every parameter a compile-time constant, so the kernels for
+// the common variants are fully unrolled and the repeat handling that does
+// not apply is compiled out; DynamicRules carries the same parameters at
+// runtime for everything else.
+
+#include "engine/packed_code.h"
+
+#include <string>
+
+const int MIN_VARIANT_LENGTH = 3;
+const int MAX_VARIANT_LENGTH = 8;
+const int MIN_VARIANT_BASE = 6;
+const int MAX_VARIANT_BASE = 16;
+
+struct GameVariant {
+    int length = CODE_LENGTH;
+    int base = 10;
+    bool repeats = false;
+
+    bool isClassic() const { return length == CODE_LENGTH && base == 10 && !repeats; }
+
+    bool operator==(const GameVariant& other) const {
+        return length == other.length && base == other.base && repeats == other.repeats;
+    }
+    bool operator!=(const GameVariant& other) const { return !(*this == other); }
+};
+
+// Outcome of checking a variant's parameters
+enum class VariantStatus {
+    Valid,
+    BadLength,      // Code length out of range
+    BadBase,        // Number of digits out of range
+    TooFewDigits    // Longer than the number of digits, without repeats
+};
+
+VariantStatus checkVariant(const GameVariant& variant);
+
+// Function to get the message for a status ("Valid" when valid); the text is
+// built once and never freed
+const char* variantStatusMessage(VariantStatus status);
+
+// Function to check a variant's parameters; returns "Valid" or an error
+std::string isValidVariant(const GameVariant& variant);
+
+// Function to get the number of possible secrets (up to 16^8)
+uint64_t variantCodeCount(const GameVariant& variant);
+
+// Function to describe a variant for the UI ("5 digits, 0-9, no repeats")
+std::string describeVariant(const GameVariant& variant);
+
+// The same into a buffer; returns the buffer
+const char* describeVariant(const GameVariant& variant, char* buffer, size_t size);
+
+// One nibble per position, position 0 in the lowest nibble
+typedef uint32_t VariantCode;
+
+// Function to count set bits in a 64-bit word
+inline int popCount64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return (int)__popcnt64(x);
+#else
+    return popCount((uint32_t)x) + popCount((uint32_t)(x >> 32));
+#endif
+}
+
+inline char digitChar(int digit) {
+    return (char)(digit < 10 ? '0' + digit : 'A' + digit - 10);
+}
+
+// Function to read a typed digit (either case for A-F); -1 if it is not one
+inline int digitValue(char ch) {
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    return -1;
+}
+
+// Outcome of checking a typed number
+enum class NumberStatus {
+    Valid,
+    WrongLength,
+    BadDigit,       // Not a digit of the variant
+    RepeatedDigit
+};
+
+// Function to check a typed number for a variant without allocating
+NumberStatus checkVariantNumber(const std::string& number, const GameVariant& variant);
+NumberStatus checkVariantNumber(const char* number, size_t length, const GameVariant& variant);
+
+// Function to write the message for a status into a buffer and return it.
+// The classic variant gives exactly the isValidNumber() messages.
+const char* numberStatusMessage(NumberStatus status, const GameVariant& variant, char* buffer, size_t size);
+
+// Function to validate a typed number for a variant. The classic variant
+// gives exactly the isValidNumber() messages.
+std::string isValidVariantNumber(const std::string& number, const GameVariant& variant);
+
+// Function to pack a number that already passed validation
+inline VariantCode packVariantCode(const char* number, size_t length) {
+    VariantCode code = 0;
+    for (size_t i = 0; i < length; i++) {
+        code |= (VariantCode)digitValue(number[i]) << (4 * i);
+    }
+    return code;
+}
+
+inline VariantCode packVariantCode(const std::string& number) {
+    return packVariantCode(number.data(), number.size());
+}
+
+// Function to write a code back out as text; out needs length + 1 chars
+inline void unpackVariantCode(VariantCode code, int length, char* out) {
+    for (int i = 0; i < length; i++) {
+        out[i] = digitChar((code >> (4 * i)) & 0xF);
+    }
+    out[length] = '\0';
+}
+
+inline std::string variantCodeToString(VariantCode code, int length) {
+    char text[MAX_VARIANT_LENGTH + 1];
+    unpackVariantCode(code, length, text);
+    return std::string(text);
+}
+
+// Function to check that a word is a code of the variant (no stray bits,
+// digits below the base, no repeats unless allowed)
+bool isValidVariantCode(VariantCode code, const GameVariant& variant);
+
+// Function to count how often each digit occurs, one nibble per digit
+inline uint64_t digitCounts(VariantCode code, int length) {
+    uint64_t counts = 0;
+    for (int i = 0; i < length; i++) {
+        counts += 1ull << (4 * ((code >> (4 * i)) & 0xF));
+    }
+    return counts;
+}
+
+// Function to sum min(a, b) over the 16 nibbles of two digit-count words.
+// Counts never exceed 8, so even and odd nibbles are spread into bytes, where
+// (a | 0x80) - b cannot borrow across lanes and bit 7 says whether a >= b.
+inline int sharedDigitCount(uint64_t a, uint64_t b) {
+    const uint64_t LOW = 0x0F0F0F0F0F0F0F0Full;
+    const uint64_t HIGH = 0x8080808080808080ull;
+    uint64_t lanes[2] = { 0, 0 };
+    for (int half = 0; half < 2; half++) {
+        uint64_t x = (a >> (4 * half)) & LOW;
+        uint64_t y = (b >> (4 * half)) & LOW;
+        uint64_t xAtLeastY = ((((x | HIGH) - y) & HIGH) >> 7) * 0xFF;
+        lanes[half] = (y & xAtLeastY) | (x & ~xAtLeastY);
+    }
+    return (int)(((lanes[0] + lanes[1]) * 0x0101010101010101ull) >> 56);
+}
+
+// Variant feedback: (digits, positions) pairs numbered densely as
+// digits*(digits+1)/2 + positions; unlike the classic Feedback nothing is
+// remapped, so a length-8 game has 45 values
+inline int variantFeedbackCount(int length) {
+    return (length + 1) * (length + 2) / 2;
+}
+
+inline Feedback makeVariantFeedback(int correctDigits, int correctPositions) {
+    return (Feedback)(((correctDigits * (correctDigits + 1)) >> 1) + correctPositions);
+}
+
+// Compile-time rules for one variant
+template <int Length, int Base, bool Repeats>
+struct CodeRules {
+    static_assert(Length >= MIN_VARIANT_LENGTH && Length <= MAX_VARIANT_LENGTH, "unsupported code length");
+    static_assert(Base >= MIN_VARIANT_BASE && Base <= MAX_VARIANT_BASE, "unsupported base");
+    static_assert(Repeats || Length <= Base, "not enough digits for distinct positions");
+
+    // Same constructor as DynamicRules so kernels can build either kind
+    constexpr explicit CodeRules(const GameVariant&) {}
+
+    static constexpr int length() { return Length; }
+    static constexpr int base() { return Base; }
+    static constexpr bool repeats() { return Repeats; }
+    static constexpr uint32_t positionMask() {
+        return Length == 8 ? 0xFFFFFFFFu : (1u << (4 * Length)) - 1;
+    }
+};
+
+// The same rules chosen at runtime
+struct DynamicRules {
+    explicit DynamicRules(const GameVariant& variant) :
+        length_(variant.length), base_(variant.base), repeats_(variant.repeats) {
+    }
+
+    int length() const { return length_; }
+    int base() const { return base_; }
+    bool repeats() const { return repeats_; }
+    uint32_t positionMask() const {
+        return length_ == 8 ? 0xFFFFFFFFu : (1u << (4 * length_)) - 1;
+    }
+
+private:
+    int length_;
+    int base_;
+    bool repeats_;
+};
+
+// Function to count positions holding the same digit (same trick as
+// packedCorrectPositions, over up to 8 nibbles)
+template <class Rules>
+inline int rulesCorrectPositions(const Rules& rules, VariantCode guess, VariantCode target) {
+    uint32_t diff = guess ^ target;
+    diff |= diff >> 1;
+    diff |= diff >> 2;
+    return rules.length() - popCount(diff & 0x11111111u & rules.positionMask());
+}
+
+// Function to count correct digits from digit-count words. Without repeats
+// every count is 0 or 1, so the counts AND together like presence masks;
+// with repeats each digit scores as often as it occurs in both codes.
+template <class Rules>
+inline int rulesCorrectDigits(const Rules& rules, uint64_t guessCounts, uint64_t targetCounts) {
+    if (!rules.repeats()) return popCount64(guessCounts & targetCounts);
+    return sharedDigitCount(guessCounts, targetCounts);
+}
+
+// Function to score any two codes of a variant
+inline Feedback scoreVariantCodes(const GameVariant& variant, VariantCode guess, VariantCode target) {
+    DynamicRules rules(variant);
+    return makeVariantFeedback(
+        rulesCorrectDigits(rules, digitCounts(guess, variant.length), digitCounts(target, variant.length)),
+        rulesCorrectPositions(rules, guess, target));
+}
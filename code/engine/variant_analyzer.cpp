@@ -0,0 +1,871 @@
+#include "engine/variant_analyzer.h"
+#include "engine/mapped_file.h"
+#include "engine/opening_book.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// Secrets still possible: indices into the variant's code list, ascending
+typedef vector<uint16_t> SecretSet;
+
+static const int MAX_TABLE_CODES = 8192;            // All-pairs feedback table up to this many codes (64 MB)
+static const int MEMO_MAX_SECRETS = 1024;           // Larger sets are searched but not memoized
+static const size_t MAX_MEMO_ENTRIES = 1 << 21;
+static const int MEMO_SHARDS = 64;
+static const int CANONICAL_PERMUTATIONS = 120;      // Most relabellings tried for one canonical form
+static const int GUESS_POSITION_PERMUTATIONS = 24;  // Most reorderings tried to match up guesses
+static const int PARALLEL_MIN_SECRETS = 200;        // Smaller nodes are searched on one thread
+static const int UNBOUNDED = INT_MAX;
+
+struct VariantCheckpointHeader {
+    char magic[4];
+    uint32_t version;
+    uint8_t length;
+    uint8_t base;
+    uint8_t repeats;
+    uint8_t reserved;
+    uint32_t codeCount;
+    uint64_t entryCount;
+};
+
+// Function to get the most children a node can have: one per feedback but
+// "solved", and never "all digits, one out of place"; without repeats a
+// guess and the secret share at least 2 * length - base digits
+static int branchingBound(const GameVariant& variant) {
+    int length = variant.length;
+    int fewestDigits = variant.repeats ? 0 : max(0, 2 * length - variant.base);
+    int count = 0;
+    for (int digits = fewestDigits; digits <= length; digits++) {
+        count += digits + 1;
+    }
+    return count - 2;
+}
+
+// Function to count the secrets a tree of this depth can find at most
+static uint64_t maxSolvable(int branching, int depth) {
+    uint64_t total = 0;
+    uint64_t width = 1;
+    for (int level = 0; level < depth; level++) {
+        total += width;
+        if (total >= (uint64_t)1 << 40) return total;
+        width *= (uint64_t)branching;
+    }
+    return total;
+}
+
+int variantDepthLowerBound(const GameVariant& variant) {
+    if (checkVariant(variant) != VariantStatus::Valid) return 1;
+    int branching = branchingBound(variant);
+    uint64_t codes = variantCodeCount(variant);
+    int depth = 1;
+    while (maxSolvable(branching, depth) < codes) depth++;
+    return depth;
+}
+
+// Optimal worst cases computed by numbrainer_analyzer
+struct KnownWorstCase {
+    int length;
+    int base;
+    bool repeats;
+    int worstCase;
+};
+
+static const KnownWorstCase KNOWN_WORST_CASES[] = {
+    { 3, 6, false, 5 },
+    { 3, 6, true, 5 },
+    { 3, 7, false, 5 },
+    { 3, 7, true, 6 },
+    { 3, 8, false, 6 },
+    { 3, 8, true, 6 },
+    { 3, 9, false, 6 },
+    { 3, 10, false, 6 },
+    { 4, 6, false, 5 },
+    { 4, 6, true, 5 },
+    { 4, 7, false, 6 },
+    { 4, 8, false, 6 },
+    { 4, 9, false, 6 },
+    { 4, 10, false, 7 },
+    { 5, 6, false, 6 },
+    { 5, 7, false, 6 },
+    { 6, 6, false, 7 },
+};
+
+int suggestedTurnLimit(const GameVariant& variant) {
+    for (const KnownWorstCase& known : KNOWN_WORST_CASES) {
+        if (known.length == variant.length && known.base == variant.base && known.repeats == variant.repeats) {
+            // The Hard computer plays the classic game from the opening
+            // book, which is not optimal: it must have room to finish it
+            const OpeningBook& book = sharedOpeningBook();
+            if (variant.isClassic() && book.isMapped()) return max(known.worstCase, (int)book.header().maxDepth);
+            return known.worstCase;
+        }
+    }
+    return variantDepthLowerBound(variant) + 2;
+}
+
+// Function to list every code of a variant, position by position
+static void listCodes(const GameVariant& variant, int position, VariantCode prefix, uint32_t used,
+    vector<VariantCode>& codes) {
+    if (position == variant.length) {
+        codes.push_back(prefix);
+        return;
+    }
+    for (int digit = 0; digit < variant.base; digit++) {
+        if (!variant.repeats && ((used >> digit) & 1)) continue;
+        listCodes(variant, position + 1, prefix | (VariantCode)digit << (4 * position), used | (1u << digit), codes);
+    }
+}
+
+class VariantAnalyzer {
+public:
+    VariantAnalyzer(const GameVariant& variant, ThreadPool& pool);
+
+    int codeCount() const { return (int)codes_.size(); }
+
+    // Function to find the optimal worst case by iterative deepening
+    int worstCase();
+    // Function to find the fewest guesses summed over every secret
+    long long totalGuesses();
+
+    bool loadCheckpoint(const char* path, uint64_t& loaded);
+    bool saveCheckpoint(const char* path);
+
+    uint64_t nodes() const { return nodes_.load(); }
+    uint64_t memoHits() const { return memoHits_.load(); }
+    uint64_t memoEntries() const { return memoEntries_.load(); }
+
+private:
+    // What a node's set allows: its memo key and the swaps that leave it unchanged
+    struct Node {
+        string key;                                 // Empty when not memoized
+        int digitClass[MAX_VARIANT_BASE];           // Class of swappable digits, -1 for none
+        int positionClass[MAX_VARIANT_LENGTH];
+        vector<vector<int>> digitClasses;           // Members of each class, ascending
+        vector<vector<int>> positionMaps;           // Reorderings of swappable positions to try
+        bool symmetric = false;
+    };
+
+    // A guess worth trying at a node, with what its feedback groups promise
+    struct Split {
+        uint16_t guess;
+        int bound;          // Counting lower bound on the node's cost with this guess
+        int largest;        // Largest group left unsolved
+    };
+
+    struct MemoEntry {
+        int costLow = 0;            // Lower bound on the cost, or the cost when exact
+        bool costExact = false;
+        uint8_t depthLow = 0;       // The set needs at least this many guesses
+        uint8_t depthHigh = 0;      // It can be done in this many (0: not known)
+    };
+
+    struct Shard {
+        mutex lock;
+        unordered_map<string, MemoEntry> entries;
+    };
+
+    Feedback feedback(int guess, int secret) const {
+        if (!table_.empty()) return table_[(size_t)guess * codes_.size() + secret];
+        return makeVariantFeedback(rulesCorrectDigits(rules_, counts_[guess], counts_[secret]),
+            rulesCorrectPositions(rules_, codes_[guess], codes_[secret]));
+    }
+    int sumLowerBound(size_t secrets) const { return lowerBounds_[secrets]; }
+    int indexOf(VariantCode code) const {
+        return (int)(lower_bound(codes_.begin(), codes_.end(), code) - codes_.begin());
+    }
+
+    void analyzeNode(const SecretSet& set, Node& node) const;
+    bool fixesSet(const vector<VariantCode>& sorted, const int* digitMap, const int* positionMap) const;
+    VariantCode relabel(VariantCode code, const int* digitMap, const int* positionMap) const;
+    VariantCode canonicalGuess(VariantCode code, const Node& node) const;
+    void findSplits(const SecretSet& set, const Node& node, vector<Split>& splits) const;
+    void partition(const SecretSet& set, uint16_t guess, vector<SecretSet>& groups) const;
+
+    int searchCost(const SecretSet& set, int budget, bool parallel);
+    int guessCost(const SecretSet& set, const Split& split, int best, bool parallel);
+    bool searchDepth(const SecretSet& set, int depth, bool parallel);
+    bool guessFits(const SecretSet& set, const Split& split, int depth, bool parallel);
+
+    bool lookup(const string& key, MemoEntry& entry);
+    void rememberCost(const string& key, int low, bool exact);
+    void rememberDepth(const string& key, int low, int high);
+    Shard& shardOf(const string& key) { return shards_[hash<string>()(key) % MEMO_SHARDS]; }
+
+    GameVariant variant_;
+    DynamicRules rules_;
+    ThreadPool& pool_;
+    int parallelGuesses_;
+    int branching_;
+    Feedback solved_;
+    int feedbackCount_;
+    vector<VariantCode> codes_;     // Ascending, so a set's codes are too
+    vector<uint64_t> counts_;       // digitCounts() of each code
+    vector<Feedback> table_;        // All pairs, when small enough
+    vector<int> lowerBounds_;       // Counting lower bound on the cost of n secrets
+    Shard shards_[MEMO_SHARDS];
+    atomic<uint64_t> nodes_{ 0 };
+    atomic<uint64_t> memoHits_{ 0 };
+    atomic<uint64_t> memoEntries_{ 0 };
+};
+
+VariantAnalyzer::VariantAnalyzer(const GameVariant& variant, ThreadPool& pool) :
+    variant_(variant), rules_(variant), pool_(pool) {
+    parallelGuesses_ = max(2, 2 * pool.threadCount());
+    branching_ = branchingBound(variant);
+    solved_ = makeVariantFeedback(variant.length, variant.length);
+    feedbackCount_ = variantFeedbackCount(variant.length);
+
+    listCodes(variant, 0, 0, 0, codes_);
+    sort(codes_.begin(), codes_.end());
+    for (VariantCode code : codes_) counts_.push_back(digitCounts(code, variant.length));
+
+    int count = (int)codes_.size();
+    if (count <= MAX_TABLE_CODES) {
+        table_.resize((size_t)count * count);
+        for (int guess = 0; guess < count; guess++) {
+            for (int secret = 0; secret < count; secret++) {
+                table_[(size_t)guess * count + secret] = makeVariantFeedback(
+                    rulesCorrectDigits(rules_, counts_[guess], counts_[secret]),
+                    rulesCorrectPositions(rules_, codes_[guess], codes_[secret]));
+            }
+        }
+    }
+
+    // The cheapest tree conceivable fills each level before the next: one
+    // secret found per node, branching_ times as many nodes a level down
+    lowerBounds_.assign(count + 1, 0);
+    long long width = 1;
+    long long filled = 0;
+    int level = 1;
+    for (int n = 1; n <= count; n++) {
+        if (filled == width) {
+            filled = 0;
+            width = min(width * branching_, (long long)INT_MAX);
+            level++;
+        }
+        filled++;
+        lowerBounds_[n] = lowerBounds_[n - 1] + level;
+    }
+}
+
+VariantCode VariantAnalyzer::relabel(VariantCode code, const int* digitMap, const int* positionMap) const {
+    VariantCode result = 0;
+    for (int p = 0; p < variant_.length; p++) {
+        int digit = (code >> (4 * p)) & 0xF;
+        result |= (VariantCode)digitMap[digit] << (4 * positionMap[p]);
+    }
+    return result;
+}
+
+bool VariantAnalyzer::fixesSet(const vector<VariantCode>& sorted, const int* digitMap, const int* positionMap) const {
+    vector<VariantCode> image;
+    image.reserve(sorted.size());
+    for (VariantCode code : sorted) image.push_back(relabel(code, digitMap, positionMap));
+    std::sort(image.begin(), image.end());
+    return image == sorted;
+}
+
+// Function to rank signatures into colours: equal signatures, equal colours,
+// numbered by the order of the signatures so the numbering is canonical too
+static int rankSignatures(const vector<vector<long long>>& signatures, int* colors) {
+    vector<vector<long long>> distinct(signatures);
+    sort(distinct.begin(), distinct.end());
+    distinct.erase(unique(distinct.begin(), distinct.end()), distinct.end());
+    for (size_t i = 0; i < signatures.size(); i++) {
+        colors[i] = (int)(lower_bound(distinct.begin(), distinct.end(), signatures[i]) - distinct.begin());
+    }
+    return (int)distinct.size();
+}
+
+void VariantAnalyzer::analyzeNode(const SecretSet& set, Node& node) const {
+    int length = variant_.length;
+    int base = variant_.base;
+    vector<VariantCode> sorted;
+    sorted.reserve(set.size());
+    int counts[MAX_VARIANT_LENGTH][MAX_VARIANT_BASE] = {};
+    for (uint16_t index : set) {
+        VariantCode code = codes_[index];
+        sorted.push_back(code);
+        for (int p = 0; p < length; p++) counts[p][(code >> (4 * p)) & 0xF]++;
+    }
+
+    // Colour digits by where they occur, positions by what occurs there,
+    // each round telling apart what the other's colours tell apart
+    int digitColor[MAX_VARIANT_BASE] = {};
+    int positionColor[MAX_VARIANT_LENGTH] = {};
+    int digitColors = 1;
+    int positionColors = 1;
+    for (int round = 0; round < MAX_VARIANT_BASE + MAX_VARIANT_LENGTH; round++) {
+        vector<vector<long long>> digitSignatures(base);
+        vector<vector<long long>> positionSignatures(length);
+        for (int d = 0; d < base; d++) {
+            vector<long long>& signature = digitSignatures[d];
+            for (int p = 0; p < length; p++) signature.push_back((long long)positionColor[p] << 32 | counts[p][d]);
+            sort(signature.begin(), signature.end());
+            signature.insert(signature.begin(), digitColor[d]);
+        }
+        for (int p = 0; p < length; p++) {
+            vector<long long>& signature = positionSignatures[p];
+            for (int d = 0; d < base; d++) signature.push_back((long long)digitColor[d] << 32 | counts[p][d]);
+            sort(signature.begin(), signature.end());
+            signature.insert(signature.begin(), positionColor[p]);
+        }
+        int newDigitColors = rankSignatures(digitSignatures, digitColor);
+        int newPositionColors = rankSignatures(positionSignatures, positionColor);
+        bool stable = newDigitColors == digitColors && newPositionColors == positionColors;
+        digitColors = newDigitColors;
+        positionColors = newPositionColors;
+        if (stable) break;
+    }
+
+    vector<vector<int>> digitGroups(digitColors);
+    vector<vector<int>> positionGroups(positionColors);
+    for (int d = 0; d < base; d++) digitGroups[digitColor[d]].push_back(d);
+    for (int p = 0; p < length; p++) positionGroups[positionColor[p]].push_back(p);
+
+    // A colour class whose members all swap with its first without changing
+    // the set can be relabelled any way at all, so it is fixed, not enumerated
+    int identityDigits[MAX_VARIANT_BASE];
+    int identityPositions[MAX_VARIANT_LENGTH];
+    for (int d = 0; d < MAX_VARIANT_BASE; d++) identityDigits[d] = d;
+    for (int p = 0; p < MAX_VARIANT_LENGTH; p++) identityPositions[p] = p;
+    vector<bool> digitGroupSwaps(digitColors, false);
+    vector<bool> positionGroupSwaps(positionColors, false);
+    for (int d = 0; d < MAX_VARIANT_BASE; d++) node.digitClass[d] = -1;
+    for (int p = 0; p < MAX_VARIANT_LENGTH; p++) node.positionClass[p] = -1;
+    for (int c = 0; c < digitColors; c++) {
+        const vector<int>& members = digitGroups[c];
+        bool swaps = members.size() >= 2;
+        for (size_t i = 1; i < members.size() && swaps; i++) {
+            int map[MAX_VARIANT_BASE];
+            memcpy(map, identityDigits, sizeof(map));
+            swap(map[members[0]], map[members[i]]);
+            swaps = fixesSet(sorted, map, identityPositions);
+        }
+        digitGroupSwaps[c] = swaps;
+        if (!swaps) continue;
+        for (int d : members) node.digitClass[d] = (int)node.digitClasses.size();
+        node.digitClasses.push_back(members);
+    }
+    vector<vector<int>> swappablePositions;
+    for (int c = 0; c < positionColors; c++) {
+        const vector<int>& members = positionGroups[c];
+        bool swaps = members.size() >= 2;
+        for (size_t i = 1; i < members.size() && swaps; i++) {
+            int map[MAX_VARIANT_LENGTH];
+            memcpy(map, identityPositions, sizeof(map));
+            swap(map[members[0]], map[members[i]]);
+            swaps = fixesSet(sorted, identityDigits, map);
+        }
+        positionGroupSwaps[c] = swaps;
+        if (!swaps) continue;
+        for (int p : members) node.positionClass[p] = (int)swappablePositions.size();
+        swappablePositions.push_back(members);
+    }
+    node.symmetric = !node.digitClasses.empty() || !swappablePositions.empty();
+
+    // Reorderings of the swappable positions, for matching up guesses
+    long long reorderings = 1;
+    for (const vector<int>& members : swappablePositions) {
+        for (int k = 2; k <= (int)members.size(); k++) reorderings *= k;
+    }
+    node.positionMaps.assign(1, vector<int>(identityPositions, identityPositions + length));
+    if (reorderings > 1 && reorderings <= GUESS_POSITION_PERMUTATIONS) {
+        node.positionMaps.clear();
+        vector<vector<int>> orders(swappablePositions);
+        while (true) {
+            vector<int> map(identityPositions, identityPositions + length);
+            for (size_t c = 0; c < orders.size(); c++) {
+                for (size_t i = 0; i < orders[c].size(); i++) map[swappablePositions[c][i]] = orders[c][i];
+            }
+            node.positionMaps.push_back(map);
+            size_t c = 0;
+            while (c < orders.size() && !next_permutation(orders[c].begin(), orders[c].end())) c++;
+            if (c == orders.size()) break;
+        }
+    }
+
+    if (set.size() < 3 || set.size() > MEMO_MAX_SECRETS) return;
+
+    // Canonical form: the smallest image over every relabelling the colours
+    // leave open, swappable classes held in one order
+    vector<vector<int>> open;     // Digit classes first, then position classes
+    size_t openDigits = 0;
+    long long relabellings = 1;
+    for (int c = 0; c < digitColors; c++) {
+        if (digitGroups[c].size() < 2 || digitGroupSwaps[c]) continue;
+        open.push_back(digitGroups[c]);
+        openDigits++;
+        for (int k = 2; k <= (int)digitGroups[c].size(); k++) relabellings *= k;
+        if (relabellings > CANONICAL_PERMUTATIONS) break;
+    }
+    for (int c = 0; c < positionColors && relabellings <= CANONICAL_PERMUTATIONS; c++) {
+        if (positionGroups[c].size() < 2 || positionGroupSwaps[c]) continue;
+        open.push_back(positionGroups[c]);
+        for (int k = 2; k <= (int)positionGroups[c].size(); k++) relabellings *= k;
+    }
+
+    node.key.clear();
+    if (relabellings > CANONICAL_PERMUTATIONS) {
+        // Too many to try: the set as it stands is still an exact key
+        node.key.push_back('R');
+        node.key.append((const char*)set.data(), set.size() * sizeof(uint16_t));
+        return;
+    }
+
+    vector<vector<int>> orders(open);
+    vector<VariantCode> best;
+    vector<VariantCode> image;
+    image.reserve(sorted.size());
+    while (true) {
+        // Labels go out colour by colour, in each class's current order
+        int digitMap[MAX_VARIANT_BASE];
+        int positionMap[MAX_VARIANT_LENGTH];
+        int next = 0;
+        size_t openIndex = 0;
+        for (int c = 0; c < digitColors; c++) {
+            bool isOpen = digitGroups[c].size() >= 2 && !digitGroupSwaps[c];
+            const vector<int>& members = isOpen ? orders[openIndex++] : digitGroups[c];
+            for (int d : members) digitMap[d] = next++;
+        }
+        next = 0;
+        openIndex = openDigits;
+        for (int c = 0; c < positionColors; c++) {
+            bool isOpen = positionGroups[c].size() >= 2 && !positionGroupSwaps[c];
+            const vector<int>& members = isOpen ? orders[openIndex++] : positionGroups[c];
+            for (int p : members) positionMap[p] = next++;
+        }
+
+        image.clear();
+        for (VariantCode code : sorted) image.push_back(relabel(code, digitMap, positionMap));
+        std::sort(image.begin(), image.end());
+        if (best.empty() || image < best) best.swap(image);
+
+        size_t c = 0;
+        while (c < orders.size() && !next_permutation(orders[c].begin(), orders[c].end())) c++;
+        if (c == orders.size()) break;
+    }
+
+    node.key.push_back('C');
+    node.key.reserve(1 + best.size() * sizeof(uint16_t));
+    for (VariantCode code : best) {
+        uint16_t index = (uint16_t)indexOf(code);
+        node.key.append((const char*)&index, sizeof(index));
+    }
+}
+
+VariantCode VariantAnalyzer::canonicalGuess(VariantCode code, const Node& node) const {
+    VariantCode best = UINT32_MAX;
+    for (const vector<int>& positionMap : node.positionMaps) {
+        // Reorder, then give each swappable digit the lowest unused label of
+        // its class in order of first appearance
+        int mapped[MAX_VARIANT_BASE];
+        size_t used[MAX_VARIANT_BASE] = {};
+        for (int d = 0; d < MAX_VARIANT_BASE; d++) mapped[d] = -1;
+        VariantCode moved = 0;
+        for (int p = 0; p < variant_.length; p++) {
+            moved |= ((code >> (4 * p)) & 0xF) << (4 * positionMap[p]);
+        }
+        VariantCode result = 0;
+        for (int p = 0; p < variant_.length; p++) {
+            int digit = (moved >> (4 * p)) & 0xF;
+            int digitClass = node.digitClass[digit];
+            if (digitClass >= 0) {
+                if (mapped[digit] < 0) mapped[digit] = node.digitClasses[digitClass][used[digitClass]++];
+                digit = mapped[digit];
+            }
+            result |= (VariantCode)digit << (4 * p);
+        }
+        if (result < best) best = result;
+    }
+    return best;
+}
+
+void VariantAnalyzer::findSplits(const SecretSet& set, const Node& node, vector<Split>& splits) const {
+    int count = (int)codes_.size();
+    vector<bool> tried(node.symmetric ? count : 0, false);
+    vector<uint32_t> histogram(feedbackCount_);
+    for (int guess = 0; guess < count; guess++) {
+        if (node.symmetric) {
+            int representative = indexOf(canonicalGuess(codes_[guess], node));
+            if (tried[representative]) continue;
+            tried[representative] = true;
+        }
+        fill(histogram.begin(), histogram.end(), 0);
+        for (uint16_t secret : set) histogram[feedback(guess, secret)]++;
+
+        Split split;
+        split.guess = (uint16_t)guess;
+        split.bound = (int)set.size();
+        split.largest = 0;
+        for (int f = 0; f < feedbackCount_; f++) {
+            if (f == solved_ || histogram[f] == 0) continue;
+            split.bound += sumLowerBound(histogram[f]);
+            if ((int)histogram[f] > split.largest) split.largest = (int)histogram[f];
+        }
+        // A guess that cannot split the set would never end
+        if (split.largest == (int)set.size()) continue;
+        splits.push_back(split);
+    }
+}
+
+void VariantAnalyzer::partition(const SecretSet& set, uint16_t guess, vector<SecretSet>& groups) const {
+    vector<SecretSet> byFeedback(feedbackCount_);
+    for (uint16_t secret : set) {
+        Feedback f = feedback(guess, secret);
+        if (f != solved_) byFeedback[f].push_back(secret);
+    }
+    groups.clear();
+    for (SecretSet& group : byFeedback) {
+        if (!group.empty()) groups.push_back(move(group));
+    }
+    // The largest group is the likeliest to blow the budget
+    sort(groups.begin(), groups.end(), [](const SecretSet& a, const SecretSet& b) {
+        return a.size() > b.size();
+    });
+}
+
+bool VariantAnalyzer::lookup(const string& key, MemoEntry& entry) {
+    if (key.empty()) return false;
+    Shard& shard = shardOf(key);
+    lock_guard<mutex> guard(shard.lock);
+    auto found = shard.entries.find(key);
+    if (found == shard.entries.end()) return false;
+    entry = found->second;
+    memoHits_++;
+    return true;
+}
+
+void VariantAnalyzer::rememberCost(const string& key, int low, bool exact) {
+    if (key.empty()) return;
+    Shard& shard = shardOf(key);
+    lock_guard<mutex> guard(shard.lock);
+    auto found = shard.entries.find(key);
+    if (found == shard.entries.end()) {
+        if (memoEntries_.load() >= MAX_MEMO_ENTRIES) return;
+        found = shard.entries.emplace(key, MemoEntry()).first;
+        memoEntries_++;
+    }
+    MemoEntry& entry = found->second;
+    if (entry.costExact) return;
+    if (exact || low > entry.costLow) entry.costLow = low;
+    entry.costExact = exact;
+}
+
+void VariantAnalyzer::rememberDepth(const string& key, int low, int high) {
+    if (key.empty()) return;
+    Shard& shard = shardOf(key);
+    lock_guard<mutex> guard(shard.lock);
+    auto found = shard.entries.find(key);
+    if (found == shard.entries.end()) {
+        if (memoEntries_.load() >= MAX_MEMO_ENTRIES) return;
+        found = shard.entries.emplace(key, MemoEntry()).first;
+        memoEntries_++;
+    }
+    MemoEntry& entry = found->second;
+    if (low > entry.depthLow) entry.depthLow = (uint8_t)low;
+    if (high > 0 && (entry.depthHigh == 0 || high < entry.depthHigh)) entry.depthHigh = (uint8_t)high;
+}
+
+// Function to cost one guess at a node: exact when below best, otherwise
+// some lower bound that is at least best
+int VariantAnalyzer::guessCost(const SecretSet& set, const Split& split, int best, bool parallel) {
+    vector<SecretSet> groups;
+    partition(set, split.guess, groups);
+    int total = split.bound;
+    for (const SecretSet& group : groups) {
+        int low = sumLowerBound(group.size());
+        int allowance = best == UNBOUNDED ? UNBOUNDED : best - (total - low);
+        total += searchCost(group, allowance, parallel) - low;
+        if (best != UNBOUNDED && total >= best) return total;
+    }
+    return total;
+}
+
+// Function to find the fewest guesses summed over the set's secrets: exact
+// when below budget, otherwise some lower bound that is at least budget.
+// Only the thread that started the analysis passes parallel.
+int VariantAnalyzer::searchCost(const SecretSet& set, int budget, bool parallel) {
+    int n = (int)set.size();
+    if (n == 1) return 1;
+    if (n == 2) return 3;
+    int lower = sumLowerBound(n);
+    if (lower >= budget) return lower;
+
+    Node node;
+    analyzeNode(set, node);
+    MemoEntry entry;
+    if (lookup(node.key, entry)) {
+        if (entry.costExact) return entry.costLow;
+        lower = max(lower, entry.costLow);
+        if (lower >= budget) return lower;
+    }
+    nodes_++;
+
+    vector<Split> splits;
+    findSplits(set, node, splits);
+    sort(splits.begin(), splits.end(), [](const Split& a, const Split& b) {
+        if (a.bound != b.bound) return a.bound < b.bound;
+        if (a.largest != b.largest) return a.largest < b.largest;
+        return a.guess < b.guess;
+    });
+
+    int best = budget;
+    parallel = parallel && n >= PARALLEL_MIN_SECRETS;
+    if (parallel && (int)splits.size() >= parallelGuesses_) {
+        // Every guess a task, all pruned against the best total so far
+        atomic<int> shared(best);
+        TaskGroup tasks;
+        for (const Split& split : splits) {
+            tasks.add();
+            pool_.submit([this, &set, &shared, &tasks, split] {
+                int current = shared.load();
+                if (split.bound < current) {
+                    int cost = guessCost(set, split, current, false);
+                    while (cost < current && !shared.compare_exchange_weak(current, cost)) {
+                    }
+                }
+                tasks.done();
+            });
+        }
+        tasks.wait();
+        best = shared.load();
+    }
+    else {
+        for (const Split& split : splits) {
+            if (split.bound >= best) break;
+            best = min(best, guessCost(set, split, best, parallel));
+        }
+    }
+
+    if (best < budget) {
+        rememberCost(node.key, best, true);
+        return best;
+    }
+    rememberCost(node.key, budget, false);
+    return budget;
+}
+
+bool VariantAnalyzer::guessFits(const SecretSet& set, const Split& split, int depth, bool parallel) {
+    vector<SecretSet> groups;
+    partition(set, split.guess, groups);
+    for (const SecretSet& group : groups) {
+        if (!searchDepth(group, depth - 1, parallel)) return false;
+    }
+    return true;
+}
+
+// Function to check whether every secret in the set can be found within
+// depth guesses
+bool VariantAnalyzer::searchDepth(const SecretSet& set, int depth, bool parallel) {
+    int n = (int)set.size();
+    if (n == 1) return depth >= 1;
+    if (depth < 2) return false;
+    if (n == 2) return true;
+    if (maxSolvable(branching_, depth) < (uint64_t)n) return false;
+
+    Node node;
+    analyzeNode(set, node);
+    MemoEntry entry;
+    if (lookup(node.key, entry)) {
+        if (entry.depthHigh > 0 && entry.depthHigh <= depth) return true;
+        if (entry.depthLow > depth) return false;
+    }
+    nodes_++;
+
+    vector<Split> splits;
+    findSplits(set, node, splits);
+    uint64_t fitsBelow = maxSolvable(branching_, depth - 1);
+    splits.erase(remove_if(splits.begin(), splits.end(), [fitsBelow](const Split& split) {
+        return (uint64_t)split.largest > fitsBelow;
+    }), splits.end());
+    sort(splits.begin(), splits.end(), [](const Split& a, const Split& b) {
+        if (a.largest != b.largest) return a.largest < b.largest;
+        if (a.bound != b.bound) return a.bound < b.bound;
+        return a.guess < b.guess;
+    });
+
+    bool fits = false;
+    parallel = parallel && n >= PARALLEL_MIN_SECRETS;
+    if (parallel && (int)splits.size() >= parallelGuesses_) {
+        atomic<bool> found(false);
+        TaskGroup tasks;
+        for (const Split& split : splits) {
+            tasks.add();
+            pool_.submit([this, &set, &found, &tasks, split, depth] {
+                if (!found.load() && guessFits(set, split, depth, false)) found = true;
+                tasks.done();
+            });
+        }
+        tasks.wait();
+        fits = found.load();
+    }
+    else {
+        for (const Split& split : splits) {
+            if (guessFits(set, split, depth, parallel)) {
+                fits = true;
+                break;
+            }
+        }
+    }
+
+    if (fits) rememberDepth(node.key, 0, depth);
+    else rememberDepth(node.key, depth + 1, 0);
+    return fits;
+}
+
+int VariantAnalyzer::worstCase() {
+    SecretSet all(codes_.size());
+    for (size_t i = 0; i < all.size(); i++) all[i] = (uint16_t)i;
+    int depth = variantDepthLowerBound(variant_);
+    while (!searchDepth(all, depth, true)) depth++;
+    return depth;
+}
+
+long long VariantAnalyzer::totalGuesses() {
+    SecretSet all(codes_.size());
+    for (size_t i = 0; i < all.size(); i++) all[i] = (uint16_t)i;
+    return searchCost(all, UNBOUNDED, true);
+}
+
+bool VariantAnalyzer::saveCheckpoint(const char* path) {
+    // Entries are facts each on its own, so shards are copied one at a time
+    vector<unsigned char> bytes;
+    uint64_t entryCount = 0;
+    for (Shard& shard : shards_) {
+        lock_guard<mutex> guard(shard.lock);
+        for (const auto& item : shard.entries) {
+            uint32_t keySize = (uint32_t)item.first.size();
+            int32_t costLow = item.second.costLow;
+            unsigned char flags[4] = { (unsigned char)item.second.costExact, item.second.depthLow,
+                item.second.depthHigh, 0 };
+            bytes.insert(bytes.end(), (const unsigned char*)&keySize, (const unsigned char*)&keySize + 4);
+            bytes.insert(bytes.end(), item.first.begin(), item.first.end());
+            bytes.insert(bytes.end(), (const unsigned char*)&costLow, (const unsigned char*)&costLow + 4);
+            bytes.insert(bytes.end(), flags, flags + 4);
+            entryCount++;
+        }
+    }
+
+    VariantCheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, VARIANT_CHECKPOINT_MAGIC, 4);
+    header.version = VARIANT_CHECKPOINT_VERSION;
+    header.length = (uint8_t)variant_.length;
+    header.base = (uint8_t)variant_.base;
+    header.repeats = variant_.repeats ? 1 : 0;
+    header.codeCount = (uint32_t)codes_.size();
+    header.entryCount = entryCount;
+
+    string tempPath = string(path) + ".tmp";
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file) return false;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        (bytes.empty() || fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size());
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        remove(tempPath.c_str());
+        return false;
+    }
+    remove(path);  // rename() does not replace an existing file on Windows
+    return rename(tempPath.c_str(), path) == 0;
+}
+
+bool VariantAnalyzer::loadCheckpoint(const char* path, uint64_t& loaded) {
+    loaded = 0;
+    MappedFile file;
+    if (!file.open(path)) return true;     // Nothing to resume yet
+
+    VariantCheckpointHeader header;
+    if (file.size() < sizeof(header)) return false;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, VARIANT_CHECKPOINT_MAGIC, 4) != 0 || header.version != VARIANT_CHECKPOINT_VERSION ||
+        header.length != variant_.length || header.base != variant_.base ||
+        header.repeats != (variant_.repeats ? 1 : 0) || header.codeCount != codes_.size()) {
+        return false;
+    }
+
+    size_t offset = sizeof(header);
+    for (uint64_t i = 0; i < header.entryCount; i++) {
+        uint32_t keySize;
+        if (offset + 4 > file.size()) break;
+        memcpy(&keySize, file.data() + offset, 4);
+        if (offset + 4 + keySize + 8 > file.size()) break;
+        string key((const char*)file.data() + offset + 4, keySize);
+        int32_t costLow;
+        memcpy(&costLow, file.data() + offset + 4 + keySize, 4);
+        const unsigned char* flags = file.data() + offset + 8 + keySize;
+        offset += 12 + keySize;
+
+        rememberCost(key, costLow, flags[0] != 0);
+        rememberDepth(key, flags[1], flags[2]);
+        loaded++;
+    }
+    return true;
+}
+
+bool analyzeVariant(const GameVariant& variant, const VariantAnalysisOptions& options,
+    VariantAnalysis& analysis, ThreadPool& pool) {
+    analysis = VariantAnalysis();
+    analysis.variant = variant;
+    if (checkVariant(variant) != VariantStatus::Valid || variantCodeCount(variant) > (uint64_t)MAX_ANALYZED_CODES) {
+        return false;
+    }
+
+    auto start = chrono::steady_clock::now();
+    VariantAnalyzer analyzer(variant, pool);
+    analysis.codeCount = analyzer.codeCount();
+    if (options.checkpointPath && !analyzer.loadCheckpoint(options.checkpointPath, analysis.resumedEntries)) {
+        return false;
+    }
+
+    // Checkpoints are written from a thread of their own while the search runs
+    mutex lock;
+    condition_variable wake;
+    bool finished = false;
+    thread checkpointer;
+    if (options.checkpointPath && options.checkpointSeconds > 0) {
+        checkpointer = thread([&] {
+            unique_lock<mutex> guard(lock);
+            while (!wake.wait_for(guard, chrono::duration<double>(options.checkpointSeconds), [&] { return finished; })) {
+                guard.unlock();
+                analyzer.saveCheckpoint(options.checkpointPath);
+                guard.lock();
+            }
+        });
+    }
+
+    if (options.worstCase) analysis.worstCase = analyzer.worstCase();
+    if (options.expectedCase) {
+        analysis.totalGuesses = analyzer.totalGuesses();
+        analysis.expectedGuesses = (double)analysis.totalGuesses / analysis.codeCount;
+    }
+
+    if (checkpointer.joinable()) {
+        {
+            lock_guard<mutex> guard(lock);
+            finished = true;
+        }
+        wake.notify_all();
+        checkpointer.join();
+    }
+    if (options.checkpointPath) analyzer.saveCheckpoint(options.checkpointPath);
+
+    analysis.nodes = analyzer.nodes();
+    analysis.memoHits = analyzer.memoHits();
+    analysis.memoEntries = analyzer.memoEntries();
+    analysis.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return true;
+}
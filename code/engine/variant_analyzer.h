@@ -0,0 +1,76 @@
+#pragma once
+
+// Exact analysis of a game variant: the fewest guesses that always suffice
+// (optimal worst case) and the fewest on average over every secret (optimal
+// expected case), with any code of the variant allowed as a guess.
+//
+// Both are a search over the game tree. A node is the set of secrets still
+// possible, and its value only depends on that set up to relabelling digits
+// and reordering positions, so results are memoized under a canonical form
+// of the set: digits and positions are coloured by how often they occur
+// where (refined until stable), and the set is relabelled every way the
+// colours leave open, keeping the smallest image. Colour classes whose
+// members can be swapped without changing the set are fixed in any order
+// instead of enumerated, which is what keeps the top of the tree cheap.
+// The same swaps prune the guesses: two guesses related by one of them
+// lead to the same subtree, so only one is tried.
+//
+// The expected case is branch-and-bound: guesses are tried in order of a
+// counting lower bound (each node finds at most one secret and has at most
+// one child per feedback), a subtree is searched with the budget left by
+// its siblings, and a node that cannot beat its budget records that as a
+// lower bound. The worst case is iterative deepening on the same nodes.
+// Near the root, where nodes are large, the candidate guesses are searched
+// in parallel on the ThreadPool against a shared bound.
+//
+// The memo is the whole state of a run, so a checkpoint is the memo written
+// out; a run given the same checkpoint file resumes from it, and a finished
+// run's file answers at once.
+
+#include "engine/thread_pool.h"
+#include "engine/variant.h"
+
+#include <cstdint>
+
+// Variants with more codes than this are not analyzed (codes are 16-bit indices)
+const int MAX_ANALYZED_CODES = 65535;
+
+// Bump the version whenever the key or entry layout changes
+const char VARIANT_CHECKPOINT_MAGIC[4] = { 'N', 'B', 'V', 'A' };
+const uint32_t VARIANT_CHECKPOINT_VERSION = 1;
+
+struct VariantAnalysisOptions {
+    bool worstCase = true;          // Compute the optimal worst case
+    bool expectedCase = true;       // Compute the optimal expected case
+    const char* checkpointPath = nullptr;   // Memo is loaded from and saved to this file
+    double checkpointSeconds = 300;
+};
+
+struct VariantAnalysis {
+    GameVariant variant;
+    int codeCount = 0;
+    int worstCase = 0;              // Guesses that always suffice; 0 when not computed
+    long long totalGuesses = 0;     // Guesses summed over every secret; 0 when not computed
+    double expectedGuesses = 0;     // totalGuesses / codeCount
+    uint64_t nodes = 0;             // Nodes searched (memo hits not counted)
+    uint64_t memoHits = 0;
+    uint64_t memoEntries = 0;
+    uint64_t resumedEntries = 0;    // Loaded from the checkpoint
+    double seconds = 0;
+};
+
+// Function to analyze a variant; false when it has too many codes or the
+// checkpoint file belongs to another variant
+bool analyzeVariant(const GameVariant& variant, const VariantAnalysisOptions& options,
+    VariantAnalysis& analysis, ThreadPool& pool = sharedThreadPool());
+
+// Function to bound the optimal worst case from below by counting alone:
+// no tree of that depth has room for every code
+int variantDepthLowerBound(const GameVariant& variant);
+
+// Function to get the default for the turn-limit prompt: the optimal worst
+// case where numbrainer_analyzer has computed it (in the classic game at
+// least the opening book's depth, so the Hard computer can always finish),
+// else the counting bound plus two (which is what the computed variants
+// average)
+int suggestedTurnLimit(const GameVariant& variant);
@@ -0,0 +1,218 @@
+#include "engine/variant_candidates.h"
+
+#include <algorithm>
+
+using namespace std;
+
+struct VariantKernels {
+    // Function to keep the codes that agree with a guess; returns how many
+    size_t (*filter)(const GameVariant& variant, VariantCode* codes, uint64_t* counts, size_t count,
+        const VariantConstraint& constraint);
+
+    // Function to list, in order from the rotated first digit, the codes
+    // that agree with every guess; false once more than limit were found or
+    // the walk made more than workLimit digit trials (0 for no cap).
+    // matched is the walk's scratch.
+    bool (*list)(const GameVariant& variant, const vector<VariantConstraint>& constraints,
+        size_t limit, long workLimit, int rotation, vector<VariantCode>& codes, vector<uint64_t>& counts,
+        vector<int>& matched);
+};
+
+template <class Rules>
+static size_t filterCodes(const GameVariant& variant, VariantCode* codes, uint64_t* counts, size_t count,
+    const VariantConstraint& constraint) {
+    Rules rules(variant);
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        bool agrees = rulesCorrectPositions(rules, constraint.guess, codes[i]) == constraint.correctPositions &&
+            rulesCorrectDigits(rules, constraint.guessCounts, counts[i]) == constraint.correctDigits;
+        // Always copy, only advance on a match: no unpredictable branch
+        codes[kept] = codes[i];
+        counts[kept] = counts[i];
+        kept += agrees;
+    }
+    return kept;
+}
+
+// Depth-first walk over the positions. For every guess it tracks the
+// positions and digits the prefix already matches; a prefix is dropped when
+// a count has overshot, or when the positions still open could not make up
+// the difference. Early in a huge variant the guesses prune too little for
+// that to pay, so a walk over a space larger than the list also gives up
+// after WALK_WORK_LIMIT digit trials; one over a space the list can hold
+// runs to the end, since it costs at most a few digit trials per code.
+static const long WALK_WORK_LIMIT = 1 << 18;
+
+template <class Rules>
+class CodeLister {
+public:
+    CodeLister(const GameVariant& variant, const vector<VariantConstraint>& constraints, size_t limit,
+        long workLimit, int rotation, vector<VariantCode>& codes, vector<uint64_t>& counts, vector<int>& matched) :
+        rules_(variant), constraints_(constraints), limit_(limit), workLimit_(workLimit), rotation_(rotation),
+        codes_(codes), counts_(counts), matched_(matched) {
+        matched_.assign((rules_.length() + 1) * constraints.size() * 2, 0);
+    }
+
+    bool run() { return visit(0, 0, 0); }
+
+private:
+    bool visit(int position, VariantCode code, uint64_t prefixCounts) {
+        if (position == rules_.length()) {
+            codes_.push_back(code);
+            counts_.push_back(prefixCounts);
+            return codes_.size() <= limit_;
+        }
+
+        const size_t n = constraints_.size();
+        const int open = rules_.length() - position - 1;
+        const int* here = &matched_[position * n * 2];
+        int* next = &matched_[(position + 1) * n * 2];
+        for (int step = 0; step < rules_.base(); step++) {
+            if (++work_ > workLimit_ && workLimit_ > 0) return false;
+            int digit = (step + rotation_) % rules_.base();
+            int used = (int)((prefixCounts >> (4 * digit)) & 0xF);
+            if (!rules_.repeats() && used) continue;
+
+            bool possible = true;
+            for (size_t c = 0; c < n && possible; c++) {
+                const VariantConstraint& constraint = constraints_[c];
+                int positions = here[2 * c] + (((constraint.guess >> (4 * position)) & 0xF) == (uint32_t)digit);
+                // Another copy of a digit only scores while the guess has more of it
+                int digits = here[2 * c + 1] + (used < (int)((constraint.guessCounts >> (4 * digit)) & 0xF));
+                possible = positions <= constraint.correctPositions && positions + open >= constraint.correctPositions &&
+                    digits <= constraint.correctDigits && digits + open >= constraint.correctDigits;
+                next[2 * c] = positions;
+                next[2 * c + 1] = digits;
+            }
+            if (possible && !visit(position + 1, code | ((VariantCode)digit << (4 * position)),
+                prefixCounts + (1ull << (4 * digit)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Rules rules_;
+    const vector<VariantConstraint>& constraints_;
+    size_t limit_;
+    long workLimit_;
+    int rotation_;
+    vector<VariantCode>& codes_;
+    vector<uint64_t>& counts_;
+    vector<int>& matched_;  // [position][constraint][positions, digits]
+    long work_ = 0;
+};
+
+template <class Rules>
+static bool listCodes(const GameVariant& variant, const vector<VariantConstraint>& constraints,
+    size_t limit, long workLimit, int rotation, vector<VariantCode>& codes, vector<uint64_t>& counts,
+    vector<int>& matched) {
+    CodeLister<Rules> lister(variant, constraints, limit, workLimit, rotation, codes, counts, matched);
+    return lister.run();
+}
+
+template <class Rules>
+static const VariantKernels* kernelsOf() {
+    static const VariantKernels kernels = { filterCodes<Rules>, listCodes<Rules> };
+    return &kernels;
+}
+
+struct SpecializedVariant {
+    GameVariant variant;
+    const VariantKernels* (*kernels)();
+};
+
+// The variants people actually play get their own instantiation
+static const SpecializedVariant SPECIALIZED_VARIANTS[] = {
+    { { 3, 10, false }, kernelsOf<CodeRules<3, 10, false>> },
+    { { 4, 10, false }, kernelsOf<CodeRules<4, 10, false>> },
+    { { 5, 10, false }, kernelsOf<CodeRules<5, 10, false>> },
+    { { 6, 10, false }, kernelsOf<CodeRules<6, 10, false>> },
+    { { 4, 10, true }, kernelsOf<CodeRules<4, 10, true>> },
+    { { 5, 10, true }, kernelsOf<CodeRules<5, 10, true>> },
+    { { 4, 6, true }, kernelsOf<CodeRules<4, 6, true>> },     // Mastermind
+    { { 5, 8, true }, kernelsOf<CodeRules<5, 8, true>> },     // Super Mastermind
+    { { 4, 16, false }, kernelsOf<CodeRules<4, 16, false>> },
+};
+
+static const VariantKernels* kernelsFor(const GameVariant& variant) {
+    for (const SpecializedVariant& specialized : SPECIALIZED_VARIANTS) {
+        if (specialized.variant == variant) return specialized.kernels();
+    }
+    return kernelsOf<DynamicRules>();
+}
+
+bool hasSpecializedKernels(const GameVariant& variant) {
+    return kernelsFor(variant) != kernelsOf<DynamicRules>();
+}
+
+void VariantCandidates::reset(const GameVariant& variant) {
+    variant_ = variant;
+    kernels_ = kernelsFor(variant);
+    constraints_.clear();
+    // A walk stops one code past the limit
+    size_t listed = (size_t)min<uint64_t>(variantCodeCount(variant), LIST_LIMIT) + 1;
+    codes_.reserve(listed);
+    counts_.reserve(listed);
+    found_.reserve(1);
+    foundCounts_.reserve(1);
+    reserveGuesses((int)constraints_.capacity());
+    relist();
+}
+
+void VariantCandidates::reserveGuesses(int count) {
+    constraints_.reserve(count);
+    matched_.reserve((size_t)(MAX_VARIANT_LENGTH + 1) * count * 2);
+}
+
+void VariantCandidates::applyGuess(VariantCode guess, int correctDigits, int correctPositions) {
+    VariantConstraint constraint;
+    constraint.guess = guess;
+    constraint.guessCounts = digitCounts(guess, variant_.length);
+    constraint.correctDigits = correctDigits;
+    constraint.correctPositions = correctPositions;
+    constraints_.push_back(constraint);
+
+    if (listed_) {
+        size_t kept = kernels_->filter(variant_, codes_.data(), counts_.data(), codes_.size(), constraint);
+        codes_.resize(kept);
+        counts_.resize(kept);
+    }
+    else {
+        relist();
+    }
+}
+
+void VariantCandidates::relist() {
+    codes_.clear();
+    counts_.clear();
+    // The whole space is only walked when it is known to fit, and then
+    // without the work cap, which is only for spaces larger than the list
+    bool fits = variantCodeCount(variant_) <= LIST_LIMIT;
+    if (constraints_.empty() && !fits) {
+        listed_ = false;
+        return;
+    }
+    listed_ = kernels_->list(variant_, constraints_, LIST_LIMIT, fits ? 0 : WALK_WORK_LIMIT, 0, codes_, counts_,
+        matched_);
+    if (!listed_) {
+        codes_.clear();
+        counts_.clear();
+    }
+}
+
+bool VariantCandidates::findConsistent(unsigned pick, VariantCode& code) const {
+    if (listed_) {
+        if (codes_.empty()) return false;
+        code = codes_[pick % codes_.size()];
+        return true;
+    }
+    // Starting the walk from a different digit varies the answer
+    found_.clear();
+    foundCounts_.clear();
+    kernels_->list(variant_, constraints_, 0, WALK_WORK_LIMIT, (int)(pick % variant_.base), found_, foundCounts_,
+        matched_);
+    if (found_.empty()) return false;
+    code = found_[0];
+    return true;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+// Secrets a guesser could still be facing, for any game variant.
+//
+// Variant code spaces run up to 16^8 (about 4.3 billion) codes, far too many
+// to keep as a list, let alone as strings. So the set keeps the guesses it
+// was given and only lists the codes that agree with all of them once there
+// are at most LIST_LIMIT; until then it is implicit and count() says "many".
+// Listing is a depth-first walk over the code positions that drops a prefix
+// as soon as some guess's feedback can no longer be met, so its cost follows
+// the number of codes it finds rather than the size of the space. In a space
+// larger than the list it is also capped, so a guess never costs more than a
+// few milliseconds; a space the list can hold is always listed. Once listed,
+// each guess filters the list in place.
+//
+// The list is stored structure-of-arrays: 4 bytes of position nibbles plus
+// an 8-byte digit-count word per code. Filtering and listing are templates
+// over the scoring rules, instantiated with compile-time CodeRules for the
+// common variants and DynamicRules for the rest. The list and the walk's
+// scratch are sized when the set is reset (and by reserveGuesses()), so
+// applying a guess or finding a consistent code never allocates.
+
+#include "engine/variant.h"
+
+#include <cstddef>
+#include <vector>
+
+// One scored guess, which every remaining candidate has to agree with
+struct VariantConstraint {
+    VariantCode guess;
+    uint64_t guessCounts;   // digitCounts() of the guess
+    int correctDigits;
+    int correctPositions;
+};
+
+struct VariantKernels;
+
+class VariantCandidates {
+public:
+    // Most codes kept as a list (12 bytes each)
+    static const size_t LIST_LIMIT = 1 << 18;
+
+    VariantCandidates() { reset(GameVariant()); }
+
+    // Function to go back to the variant's whole code space
+    void reset(const GameVariant& variant);
+
+    const GameVariant& variant() const { return variant_; }
+    int guessCount() const { return (int)constraints_.size(); }
+
+    // Function to make room for this many guesses' constraints
+    void reserveGuesses(int count);
+
+    // Function to keep only the codes that give this feedback for the guess
+    void applyGuess(VariantCode guess, int correctDigits, int correctPositions);
+
+    // Function to get the number of codes left; -1 means more than LIST_LIMIT
+    long long count() const { return listed_ ? (long long)codes_.size() : -1; }
+
+    bool isListed() const { return listed_; }
+    const std::vector<VariantCode>& codes() const { return codes_; }
+
+    // Function to find some code that agrees with every guess so far (the
+    // listed code at pick % count, or the first one the walk reaches);
+    // false when there is none, or none turned up within the walk's cap.
+    // The walk uses the set's scratch: not for two threads at once.
+    bool findConsistent(unsigned pick, VariantCode& code) const;
+
+private:
+    void relist();
+
+    GameVariant variant_;
+    const VariantKernels* kernels_ = nullptr;
+    std::vector<VariantConstraint> constraints_;
+    std::vector<VariantCode> codes_;
+    std::vector<uint64_t> counts_;
+    bool listed_ = false;
+
+    // Scratch of the walk: what each prefix matches of every guess, and
+    // findConsistent()'s one code
+    mutable std::vector<int> matched_;
+    mutable std::vector<VariantCode> found_;
+    mutable std::vector<uint64_t> foundCounts_;
+};
+
+// Function to check whether a variant has compile-time specialized kernels
+bool hasSpecializedKernels(const GameVariant& variant);
@@ -6,12 +6,33 @@
 #endif
 
 #include "raylib.h"
+#include "engine/game_engine.h"
+#include "engine/candidate_set.h"
+#include "engine/hint_engine.h"
+#include "engine/computer_player.h"
+#include "engine/variant_candidates.h"
+#include "engine/frame_profiler.h"
+#include "engine/match_history.h"
+#include "engine/frame_arena.h"
+#include "engine/game_clock.h"
+#include "engine/game_record.h"
+#include "engine/input_queue.h"
+#include "engine/mapped_file.h"
+#include "engine/match_client.h"
+#include "engine/match_snapshot.h"
+#include "engine/player_store.h"
+#include "engine/variant_analyzer.h"
 #include <string>
-#include <set>
 #include <vector>
 #include <cstdlib>
 #include <ctime>
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#if defined(NUMBRAINER_COUNT_ALLOCATIONS)
+#include "bench/alloc_counter.h"
+#endif
 
 using namespace std;
 
@@ -27,6 +48,52 @@ const Color SUCCESS_COLOR = { 25, 135, 84, 255 };       // Deep green
 const Color WARNING_COLOR = { 255, 193, 7, 255 };       // Bright yellow
 const Color TIMER_WARNING = { 220, 20, 60, 255 };       // Crimson red for urgency
 
+// Frame timing for the F3 overlay and the F4 trace
+static FrameProfiler frameProfiler;
+
+// Every raylib draw call made in this file goes through these, so it is
+// counted for the overlay
+static void CountedDrawText(const char* text, int posX, int posY, int fontSize, Color color) {
+    frameProfiler.countDrawCall();
+    DrawText(text, posX, posY, fontSize, color);
+}
+
+static void CountedDrawRectangle(int posX, int posY, int width, int height, Color color) {
+    frameProfiler.countDrawCall();
+    DrawRectangle(posX, posY, width, height, color);
+}
+
+static void CountedDrawRectangleRounded(Rectangle rec, float roundness, int segments, Color color) {
+    frameProfiler.countDrawCall();
+    DrawRectangleRounded(rec, roundness, segments, color);
+}
+
+static void CountedDrawRectangleRoundedLines(Rectangle rec, float roundness, int segments, float lineThick, Color color) {
+    frameProfiler.countDrawCall();
+    DrawRectangleRoundedLines(rec, roundness, segments, lineThick, color);
+}
+
+static void CountedDrawTextureRec(Texture2D texture, Rectangle source, Vector2 position, Color tint) {
+    frameProfiler.countDrawCall();
+    DrawTextureRec(texture, source, position, tint);
+}
+
+// Idle rendering: how often the input is polled while nothing is drawn, and
+// the longest a still screen goes without being redrawn anyway
+const double IDLE_POLL_INTERVAL = 1.0 / 30.0;
+const double IDLE_REFRESH_INTERVAL = 1.0;
+
+// Trace file written when tracing is switched on with F4 (or at launch
+// through the NUMBRAINER_TRACE environment variable, which names the file)
+const char* const TRACE_FILE = "numbrainer_trace.json";
+// Where played matches are appended unless NUMBRAINER_RECORD says otherwise
+const char* const RECORD_FILE = "numbrainer_games.nbr";
+// Snapshot of the match in progress, offered for resuming after a crash
+const char* const SNAPSHOT_FILE = "numbrainer_resume.bin";
+// Player profiles (append-only log) and the index over them
+const char* const PLAYER_LOG_FILE = "numbrainer_players.nbp";
+const char* const PLAYER_INDEX_FILE = "numbrainer_players.nbi";
+
 // Global button rectangles
 static Rectangle resetButton = { 0, 0, 200, 40 };
 static Rectangle menuButton = { 0, 0, 200, 40 };
@@ -49,23 +116,15 @@ float Clamp(float value, float min, float max) {
 }
 
 // Function to reset the game state
-void ResetGame(bool& startScreen, string& player1Number, string& player2Number, string& guess,
-    string& feedbackMessage, bool& player1Turn, bool& settingUp, bool& settingTurnLimit,
-    bool& gameOver, vector<string>& feedbackHistory,
-    int& player1Turns, int& player2Turns, string& turnLimitInput, int& remainingTime,
+void ResetGame(bool& startScreen, GameState& game, string& guess,
+    string& feedbackMessage, MatchHistory& feedbackHistory,
+    string& turnLimitInput, int& remainingTime,
     string& player1Name, string& player2Name, bool& settingPlayer1Name, bool& settingPlayer2Name) {
     startScreen = true;
-    player1Number.clear();
-    player2Number.clear();
+    game = GameState();
     guess.clear();
     feedbackMessage.clear();
-    player1Turn = true;
-    settingUp = true;
-    settingTurnLimit = true;
-    gameOver = false;
     feedbackHistory.clear();
-    player1Turns = 0;
-    player2Turns = 0;
     turnLimitInput.clear();
     remainingTime = 0;
     player1Name.clear();
@@ -74,50 +133,6 @@ void ResetGame(bool& startScreen, string& player1Number, string& player2Number,
     settingPlayer2Name = false;
 }
 
-// Function to count how many digits are correct
-int countCorrectDigits(const string& guess, const string& target) {
-    int correctCount = 0;
-    for (char ch : guess) {
-        if (target.find(ch) != string::npos) {
-            correctCount++;
-        }
-    }
-    return correctCount;
-}
-
-// Function to count how many digits are in the correct position
-int countCorrectPositions(const string& guess, const string& target) {
-    int correctPosCount = 0;
-    for (int i = 0; i < guess.length(); i++) {
-        if (guess[i] == target[i]) {
-            correctPosCount++;
-        }
-    }
-    return correctPosCount;
-}
-
-// Function to validate the number input (4 digits, no repeating digits)
-string isValidNumber(const string& number) {
-    if (number.length() != 4) {
-        return "Error: Number must be exactly 4 digits long.";
-    }
-
-    set<char> digits;
-    for (char ch : number) {
-        if (!isdigit(ch)) {
-            return "Error: Only numeric digits (0-9) are allowed.";
-        }
-        if (digits.find(ch) != digits.end()) {
-            return "Error: Digits must not repeat.";
-        }
-        digits.insert(ch);
-    }
-
-    return "Valid"; // If all checks pass, return "Valid"
-}
-
-
-
 // Function to display game statistics
 void DrawGameStatistics(int player1Turns, int player2Turns, bool gameOver, const string& feedbackMessage, int turnLimit) {
     if (!gameOver) return;
@@ -128,27 +143,28 @@ void DrawGameStatistics(int player1Turns, int player2Turns, bool gameOver, const
     int lineSpacing = 50;
 
     // Draw a card-like container
-    DrawRectangleRounded({ (float)(centerX - 300), (float)(startY - 50), 600, 400 }, 0.02f, 8, BLACK);
-    DrawRectangleRoundedLines({ (float)(centerX - 300), (float)(startY - 50), 600, 400 }, 0.02f, 8, 2, Fade(NEUTRAL_COLOR, 0.3f));
+    CountedDrawRectangleRounded({ (float)(centerX - 300), (float)(startY - 50), 600, 400 }, 0.02f, 8, BLACK);
+    CountedDrawRectangleRoundedLines({ (float)(centerX - 300), (float)(startY - 50), 600, 400 }, 0.02f, 8, 2, Fade(NEUTRAL_COLOR, 0.3f));
 
     // Title with shadow
-    DrawText("NumBrainer", centerX - MeasureText("NumBrainer", 40) / 2 + 3, 53, 40, Fade(BLACK, 0.2f));
-    DrawText("NumBrainer", centerX - MeasureText("NumBrainer", 40) / 2, 50, 40, PRIMARY_COLOR);
+    CountedDrawText("NumBrainer", centerX - MeasureText("NumBrainer", 40) / 2 + 3, 53, 40, Fade(BLACK, 0.2f));
+    CountedDrawText("NumBrainer", centerX - MeasureText("NumBrainer", 40) / 2, 50, 40, PRIMARY_COLOR);
 
     // Game Statistics header
-    DrawText("Game Statistics", centerX - MeasureText("Game Statistics", 40) / 2, startY, 40, PRIMARY_COLOR);
+    CountedDrawText("Game Statistics", centerX - MeasureText("Game Statistics", 40) / 2, startY, 40, PRIMARY_COLOR);
 
     // Player stats with modern styling
-    string p1Text = "Player 1 Turns: " + to_string(player1Turns) + "/" + to_string(turnLimit);
-    string p2Text = "Player 2 Turns: " + to_string(player2Turns) + "/" + to_string(turnLimit);
+    char p1Text[48], p2Text[48];
+    snprintf(p1Text, sizeof(p1Text), "Player 1 Turns: %d/%d", player1Turns, turnLimit);
+    snprintf(p2Text, sizeof(p2Text), "Player 2 Turns: %d/%d", player2Turns, turnLimit);
 
     // Player 1 stats box
-    DrawRectangleRounded({ (float)(centerX - 200), (float)(startY + lineSpacing), 400, 40 }, 0.2f, 8, Fade(PRIMARY_COLOR, 0.1f));
-    DrawText(p1Text.c_str(), centerX - MeasureText(p1Text.c_str(), 30) / 2, startY + lineSpacing + 5, 30, PRIMARY_COLOR);
+    CountedDrawRectangleRounded({ (float)(centerX - 200), (float)(startY + lineSpacing), 400, 40 }, 0.2f, 8, Fade(PRIMARY_COLOR, 0.1f));
+    CountedDrawText(p1Text, centerX - MeasureText(p1Text, 30) / 2, startY + lineSpacing + 5, 30, PRIMARY_COLOR);
 
     // Player 2 stats box
-    DrawRectangleRounded({ (float)(centerX - 200), (float)(startY + lineSpacing * 2), 400, 40 }, 0.2f, 8, Fade(SECONDARY_COLOR, 0.1f));
-    DrawText(p2Text.c_str(), centerX - MeasureText(p2Text.c_str(), 30) / 2, startY + lineSpacing * 2 + 5, 30, SECONDARY_COLOR);
+    CountedDrawRectangleRounded({ (float)(centerX - 200), (float)(startY + lineSpacing * 2), 400, 40 }, 0.2f, 8, Fade(SECONDARY_COLOR, 0.1f));
+    CountedDrawText(p2Text, centerX - MeasureText(p2Text, 30) / 2, startY + lineSpacing * 2 + 5, 30, SECONDARY_COLOR);
 
     // Result text with appropriate styling
     string resultText;
@@ -167,8 +183,8 @@ void DrawGameStatistics(int player1Turns, int player2Turns, bool gameOver, const
     }
 
     // Result box
-    DrawRectangleRounded({ (float)(centerX - 200), (float)(startY + lineSpacing * 3), 400, 40 }, 0.2f, 8, Fade(resultColor, 0.1f));
-    DrawText(resultText.c_str(), centerX - MeasureText(resultText.c_str(), 30) / 2, startY + lineSpacing * 3 + 5, 30, resultColor);
+    CountedDrawRectangleRounded({ (float)(centerX - 200), (float)(startY + lineSpacing * 3), 400, 40 }, 0.2f, 8, Fade(resultColor, 0.1f));
+    CountedDrawText(resultText.c_str(), centerX - MeasureText(resultText.c_str(), 30) / 2, startY + lineSpacing * 3 + 5, 30, resultColor);
 
     // Modern buttons at the bottom
     float buttonY = startY + lineSpacing * 4;
@@ -182,13 +198,13 @@ void DrawGameStatistics(int player1Turns, int player2Turns, bool gameOver, const
 
     // Reset button with hover effect
     Color resetColor = CheckCollisionPointRec(mousePoint, resetButton) ? BUTTON_HOVER_COLOR : BUTTON_COLOR;
-    DrawRectangleRounded(resetButton, 0.3f, 8, resetColor);
-    DrawText("Reset (R)", centerX - 180, buttonY + 10, 20, WHITE);
+    CountedDrawRectangleRounded(resetButton, 0.3f, 8, resetColor);
+    CountedDrawText("Reset (R)", centerX - 180, buttonY + 10, 20, WHITE);
 
     // Menu button with hover effect
     Color menuColor = CheckCollisionPointRec(mousePoint, menuButton) ? BUTTON_HOVER_COLOR : BUTTON_COLOR;
-    DrawRectangleRounded(menuButton, 0.3f, 8, menuColor);
-    DrawText("Menu (M)", centerX + 40, buttonY + 10, 20, WHITE);
+    CountedDrawRectangleRounded(menuButton, 0.3f, 8, menuColor);
+    CountedDrawText("Menu (M)", centerX + 40, buttonY + 10, 20, WHITE);
 
     // Handle button clicks in main game loop
     if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
@@ -204,30 +220,56 @@ void DrawGameStatistics(int player1Turns, int player2Turns, bool gameOver, const
 }
 
 
-void DrawModernInput(const char* label, const char* value, float x, float y, bool isActive) {
+// Function to draw the parts of an input field that do not change while typing
+void DrawModernInputFrame(const char* label, float x, float y, bool isActive) {
     // Draw label
-    DrawText(label, x, y, 20, NEUTRAL_COLOR);
+    CountedDrawText(label, x, y, 20, NEUTRAL_COLOR);
 
     // Input box
     Rectangle inputRect = { x, y + 30, 200, 40 };
-    DrawRectangleRounded(inputRect, 0.2f, 8, Fade(INPUT_BG, 0.5f));
+    CountedDrawRectangleRounded(inputRect, 0.2f, 8, Fade(INPUT_BG, 0.5f));
 
     // Bottom line (active indicator)
     if (isActive) {
-        DrawRectangleRounded(
+        CountedDrawRectangleRounded(
             { inputRect.x, inputRect.y + inputRect.height - 2, inputRect.width, 2 },
             1.0f, 1, PRIMARY_COLOR);
     }
+}
 
+// Function to draw what has been typed into an input field, and its cursor
+void DrawModernInputValue(const char* value, float x, float y, bool isActive) {
     // Input text
-    DrawText(value, x + 10, y + 40, 20, PRIMARY_COLOR);
+    CountedDrawText(value, x + 10, y + 40, 20, PRIMARY_COLOR);
 
     // Blinking cursor when active
     if (isActive && ((int)(GetTime() * 2) % 2)) {
-        DrawText("_", x + 10 + MeasureText(value, 20), y + 40, 20, PRIMARY_COLOR);
+        CountedDrawText("_", x + 10 + MeasureText(value, 20), y + 40, 20, PRIMARY_COLOR);
     }
 }
 
+// Function to draw a "label  < value >" selector; returns -1 or +1 when an
+// arrow is clicked, 0 otherwise
+int DrawSelector(const char* label, const char* value, float x, float y, Vector2 mousePoint) {
+    CountedDrawText(label, x, y + 8, 20, NEUTRAL_COLOR);
+
+    Rectangle leftBtn = { x + 130, y, 35, 35 };
+    Rectangle rightBtn = { x + 245, y, 35, 35 };
+    CountedDrawRectangleRounded(leftBtn, 0.3f, 8,
+        CheckCollisionPointRec(mousePoint, leftBtn) ? BUTTON_HOVER_COLOR : BUTTON_COLOR);
+    CountedDrawRectangleRounded(rightBtn, 0.3f, 8,
+        CheckCollisionPointRec(mousePoint, rightBtn) ? BUTTON_HOVER_COLOR : BUTTON_COLOR);
+    CountedDrawText("<", x + 142, y + 8, 20, WHITE);
+    CountedDrawText(">", x + 257, y + 8, 20, WHITE);
+    CountedDrawText(value, x + 205 - MeasureText(value, 20) / 2, y + 8, 20, PRIMARY_COLOR);
+
+    if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+        if (CheckCollisionPointRec(mousePoint, leftBtn)) return -1;
+        if (CheckCollisionPointRec(mousePoint, rightBtn)) return 1;
+    }
+    return 0;
+}
+
 void DrawFeedbackMessage(const char* message, float x, float y) {
     Color messageColor = NEUTRAL_COLOR;
     const char* icon = ">";
@@ -241,8 +283,197 @@ void DrawFeedbackMessage(const char* message, float x, float y) {
         icon = "*";
     }
 
-    DrawText(icon, x, y, 20, messageColor);
-    DrawText(message, x + 30, y, 20, messageColor);
+    CountedDrawText(icon, x, y, 20, messageColor);
+    CountedDrawText(message, x + 30, y, 20, messageColor);
+}
+
+// Static parts of a screen, baked into a texture and then redrawn with one
+// call. The key hashes everything the baked drawing depends on (player names,
+// messages and so on); the layer is baked again whenever it changes.
+struct ChromeLayer {
+    RenderTexture2D texture = {};
+    Rectangle area = {};
+    uint64_t key = 0;
+    bool baked = false;
+};
+
+// Function to mix a piece of text into a chrome key
+uint64_t HashText(uint64_t hash, const char* text) {
+    return fnv1a(hash, (const unsigned char*)text, strlen(text) + 1);
+}
+
+uint64_t HashText(uint64_t hash, const string& text) {
+    return fnv1a(hash, (const unsigned char*)text.c_str(), text.size() + 1);
+}
+
+// Function to mix a number into a chrome key
+uint64_t HashValue(uint64_t hash, long long value) {
+    return fnv1a(hash, (const unsigned char*)&value, sizeof(value));
+}
+
+// Function to bring a layer up to date. Returns true, with drawing redirected
+// into the layer (its area's corner at 0,0, cleared to the background), when
+// the caller must bake it again; the caller then draws it and calls EndChrome().
+bool BeginChrome(ChromeLayer& layer, uint64_t key, Rectangle area, Color background) {
+    if (layer.baked && layer.key == key && layer.area.width == area.width && layer.area.height == area.height) {
+        layer.area = area;
+        return false;
+    }
+    if (layer.texture.id != 0 && (layer.area.width != area.width || layer.area.height != area.height)) {
+        UnloadRenderTexture(layer.texture);
+        layer.texture = {};
+    }
+    if (layer.texture.id == 0) {
+        layer.texture = LoadRenderTexture((int)area.width, (int)area.height);
+    }
+    layer.area = area;
+    layer.key = key;
+    layer.baked = true;
+    BeginTextureMode(layer.texture);
+    ClearBackground(background);
+    return true;
+}
+
+// Function to bake a whole screen; the layer then also replaces ClearBackground()
+bool BeginChrome(ChromeLayer& layer, uint64_t key) {
+    return BeginChrome(layer, key, { 0, 0, (float)GetScreenWidth(), (float)GetScreenHeight() }, BACKGROUND_COLOR);
+}
+
+void EndChrome(const ChromeLayer& layer) {
+    // Blending translucent shapes also blends the texture's alpha, which would
+    // let the screen behind show through. Adding full alpha everywhere makes
+    // the layer opaque again without touching its colors.
+    BeginBlendMode(BLEND_ADD_COLORS);
+    CountedDrawRectangle(0, 0, (int)layer.area.width, (int)layer.area.height, { 0, 0, 0, 255 });
+    EndBlendMode();
+    EndTextureMode();
+}
+
+void DrawChrome(const ChromeLayer& layer) {
+    // Render textures are stored upside down, hence the negative height
+    CountedDrawTextureRec(layer.texture.texture, { 0, 0, layer.area.width, -layer.area.height },
+        { layer.area.x, layer.area.y }, WHITE);
+}
+
+void UnloadChrome(ChromeLayer& layer) {
+    if (layer.texture.id != 0) UnloadRenderTexture(layer.texture);
+    layer = ChromeLayer();
+}
+
+// Function to measure a string literal once per font size; the text is
+// recognised by its address, so this must not be used for built strings
+int MeasureTextCached(const char* text, int fontSize) {
+    struct Measurement {
+        const char* text;
+        int fontSize;
+        int width;
+    };
+    static Measurement cache[32];
+    static int cached = 0;
+    for (int i = 0; i < cached; i++) {
+        if (cache[i].text == text && cache[i].fontSize == fontSize) return cache[i].width;
+    }
+    int width = MeasureText(text, fontSize);
+    if (cached < 32) cache[cached++] = { text, fontSize, width };
+    return width;
+}
+
+// Function to draw the title and container shared by the in-game screens
+void DrawGameFrame(int screenWidth, int screenHeight) {
+    // Draw  title
+    CountedDrawText("NumBrainer", 253, 53, 50, Fade(BLACK, 0.2f));
+    CountedDrawText("NumBrainer", 250, 50, 50, PRIMARY_COLOR);
+
+    // Main game container
+    CountedDrawRectangleRounded({ 50, 90, (float)(screenWidth - 100), (float)(screenHeight - 140) }, 0.02f, 8, WHITE);
+    CountedDrawRectangleRoundedLines({ 50, 90, (float)(screenWidth - 100), (float)(screenHeight - 140) }, 0.02f, 8, 2,
+        Fade(NEUTRAL_COLOR, 0.3f));
+}
+
+// Function to draw the in-game reset button with its hover effect
+void DrawResetButton(Rectangle resetBtn, Vector2 mousePoint) {
+    Color resetColor = CheckCollisionPointRec(mousePoint, resetBtn) ?
+        BUTTON_HOVER_COLOR : BUTTON_COLOR;
+    CountedDrawRectangleRounded(resetBtn, 0.3f, 8, resetColor);
+    CountedDrawText("RESET", (int)resetBtn.x + 20, (int)resetBtn.y + 10, 20, WHITE);
+}
+
+// Function to check for any mouse or keyboard activity in the last input poll
+bool IsInputActive() {
+    Vector2 delta = GetMouseDelta();
+    if (delta.x != 0 || delta.y != 0 || GetMouseWheelMove() != 0) return true;
+    for (int button = MOUSE_BUTTON_LEFT; button <= MOUSE_BUTTON_MIDDLE; button++) {
+        if (IsMouseButtonDown(button) || IsMouseButtonReleased(button)) return true;
+    }
+    for (int key = KEY_SPACE; key <= KEY_KB_MENU; key++) {
+        if (IsKeyDown(key) || IsKeyReleased(key)) return true;
+    }
+    return false;
+}
+
+// Function to check whether a key types a character (the printable keys and
+// the keypad's digits and operators)
+bool KeyTypesText(int key) {
+    return (key >= KEY_SPACE && key <= KEY_GRAVE) || (key >= KEY_KP_0 && key <= KEY_KP_ADD);
+}
+
+// Function to move everything typed since the last poll into the queue.
+// The window keeps keys and characters in separate queues and forgets both
+// at the next poll, so both are read to the end. Each key that types text
+// is paired with the next character, which keeps the two in typing order;
+// characters left over (key repeat, input methods) follow as text alone.
+void DrainInput(InputQueue& input, double seenTime) {
+    input.clear();
+    int chars[InputQueue::CAPACITY];
+    int charCount = 0;
+    for (int text = GetCharPressed(); text != 0; text = GetCharPressed()) {
+        if (charCount < InputQueue::CAPACITY) chars[charCount++] = text;
+    }
+    // With a modifier held a key types nothing, so it must not take a character
+    bool modified = IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL) ||
+        IsKeyDown(KEY_LEFT_ALT) || IsKeyDown(KEY_RIGHT_ALT);
+    int nextChar = 0;
+    for (int key = GetKeyPressed(); key != 0; key = GetKeyPressed()) {
+        int text = !modified && KeyTypesText(key) && nextChar < charCount ? chars[nextChar++] : 0;
+        input.push(key, text, seenTime);
+    }
+    while (nextChar < charCount) {
+        input.push(0, chars[nextChar++], seenTime);
+    }
+}
+
+// Function to draw the profiling overlay: frame time, its recent median and
+// 99th percentile, draw calls, input latency the same way as frame time,
+// heap allocations when they are counted, and the time of each scope in the
+// last frame
+void DrawProfilerOverlay(const FrameProfiler& profiler) {
+    char line[96];
+    int top = profiler.countsAllocations() ? 94 : 78;
+    int height = top + 8 + profiler.scopeCount() * 16;
+    CountedDrawRectangle(5, 5, 250, height, Fade(BLACK, 0.7f));
+
+    snprintf(line, sizeof(line), "Frame %.2f ms (%d fps)", profiler.lastFrameMs(), GetFPS());
+    CountedDrawText(line, 12, 10, 10, WHITE);
+    snprintf(line, sizeof(line), "p50 %.2f ms  p99 %.2f ms",
+        profiler.percentileMs(0.50), profiler.percentileMs(0.99));
+    CountedDrawText(line, 12, 26, 10, WHITE);
+    snprintf(line, sizeof(line), "Draw calls %d%s", profiler.lastDrawCalls(),
+        profiler.isTracing() ? "  [tracing]" : "");
+    CountedDrawText(line, 12, 42, 10, profiler.isTracing() ? WARNING_COLOR : WHITE);
+    snprintf(line, sizeof(line), "Input p50 %.2f ms  p99 %.2f ms  (%d keys)",
+        profiler.inputLatencyPercentileMs(0.50), profiler.inputLatencyPercentileMs(0.99), profiler.inputCount());
+    CountedDrawText(line, 12, 58, 10, WHITE);
+    if (profiler.countsAllocations()) {
+        snprintf(line, sizeof(line), "Allocs %llu  (%d frames allocating)",
+            (unsigned long long)profiler.lastAllocations(), profiler.allocatingFrames());
+        CountedDrawText(line, 12, 74, 10, profiler.lastAllocations() > 0 ? WARNING_COLOR : WHITE);
+    }
+
+    for (int i = 0; i < profiler.scopeCount(); i++) {
+        const FrameProfiler::ScopeTotal& scope = profiler.scope(i);
+        snprintf(line, sizeof(line), "%-14s %7.3f ms", scope.name, scope.ms);
+        CountedDrawText(line, 12, top + i * 16, 10, Fade(WHITE, 0.8f));
+    }
 }
 
 #if defined(_WIN32)
@@ -258,27 +489,112 @@ int main(void)
     SetTargetFPS(60);
     SetExitKey(KEY_NULL);  // Disable default ESC key handling
 
+    // Baked static chrome: one layer for the current screen, one for the
+    // visible history rows
+    ChromeLayer screenChrome, historyChrome;
+
+    // Profiling overlay (F3) and trace streaming (F4)
+    bool profilerOverlay = false;
+
+    // Idle rendering (F5 toggles it): a frame is drawn only when there was
+    // input, something shown has changed, or an animation is running.
+    // Otherwise the loop sleeps and polls input, and the last frame stays up.
+    bool idleRendering = true;
+    uint64_t drawnStateKey = 0;
+    double lastDrawTime = -IDLE_REFRESH_INTERVAL;
+
+    // Keys typed since the last poll, and when that poll happened; a key
+    // counts as seen at the poll that delivered it
+    InputQueue input;
+    double lastPollTime = GetTime();
+    const char* tracePath = getenv("NUMBRAINER_TRACE");
+    if (tracePath && *tracePath) {
+        frameProfiler.startTrace(tracePath);
+    }
+
+    // Every match is appended to a record file (NUMBRAINER_RECORD names it;
+    // see engine/game_record.h for the format and tools/ for replaying it)
+    GameRecordWriter gameRecord;
+    const char* recordPath = getenv("NUMBRAINER_RECORD");
+    gameRecord.open(recordPath && *recordPath ? recordPath : RECORD_FILE);
+
+    // The match in progress is snapshotted after every event (and every
+    // second of its timer); an unfinished one left by the last run is
+    // offered on the start screen
+    SnapshotFile snapshotFile;
+    MatchSnapshot snapshot;
+    bool resumeOffered = snapshotFile.open(SNAPSHOT_FILE) && snapshotFile.load(snapshot) &&
+        snapshot.isUnfinished();
+
+    // Every finished local match updates both players' profiles; the store
+    // reads what its index does not cover in the background, and the start
+    // screen shows the leaderboard once that is done
+    PlayerStore players;
+    if (!players.open(PLAYER_LOG_FILE, PLAYER_INDEX_FILE)) {
+        // Not a log this build can read: kept aside, and a new one started
+        string keptPath = string(PLAYER_LOG_FILE) + ".unreadable";
+        remove(keptPath.c_str());
+        bool kept = rename(PLAYER_LOG_FILE, keptPath.c_str()) == 0;
+        remove(PLAYER_INDEX_FILE);
+        TraceLog(LOG_WARNING, "Player log %s cannot be read; %s", PLAYER_LOG_FILE,
+            kept ? "moved it aside and started a new one" : "could not move it aside, profiles are not kept");
+        if (kept) players.open(PLAYER_LOG_FILE, PLAYER_INDEX_FILE);
+    }
+    int matchesRecorded = 0;    // Keys the baked start screen and game-over card
+
+    // Spectator mode (NUMBRAINER_REPLAY names a record): the recorded matches
+    // are played back one after another at the pace they were played, their
+    // times shifted so each match starts when its playback does
+    MappedFile replayFile;
+    GameRecordReader replay(nullptr, 0);
+    bool spectating = false;
+    double replayShift = 0;
+    GameEvent replayEvent;
+    bool replayEventReady = false;
+    const char* replayPath = getenv("NUMBRAINER_REPLAY");
+    if (replayPath && *replayPath && replayFile.open(replayPath)) {
+        replay = GameRecordReader(replayFile.data(), replayFile.size());
+    }
+
+    // Online mode (NUMBRAINER_SERVER=host:port): the server runs the match,
+    // and this window only sends the local player's moves and shows the
+    // updates that come back. The secret numbers never reach it.
+    const char* serverAddress = getenv("NUMBRAINER_SERVER");
+    bool onlineOffered = serverAddress && *serverAddress;
+    MatchClient netClient;
+    bool online = false;
+    bool awaitingOpponent = false;   // Queued on the server for the next match
+    int onlineSeat = 0;              // 0 plays as player 1
+    string onlineName = "";
+
     // Game variables
-    string player1Number = "", player2Number = "";
+    GameState game;              // Rules state, only ever advanced through step()
+    SteadyClock matchClock;      // Drives the match; every event is stamped by the timer
+    TurnTimer turnTimer(matchClock);
+    StepResult stepResult;       // What the last step() did
+    // Secrets each player could still be facing, narrowed after every guess
+    CandidateSet player1Candidates, player2Candidates;
+    // The same for the other variants (the classic sets feed the hints)
+    VariantCandidates player1VariantCandidates, player2VariantCandidates;
+    GameVariant selectedVariant;  // Picked on the setup screen, fixed once the game starts
+    // Background hint search; only shown during the turn it was asked for
+    HintSearch hintSearch;
+    bool hintVisible = false;
+    int hintTurnNumber = 0;
+    HintMode hintMode = HintMode::Minimax;
+    // Single-player mode: the computer plays as Player 2
+    bool vsComputer = false;
+    ComputerPlayer computer;
     string guess = "";
     string feedbackMessage = "";
     string turnLimitInput = "";  // Input for number of turns
-    int turnLimit = 0;           // Number of turns for the round
-    int timeLimitPerTurn = 30;   // Set default time limit to 30 seconds
-    int player1Turns = 0, player2Turns = 0;
-    int correctDigits = 0, correctPositions = 0;
-    bool gameOver = false;
-    bool player1Turn = true;
-    bool settingUp = true;
-    bool settingTurnLimit = true;  // Variable to control turn limit setting
     bool startScreen = true;
     bool exitRequested = false;  // Add exit confirmation flag
     // Time limit feature variables
     int remainingTime = 0;  // Time left for the current player's turn
-    double startTime = 0;   // To track elapsed time per turn
 
-    // History vector to store feedback messages
-    vector<string> feedbackHistory;
+    // Feedback history, kept as records and only turned into text when drawn
+    MatchHistory feedbackHistory;
 
     // Button properties
     const int buttonWidth = 100;
@@ -292,16 +608,627 @@ int main(void)
     bool settingPlayer1Name = false;
     bool settingPlayer2Name = false;
 
+    // Text built during a frame comes from here and is dropped when the next
+    // frame starts; messages that outlive the frame are copied into strings
+    // whose capacity is reserved up front, so a steady frame never allocates
+    FrameArena frameArena;
+    feedbackMessage.reserve(128);
+
+    // Function to record what the last step() did as a history row
+    auto historyEntry = [&](HistoryKind kind, const GameEvent& event) {
+        HistoryEntry entry;
+        entry.kind = kind;
+        entry.code = event.code;
+        entry.time = (float)event.time;
+        entry.byPlayer1 = stepResult.byPlayer1;
+        entry.correctDigits = (uint8_t)stepResult.correctDigits;
+        entry.correctPositions = (uint8_t)stepResult.correctPositions;
+        return entry;
+    };
+
+    // Function to add an event to the match record once step() has accepted
+    // it; the turn limit opens the match (names and settings are known by
+    // then) and game over closes it. Spectated matches are not recorded
+    // again, and online ones are the server's to record.
+    auto recordEvent = [&](const GameEvent& event) {
+        if (spectating || online || stepResult.outcome == StepOutcome::Ignored ||
+            stepResult.outcome == StepOutcome::Rejected) {
+            return;
+        }
+        if (event.type == GameEventType::SetTurnLimit) {
+            MatchInfo info;
+            info.player1Name = player1Name;
+            info.player2Name = player2Name;
+            info.vsComputer = vsComputer;
+            info.ticksPerSecond = turnTimer.ticksPerSecond();
+            info.timeLimitPerTurn = game.timeLimitPerTurn;
+            info.startTime = event.time;
+            gameRecord.beginMatch(info);
+        }
+        gameRecord.recordEvent(event);
+        if (game.phase == GamePhase::GameOver) {
+            gameRecord.endMatch(event.time, MatchEnd::Finished);
+
+            int timeouts[2] = { 0, 0 };
+            // The history row for this event is pushed after it is recorded
+            for (int i = 0; i < feedbackHistory.size(); i++) {
+                if (feedbackHistory[i].kind == HistoryKind::TimedOut) timeouts[feedbackHistory[i].byPlayer1 ? 0 : 1]++;
+            }
+            if (stepResult.outcome == StepOutcome::TimedOut) timeouts[stepResult.byPlayer1 ? 0 : 1]++;
+            players.recordMatch(makePlayedMatch(game, player1Name, player2Name, timeouts[0], timeouts[1]));
+            matchesRecorded++;
+        }
+    };
+
+    // Function to save the match in progress to the snapshot file, or clear
+    // the file once there is none to resume (spectated and online matches
+    // are not saved)
+    auto persistMatch = [&]() {
+        if (spectating || online) return;
+        if (game.phase != GamePhase::SettingNumbers && game.phase != GamePhase::Guessing) {
+            snapshotFile.clear();
+            return;
+        }
+        captureMatch(snapshot, game, turnTimer.now(), feedbackHistory);
+        snapshot.vsComputer = vsComputer ? 1 : 0;
+        snapshot.difficulty = (uint8_t)computer.difficulty();
+        setSnapshotName(snapshot.player1Name, player1Name.c_str());
+        setSnapshotName(snapshot.player2Name, player2Name.c_str());
+        snapshotFile.save(snapshot);
+    };
+
+    // Function to start both players' candidate sets over for a new match
+    auto resetCandidates = [&]() {
+        player1Candidates.reset();
+        player2Candidates.reset();
+        player1VariantCandidates.reset(game.variant);
+        player2VariantCandidates.reset(game.variant);
+        // Room for every guess of the match, so scoring one never allocates
+        player1Candidates.reserveGuesses(game.turnLimit + 1);
+        player2Candidates.reserveGuesses(game.turnLimit + 1);
+        player1VariantCandidates.reserveGuesses(game.turnLimit + 1);
+        player2VariantCandidates.reserveGuesses(game.turnLimit + 1);
+    };
+
+    // Function to narrow the guessing player's candidates by a scored guess
+    auto applyToCandidates = [&](bool byPlayer1, PackedCode code, int correctDigits, int correctPositions) {
+        if (game.variant.isClassic()) {
+            (byPlayer1 ? player1Candidates : player2Candidates).applyGuess(code,
+                makeFeedback(correctDigits, correctPositions));
+        }
+        else {
+            (byPlayer1 ? player1VariantCandidates : player2VariantCandidates).applyGuess(code,
+                correctDigits, correctPositions);
+        }
+    };
+
+    // Function to report what became of the turn limit
+    auto reportTurnLimit = [&]() {
+        if (stepResult.outcome == StepOutcome::Rejected) {
+            feedbackMessage = stepResult.error;
+            turnLimitInput.clear(); // Clear invalid input
+        }
+        else {
+            feedbackMessage = frameArena.format("Player 1, set your %d-digit number.", game.variant.length);
+            remainingTime = game.timeLimitPerTurn;  // Set initial turn time
+        }
+    };
+
+    // Function to hand the turn limit and variant to the engine and report it
+    auto submitTurnLimit = [&](const GameEvent& event) {
+        game = step(game, event, &stepResult);
+        recordEvent(event);
+        persistMatch();
+        reportTurnLimit();
+    };
+
+    // Function to report a turn that ran out
+    auto reportTimeout = [&](const GameEvent& tick) {
+        feedbackMessage = frameArena.format("%s ran out of time!",
+            (stepResult.byPlayer1 ? player1Name : player2Name).c_str());
+        feedbackHistory.push(historyEntry(HistoryKind::TimedOut, tick));
+        guess.clear();
+
+        if (game.result == GameResult::Draw) {
+            feedbackMessage = "Turn limit reached! It's a draw.";
+        }
+    };
+
+    // Function to run out the current player's turn and report it
+    auto submitTimeout = [&](const GameEvent& tick) {
+        game = step(game, tick, &stepResult);
+        recordEvent(tick);
+        if (stepResult.outcome != StepOutcome::TimedOut) return false;
+        reportTimeout(tick);
+        persistMatch();
+        return true;
+    };
+
+    // Function to report what a secret or a guess did
+    auto reportNumber = [&](const GameEvent& event) {
+        switch (stepResult.outcome) {
+        case StepOutcome::Rejected:
+            feedbackMessage = stepResult.error;
+            break;
+        case StepOutcome::NumberSet:
+            if (game.phase == GamePhase::Guessing) {
+                feedbackMessage = "Game starts! Player 1's turn to guess.";
+                remainingTime = game.timeLimitPerTurn;
+                resetCandidates();
+            }
+            else {
+                feedbackMessage = frameArena.format("Player 2, set your %d-digit number.", game.variant.length);
+            }
+            break;
+        case StepOutcome::Won:
+            feedbackMessage = stepResult.byPlayer1 ? "Player 1 wins!" : "Player 2 wins!";
+            feedbackHistory.push(historyEntry(HistoryKind::Win, event));
+            break;
+        case StepOutcome::Scored:
+            applyToCandidates(stepResult.byPlayer1, event.code, stepResult.correctDigits, stepResult.correctPositions);
+            if (game.result == GameResult::Draw) {
+                feedbackMessage = "Turn limit reached! It's a draw.";
+            }
+            else {
+                char guessText[MAX_VARIANT_LENGTH + 1];
+                char line[128];
+                formatCode(event.code, game.variant, guessText);
+                feedbackMessage = describeGuess(line, sizeof(line),
+                    (stepResult.byPlayer1 ? player1Name : player2Name).c_str(), guessText,
+                    stepResult.correctDigits, stepResult.correctPositions);
+            }
+            feedbackHistory.push(historyEntry(
+                game.result == GameResult::Draw ? HistoryKind::Draw : HistoryKind::Guess, event));
+            break;
+        default:
+            break;
+        }
+    };
+
+    // Function to hand a secret or a guess, from either player, to the engine
+    // and report what it did
+    auto submitNumber = [&](const GameEvent& event) {
+        game = step(game, event, &stepResult);
+        recordEvent(event);
+        reportNumber(event);
+        // After the history row, so the snapshot includes it
+        persistMatch();
+    };
+
+    // Function to tell whether the local player is the one to move: always
+    // offline, and online only on their own turns (player 1 picks the rules)
+    auto isLocalTurn = [&]() {
+        if (!online) return true;
+        if (awaitingOpponent) return false;
+        if (game.phase == GamePhase::SettingTurnLimit) return onlineSeat == 0;
+        return game.player1Turn == (onlineSeat == 0);
+    };
+
+    // Function to apply what the server sent since the last frame; updates
+    // go through the same reporting as local steps, so the screens, history
+    // and candidate sets behave as they do offline
+    auto receiveFromServer = [&]() {
+        NetMessage message;
+        while (netClient.receive(message)) {
+            switch (message.type) {
+            case NetMessageType::Matched:
+                awaitingOpponent = false;
+                onlineSeat = message.seat;
+                player1Name = onlineSeat == 0 ? onlineName : message.text;
+                player2Name = onlineSeat == 0 ? message.text : onlineName;
+                game = GameState();
+                feedbackHistory.clear();
+                guess.clear();
+                turnLimitInput.clear();
+                feedbackMessage.clear();
+                break;
+            case NetMessageType::Update: {
+                const MatchUpdate& update = message.update;
+                applyUpdate(game, update, turnTimer.now());
+                stepResult = StepResult();
+                stepResult.outcome = update.outcome;
+                stepResult.byPlayer1 = update.byPlayer1;
+                stepResult.correctDigits = update.correctDigits;
+                stepResult.correctPositions = update.correctPositions;
+                GameEvent event;
+                event.time = turnTimer.now();
+                event.code = update.code;
+                switch (update.outcome) {
+                case StepOutcome::TurnLimitSet:
+                    reportTurnLimit();
+                    break;
+                case StepOutcome::TimedOut:
+                    reportTimeout(event);
+                    break;
+                case StepOutcome::NumberSet:
+                case StepOutcome::Scored:
+                case StepOutcome::Won:
+                    reportNumber(event);
+                    break;
+                default:
+                    break;
+                }
+                remainingTime = game.phase == GamePhase::Guessing ?
+                    turnTimeRemaining(game, turnTimer.now()) : game.timeLimitPerTurn;
+                break;
+            }
+            case NetMessageType::Rejected:
+                feedbackMessage = message.text;
+                if (game.phase == GamePhase::SettingTurnLimit) turnLimitInput.clear();
+                break;
+            case NetMessageType::OpponentLeft:
+                feedbackMessage = frameArena.format("%s left the match.",
+                    (onlineSeat == 0 ? player2Name : player1Name).c_str());
+                game.phase = GamePhase::GameOver;
+                break;
+            default:
+                break;
+            }
+        }
+        if (!netClient.isConnected() && game.phase != GamePhase::GameOver) {
+            feedbackMessage = "Lost the connection to the server.";
+            awaitingOpponent = false;
+            game.phase = GamePhase::GameOver;
+        }
+    };
+
+    // Function to pick up the snapshotted match where it stopped: the rules
+    // state and history come back as saved, the candidate sets are rebuilt
+    // from the history, and the current turn gets the time it had left
+    auto resumeMatch = [&]() {
+        ResetGame(startScreen, game, guess, feedbackMessage,
+            feedbackHistory, turnLimitInput, remainingTime,
+            player1Name, player2Name, settingPlayer1Name, settingPlayer2Name);
+        startScreen = false;
+        resumeOffered = false;
+        game = restoreMatch(snapshot, turnTimer.now(), feedbackHistory);
+        player1Name = snapshot.player1Name;
+        player2Name = snapshot.player2Name;
+        vsComputer = snapshot.vsComputer != 0;
+        computer.setDifficulty((Difficulty)snapshot.difficulty);
+
+        resetCandidates();
+        for (int i = 0; i < feedbackHistory.size(); i++) {
+            const HistoryEntry& entry = feedbackHistory[i];
+            if (entry.kind == HistoryKind::Guess) {
+                applyToCandidates(entry.byPlayer1, entry.code, entry.correctDigits, entry.correctPositions);
+            }
+        }
+        remainingTime = game.phase == GamePhase::Guessing ?
+            turnTimeRemaining(game, turnTimer.now()) : game.timeLimitPerTurn;
+        feedbackMessage = game.phase == GamePhase::Guessing ? "Match resumed." :
+            frameArena.format("Match resumed. %s, set your %d-digit number.",
+                (game.player1Turn ? player1Name : player2Name).c_str(), game.variant.length);
+    };
+
+    // Function to hash everything the current screen shows, so a change to
+    // any of it (a timer second, a message, the cursor blink) forces a frame
+    auto displayedStateKey = [&]() {
+        uint64_t key = HashValue(FNV_OFFSET, startScreen);
+        key = HashValue(key, exitRequested);
+        key = HashValue(key, settingPlayer1Name);
+        key = HashValue(key, settingPlayer2Name);
+        key = HashValue(key, vsComputer);
+        key = HashValue(key, awaitingOpponent);
+        key = HashValue(key, (int)game.phase);
+        key = HashValue(key, game.player1Turn);
+        key = HashValue(key, game.player1Turns);
+        key = HashValue(key, game.player2Turns);
+        key = HashValue(key, remainingTime);
+        key = HashText(key, guess);
+        key = HashText(key, turnLimitInput);
+        key = HashText(key, player1Name);
+        key = HashText(key, player2Name);
+        key = HashText(key, feedbackMessage);
+        key = HashValue(key, feedbackHistory.total());
+        key = HashValue(key, selectedVariant.length);
+        key = HashValue(key, selectedVariant.base);
+        key = HashValue(key, selectedVariant.repeats);
+        key = HashValue(key, (int)computer.difficulty());
+        key = HashValue(key, hintVisible);
+        key = HashValue(key, hintVisible && hintSearch.isRunning());
+        key = HashValue(key, frameProfiler.isTracing());
+        key = HashValue(key, players.ready());
+        key = HashValue(key, matchesRecorded);
+        // Every screen but the start screen and the game-over card has a blinking cursor
+        if (!startScreen && !exitRequested && game.phase != GamePhase::GameOver) {
+            key = HashValue(key, (int)(GetTime() * 2) % 2);
+        }
+        return key;
+    };
+
+    // Function to decide whether this loop iteration draws a frame
+    auto shouldDraw = [&](bool animating) {
+        if (!idleRendering || profilerOverlay || animating || !input.empty() || IsInputActive()) return true;
+        if (displayedStateKey() != drawnStateKey) return true;
+        return GetTime() - lastDrawTime >= IDLE_REFRESH_INTERVAL;
+    };
+
+    // Function to remember what the frame about to be drawn shows
+    auto markDrawn = [&]() {
+        drawnStateKey = displayedStateKey();
+        lastDrawTime = GetTime();
+    };
+
+    // Function to spend an iteration that draws nothing; EndDrawing() would
+    // normally poll the input, so it is polled here instead
+    auto idleWait = [&]() {
+        frameProfiler.skipFrame();
+        WaitTime(IDLE_POLL_INTERVAL);
+        PollInputEvents();
+        lastPollTime = GetTime();
+    };
+
+    // Function to record, once a frame is on screen, how long each key
+    // drained for it took to get there
+    auto recordInputLatency = [&]() {
+        double now = GetTime();
+        for (int i = 0; i < input.size(); i++) {
+            frameProfiler.recordInputLatency((now - input[i].time) * 1000.0);
+        }
+    };
+
+    // Function to handle a key on the name entry screens - only letters and space
+    auto handleNameKey = [&](const InputQueue::Event& key) {
+        string& currentName = settingPlayer1Name ? player1Name : player2Name;
+
+        // Letters keep the case they were typed in; a name cannot start with a space
+        bool letter = (key.text >= 'a' && key.text <= 'z') || (key.text >= 'A' && key.text <= 'Z');
+        if (currentName.length() < 12 && (letter || (key.text == ' ' && !currentName.empty()))) {
+            currentName += (char)key.text;
+        }
+
+        if (key.key == KEY_BACKSPACE && !currentName.empty()) {
+            currentName.pop_back();
+        }
+
+        // ENTER only if the name isn't empty and isn't just spaces
+        if (key.key == KEY_ENTER && !currentName.empty() &&
+            currentName.find_first_not_of(' ') != string::npos) {
+            if (settingPlayer1Name && online) {
+                // Online the other name comes from the server with the match
+                settingPlayer1Name = false;
+                onlineName = currentName;
+                awaitingOpponent = netClient.connect(serverAddress) && netClient.sendHello(onlineName.c_str());
+                if (awaitingOpponent) {
+                    feedbackMessage = "Waiting for an opponent...";
+                }
+                else {
+                    feedbackMessage = frameArena.format("Could not reach the server at %s.", serverAddress);
+                    game.phase = GamePhase::GameOver;
+                }
+            }
+            else if (settingPlayer1Name && vsComputer) {
+                // The computer needs no name entry; go straight to the setup
+                settingPlayer1Name = false;
+                player2Name = "Computer";
+                feedbackMessage.clear();
+                turnLimitInput.clear();
+            }
+            else if (settingPlayer1Name) {
+                settingPlayer1Name = false;
+                settingPlayer2Name = true;
+                feedbackMessage = "Enter Player 2's name (must be different from Player 1)";
+            }
+            else {
+                // Check if Player 2's name is the same as Player 1's
+                if (currentName == player1Name) {
+                    feedbackMessage = "Names must be different! Please choose another name.";
+                    currentName.clear();
+                }
+                else {
+                    settingPlayer2Name = false;
+                    feedbackMessage.clear();
+                    turnLimitInput.clear();
+                }
+            }
+        }
+    };
+
+    // Function to handle a key on the turn limit (and difficulty) screen
+    auto handleTurnLimitKey = [&](const InputQueue::Event& key) {
+        if (key.text >= '0' && key.text <= '9' && turnLimitInput.length() < 2) {
+            turnLimitInput += (char)key.text;
+        }
+        if (key.key == KEY_BACKSPACE && !turnLimitInput.empty()) {
+            turnLimitInput.pop_back();
+        }
+        // Difficulty is picked on the same screen in single-player games
+        if (vsComputer && key.key == KEY_LEFT && computer.difficulty() != Difficulty::Easy) {
+            computer.setDifficulty((Difficulty)((int)computer.difficulty() - 1));
+        }
+        if (vsComputer && key.key == KEY_RIGHT && computer.difficulty() != Difficulty::Hard) {
+            computer.setDifficulty((Difficulty)((int)computer.difficulty() + 1));
+        }
+        // An empty limit takes the variant's suggestion: enough turns for
+        // perfect play to always find the secret
+        int turnLimit = turnLimitInput.empty() ? suggestedTurnLimit(selectedVariant) : stoi(turnLimitInput);
+        if (key.key == KEY_ENTER && online) {
+            netClient.sendTurnLimit(turnLimit, selectedVariant);
+        }
+        else if (key.key == KEY_ENTER) {
+            GameEvent event;
+            event.type = GameEventType::SetTurnLimit;
+            event.time = turnTimer.now();
+            event.turnLimit = turnLimit;
+            event.variant = selectedVariant;
+            submitTurnLimit(event);
+        }
+    };
+
+    // Function to handle a key while a player types a secret number or a guess
+    auto handleNumberKey = [&](const InputQueue::Event& key) {
+        // Digits above 9 are typed as letters (A-F, either case)
+        int digit = key.text > 0 && key.text < 128 ? digitValue((char)key.text) : -1;
+        if (digit >= 0 && digit < game.variant.base && (int)guess.length() < game.variant.length) {
+            guess += digitChar(digit);
+        }
+        if (key.key == KEY_BACKSPACE && !guess.empty()) {
+            guess.pop_back();
+        }
+        // ENTER either sets a secret number or submits a guess, depending on the phase
+        if (key.key == KEY_ENTER && !guess.empty()) {
+            GameEvent event;
+            event.type = game.phase == GamePhase::SettingNumbers ?
+                GameEventType::SetNumber : GameEventType::Guess;
+            event.time = turnTimer.now();
+
+            // Validate and pack the typed number once, before it reaches the
+            // engine; online the server checks it again and has the last word
+            NumberStatus status = packNumber(guess, game.variant, event.code);
+            if (status != NumberStatus::Valid) {
+                char message[64];
+                stepResult = StepResult();
+                stepResult.outcome = StepOutcome::Rejected;
+                feedbackMessage = numberStatusMessage(status, game.variant, message, sizeof(message));
+            }
+            else if (online) {
+                netClient.sendNumber(event.type == GameEventType::SetNumber ?
+                    NetMessageType::SetNumber : NetMessageType::Guess, guess.c_str());
+            }
+            else {
+                submitNumber(event);
+            }
+            guess.clear();
+        }
+    };
+
+    // Function to start playing back the next recorded match; when the
+    // record has no more, spectating ends on the start screen
+    auto startReplayMatch = [&]() {
+        ResetGame(startScreen, game, guess, feedbackMessage,
+            feedbackHistory, turnLimitInput, remainingTime,
+            player1Name, player2Name, settingPlayer1Name, settingPlayer2Name);
+        MatchInfo info;
+        spectating = replay.nextMatch(info);
+        if (!spectating) return;
+        startScreen = false;
+        vsComputer = false;     // The computer's recorded moves are replayed too
+        player1Name = info.player1Name;
+        player2Name = info.player2Name;
+        game.timeLimitPerTurn = info.timeLimitPerTurn;
+        replayShift = turnTimer.now() - info.startTime;
+        replayEventReady = replay.nextEvent(replayEvent);
+    };
+
+    // Function to feed the recorded events that are due; a match that was
+    // reset moves straight on to the next one, a finished one stays on its
+    // game-over screen until it is dismissed
+    auto advanceReplay = [&]() {
+        while (replayEventReady && replayEvent.time + replayShift <= turnTimer.now()) {
+            GameEvent event = replayEvent;
+            event.time += replayShift;
+            switch (event.type) {
+            case GameEventType::SetTurnLimit:
+                submitTurnLimit(event);
+                break;
+            case GameEventType::Tick:
+                submitTimeout(event);
+                break;
+            default:
+                submitNumber(event);
+                break;
+            }
+            replayEventReady = replay.nextEvent(replayEvent);
+        }
+        if (!replayEventReady && game.phase != GamePhase::GameOver) {
+            startReplayMatch();
+        }
+    };
+
+    // Function to leave the current match, closing it in the record as
+    // abandoned; while spectating, anything but the menu plays the next match,
+    // and online, Reset after a match queues for another one
+    auto resetGame = [&](bool toMenu) {
+        if (online && !toMenu && game.phase == GamePhase::GameOver && netClient.isConnected()) {
+            awaitingOpponent = netClient.sendHello(onlineName.c_str());
+            game = GameState();
+            feedbackHistory.clear();
+            guess.clear();
+            feedbackMessage = "Waiting for an opponent...";
+            return;
+        }
+        // Leaving mid-match hands the opponent the end of it
+        netClient.close();
+        online = false;
+        awaitingOpponent = false;
+        gameRecord.endMatch(turnTimer.now(), MatchEnd::Reset);
+        if (!spectating) snapshotFile.clear();
+        if (spectating && !toMenu) {
+            startReplayMatch();
+            return;
+        }
+        spectating = false;
+        ResetGame(startScreen, game, guess, feedbackMessage,
+            feedbackHistory, turnLimitInput, remainingTime,
+            player1Name, player2Name, settingPlayer1Name, settingPlayer2Name);
+    };
+
+    // Function to hand each key of the frame, in order, to the screen that is
+    // active when it is reached; ESC opens the exit dialog, which then takes
+    // no more typing
+    auto routeInput = [&]() {
+        for (int i = 0; i < input.size() && !exitRequested; i++) {
+            const InputQueue::Event& key = input[i];
+            if (key.key == KEY_ESCAPE) {
+                exitRequested = true;
+            }
+            else if (startScreen || spectating) {
+                continue;   // Nothing to type into (yet)
+            }
+            else if (settingPlayer1Name || settingPlayer2Name) {
+                handleNameKey(key);
+            }
+            else if (!isLocalTurn()) {
+                continue;   // Online, the opponent is the one to move
+            }
+            else if (game.phase == GamePhase::SettingTurnLimit) {
+                handleTurnLimitKey(key);
+            }
+            else if (game.phase != GamePhase::GameOver && !(vsComputer && !game.player1Turn)) {
+                handleNumberKey(key);
+            }
+        }
+    };
+
+    if (replay.valid()) {
+        startReplayMatch();
+    }
+
+#if defined(NUMBRAINER_COUNT_ALLOCATIONS)
+    frameProfiler.setAllocationCounter([]() { return allocationStats().count; });
+#endif
+
     while (!WindowShouldClose() || exitRequested)  // Modified condition to prevent immediate exit
     {
+        frameProfiler.beginFrame();
+        frameArena.reset();
         Vector2 mousePoint = { (float)GetMouseX(), (float)GetMouseY() };
 
-        // Handle exit confirmation
-        if (IsKeyPressed(KEY_ESCAPE)) {
-            exitRequested = true;
+        if (IsKeyPressed(KEY_F3)) {
+            profilerOverlay = !profilerOverlay;
+        }
+        if (IsKeyPressed(KEY_F4)) {
+            if (frameProfiler.isTracing()) {
+                frameProfiler.stopTrace();
+            }
+            else {
+                frameProfiler.startTrace(TRACE_FILE);
+            }
+        }
+        if (IsKeyPressed(KEY_F5)) {
+            idleRendering = !idleRendering;
         }
 
+        // Typing goes to the screens (ESC included, which asks to exit)
+        frameProfiler.beginScope("input");
+        DrainInput(input, lastPollTime);
+        routeInput();
+        frameProfiler.endScope();
+
         if (exitRequested) {
+            ProfileScope exitScope(frameProfiler, "exit_dialog");
+
             // Define buttons first
             Rectangle yesBtn = { screenWidth/2 - 160, screenHeight/2 + 20, 140, 40 };
             Rectangle noBtn = { screenWidth/2 + 20, screenHeight/2 + 20, 140, 40 };
@@ -316,455 +1243,642 @@ int main(void)
                 exitRequested = false;
             }
 
+            if (!shouldDraw(false)) {
+                idleWait();
+                continue;
+            }
+            markDrawn();
             BeginDrawing();
-            ClearBackground(BACKGROUND_COLOR);
-            
-            // Draw semi-transparent overlay (reduced opacity)
-            DrawRectangle(0, 0, screenWidth, screenHeight, Fade(BLACK, 0.3f));
-            
-            // Draw confirmation dialog with modern styling
-            Rectangle dialogBox = { screenWidth/2 - 200, screenHeight/2 - 100, 400, 200 };
-            
-            // Main dialog box with gradient effect
-            DrawRectangleRounded(dialogBox, 0.02f, 8, WHITE);
-            DrawRectangleRoundedLines(dialogBox, 0.02f, 8, 2, Fade(NEUTRAL_COLOR, 0.3f));
-            
-            // Title with shadow effect
-            DrawText("Exit Game", 
-                screenWidth/2 - MeasureText("Exit Game", 30)/2 + 2,
-                screenHeight/2 - 80 + 2, 30, Fade(BLACK, 0.2f));  // Shadow
-            DrawText("Exit Game", 
-                screenWidth/2 - MeasureText("Exit Game", 30)/2,
-                screenHeight/2 - 80, 30, PRIMARY_COLOR);
-            
-            // Question text
-            DrawText("Are you sure you want to exit?",
-                screenWidth/2 - MeasureText("Are you sure you want to exit?", 20)/2,
-                screenHeight/2 - 30, 20, NEUTRAL_COLOR);
-            
+
+            // Everything but the two buttons is baked once
+            if (BeginChrome(screenChrome, HashText(FNV_OFFSET, "exit_dialog"))) {
+                // Draw semi-transparent overlay (reduced opacity)
+                CountedDrawRectangle(0, 0, screenWidth, screenHeight, Fade(BLACK, 0.3f));
+
+                // Draw confirmation dialog with modern styling
+                Rectangle dialogBox = { screenWidth/2 - 200, screenHeight/2 - 100, 400, 200 };
+
+                // Main dialog box with gradient effect
+                CountedDrawRectangleRounded(dialogBox, 0.02f, 8, WHITE);
+                CountedDrawRectangleRoundedLines(dialogBox, 0.02f, 8, 2, Fade(NEUTRAL_COLOR, 0.3f));
+
+                // Title with shadow effect
+                CountedDrawText("Exit Game",
+                    screenWidth/2 - MeasureText("Exit Game", 30)/2 + 2,
+                    screenHeight/2 - 80 + 2, 30, Fade(BLACK, 0.2f));  // Shadow
+                CountedDrawText("Exit Game",
+                    screenWidth/2 - MeasureText("Exit Game", 30)/2,
+                    screenHeight/2 - 80, 30, PRIMARY_COLOR);
+
+                // Question text
+                CountedDrawText("Are you sure you want to exit?",
+                    screenWidth/2 - MeasureText("Are you sure you want to exit?", 20)/2,
+                    screenHeight/2 - 30, 20, NEUTRAL_COLOR);
+                EndChrome(screenChrome);
+            }
+            DrawChrome(screenChrome);
+
             // Yes button (with hover effect)
             Color yesColor = (IsKeyDown(KEY_Y) || CheckCollisionPointRec(mousePoint, yesBtn)) ? 
                 BUTTON_HOVER_COLOR : BUTTON_COLOR;
-            DrawRectangleRounded(yesBtn, 0.3f, 8, yesColor);
-            DrawText("Yes (Y)",
-                screenWidth/2 - 160 + (140 - MeasureText("Yes (Y)", 20))/2,
+            CountedDrawRectangleRounded(yesBtn, 0.3f, 8, yesColor);
+            CountedDrawText("Yes (Y)",
+                screenWidth/2 - 160 + (140 - MeasureTextCached("Yes (Y)", 20))/2,
                 screenHeight/2 + 30, 20, WHITE);
             
             // No button (with hover effect)
             Color noColor = (IsKeyDown(KEY_N) || CheckCollisionPointRec(mousePoint, noBtn)) ? 
                 BUTTON_HOVER_COLOR : BUTTON_COLOR;
-            DrawRectangleRounded(noBtn, 0.3f, 8, noColor);
-            DrawText("No (N)",
-                screenWidth/2 + 20 + (140 - MeasureText("No (N)", 20))/2,
+            CountedDrawRectangleRounded(noBtn, 0.3f, 8, noColor);
+            CountedDrawText("No (N)",
+                screenWidth/2 + 20 + (140 - MeasureTextCached("No (N)", 20))/2,
                 screenHeight/2 + 30, 20, WHITE);
-            
+
+            if (profilerOverlay) {
+                DrawProfilerOverlay(frameProfiler);
+            }
             EndDrawing();
+            lastPollTime = GetTime();
+            recordInputLatency();
             continue;
         }
 
-        // Handle input for turn limit or game setup
-        if (settingTurnLimit && !gameOver) {
-            int key = GetCharPressed();
-            if (key >= '0' && key <= '9' && turnLimitInput.length() < 2) {
-                turnLimitInput += (char)key;
-            }
-            if (IsKeyPressed(KEY_BACKSPACE) && !turnLimitInput.empty()) {
-                turnLimitInput.pop_back();
-            }
-            if (IsKeyPressed(KEY_ENTER) && !turnLimitInput.empty()) {
-                int tempTurnLimit = stoi(turnLimitInput);
-                if (tempTurnLimit < 1) {
-                    feedbackMessage = "Turn limit must be at least 1. Try again:";
-                    turnLimitInput.clear(); // Clear invalid input
-                }
-                else {
-                    turnLimit = tempTurnLimit;
-                    settingTurnLimit = false;
-                    feedbackMessage = "Player 1, set your 4-digit number.";
-                    remainingTime = timeLimitPerTurn;  // Set initial turn time
-                }
-            }
+        // The computer's move and the turn timer; the screens below
+        // still handle their own clicks while they draw
+        frameProfiler.beginScope("update");
+
+        if (online) {
+            receiveFromServer();
         }
-        else if (!settingTurnLimit && !gameOver) {
-            int key = GetCharPressed();
-            if (key >= '0' && key <= '9' && guess.length() < 4) {
-                guess += (char)key;
+
+        // The computer sets its number right after Player 1, then on each of its
+        // turns polls its search and plays the guess once the search stops
+        if (vsComputer && !startScreen && !game.player1Turn) {
+            if (game.phase == GamePhase::SettingNumbers) {
+                GameEvent event;
+                event.type = GameEventType::SetNumber;
+                event.time = turnTimer.now();
+                event.code = computer.chooseSecret(game.variant);
+                submitNumber(event);
             }
-            if (IsKeyPressed(KEY_BACKSPACE) && !guess.empty()) {
-                guess.pop_back();
+            else if (game.phase == GamePhase::Guessing && !game.variant.isClassic()) {
+                // No search outside the classic game; picking a code is quick
+                GameEvent event;
+                event.type = GameEventType::Guess;
+                event.time = turnTimer.now();
+                event.code = computer.chooseVariantGuess(player2VariantCandidates);
+                submitNumber(event);
             }
-            // Add back the ENTER key handling for number setup and guessing
-            if (IsKeyPressed(KEY_ENTER) && !guess.empty()) {
-                string validationMessage = isValidNumber(guess);
-                if (validationMessage != "Valid") {
-                    feedbackMessage = validationMessage;
-                    guess.clear();
+            else if (game.phase == GamePhase::Guessing) {
+                GameEvent event;
+                if (!computer.isThinking()) {
+                    computer.startThinking(player2Candidates, turnTimeRemaining(game, turnTimer.now()));
                 }
-                else {
-                    if (settingUp) {
-                        if (player1Turn) {
-                            player1Number = guess;
-                            player1Turn = false;
-                            feedbackMessage = "Player 2, set your 4-digit number.";
-                        }
-                        else {
-                            player2Number = guess;
-                            settingUp = false;
-                            player1Turn = true;
-                            feedbackMessage = "Game starts! Player 1's turn to guess.";
-                            remainingTime = timeLimitPerTurn;
-                            startTime = GetTime();
-                        }
-                        guess.clear();
-                    }
-                    else {
-                        string target = player1Turn ? player2Number : player1Number;
-                        correctDigits = countCorrectDigits(guess, target);
-                        correctPositions = countCorrectPositions(guess, target);
-
-                        if (guess == target) {
-                            feedbackMessage = string(player1Turn ? "Player 1" : "Player 2") + string(" wins!");
-                            gameOver = true;
-                        }
-                        else {
-                            feedbackMessage = (player1Turn ? player1Name : player2Name);
-                            feedbackMessage += " guessed " + guess + ": " +  // Add the guess to the feedback
-                                to_string(correctDigits) + " correct digits, " +
-                                to_string(correctPositions) + " in position.";
-
-                            if (player1Turn) player1Turns++;
-                            else player2Turns++;
-
-                            if (player1Turns < turnLimit || player2Turns < turnLimit) {
-                                player1Turn = !player1Turn;
-                                startTime = GetTime();
-                                remainingTime = timeLimitPerTurn;
-                            }
-
-                            if (player1Turns >= turnLimit && player2Turns >= turnLimit) {
-                                feedbackMessage = "Turn limit reached! It's a draw.";
-                                gameOver = true;
-                            }
-                        }
-
-                        // Add to history with the feedback message
-                        feedbackHistory.push_back(feedbackMessage);
-                        guess.clear();
-                    }
+                else if (computer.pollGuess(event.code)) {
+                    event.type = GameEventType::Guess;
+                    event.time = turnTimer.now();
+                    submitNumber(event);
                 }
             }
         }
 
-        // Update timer if game is in progress (add this before BeginDrawing())
-        if (!gameOver && !settingTurnLimit && !settingUp && !startScreen) {
-            remainingTime = timeLimitPerTurn - (int)(GetTime() - startTime);
-
-            // Check if time ran out
-            if (remainingTime <= 0) {
-                if (player1Turn) player1Turns++;
-                else player2Turns++;
+        // A spectated match moves only by its recorded events, timeouts included
+        if (spectating) {
+            advanceReplay();
+        }
 
-                feedbackMessage = (player1Turn ? player1Name : player2Name) + string(" ran out of time!");
-                feedbackHistory.push_back(feedbackMessage);
+        // Expire every turn whose deadline has passed, each at its own tick,
+        // so a long stall expires as many turns as it covered
+        if (game.phase == GamePhase::Guessing && !startScreen) {
+            GameEvent tick;
+            // Online the server expires turns and says so
+            while (!spectating && !online && turnTimer.nextExpiry(game, tick) && submitTimeout(tick)) {}
+            int secondsLeft = game.phase == GamePhase::Guessing ?
+                turnTimeRemaining(game, turnTimer.now()) : game.timeLimitPerTurn;
+            // Each second of the timer is saved too, so a resumed turn loses
+            // at most a second of the time it had
+            bool secondPassed = secondsLeft != remainingTime;
+            remainingTime = secondsLeft;
+            if (secondPassed && game.phase == GamePhase::Guessing) {
+                persistMatch();
+            }
+        }
 
-                // Switch turns
-                player1Turn = !player1Turn;
-                startTime = GetTime();
-                remainingTime = timeLimitPerTurn;
-                guess.clear();
+        // A hint belongs to the turn it was asked for; drop it once play moves on
+        if (hintVisible && (game.phase != GamePhase::Guessing ||
+            hintTurnNumber != game.player1Turns + game.player2Turns)) {
+            hintSearch.cancel();
+            hintVisible = false;
+        }
+        // Likewise the computer stops thinking if its turn ends without a guess
+        if (computer.isThinking() && (game.phase != GamePhase::Guessing || game.player1Turn)) {
+            computer.stop();
+        }
+        frameProfiler.endScope();
 
-                // Check if game should end
-                if (player1Turns >= turnLimit && player2Turns >= turnLimit) {
-                    feedbackMessage = "Turn limit reached! It's a draw.";
-                    gameOver = true;
-                }
-            }
+        // The timer warning pulses, so it is drawn at the full frame rate
+        bool animating = !startScreen && game.phase == GamePhase::Guessing && remainingTime <= 5;
+        if (!shouldDraw(animating)) {
+            idleWait();
+            continue;
         }
+        markDrawn();
 
+        frameProfiler.beginScope("draw");
         BeginDrawing();
-        ClearBackground(BACKGROUND_COLOR);
 
+        // Each screen bakes its static chrome into screenChrome, which also
+        // stands in for clearing the background, then draws only the parts
+        // that change from frame to frame on top of it
         if (startScreen) {
-            // Modern title with shadow effect
-            DrawText("NumBrainer", 253, 203, 50, Fade(BLACK, 0.2f));  // Shadow
-            DrawText("NumBrainer", 250, 200, 50, PRIMARY_COLOR);
+            ProfileScope screenScope(frameProfiler, "start_screen");
 
-            // Stylish start button with hover effect
             int startButtonX = screenWidth / 2 - 100;
             int startButtonY = screenHeight / 2 - 25;
             int startButtonWidth = 200;
             int startButtonHeight = 50;
+            int computerButtonY = startButtonY + startButtonHeight + 15;
+
+            uint64_t chromeKey = HashText(FNV_OFFSET, "start_screen");
+            chromeKey = HashValue(chromeKey, players.ready());
+            chromeKey = HashValue(chromeKey, matchesRecorded);
+            if (BeginChrome(screenChrome, chromeKey)) {
+                // Modern title with shadow effect
+                CountedDrawText("NumBrainer", 253, 203, 50, Fade(BLACK, 0.2f));  // Shadow
+                CountedDrawText("NumBrainer", 250, 200, 50, PRIMARY_COLOR);
+
+                // Leaderboard in the left margin, once the store has caught up
+                // (until then a query would wait for it)
+                if (players.ready()) {
+                    vector<PlayerProfile> top;
+                    players.leaderboard(5, top);
+                    if (!top.empty()) {
+                        CountedDrawText("Top players", 30, startButtonY, 20, SECONDARY_COLOR);
+                    }
+                    for (size_t i = 0; i < top.size(); i++) {
+                        const char* row = frameArena.format("%d. %s  %d", (int)i + 1, top[i].name.c_str(),
+                            (int)lround(top[i].rating.value));
+                        CountedDrawText(row, 30, startButtonY + 30 + 24 * (int)i, 18, NEUTRAL_COLOR);
+                    }
+                }
+
+                // Add a subtle description
+                const char* descText = "A two-player number guessing game";
+                int descWidth = MeasureText(descText, 20);
+                CountedDrawText(descText,
+                    screenWidth / 2 - descWidth / 2,
+                    screenHeight / 2 + 130,
+                    20, NEUTRAL_COLOR);
+                EndChrome(screenChrome);
+            }
+            DrawChrome(screenChrome);
 
+            // Stylish start button with hover effect
             bool isOverStartButton = IsMouseOverButton((int)mousePoint.x, (int)mousePoint.y,
                 startButtonX, startButtonY,
                 startButtonWidth, startButtonHeight);
 
             // Draw button with hover effect
             Color currentButtonColor = isOverStartButton ? BUTTON_HOVER_COLOR : BUTTON_COLOR;
-            DrawRectangleRounded({ (float)startButtonX, (float)startButtonY,
+            CountedDrawRectangleRounded({ (float)startButtonX, (float)startButtonY,
                                  (float)startButtonWidth, (float)startButtonHeight },
                 0.3f, 8, currentButtonColor);
 
             // Center the text in the button
-            const char* startText = "START GAME";
-            int textWidth = MeasureText(startText, 24);
-            DrawText(startText,
+            const char* startText = onlineOffered ? "PLAY ONLINE" : "START GAME";
+            int textWidth = MeasureTextCached(startText, 24);
+            CountedDrawText(startText,
                 startButtonX + (startButtonWidth - textWidth) / 2,
                 startButtonY + 12,
                 24, WHITE);
 
-            // Add a subtle description
-            const char* descText = "A two-player number guessing game";
-            int descWidth = MeasureText(descText, 20);
-            DrawText(descText,
-                screenWidth / 2 - descWidth / 2,
-                screenHeight / 2 + 60,
-                20, NEUTRAL_COLOR);
+            // Single-player button just below, same size
+            bool isOverComputerButton = IsMouseOverButton((int)mousePoint.x, (int)mousePoint.y,
+                startButtonX, computerButtonY,
+                startButtonWidth, startButtonHeight);
+            CountedDrawRectangleRounded({ (float)startButtonX, (float)computerButtonY,
+                                 (float)startButtonWidth, (float)startButtonHeight },
+                0.3f, 8, isOverComputerButton ? BUTTON_HOVER_COLOR : BUTTON_COLOR);
+            const char* computerText = "VS COMPUTER";
+            CountedDrawText(computerText,
+                startButtonX + (startButtonWidth - MeasureTextCached(computerText, 24)) / 2,
+                computerButtonY + 12,
+                24, WHITE);
 
-            if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && isOverStartButton) {
+            // Resume button, below the description, when the last run left a
+            // match unfinished
+            bool isOverResumeButton = false;
+            if (resumeOffered) {
+                int resumeButtonY = screenHeight / 2 + 170;
+                isOverResumeButton = IsMouseOverButton((int)mousePoint.x, (int)mousePoint.y,
+                    startButtonX, resumeButtonY, startButtonWidth, startButtonHeight);
+                CountedDrawRectangleRounded({ (float)startButtonX, (float)resumeButtonY,
+                                     (float)startButtonWidth, (float)startButtonHeight },
+                    0.3f, 8, isOverResumeButton ? BUTTON_HOVER_COLOR : SECONDARY_COLOR);
+                const char* resumeText = "RESUME MATCH";
+                CountedDrawText(resumeText,
+                    startButtonX + (startButtonWidth - MeasureTextCached(resumeText, 24)) / 2,
+                    resumeButtonY + 12,
+                    24, WHITE);
+                const char* resumeInfo = frameArena.format("%s vs %s, turn %d of %d",
+                    snapshot.player1Name, snapshot.player2Name,
+                    max(snapshot.player1Turns, snapshot.player2Turns) + 1, snapshot.turnLimit);
+                CountedDrawText(resumeInfo, screenWidth / 2 - MeasureText(resumeInfo, 16) / 2,
+                    resumeButtonY + startButtonHeight + 8, 16, NEUTRAL_COLOR);
+            }
+
+            if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && isOverResumeButton) {
+                resumeMatch();
+            }
+            else if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && (isOverStartButton || isOverComputerButton)) {
                 startScreen = false;
                 settingPlayer1Name = true;  // Start with player 1's name
+                vsComputer = isOverComputerButton;
+                online = onlineOffered && !vsComputer;
             }
         }
         else if (settingPlayer1Name || settingPlayer2Name) {
+            ProfileScope screenScope(frameProfiler, "name_entry");
             string& currentName = settingPlayer1Name ? player1Name : player2Name;
 
-            // Handle keyboard input for names - only letters and space
-            int key = GetKeyPressed();
-
-            // Handle letters (both uppercase and lowercase)
-            if (currentName.length() < 12) {
-                // Handle uppercase letters
-                if (key >= KEY_A && key <= KEY_Z) {
-                    // Add uppercase if shift is pressed, lowercase otherwise
-                    if (IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT)) {
-                        currentName += (char)('A' + (key - KEY_A));
-                    }
-                    else {
-                        currentName += (char)('a' + (key - KEY_A));
-                    }
-                }
-                // Handle space
-                else if (key == KEY_SPACE && !currentName.empty()) {  // Prevent starting with space
-                    currentName += ' ';
+            // Draw name input screen; only the name and cursor change while typing
+            Color promptColor = settingPlayer1Name ? PRIMARY_COLOR : SECONDARY_COLOR;
+            uint64_t chromeKey = HashText(FNV_OFFSET, online ? "name_entry_online" :
+                settingPlayer1Name ? "name_entry_1" : "name_entry_2");
+            chromeKey = HashText(chromeKey, feedbackMessage);
+            if (BeginChrome(screenChrome, chromeKey)) {
+                CountedDrawText("NumBrainer", screenWidth / 2 - MeasureText("NumBrainer", 50) / 2, 100, 50, PRIMARY_COLOR);
+
+                const char* prompt = online ? "Enter Your Name" :
+                    settingPlayer1Name ? "Enter Player 1's Name" : "Enter Player 2's Name";
+                CountedDrawText(prompt,
+                    screenWidth / 2 - MeasureText(prompt, 30) / 2,
+                    200, 30, promptColor);
+
+                // Draw input box
+                Rectangle inputBox = { screenWidth / 2 - 150, 250, 300, 40 };
+                CountedDrawRectangleRounded(inputBox, 0.2f, 8, Fade(INPUT_BG, 0.5f));
+
+                // Draw feedback message if it exists
+                if (!feedbackMessage.empty()) {
+                    CountedDrawText(feedbackMessage.c_str(),
+                        screenWidth / 2 - MeasureText(feedbackMessage.c_str(), 20) / 2,
+                        320, 20, WARNING_COLOR);
                 }
-            }
-
-            // Handle backspace
-            if (IsKeyPressed(KEY_BACKSPACE) && !currentName.empty()) {
-                currentName.pop_back();
-            }
 
-            // Handle enter key - only if name isn't empty and isn't just spaces
-            if (IsKeyPressed(KEY_ENTER) && !currentName.empty() &&
-                currentName.find_first_not_of(' ') != string::npos) {
-                if (settingPlayer1Name) {
-                    settingPlayer1Name = false;
-                    settingPlayer2Name = true;
-                    feedbackMessage = "Enter Player 2's name (must be different from Player 1)";
-                }
-                else {
-                    // Check if Player 2's name is the same as Player 1's
-                    if (currentName == player1Name) {
-                        feedbackMessage = "Names must be different! Please choose another name.";
-                        currentName.clear();
-                    }
-                    else {
-                        settingPlayer2Name = false;
-                        settingTurnLimit = true;
-                        feedbackMessage.clear();
-                        while (GetKeyPressed() != 0) {} // Clear key buffer
-                        turnLimitInput.clear();
-                    }
-                }
+                // Draw instruction
+                CountedDrawText("Press ENTER to confirm",
+                    screenWidth / 2 - MeasureText("Press ENTER to confirm", 20) / 2,
+                    360, 20, NEUTRAL_COLOR);
+                EndChrome(screenChrome);
             }
-
-            // Draw name input screen
-            DrawText("NumBrainer", screenWidth / 2 - MeasureText("NumBrainer", 50) / 2, 100, 50, PRIMARY_COLOR);
-
-            string prompt = settingPlayer1Name ? "Enter Player 1's Name" : "Enter Player 2's Name";
-            Color promptColor = settingPlayer1Name ? PRIMARY_COLOR : SECONDARY_COLOR;
-            DrawText(prompt.c_str(),
-                screenWidth / 2 - MeasureText(prompt.c_str(), 30) / 2,
-                200, 30, promptColor);
-
-            // Draw input box
-            Rectangle inputBox = { screenWidth / 2 - 150, 250, 300, 40 };
-            DrawRectangleRounded(inputBox, 0.2f, 8, Fade(INPUT_BG, 0.5f));
+            DrawChrome(screenChrome);
 
             // Draw current name
-            DrawText(currentName.c_str(),
-                screenWidth / 2 - MeasureText(currentName.c_str(), 20) / 2,
+            int nameWidth = MeasureText(currentName.c_str(), 20);
+            CountedDrawText(currentName.c_str(),
+                screenWidth / 2 - nameWidth / 2,
                 260, 20, promptColor);
 
             // Draw blinking cursor
             if ((int)(GetTime() * 2) % 2) {
-                DrawText("_",
-                    screenWidth / 2 - MeasureText(currentName.c_str(), 20) / 2 +
-                    MeasureText(currentName.c_str(), 20),
+                CountedDrawText("_",
+                    screenWidth / 2 - nameWidth / 2 + nameWidth,
                     260, 20, promptColor);
             }
+        }
+        else if (game.phase != GamePhase::GameOver && !isLocalTurn() && game.phase != GamePhase::Guessing) {
+            ProfileScope screenScope(frameProfiler, "online_wait");
+
+            // Online, while queued or while the opponent picks the rules or
+            // their number; the guessing screen has its own waiting state
+            if (!awaitingOpponent && game.phase == GamePhase::SettingTurnLimit) {
+                feedbackMessage = frameArena.format("Waiting for %s to pick the rules...", player1Name.c_str());
+            }
+            else if (!awaitingOpponent) {
+                feedbackMessage = frameArena.format("Waiting for %s to set their number...",
+                    (game.player1Turn ? player1Name : player2Name).c_str());
+            }
+            uint64_t chromeKey = HashText(FNV_OFFSET, "online_wait");
+            chromeKey = HashText(chromeKey, feedbackMessage);
+            if (BeginChrome(screenChrome, chromeKey)) {
+                DrawGameFrame(screenWidth, screenHeight);
+                const char* title = awaitingOpponent ? "Online Match" :
+                    frameArena.format("%s vs %s", player1Name.c_str(), player2Name.c_str());
+                CountedDrawText(title, screenWidth / 2 - MeasureText(title, 30) / 2, 110, 30, PRIMARY_COLOR);
+                CountedDrawText(feedbackMessage.c_str(), screenWidth / 2 - MeasureText(feedbackMessage.c_str(), 20) / 2,
+                    250, 20, NEUTRAL_COLOR);
+                EndChrome(screenChrome);
+            }
+            DrawChrome(screenChrome);
+
+            // Reset leaves the queue or the match
+            Rectangle resetBtn = { (float)(screenWidth - 120), 20, 100, 40 };
+            DrawResetButton(resetBtn, mousePoint);
+            if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && CheckCollisionPointRec(mousePoint, resetBtn)) {
+                resetGame(true);
+            }
+        }
+        else if (game.phase == GamePhase::GameOver) {
+            ProfileScope screenScope(frameProfiler, "game_over");
+
+            // Everything but the two buttons stays put until the next game
+            uint64_t chromeKey = HashText(FNV_OFFSET, "game_over");
+            chromeKey = HashText(chromeKey, player1Name);
+            chromeKey = HashText(chromeKey, player2Name);
+            chromeKey = HashText(chromeKey, feedbackMessage);
+            chromeKey = HashValue(chromeKey, game.player1Turns);
+            chromeKey = HashValue(chromeKey, game.player2Turns);
+            chromeKey = HashValue(chromeKey, game.turnLimit);
+            chromeKey = HashValue(chromeKey, matchesRecorded);
+            if (BeginChrome(screenChrome, chromeKey)) {
+                // Card container
+                CountedDrawRectangleRounded({ screenWidth / 2 - 250, 100, 500, 400 }, 0.02f, 8, WHITE);
+                CountedDrawRectangleRoundedLines({ screenWidth / 2 - 250, 100, 500, 400 }, 0.02f, 8, 2,
+                    ColorAlpha(NEUTRAL_COLOR, 0.3f));
+
+                // Title with shadow effect
+                CountedDrawText("Game Over!", screenWidth / 2 - MeasureText("Game Over!", 40) / 2 + 3, 53, 40,
+                    Fade(BLACK, 0.2f));
+                CountedDrawText("Game Over!", screenWidth / 2 - MeasureText("Game Over!", 40) / 2, 50, 40,
+                    PRIMARY_COLOR);
+
+                // Statistics
+                const char* p1Stats = frameArena.format("%s's Turns: %d/%d", player1Name.c_str(),
+                    game.player1Turns, game.turnLimit);
+                const char* p2Stats = frameArena.format("%s's Turns: %d/%d", player2Name.c_str(),
+                    game.player2Turns, game.turnLimit);
+
+                // Player 1 stats
+                CountedDrawRectangleRounded({ screenWidth / 2 - 200, 180, 400, 40 }, 0.2f, 8,
+                    Fade(PRIMARY_COLOR, 0.1f));
+                CountedDrawText(p1Stats, screenWidth / 2 - MeasureText(p1Stats, 30) / 2, 185, 30,
+                    PRIMARY_COLOR);
+
+                // Player 2 stats
+                CountedDrawRectangleRounded({ screenWidth / 2 - 200, 240, 400, 40 }, 0.2f, 8,
+                    Fade(SECONDARY_COLOR, 0.1f));
+                CountedDrawText(p2Stats, screenWidth / 2 - MeasureText(p2Stats, 30) / 2, 245, 30,
+                    SECONDARY_COLOR);
+
+                // Career so far, under each player's bar
+                const string* names[2] = { &player1Name, &player2Name };
+                for (int p = 0; p < 2; p++) {
+                    PlayerProfile profile;
+                    if (online || !players.find(*names[p], profile)) continue;
+                    const char* career = frameArena.format(
+                        "%dW %dD %dL, %.1f guesses a match, rating %d (#%d of %d)",
+                        profile.wins, profile.draws, profile.losses(), profile.averageGuesses(),
+                        (int)lround(profile.rating.value), players.rankOf(*names[p]), players.playerCount());
+                    CountedDrawText(career, screenWidth / 2 - MeasureText(career, 14) / 2, 222 + 60 * p, 14, NEUTRAL_COLOR);
+                }
 
-            // Draw feedback message if it exists
-            if (!feedbackMessage.empty()) {
-                DrawText(feedbackMessage.c_str(),
-                    screenWidth / 2 - MeasureText(feedbackMessage.c_str(), 20) / 2,
-                    320, 20, WARNING_COLOR);
-            }
-
-            // Draw instruction
-            DrawText("Press ENTER to confirm",
-                screenWidth / 2 - MeasureText("Press ENTER to confirm", 20) / 2,
-                360, 20, NEUTRAL_COLOR);
-        }
-        else if (gameOver) {
-            // Card container
-            DrawRectangleRounded({ screenWidth / 2 - 250, 100, 500, 400 }, 0.02f, 8, WHITE);
-            DrawRectangleRoundedLines({ screenWidth / 2 - 250, 100, 500, 400 }, 0.02f, 8, 2,
-                ColorAlpha(NEUTRAL_COLOR, 0.3f));
-
-            // Title with shadow effect
-            DrawText("Game Over!", screenWidth / 2 - MeasureText("Game Over!", 40) / 2 + 3, 53, 40,
-                Fade(BLACK, 0.2f));
-            DrawText("Game Over!", screenWidth / 2 - MeasureText("Game Over!", 40) / 2, 50, 40,
-                PRIMARY_COLOR);
-
-            // Statistics
-            string p1Stats = player1Name + "'s Turns: " + to_string(player1Turns) + "/" + to_string(turnLimit);
-            string p2Stats = player2Name + "'s Turns: " + to_string(player2Turns) + "/" + to_string(turnLimit);
-
-            // Player 1 stats
-            DrawRectangleRounded({ screenWidth / 2 - 200, 180, 400, 40 }, 0.2f, 8,
-                Fade(PRIMARY_COLOR, 0.1f));
-            DrawText(p1Stats.c_str(), screenWidth / 2 - MeasureText(p1Stats.c_str(), 30) / 2, 185, 30,
-                PRIMARY_COLOR);
-
-            // Player 2 stats
-            DrawRectangleRounded({ screenWidth / 2 - 200, 240, 400, 40 }, 0.2f, 8,
-                Fade(SECONDARY_COLOR, 0.1f));
-            DrawText(p2Stats.c_str(), screenWidth / 2 - MeasureText(p2Stats.c_str(), 30) / 2, 245, 30,
-                SECONDARY_COLOR);
-
-            // Result text
-            Color resultColor = feedbackMessage.find("Player 1 wins") != string::npos ? PRIMARY_COLOR :
-                              feedbackMessage.find("Player 2 wins") != string::npos ? SECONDARY_COLOR :
-                              NEUTRAL_COLOR;
-            DrawText(feedbackMessage.c_str(),
-                screenWidth / 2 - MeasureText(feedbackMessage.c_str(), 30) / 2,
-                320, 30, resultColor);
+                // Result text
+                Color resultColor = feedbackMessage.find("Player 1 wins") != string::npos ? PRIMARY_COLOR :
+                                  feedbackMessage.find("Player 2 wins") != string::npos ? SECONDARY_COLOR :
+                                  NEUTRAL_COLOR;
+                CountedDrawText(feedbackMessage.c_str(),
+                    screenWidth / 2 - MeasureText(feedbackMessage.c_str(), 30) / 2,
+                    320, 30, resultColor);
+                EndChrome(screenChrome);
+            }
+            DrawChrome(screenChrome);
 
             // Buttons
             // Reset button
             Rectangle resetBtn = { screenWidth / 2 - 210, 400, 200, 40 };
             Color resetColor = CheckCollisionPointRec(mousePoint, resetBtn) ?
                 BUTTON_HOVER_COLOR : BUTTON_COLOR;
-            DrawRectangleRounded(resetBtn, 0.3f, 8, resetColor);
-            DrawText("Reset (R)", screenWidth / 2 - 180, 410, 20, WHITE);
+            CountedDrawRectangleRounded(resetBtn, 0.3f, 8, resetColor);
+            CountedDrawText("Reset (R)", screenWidth / 2 - 180, 410, 20, WHITE);
 
             // Menu button
             Rectangle menuBtn = { screenWidth / 2 + 10, 400, 200, 40 };
             Color menuColor = CheckCollisionPointRec(mousePoint, menuBtn) ?
                 BUTTON_HOVER_COLOR : BUTTON_COLOR;
-            DrawRectangleRounded(menuBtn, 0.3f, 8, menuColor);
-            DrawText("Menu (M)", screenWidth / 2 + 40, 410, 20, WHITE);
+            CountedDrawRectangleRounded(menuBtn, 0.3f, 8, menuColor);
+            CountedDrawText("Menu (M)", screenWidth / 2 + 40, 410, 20, WHITE);
 
             // Handle button clicks
             if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
                 if (CheckCollisionPointRec(mousePoint, resetBtn)) {
-                    ResetGame(startScreen, player1Number, player2Number, guess, feedbackMessage,
-                        player1Turn, settingUp, settingTurnLimit, gameOver,
-                        feedbackHistory, player1Turns, player2Turns, turnLimitInput, remainingTime,
-                        player1Name, player2Name, settingPlayer1Name, settingPlayer2Name);
+                    resetGame(false);
                 }
                 else if (CheckCollisionPointRec(mousePoint, menuBtn)) {
-                    startScreen = true;
-                    ResetGame(startScreen, player1Number, player2Number, guess, feedbackMessage,
-                        player1Turn, settingUp, settingTurnLimit, gameOver,
-                        feedbackHistory, player1Turns, player2Turns, turnLimitInput, remainingTime,
-                        player1Name, player2Name, settingPlayer1Name, settingPlayer2Name);
+                    resetGame(true);
                 }
             }
         }
         else {
-            // Draw  title
-            DrawText("NumBrainer", 253, 53, 50, Fade(BLACK, 0.2f));
-            DrawText("NumBrainer", 250, 50, 50, PRIMARY_COLOR);
-
-            // Add reset button in top-right corner
+            // Reset button in the top-right corner, drawn over each phase's chrome
             Rectangle resetBtn = { (float)(screenWidth - 120), 20, 100, 40 };
-            Color resetColor = CheckCollisionPointRec(mousePoint, resetBtn) ?
-                BUTTON_HOVER_COLOR : BUTTON_COLOR;
-            DrawRectangleRounded(resetBtn, 0.3f, 8, resetColor);
-            DrawText("RESET", screenWidth - 100, 30, 20, WHITE);
-
-            // Handle reset button click
-            if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) &&
-                CheckCollisionPointRec(mousePoint, resetBtn)) {
-                ResetGame(startScreen, player1Number, player2Number, guess, feedbackMessage,
-                    player1Turn, settingUp, settingTurnLimit, gameOver,
-                    feedbackHistory, player1Turns, player2Turns, turnLimitInput, remainingTime,
-                    player1Name, player2Name, settingPlayer1Name, settingPlayer2Name);
-            }
-
-            // Main game container
-            DrawRectangleRounded({ 50, 90, screenWidth - 100, screenHeight - 140 }, 0.02f, 8, WHITE);
-            DrawRectangleRoundedLines({ 50, 90, screenWidth - 100, screenHeight - 140 }, 0.02f, 8, 2,
-                Fade(NEUTRAL_COLOR, 0.3f));
-
-            if (settingTurnLimit) {
-                DrawText("Game Setup", screenWidth / 2 - MeasureText("Game Setup", 40) / 2, 110, 40, PRIMARY_COLOR);
-                DrawModernInput("Number of turns per player", turnLimitInput.c_str(), 100, 180, true);
-                DrawText("Press ENTER to confirm", 100, 280, 20, NEUTRAL_COLOR);
+            bool resetClicked = IsMouseButtonPressed(MOUSE_LEFT_BUTTON) &&
+                CheckCollisionPointRec(mousePoint, resetBtn);
+
+            if (game.phase == GamePhase::SettingTurnLimit) {
+                ProfileScope screenScope(frameProfiler, "setup");
+
+                uint64_t chromeKey = HashText(FNV_OFFSET, "setup");
+                chromeKey = HashText(chromeKey, feedbackMessage);
+                chromeKey = HashText(chromeKey, vsComputer ? difficultyName(computer.difficulty()) : "");
+                chromeKey = HashValue(chromeKey, selectedVariant.length);
+                chromeKey = HashValue(chromeKey, selectedVariant.base);
+                chromeKey = HashValue(chromeKey, selectedVariant.repeats);
+                if (BeginChrome(screenChrome, chromeKey)) {
+                    DrawGameFrame(screenWidth, screenHeight);
+                    CountedDrawText("Game Setup", screenWidth / 2 - MeasureText("Game Setup", 40) / 2, 110, 40, PRIMARY_COLOR);
+                    DrawModernInputFrame("Number of turns per player", 100, 180, true);
+                    const char* confirmText = frameArena.format("Press ENTER (empty: %d turns)",
+                        suggestedTurnLimit(selectedVariant));
+                    CountedDrawText(confirmText, 100, 280, 20, NEUTRAL_COLOR);
+
+                    if (!feedbackMessage.empty()) {
+                        DrawFeedbackMessage(feedbackMessage.c_str(), 100, 320);
+                    }
 
-                if (!feedbackMessage.empty()) {
-                    DrawFeedbackMessage(feedbackMessage.c_str(), 100, 320);
+                    if (vsComputer) {
+                        DifficultySettings settings = difficultySettings(computer.difficulty());
+                        const char* difficultyText = frameArena.format("Computer: < %s >",
+                            difficultyName(computer.difficulty()));
+                        CountedDrawText(difficultyText, 100, 380, 25, SECONDARY_COLOR);
+                        const char* budgetText = frameArena.format("Thinks %d ms per move. LEFT/RIGHT to change",
+                            (int)(settings.thinkBudget * 1000 + 0.5));
+                        CountedDrawText(budgetText, 100, 415, 20, NEUTRAL_COLOR);
+                    }
+                    EndChrome(screenChrome);
+                }
+                DrawChrome(screenChrome);
+                DrawResetButton(resetBtn, mousePoint);
+                DrawModernInputValue(turnLimitInput.c_str(), 100, 180, true);
+
+                // Variant selectors; a change that leaves too few digits for a
+                // code without repeats is undone
+                GameVariant previousVariant = selectedVariant;
+                const char* lengthText = frameArena.format("%d", selectedVariant.length);
+                const char* baseText = frameArena.format("0-%c", digitChar(selectedVariant.base - 1));
+                selectedVariant.length = (int)Clamp((float)(selectedVariant.length +
+                    DrawSelector("Code length", lengthText, 420, 175, mousePoint)),
+                    MIN_VARIANT_LENGTH, MAX_VARIANT_LENGTH);
+                selectedVariant.base = (int)Clamp((float)(selectedVariant.base +
+                    DrawSelector("Digits", baseText, 420, 220, mousePoint)),
+                    MIN_VARIANT_BASE, MAX_VARIANT_BASE);
+                if (DrawSelector("Repeats", selectedVariant.repeats ? "Yes" : "No", 420, 265, mousePoint) != 0) {
+                    selectedVariant.repeats = !selectedVariant.repeats;
+                }
+                if (checkVariant(selectedVariant) != VariantStatus::Valid) {
+                    selectedVariant = previousVariant;
                 }
             }
-            else if (settingUp) {
-                string setupText = player1Turn ? player1Name : player2Name;
-                setupText += ", set your number";
-
-                DrawText(setupText.c_str(), screenWidth / 2 - MeasureText(setupText.c_str(), 30) / 2, 110, 30,
-                    player1Turn ? PRIMARY_COLOR : SECONDARY_COLOR);
-
-                string maskedGuess(guess.length(), '*');
-                DrawModernInput("Enter 4-digit number", maskedGuess.c_str(), 100, 180, true);
-
-                DrawText("Number must be 4 digits with no repeats", 100, 280, 20, NEUTRAL_COLOR);
-                DrawText("Press ENTER to confirm", 100, 310, 20, NEUTRAL_COLOR);
-
-                if (!feedbackMessage.empty()) {
-                    DrawFeedbackMessage(feedbackMessage.c_str(), 100, 350);
+            else if (game.phase == GamePhase::SettingNumbers) {
+                ProfileScope screenScope(frameProfiler, "set_number");
+
+                uint64_t chromeKey = HashText(FNV_OFFSET, "set_number");
+                chromeKey = HashValue(chromeKey, game.player1Turn);
+                chromeKey = HashText(chromeKey, game.player1Turn ? player1Name : player2Name);
+                chromeKey = HashText(chromeKey, feedbackMessage);
+                chromeKey = HashValue(chromeKey, game.variant.length);
+                chromeKey = HashValue(chromeKey, game.variant.base);
+                chromeKey = HashValue(chromeKey, game.variant.repeats);
+                if (BeginChrome(screenChrome, chromeKey)) {
+                    DrawGameFrame(screenWidth, screenHeight);
+
+                    const char* setupText = frameArena.format("%s, set your number",
+                        (game.player1Turn ? player1Name : player2Name).c_str());
+                    CountedDrawText(setupText, screenWidth / 2 - MeasureText(setupText, 30) / 2, 110, 30,
+                        game.player1Turn ? PRIMARY_COLOR : SECONDARY_COLOR);
+
+                    const char* inputLabel = frameArena.format("Enter %d-digit number", game.variant.length);
+                    DrawModernInputFrame(inputLabel, 100, 180, true);
+
+                    char variantText[64];
+                    const char* rulesText = frameArena.format("Number must be %s",
+                        describeVariant(game.variant, variantText, sizeof(variantText)));
+                    CountedDrawText(rulesText, 100, 280, 20, NEUTRAL_COLOR);
+                    CountedDrawText("Press ENTER to confirm", 100, 310, 20, NEUTRAL_COLOR);
+
+                    if (!feedbackMessage.empty()) {
+                        DrawFeedbackMessage(feedbackMessage.c_str(), 100, 350);
+                    }
+                    EndChrome(screenChrome);
                 }
+                DrawChrome(screenChrome);
+                DrawResetButton(resetBtn, mousePoint);
+
+                char maskedGuess[MAX_VARIANT_LENGTH + 1];
+                int maskedLength = (int)min(guess.length(), (size_t)MAX_VARIANT_LENGTH);
+                memset(maskedGuess, '*', maskedLength);
+                maskedGuess[maskedLength] = '\0';
+                DrawModernInputValue(maskedGuess, 100, 180, true);
             }
             else {
-                string playerText = player1Turn ? player1Name + "'s Turn" : player2Name + "'s Turn";
-                DrawText(playerText.c_str(), screenWidth / 2 - MeasureText(playerText.c_str(), 30) / 2, 110, 30,
-                    player1Turn ? PRIMARY_COLOR : SECONDARY_COLOR);
+                ProfileScope screenScope(frameProfiler, "guessing");
+
+                // The computer's or, online, the opponent's turn: nothing to type
+                bool computerTurn = vsComputer && !game.player1Turn;
+                bool remoteTurn = computerTurn || !isLocalTurn();
+                bool hintsOffered = game.variant.isClassic();
+
+                // Remaining possibilities for the current guesser (count is kept by the set;
+                // huge variants are not counted until the feedback narrows them down)
+                long long possibilities = game.variant.isClassic() ?
+                    (game.player1Turn ? player1Candidates : player2Candidates).count() :
+                    (game.player1Turn ? player1VariantCandidates : player2VariantCandidates).count();
+
+                // Chrome changes once per turn: whose turn it is, the count and the feedback
+                uint64_t chromeKey = HashText(FNV_OFFSET, "guessing");
+                chromeKey = HashValue(chromeKey, game.player1Turn);
+                chromeKey = HashText(chromeKey, game.player1Turn ? player1Name : player2Name);
+                chromeKey = HashText(chromeKey, feedbackMessage);
+                chromeKey = HashText(chromeKey, computerTurn ? "computer" : remoteTurn ? "remote" : "human");
+                chromeKey = HashValue(chromeKey, possibilities);
+                if (BeginChrome(screenChrome, chromeKey)) {
+                    DrawGameFrame(screenWidth, screenHeight);
+
+                    const char* playerText = frameArena.format("%s's Turn",
+                        (game.player1Turn ? player1Name : player2Name).c_str());
+                    CountedDrawText(playerText, screenWidth / 2 - MeasureText(playerText, 30) / 2, 110, 30,
+                        game.player1Turn ? PRIMARY_COLOR : SECONDARY_COLOR);
+
+                    DrawModernInputFrame(computerTurn ? "Computer is thinking..." :
+                        remoteTurn ? "Opponent is guessing..." : "Enter your guess",
+                        100, 180, !remoteTurn);
+
+                    const char* possibilitiesText = possibilities < 0 ?
+                        frameArena.format("Over %zu possibilities left", VariantCandidates::LIST_LIMIT) :
+                        frameArena.format("%lld %s", possibilities, possibilities == 1 ? "possibility left" : "possibilities left");
+                    CountedDrawText(possibilitiesText, 270, 260, 20, NEUTRAL_COLOR);
+
+                    if (!feedbackMessage.empty()) {
+                        DrawFeedbackMessage(feedbackMessage.c_str(), 100, 310);
+                    }
 
-                DrawModernInput("Enter your guess", guess.c_str(), 100, 180, true);
+                    CountedDrawText("History", 100, 350, 25, NEUTRAL_COLOR);
+                    EndChrome(screenChrome);
+                }
+                DrawChrome(screenChrome);
+                DrawResetButton(resetBtn, mousePoint);
+                DrawModernInputValue(guess.c_str(), 100, 180, !remoteTurn);
 
                 Color timerColor = remainingTime <= 5 ? TIMER_WARNING : NEUTRAL_COLOR;
                 if (remainingTime <= 5) {
                     timerColor = ColorAlpha(TIMER_WARNING, 0.5f + sinf(GetTime() * 4) * 0.5f);
                 }
 
-                string timeText = "Time: " + to_string(remainingTime) + "s";
-                DrawRectangleRounded({ 100, 250, 150, 40 }, 0.2f, 8, Fade(timerColor, 0.1f));
-                DrawText(timeText.c_str(), 120, 260, 20, timerColor);
+                const char* timeText = frameArena.format("Time: %ds", remainingTime);
+                CountedDrawRectangleRounded({ 100, 250, 150, 40 }, 0.2f, 8, Fade(timerColor, 0.1f));
+                CountedDrawText(timeText, 120, 260, 20, timerColor);
+
+                // Hint button: starts a background search, or stops a running one
+                // early (the best guess found so far is kept). Shift picks entropy.
+                // Only the classic game has hints, and not while the computer is guessing.
+                Rectangle hintBtn = { 320, 210, 120, 40 };
+                if (hintsOffered && !remoteTurn && (IsKeyPressed(KEY_H) || (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) &&
+                    CheckCollisionPointRec(mousePoint, hintBtn)))) {
+                    if (hintVisible && hintSearch.isRunning()) {
+                        hintSearch.cancel();
+                    }
+                    else {
+                        hintMode = (IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT)) ?
+                            HintMode::Entropy : HintMode::Minimax;
+                        // Budget ends just before the turn timer so a result is always shown
+                        HintOptions hintOptions;
+                        hintOptions.timeBudget = remainingTime > 1 ? remainingTime - 0.5 : 0.5;
+                        hintSearch.start(game.player1Turn ? player1Candidates : player2Candidates,
+                            hintMode, hintOptions);
+                        hintVisible = true;
+                        hintTurnNumber = game.player1Turns + game.player2Turns;
+                    }
+                }
+                bool hintRunning = hintVisible && hintSearch.isRunning();
+                if (hintsOffered) {
+                    Color hintColor = CheckCollisionPointRec(mousePoint, hintBtn) ? BUTTON_HOVER_COLOR : BUTTON_COLOR;
+                    CountedDrawRectangleRounded(hintBtn, 0.3f, 8, hintColor);
+                    const char* hintLabel = hintRunning ? "Stop (H)" : "Hint (H)";
+                    CountedDrawText(hintLabel, (int)hintBtn.x + (120 - MeasureTextCached(hintLabel, 20)) / 2, 220, 20, WHITE);
+                }
 
-                if (!feedbackMessage.empty()) {
-                    DrawFeedbackMessage(feedbackMessage.c_str(), 100, 310);
+                if (hintVisible) {
+                    const char* hintText = "Thinking...";
+                    if (!hintRunning) {
+                        HintResult hint = hintSearch.best();
+                        char hintCode[CODE_LENGTH + 1];
+                        if (hint.found) unpackCode(codeAt(hint.guess), hintCode);
+                        hintText = !hint.found ? "No hint" :
+                            frameArena.format("Try %s%s", hintCode, hint.fromBook ? " (book)" :
+                                !hint.complete ? " (best so far)" : "");
+                    }
+                    CountedDrawText(hintText, 460, 220, 20, PRIMARY_COLOR);
                 }
 
                 // Feedback history with scrolling
-                DrawText("History", 100, 350, 25, NEUTRAL_COLOR);
+                frameProfiler.beginScope("history");
 
                 // Define the scrollable area
                 Rectangle historyArea = { 90, 390, 620, 160 }; // Fixed height for history area
 
                 // Calculate total content height
-                float totalContentHeight = feedbackHistory.size() * 35; // 35 pixels per history item
+                const float rowHeight = 35;
+                float totalContentHeight = feedbackHistory.size() * rowHeight;
 
                 // Handle mouse wheel for scrolling
                 static float scrollOffset = 0;
@@ -775,27 +1889,35 @@ int main(void)
                 float maxScroll = totalContentHeight - historyArea.height;
                 scrollOffset = Clamp(scrollOffset, 0, maxScroll > 0 ? maxScroll : 0);
 
-                // Begin scissors mode to clip content outside the history area
-                BeginScissorMode((int)historyArea.x, (int)historyArea.y,
-                    (int)historyArea.width, (int)historyArea.height);
+                // The visible rows are baked into their own layer, redrawn only
+                // when a row is added or the list scrolls. The layer's origin is
+                // the history area's corner and its texture clips the rows.
+                uint64_t historyKey = HashValue(FNV_OFFSET, feedbackHistory.total());
+                historyKey = HashValue(historyKey, (long long)scrollOffset);
+                historyKey = HashText(historyKey, player1Name);
+                historyKey = HashText(historyKey, player2Name);
+                if (BeginChrome(historyChrome, historyKey, historyArea, WHITE)) {
+                    // Only the rows in view are formatted; each row's box starts
+                    // 5 pixels above its text, hence the taller view
+                    HistoryWindow rows = visibleHistoryRows(feedbackHistory.size(), rowHeight,
+                        scrollOffset, historyArea.height + 5);
+                    for (int i = 0; i < rows.count; i++) {
+                        const HistoryEntry& entry = feedbackHistory[rows.first + i];
+                        int yOffset = (int)(rows.firstY + i * rowHeight);
+                        char feedback[128];
+                        describeHistoryEntry(entry, (entry.byPlayer1 ? player1Name : player2Name).c_str(),
+                            game.variant, feedback, sizeof(feedback));
 
-                // Draw history items with scroll offset
-                int yOffset = 390 - (int)scrollOffset;
-                for (const string& feedback : feedbackHistory) {
-                    // Only draw if in visible area (with some padding)
-                    if (yOffset + 35 >= historyArea.y - 35 && yOffset <= historyArea.y + historyArea.height + 35) {
                         // Use the color based on whose turn it was
-                        Color feedbackColor = feedback.find(player1Name) != string::npos ?
-                            PRIMARY_COLOR : SECONDARY_COLOR;
+                        Color feedbackColor = entry.byPlayer1 ? PRIMARY_COLOR : SECONDARY_COLOR;
 
-                        DrawRectangleRounded({ 90, (float)yOffset - 5, 620, 30 },
+                        CountedDrawRectangleRounded({ 0, (float)yOffset - 5, 620, 30 },
                             0.2f, 8, Fade(feedbackColor, 0.1f));
-                        DrawText(feedback.c_str(), 100, yOffset, 20, feedbackColor);
+                        CountedDrawText(feedback, 10, yOffset, 20, feedbackColor);
                     }
-                    yOffset += 35;
+                    EndChrome(historyChrome);
                 }
-
-                EndScissorMode();
+                DrawChrome(historyChrome);
 
                 // Draw scroll indicator if content exceeds view area
                 if (totalContentHeight > historyArea.height) {
@@ -804,36 +1926,53 @@ int main(void)
                         (historyArea.height - scrollBarHeight);
 
                     // Draw scroll track
-                    DrawRectangleRounded({ historyArea.x + historyArea.width + 5, historyArea.y,
+                    CountedDrawRectangleRounded({ historyArea.x + historyArea.width + 5, historyArea.y,
                                         8, historyArea.height }, 1.0f, 2,
                         Fade(NEUTRAL_COLOR, 0.1f));
 
                     // Draw scroll thumb
-                    DrawRectangleRounded({ historyArea.x + historyArea.width + 5, scrollBarY,
+                    CountedDrawRectangleRounded({ historyArea.x + historyArea.width + 5, scrollBarY,
                                         8, scrollBarHeight }, 1.0f, 2,
                         Fade(NEUTRAL_COLOR, 0.5f));
                 }
+                frameProfiler.endScope();
+            }
+
+            // Handle reset button click
+            if (resetClicked) {
+                resetGame(false);
             }
         }
 
         // Reset game state
-        if (IsKeyPressed(KEY_R) && gameOver) {
-            ResetGame(startScreen, player1Number, player2Number, guess, feedbackMessage,
-                player1Turn, settingUp, settingTurnLimit, gameOver,
-                feedbackHistory, player1Turns, player2Turns, turnLimitInput, remainingTime,
-                player1Name, player2Name, settingPlayer1Name, settingPlayer2Name);
+        if (IsKeyPressed(KEY_R) && game.phase == GamePhase::GameOver) {
+            resetGame(false);
         }
-        else if (IsKeyPressed(KEY_M) && gameOver) {
-            startScreen = true;
-            ResetGame(startScreen, player1Number, player2Number, guess, feedbackMessage,
-                player1Turn, settingUp, settingTurnLimit, gameOver,
-                feedbackHistory, player1Turns, player2Turns, turnLimitInput, remainingTime,
-                player1Name, player2Name, settingPlayer1Name, settingPlayer2Name);
+        else if (IsKeyPressed(KEY_M) && game.phase == GamePhase::GameOver) {
+            resetGame(true);
+        }
+        frameProfiler.endScope();
+
+        if (profilerOverlay) {
+            ProfileScope overlayScope(frameProfiler, "overlay");
+            DrawProfilerOverlay(frameProfiler);
         }
 
+        // Buffer swap, including any wait for the frame rate cap
+        frameProfiler.beginScope("present");
         EndDrawing();
+        lastPollTime = GetTime();
+        frameProfiler.endScope();
+        recordInputLatency();
     }
 
+    frameProfiler.endFrame();
+    frameProfiler.stopTrace();
+    gameRecord.endMatch(turnTimer.now(), MatchEnd::Reset);
+    gameRecord.close();
+    players.close();    // Rewrites the index so the next start reads nothing
+    UnloadChrome(screenChrome);
+    UnloadChrome(historyChrome);
     CloseWindow();
     return 0;
 }
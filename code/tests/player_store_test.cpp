@@ -0,0 +1,194 @@
+// The player store (engine/player_store.h) answers the same from its index
+// as from its overlay: profiles are checked against a reference kept here,
+// while recording (past OVERLAY_LIMIT, so the index is rewritten in the
+// background), after reopening on a full index, and with no index at all.
+// A won match counts the winning guess among the winner's guesses.
+
+#include "engine/player_store.h"
+#include "tests/test_check.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const char* LOG_PATH = "test_players.nbp";
+static const char* INDEX_PATH = "test_players.nbi";
+
+static bool sameProfile(const PlayerProfile& a, const PlayerProfile& b) {
+    return a.name == b.name && a.matches == b.matches && a.wins == b.wins && a.draws == b.draws &&
+        a.timeouts == b.timeouts && a.guesses == b.guesses && a.rating.value == b.rating.value &&
+        a.rating.deviation == b.rating.deviation && a.rating.volatility == b.rating.volatility;
+}
+
+// Function to apply a match to the reference the way the store does
+static void referenceMatch(map<string, PlayerProfile>& reference, const PlayedMatch& match,
+    const RatingOptions& options) {
+    PlayerProfile& player1 = reference[match.player1Name];
+    PlayerProfile& player2 = reference[match.player2Name];
+    player1.name = match.player1Name;
+    player2.name = match.player2Name;
+    rateMatch(options, player1.rating, player2.rating, match.result);
+    player1.matches++;
+    player2.matches++;
+    player1.wins += match.result == GameResult::Player1Wins;
+    player2.wins += match.result == GameResult::Player2Wins;
+    player1.draws += match.result == GameResult::Draw;
+    player2.draws += match.result == GameResult::Draw;
+    player1.guesses += match.player1Guesses;
+    player2.guesses += match.player2Guesses;
+    player1.timeouts += match.player1Timeouts;
+    player2.timeouts += match.player2Timeouts;
+}
+
+// Function to record random matches among playerCount players
+static void playMatches(PlayerStore& store, map<string, PlayerProfile>& reference, int matchCount,
+    int playerCount, unsigned& seed, const RatingOptions& options) {
+    for (int i = 0; i < matchCount; i++) {
+        PlayedMatch match;
+        seed = seed * 1103515245u + 12345u;
+        int player1 = (int)((seed >> 8) % (unsigned)playerCount);
+        seed = seed * 1103515245u + 12345u;
+        int player2 = (int)((seed >> 8) % (unsigned)(playerCount - 1));
+        if (player2 >= player1) player2++;
+        match.player1Name = "player " + to_string(player1);
+        match.player2Name = "player " + to_string(player2);
+        match.result = (GameResult)(1 + (seed >> 4) % 3);
+        match.player1Guesses = 1 + (int)(seed >> 12) % 9;
+        match.player2Guesses = 1 + (int)(seed >> 16) % 9;
+        match.player1Timeouts = (int)(seed >> 20) % 2;
+        match.player2Timeouts = (int)(seed >> 21) % 2;
+        store.recordMatch(match, options);
+        referenceMatch(reference, match, options);
+    }
+}
+
+// Function to compare every query of the store with the reference
+static void checkStore(PlayerStore& store, const map<string, PlayerProfile>& reference, int unknownPlayer) {
+    CHECK(store.playerCount() == (int)reference.size());
+    PlayerProfile profile;
+    for (const auto& entry : reference) {
+        bool found = store.find(entry.first, profile);
+        CHECK(found && sameProfile(profile, entry.second));
+    }
+    CHECK(!store.find("player " + to_string(unknownPlayer), profile));
+    CHECK(store.rankOf("player " + to_string(unknownPlayer)) == 0);
+
+    // The leaderboard is every player, best first, each placed by rankOf()
+    vector<double> ratings;
+    for (const auto& entry : reference) ratings.push_back(entry.second.rating.value);
+    sort(ratings.begin(), ratings.end(), [](double a, double b) { return a > b; });
+    vector<PlayerProfile> top;
+    store.leaderboard((int)reference.size() + 10, top);
+    CHECK(top.size() == reference.size());
+    for (size_t i = 0; i < top.size() && i < ratings.size(); i++) {
+        CHECK(top[i].rating.value == ratings[i]);
+        auto expected = reference.find(top[i].name);
+        CHECK(expected != reference.end() && sameProfile(top[i], expected->second));
+        size_t place = lower_bound(ratings.begin(), ratings.end(), top[i].rating.value,
+            [](double a, double b) { return a > b; }) - ratings.begin();
+        CHECK(store.rankOf(top[i].name) == (int)place + 1);
+    }
+}
+
+// Function to play a scripted match through step(), counting timeouts as
+// the game does, and record it
+static void recordScripted(PlayerStore& store, const vector<GameEvent>& events) {
+    GameState state;
+    int timeouts[2] = { 0, 0 };
+    for (const GameEvent& event : events) {
+        StepResult result;
+        state = step(state, event, &result);
+        if (result.outcome == StepOutcome::TimedOut) timeouts[result.byPlayer1 ? 0 : 1]++;
+    }
+    store.recordMatch(makePlayedMatch(state, "winner", "loser", timeouts[0], timeouts[1]));
+}
+
+// Function to check that the winning guess is counted: step() does not
+// count it as a turn
+static void checkWinningGuess() {
+    remove(LOG_PATH);
+    remove(INDEX_PATH);
+    PlayerStore store;
+    CHECK(store.open(LOG_PATH, INDEX_PATH));
+
+    GameEvent limit;
+    limit.type = GameEventType::SetTurnLimit;
+    limit.turnLimit = 10;
+    GameEvent number1;
+    number1.type = GameEventType::SetNumber;
+    number1.code = packCode("1234");
+    GameEvent number2 = number1;
+    number2.code = packCode("5678");
+    GameEvent win;
+    win.type = GameEventType::Guess;
+    win.code = packCode("5678");
+
+    // Won with the first guess
+    recordScripted(store, { limit, number1, number2, win });
+    PlayerProfile winner;
+    PlayerProfile loser;
+    CHECK(store.find("winner", winner) && winner.wins == 1 && winner.guesses == 1 && winner.timeouts == 0);
+    CHECK(store.find("loser", loser) && loser.guesses == 0);
+
+    // A miss, the loser's turn running out, then the win
+    GameEvent miss = win;
+    miss.code = packCode("9012");
+    GameEvent timeout;
+    timeout.type = GameEventType::Tick;
+    timeout.time = 1000;
+    win.time = 1001;
+    recordScripted(store, { limit, number1, number2, miss, timeout, win });
+    CHECK(store.find("winner", winner) && winner.wins == 2 && winner.guesses == 3 && winner.timeouts == 0);
+    CHECK(store.find("loser", loser) && loser.guesses == 0 && loser.timeouts == 1);
+    CHECK(winner.averageGuesses() == 1.5);
+    store.close();
+    remove(LOG_PATH);
+    remove(INDEX_PATH);
+}
+
+int main() {
+    checkWinningGuess();
+
+    remove(LOG_PATH);
+    remove(INDEX_PATH);
+    map<string, PlayerProfile> reference;
+    unsigned seed = 11;
+    RatingOptions options;
+    options.formula = RatingFormula::Glicko2;
+    const int playerCount = (int)OVERLAY_LIMIT * 2;
+
+    // Recording enough players to rewrite the index while it goes on
+    {
+        PlayerStore store;
+        CHECK(store.open(LOG_PATH, INDEX_PATH));
+        playMatches(store, reference, 3 * playerCount, playerCount, seed, options);
+        checkStore(store, reference, playerCount);
+    }
+
+    // Closing wrote an index of the whole log: nothing left for the overlay
+    {
+        PlayerStore store;
+        CHECK(store.open(LOG_PATH, INDEX_PATH));
+        checkStore(store, reference, playerCount);
+        // Then the overlay over the index: players old and new
+        playMatches(store, reference, 500, playerCount + 200, seed, options);
+        checkStore(store, reference, playerCount + 200);
+        CHECK(store.saveIndex());
+        checkStore(store, reference, playerCount + 200);
+    }
+
+    // Without an index the whole log is the overlay, and answers the same
+    remove(INDEX_PATH);
+    {
+        PlayerStore store;
+        CHECK(store.open(LOG_PATH, INDEX_PATH));
+        checkStore(store, reference, playerCount + 200);
+    }
+    remove(LOG_PATH);
+    remove(INDEX_PATH);
+    return testResult("player_store");
+}
@@ -0,0 +1,148 @@
+// Round trip of every match protocol message (engine/match_protocol.h)
+// through encodeMessage() and decodeMessage(), with the frames cut short,
+// run together and malformed the ways a socket can deliver them.
+
+#include "engine/match_protocol.h"
+#include "tests/test_check.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+// Function to compare the fields a message of its type carries
+static bool sameMessage(const NetMessage& a, const NetMessage& b) {
+    if (a.type != b.type) return false;
+    switch (a.type) {
+    case NetMessageType::Hello:
+    case NetMessageType::SetNumber:
+    case NetMessageType::Guess:
+    case NetMessageType::Rejected:
+        return strcmp(a.text, b.text) == 0;
+    case NetMessageType::SetTurnLimit:
+        return a.turnLimit == b.turnLimit && a.variant == b.variant;
+    case NetMessageType::Matched:
+        return a.seat == b.seat && strcmp(a.text, b.text) == 0;
+    case NetMessageType::Update: {
+        const MatchUpdate& x = a.update;
+        const MatchUpdate& y = b.update;
+        return x.outcome == y.outcome && x.byPlayer1 == y.byPlayer1 && x.correctDigits == y.correctDigits &&
+            x.correctPositions == y.correctPositions && x.code == y.code && x.phase == y.phase &&
+            x.result == y.result && x.player1Turn == y.player1Turn && x.turnLimit == y.turnLimit &&
+            x.variant == y.variant && x.timeLimitPerTurn == y.timeLimitPerTurn &&
+            x.player1Turns == y.player1Turns && x.player2Turns == y.player2Turns &&
+            x.turnElapsed == y.turnElapsed;
+    }
+    case NetMessageType::OpponentLeft:
+        return true;
+    }
+    return false;
+}
+
+// Function to build one message of every type, texts from empty to too long
+static vector<NetMessage> sampleMessages() {
+    vector<NetMessage> messages;
+    NetMessage message;
+    const char* texts[] = { "", "1234", "Player with a long name", "a name well past the thirty-one bytes kept" };
+    NetMessageType textTypes[] = { NetMessageType::Hello, NetMessageType::SetNumber, NetMessageType::Guess,
+        NetMessageType::Rejected };
+    for (NetMessageType type : textTypes) {
+        for (const char* text : texts) {
+            message = NetMessage();
+            message.type = type;
+            setMessageText(message, text);
+            messages.push_back(message);
+        }
+    }
+
+    message = NetMessage();
+    message.type = NetMessageType::SetTurnLimit;
+    message.turnLimit = 12;
+    message.variant.length = 6;
+    message.variant.base = 10;
+    message.variant.repeats = true;
+    messages.push_back(message);
+
+    for (int seat = 0; seat < 2; seat++) {
+        message = NetMessage();
+        message.type = NetMessageType::Matched;
+        message.seat = seat;
+        setMessageText(message, "Opponent");
+        messages.push_back(message);
+    }
+
+    message = NetMessage();
+    message.type = NetMessageType::Update;
+    MatchUpdate& update = message.update;
+    update.outcome = StepOutcome::Scored;
+    update.byPlayer1 = false;
+    update.correctDigits = 3;
+    update.correctPositions = 1;
+    update.code = packCode("5072");
+    update.phase = GamePhase::Guessing;
+    update.player1Turn = true;
+    update.turnLimit = 10;
+    update.timeLimitPerTurn = 45;
+    update.player1Turns = 4;
+    update.player2Turns = 4;
+    update.turnElapsed = 12.345;
+    messages.push_back(message);
+    update.outcome = StepOutcome::Won;
+    update.phase = GamePhase::GameOver;
+    update.result = GameResult::Player2Wins;
+    update.turnElapsed = 0;
+    messages.push_back(message);
+
+    message = NetMessage();
+    message.type = NetMessageType::OpponentLeft;
+    messages.push_back(message);
+    return messages;
+}
+
+int main() {
+    vector<NetMessage> messages = sampleMessages();
+    unsigned char frame[NET_MAX_FRAME];
+    vector<unsigned char> stream;
+    NetMessage decoded;
+
+    for (const NetMessage& message : messages) {
+        size_t length = encodeMessage(message, frame);
+        CHECK(length >= 2 && length <= NET_MAX_FRAME);
+        CHECK(decodeMessage(frame, length, decoded) == (int)length);
+        CHECK(sameMessage(message, decoded));
+        // A partial frame asks for more, however little of it has arrived
+        for (size_t cut = 0; cut < length; cut++) CHECK(decodeMessage(frame, cut, decoded) == 0);
+        stream.insert(stream.end(), frame, frame + length);
+    }
+
+    // Frames back to back, as one read returns them
+    size_t offset = 0;
+    for (const NetMessage& message : messages) {
+        int length = decodeMessage(stream.data() + offset, stream.size() - offset, decoded);
+        CHECK(length > 0);
+        if (length <= 0) break;
+        CHECK(sameMessage(message, decoded));
+        offset += (size_t)length;
+    }
+    CHECK(offset == stream.size());
+
+    // Frames a well-behaved peer never sends are refused
+    const unsigned char unknownType[] = { 0, 99 };
+    const unsigned char longText[2 + NET_TEXT_BYTES] = { NET_TEXT_BYTES, (unsigned char)NetMessageType::Hello };
+    const unsigned char shortTurnLimit[] = { 3, (unsigned char)NetMessageType::SetTurnLimit, 10, 4, 10 };
+    const unsigned char badSeat[] = { 1, (unsigned char)NetMessageType::Matched, 2 };
+    const unsigned char leftWithPayload[] = { 1, (unsigned char)NetMessageType::OpponentLeft, 0 };
+    CHECK(decodeMessage(unknownType, sizeof(unknownType), decoded) == -1);
+    CHECK(decodeMessage(longText, sizeof(longText), decoded) == -1);
+    CHECK(decodeMessage(shortTurnLimit, sizeof(shortTurnLimit), decoded) == -1);
+    CHECK(decodeMessage(badSeat, sizeof(badSeat), decoded) == -1);
+    CHECK(decodeMessage(leftWithPayload, sizeof(leftWithPayload), decoded) == -1);
+
+    // An update whose phase is out of range is a bad frame too
+    NetMessage update;
+    update.type = NetMessageType::Update;
+    size_t length = encodeMessage(update, frame);
+    frame[2 + 8] = 200;
+    CHECK(decodeMessage(frame, length, decoded) == -1);
+    return testResult("protocol");
+}
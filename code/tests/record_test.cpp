@@ -0,0 +1,172 @@
+// Write and replay of game records (engine/game_record.h): matches read back
+// event for event and replay to the results they were played to, and a file
+// cut short by a crash is trimmed so matches appended after it are kept.
+
+#include "engine/code_space.h"
+#include "engine/game_record.h"
+#include "engine/mapped_file.h"
+#include "tests/test_check.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const char* RECORD_PATH = "test_record.nbr";
+static const int TICKS_PER_SECOND = 60;
+
+struct ScriptedMatch {
+    MatchInfo info;
+    vector<GameEvent> events;
+    MatchEnd end = MatchEnd::Finished;
+};
+
+// Function to step a small generator, as the replay tool's does
+static unsigned nextSeed(unsigned& seed) {
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 8;
+}
+
+static PackedCode randomNumber(unsigned& seed) {
+    return codeAt((CodeIndex)(nextSeed(seed) % CODE_COUNT));
+}
+
+// Function to play a match between random guessers, every event on a whole
+// tick; one in eight turns runs out instead. A match cut short stops after
+// a few guesses and is ended as Reset.
+static ScriptedMatch playMatch(int number, long long& tick, unsigned& seed, bool cutShort) {
+    ScriptedMatch match;
+    match.info.player1Name = "Player " + to_string(number);
+    match.info.player2Name = number % 3 ? "Computer" : "Player " + to_string(number + 1);
+    match.info.vsComputer = number % 3 != 0;
+    match.info.startTime = (double)tick / TICKS_PER_SECOND;
+
+    GameState state;
+    GameEvent event;
+    event.type = GameEventType::SetTurnLimit;
+    event.time = match.info.startTime;
+    event.turnLimit = 5 + number % 10;
+    state = step(state, event);
+    match.events.push_back(event);
+
+    event.type = GameEventType::SetNumber;
+    for (int player = 0; player < 2; player++) {
+        tick += 60 + nextSeed(seed) % 600;
+        event.time = (double)tick / TICKS_PER_SECOND;
+        event.code = randomNumber(seed);
+        state = step(state, event);
+        match.events.push_back(event);
+    }
+
+    while (state.phase == GamePhase::Guessing && !(cutShort && match.events.size() > 6)) {
+        if (nextSeed(seed) % 8 == 0) {
+            tick += (long long)state.timeLimitPerTurn * TICKS_PER_SECOND;
+            event.type = GameEventType::Tick;
+        }
+        else {
+            tick += 30 + nextSeed(seed) % 900;
+            event.type = GameEventType::Guess;
+            event.code = randomNumber(seed);
+        }
+        event.time = (double)tick / TICKS_PER_SECOND;
+        state = step(state, event);
+        match.events.push_back(event);
+    }
+    match.end = cutShort ? MatchEnd::Reset : MatchEnd::Finished;
+    return match;
+}
+
+static bool writeMatches(const vector<ScriptedMatch>& matches, size_t first) {
+    GameRecordWriter writer;
+    if (!writer.open(RECORD_PATH)) return false;
+    for (size_t i = first; i < matches.size(); i++) {
+        writer.beginMatch(matches[i].info);
+        for (const GameEvent& event : matches[i].events) writer.recordEvent(event);
+        writer.endMatch(matches[i].events.back().time, matches[i].end);
+    }
+    writer.close();
+    return true;
+}
+
+static bool sameEvent(const GameEvent& a, const GameEvent& b) {
+    if (a.type != b.type || a.time != b.time) return false;
+    if (a.type == GameEventType::SetTurnLimit) return a.turnLimit == b.turnLimit && a.variant == b.variant;
+    if (a.type == GameEventType::SetNumber || a.type == GameEventType::Guess) return a.code == b.code;
+    return true;
+}
+
+// Function to read the record back and compare it with the matches
+static void checkRecord(const vector<ScriptedMatch>& matches) {
+    MappedFile file;
+    CHECK(file.open(RECORD_PATH));
+    if (!file.isOpen()) return;
+    GameRecordReader reader(file.data(), file.size());
+    CHECK(reader.valid());
+
+    MatchInfo info;
+    GameEvent event;
+    size_t count = 0;
+    while (reader.nextMatch(info)) {
+        CHECK(count < matches.size());
+        if (count >= matches.size()) return;
+        const ScriptedMatch& match = matches[count++];
+        CHECK(info.player1Name == match.info.player1Name && info.player2Name == match.info.player2Name);
+        CHECK(info.vsComputer == match.info.vsComputer);
+        CHECK(info.ticksPerSecond == TICKS_PER_SECOND && info.timeLimitPerTurn == match.info.timeLimitPerTurn);
+        CHECK(info.startTime == match.info.startTime);
+        size_t events = 0;
+        while (reader.nextEvent(event)) {
+            CHECK(events < match.events.size() && sameEvent(event, match.events[events]));
+            events++;
+        }
+        CHECK(events == match.events.size());
+        CHECK(reader.matchEnd() == match.end);
+    }
+    CHECK(count == matches.size());
+    CHECK(reader.completeBytes() == file.size());
+
+    // Replaying gives what the matches were played to
+    vector<MatchSummary> summaries = replayRecord(file.data(), file.size());
+    CHECK(summaries.size() == matches.size());
+    for (size_t i = 0; i < summaries.size() && i < matches.size(); i++) {
+        MatchSummary played = simulateMatch(matches[i].events);
+        CHECK(summaries[i].result == played.result);
+        CHECK(summaries[i].player1Turns == played.player1Turns && summaries[i].player2Turns == played.player2Turns);
+        CHECK(summaries[i].eventsApplied == (int)matches[i].events.size());
+    }
+}
+
+int main() {
+    remove(RECORD_PATH);
+    vector<ScriptedMatch> matches;
+    long long tick = 0;
+    unsigned seed = 7;
+    for (int i = 0; i < 200; i++) matches.push_back(playMatch(i, tick, seed, i % 25 == 12));
+
+    // Written in two sessions, the second appending to the first
+    CHECK(writeMatches(vector<ScriptedMatch>(matches.begin(), matches.begin() + 120), 0));
+    CHECK(writeMatches(matches, 120));
+    checkRecord(matches);
+
+    // A crash tears the last end record; the match it ended is kept without
+    // it (so it reads as Reset) and the next session's matches follow it
+    MappedFile before;
+    CHECK(before.open(RECORD_PATH));
+    uint64_t size = before.size();
+    before.close();
+    CHECK(truncateFile(RECORD_PATH, size - 1));
+    matches.back().end = MatchEnd::Reset;
+    size_t appended = matches.size();
+    for (int i = 200; i < 230; i++) matches.push_back(playMatch(i, tick, seed, false));
+    CHECK(writeMatches(matches, appended));
+    checkRecord(matches);
+
+    // A file that is not a record is refused, not appended to
+    FILE* other = fopen(RECORD_PATH, "wb");
+    CHECK(other && fputs("not a game record", other) >= 0 && fclose(other) == 0);
+    GameRecordWriter writer;
+    CHECK(!writer.open(RECORD_PATH));
+    remove(RECORD_PATH);
+    return testResult("record");
+}
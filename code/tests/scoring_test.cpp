@@ -0,0 +1,66 @@
+// Cross-checks the SIMD scoring kernels (engine/batch_scoring.h) against the
+// scalar path, and the scalar path against scoreCodes(): every guess against
+// the whole code space, then against a subset cut to every tail length the
+// SIMD loops can leave. Paths this CPU lacks are skipped.
+
+#include "engine/batch_scoring.h"
+#include "tests/test_check.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+static const ScoringPath SIMD_PATHS[] = { ScoringPath::SSE2, ScoringPath::AVX2 };
+
+// Function to score every guess on every supported path and compare
+static void checkAgainstScalar(const CandidateBuffer& candidates) {
+    size_t count = candidates.size();
+    vector<Feedback> expected(count);
+    vector<Feedback> feedback(count);
+    uint32_t expectedHistogram[FEEDBACK_COUNT];
+    uint32_t histogram[FEEDBACK_COUNT];
+
+    for (int g = 0; g < CODE_COUNT; g++) {
+        PackedCode guess = codeAt((CodeIndex)g);
+        scoreCandidatesWith(ScoringPath::Scalar, guess, candidates, expected.data(), expectedHistogram);
+        bool scalarRight = true;
+        for (size_t i = 0; i < count; i++) {
+            scalarRight = scalarRight && expected[i] == scoreCodes(guess, codeAt(candidates.indices[i]));
+        }
+        CHECK(scalarRight);
+
+        for (ScoringPath path : SIMD_PATHS) {
+            if (!isScoringPathSupported(path)) continue;
+            scoreCandidatesWith(path, guess, candidates, feedback.data(), histogram);
+            CHECK(memcmp(feedback.data(), expected.data(), count * sizeof(Feedback)) == 0);
+            CHECK(memcmp(histogram, expectedHistogram, sizeof(histogram)) == 0);
+            // The histogram alone goes down its own loop
+            scoreCandidatesWith(path, guess, candidates, nullptr, histogram);
+            CHECK(memcmp(histogram, expectedHistogram, sizeof(histogram)) == 0);
+        }
+    }
+}
+
+int main() {
+    for (ScoringPath path : SIMD_PATHS) {
+        printf("%s: %s\n", scoringPathName(path), isScoringPathSupported(path) ? "checked" : "not supported, skipped");
+    }
+
+    CandidateBuffer all;
+    all.fillAll();
+    checkAgainstScalar(all);
+
+    // Every seventh code is 720 of them; dropping up to 16 from the end
+    // leaves every remainder an 8- or 16-wide loop can end on
+    CandidateBuffer subset;
+    for (int i = 0; i < CODE_COUNT; i += 7) subset.push((CodeIndex)i);
+    CHECK(subset.size() == 720);
+    for (int tail = 0; tail < 16; tail++) {
+        checkAgainstScalar(subset);
+        subset.nibbles.pop_back();
+        subset.masks.pop_back();
+        subset.indices.pop_back();
+    }
+    return testResult("scoring");
+}
@@ -0,0 +1,152 @@
+// Save and load of match snapshots (engine/match_snapshot.h): a match comes
+// back as it was captured, a torn slot falls back to the other one, and the
+// save after a tear goes into the torn slot, never over the intact one.
+
+#include "engine/match_snapshot.h"
+#include "tests/test_check.h"
+
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+static const char* SNAPSHOT_PATH = "test_snapshot.bin";
+
+// The file layout, as match_snapshot.cpp lays it out: a 16-byte header, then
+// two slots of a 24-byte slot header and a snapshot each
+static const long FILE_HEADER_BYTES = 16;
+static const long SLOT_BYTES = 24 + (long)sizeof(MatchSnapshot);
+
+// Function to build a match in progress; tag tells matches apart
+static MatchSnapshot makeSnapshot(int tag, const char* player1, const char* player2) {
+    GameState state;
+    state.phase = GamePhase::Guessing;
+    state.turnLimit = 10 + tag;
+    state.timeLimitPerTurn = 30;
+    state.player1Number = packCode("1234");
+    state.player2Number = packCode("5678");
+    state.player1Turn = tag % 2 == 0;
+    state.player1Turns = tag;
+    state.player2Turns = tag;
+    state.startTime = 100;
+
+    MatchHistory history;
+    for (int i = 0; i < 2 * tag + 1; i++) {
+        HistoryEntry entry;
+        entry.code = packCode(i % 2 ? "9012" : "3456");
+        entry.time = 10.0f * i;
+        entry.kind = i % 5 == 4 ? HistoryKind::TimedOut : HistoryKind::Guess;
+        entry.byPlayer1 = i % 2 == 0;
+        entry.correctDigits = (uint8_t)(i % 4);
+        entry.correctPositions = (uint8_t)(i % 2);
+        history.push(entry);
+    }
+
+    MatchSnapshot snapshot;
+    captureMatch(snapshot, state, 107.5, history);
+    setSnapshotName(snapshot.player1Name, player1);
+    setSnapshotName(snapshot.player2Name, player2);
+    return snapshot;
+}
+
+// Function to compare two snapshots by what restoring them gives back
+static bool sameMatch(const MatchSnapshot& a, const MatchSnapshot& b) {
+    MatchHistory historyA;
+    MatchHistory historyB;
+    GameState x = restoreMatch(a, 200, historyA);
+    GameState y = restoreMatch(b, 200, historyB);
+    if (x.phase != y.phase || x.result != y.result || x.turnLimit != y.turnLimit || !(x.variant == y.variant) ||
+        x.timeLimitPerTurn != y.timeLimitPerTurn || x.player1Number != y.player1Number ||
+        x.player2Number != y.player2Number || x.player1Turn != y.player1Turn ||
+        x.player1Turns != y.player1Turns || x.player2Turns != y.player2Turns || x.startTime != y.startTime) {
+        return false;
+    }
+    if (strcmp(a.player1Name, b.player1Name) != 0 || strcmp(a.player2Name, b.player2Name) != 0) return false;
+    if (historyA.size() != historyB.size()) return false;
+    for (int i = 0; i < historyA.size(); i++) {
+        const HistoryEntry& p = historyA[i];
+        const HistoryEntry& q = historyB[i];
+        if (p.code != q.code || p.time != q.time || p.kind != q.kind || p.byPlayer1 != q.byPlayer1 ||
+            p.correctDigits != q.correctDigits || p.correctPositions != q.correctPositions) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Function to flip a byte of a slot's snapshot, as a save torn by a crash
+// leaves it; the file must be closed
+static bool tearSlot(int index) {
+    FILE* file = fopen(SNAPSHOT_PATH, "r+b");
+    if (!file) return false;
+    long offset = FILE_HEADER_BYTES + index * SLOT_BYTES + 24;
+    bool ok = fseek(file, offset, SEEK_SET) == 0;
+    int byte = ok ? fgetc(file) : EOF;
+    ok = byte != EOF && fseek(file, offset, SEEK_SET) == 0 && fputc(byte ^ 0xFF, file) != EOF;
+    return fclose(file) == 0 && ok;
+}
+
+int main() {
+    remove(SNAPSHOT_PATH);
+    MatchSnapshot first = makeSnapshot(1, "Ann", "Bo");
+    MatchSnapshot second = makeSnapshot(2, "Cy", "Di");
+    MatchSnapshot third = makeSnapshot(3, "Ed", "Flo");
+    MatchSnapshot loaded;
+    {
+        SnapshotFile file;
+        CHECK(file.open(SNAPSHOT_PATH));
+        CHECK(!file.load(loaded));
+        file.save(first);       // Slot 0
+        CHECK(file.load(loaded) && sameMatch(loaded, first));
+        file.save(second);      // Slot 1
+        CHECK(file.load(loaded) && sameMatch(loaded, second));
+        CHECK(loaded.isUnfinished());
+    }
+
+    // The newest snapshot survives the file being closed
+    {
+        SnapshotFile file;
+        CHECK(file.open(SNAPSHOT_PATH));
+        CHECK(file.load(loaded) && sameMatch(loaded, second));
+    }
+
+    // A torn newest slot falls back to the one before it...
+    CHECK(tearSlot(1));
+    {
+        SnapshotFile file;
+        CHECK(file.open(SNAPSHOT_PATH));
+        CHECK(file.load(loaded) && sameMatch(loaded, first));
+        // ...and the next save replaces the torn slot, not the intact one
+        file.save(third);
+        CHECK(file.load(loaded) && sameMatch(loaded, third));
+    }
+    CHECK(tearSlot(1));
+    {
+        SnapshotFile file;
+        CHECK(file.open(SNAPSHOT_PATH));
+        CHECK(file.load(loaded) && sameMatch(loaded, first));
+    }
+
+    // With both slots torn there is nothing to resume, until a clear()
+    CHECK(tearSlot(0));
+    {
+        SnapshotFile file;
+        CHECK(file.open(SNAPSHOT_PATH));
+        CHECK(!file.load(loaded));
+        file.clear();
+        CHECK(file.load(loaded) && !loaded.isUnfinished());
+    }
+
+    // A file of another size is started afresh
+    FILE* other = fopen(SNAPSHOT_PATH, "wb");
+    CHECK(other && fputs("not a snapshot", other) >= 0 && fclose(other) == 0);
+    {
+        SnapshotFile file;
+        CHECK(file.open(SNAPSHOT_PATH));
+        CHECK(!file.load(loaded));
+        file.save(first);
+        CHECK(file.load(loaded) && sameMatch(loaded, first));
+    }
+    remove(SNAPSHOT_PATH);
+    return testResult("snapshot");
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+// The engine tests are plain executables run by ctest. CHECK() reports a
+// failed condition with its line and carries on, so one run shows every
+// failure; testResult() is what main() returns.
+
+#include <cstdio>
+
+static int testFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            testFailures++; \
+        } \
+    } while (0)
+
+// Function to print the outcome and turn it into an exit status
+inline int testResult(const char* name) {
+    if (testFailures) fprintf(stderr, "%s: %d checks failed\n", name, testFailures);
+    else printf("%s: all checks passed\n", name);
+    return testFailures ? 1 : 0;
+}
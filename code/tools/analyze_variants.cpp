@@ -0,0 +1,111 @@
+// Exact optimal worst and expected guess counts for game variants (see
+// engine/variant_analyzer.h), on every core.
+//
+// Usage: numbrainer_analyzer [--length N --base N [--repeats]]
+//            [--worst-only | --expected-only] [--checkpoint FILE]
+//            [--checkpoint-seconds N] [--threads N]
+//
+// Without --length and --base every variant of length 3 and the base-6
+// variants of length 4 are swept, which takes seconds. Larger variants can
+// run for hours: with --checkpoint the search state is saved every
+// --checkpoint-seconds (default 300) and at the end, and a run started with
+// the same file picks up where the last one stopped.
+
+#include "engine/variant_analyzer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+// Function to print one analysis as a table row
+static void printAnalysis(const VariantAnalysis& analysis) {
+    char name[64];
+    describeVariant(analysis.variant, name, sizeof(name));
+    printf("%-28s %7d ", name, analysis.codeCount);
+    if (analysis.worstCase) printf("%6d ", analysis.worstCase);
+    else printf("%6s ", "-");
+    if (analysis.totalGuesses) printf("%9lld %8.4f ", analysis.totalGuesses, analysis.expectedGuesses);
+    else printf("%9s %8s ", "-", "-");
+    printf("%11llu %10llu %9.2f\n", (unsigned long long)analysis.nodes, (unsigned long long)analysis.memoEntries,
+        analysis.seconds);
+    fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    GameVariant variant;
+    bool chosen = false;
+    VariantAnalysisOptions options;
+    int threads = 0;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--length") == 0 && hasValue) {
+            variant.length = atoi(argv[++i]);
+            chosen = true;
+        }
+        else if (strcmp(argv[i], "--base") == 0 && hasValue) {
+            variant.base = atoi(argv[++i]);
+            chosen = true;
+        }
+        else if (strcmp(argv[i], "--repeats") == 0) variant.repeats = true;
+        else if (strcmp(argv[i], "--worst-only") == 0) options.expectedCase = false;
+        else if (strcmp(argv[i], "--expected-only") == 0) options.worstCase = false;
+        else if (strcmp(argv[i], "--checkpoint") == 0 && hasValue) options.checkpointPath = argv[++i];
+        else if (strcmp(argv[i], "--checkpoint-seconds") == 0 && hasValue) options.checkpointSeconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue) threads = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [--length N --base N [--repeats]]\n"
+                "           [--worst-only | --expected-only] [--checkpoint FILE]\n"
+                "           [--checkpoint-seconds N] [--threads N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!options.worstCase && !options.expectedCase) {
+        fprintf(stderr, "Error: --worst-only and --expected-only leave nothing to compute\n");
+        return 2;
+    }
+
+    vector<GameVariant> variants;
+    if (chosen) {
+        VariantStatus status = checkVariant(variant);
+        if (status != VariantStatus::Valid) {
+            fprintf(stderr, "Error: %s\n", variantStatusMessage(status));
+            return 2;
+        }
+        if (variantCodeCount(variant) > (uint64_t)MAX_ANALYZED_CODES) {
+            fprintf(stderr, "Error: more than %d codes\n", MAX_ANALYZED_CODES);
+            return 2;
+        }
+        variants.push_back(variant);
+    }
+    else {
+        if (options.checkpointPath) {
+            fprintf(stderr, "Error: --checkpoint needs one variant (--length and --base)\n");
+            return 2;
+        }
+        for (int base = MIN_VARIANT_BASE; base <= 10; base++) {
+            variants.push_back(GameVariant{ 3, base, false });
+        }
+        variants.push_back(GameVariant{ 3, 6, true });
+        variants.push_back(GameVariant{ 4, 6, false });
+        variants.push_back(GameVariant{ 4, 6, true });
+    }
+
+    // All of the hardware: nothing else runs in this process
+    ThreadPool pool(threads);
+    printf("%d threads\n", pool.threadCount());
+    printf("%-28s %7s %6s %9s %8s %11s %10s %9s\n", "variant", "codes", "worst", "total", "mean", "nodes",
+        "memo", "seconds");
+    for (const GameVariant& current : variants) {
+        VariantAnalysis analysis;
+        if (!analyzeVariant(current, options, analysis, pool)) {
+            fprintf(stderr, "Error: %s does not match this variant\n", options.checkpointPath);
+            return 1;
+        }
+        if (analysis.resumedEntries) printf("resumed %llu memo entries\n", (unsigned long long)analysis.resumedEntries);
+        printAnalysis(analysis);
+    }
+    return 0;
+}
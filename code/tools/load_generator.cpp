@@ -0,0 +1,514 @@
+// Load generator for the match server (engine/match_server.h): thousands of
+// bot players over loopback, playing whole matches, to find how many
+// concurrent matches a box can host before moves slow down or turn timers
+// drift.
+//
+// Usage: numbrainer_loadgen [--matches N] [--ramp SECONDS] [--duration SECONDS]
+//            [--turns N] [--time-limit SECONDS] [--think-ms MS] [--timeout-share F]
+//            [--solver] [--seed N] [--server HOST:PORT [--server-pid PID]] [--json FILE]
+//
+// --matches bot pairs connect over the ramp, then play until the duration
+// is up, queueing again after every match. A bot waits --think-ms (give or
+// take half) before each move, and lets --timeout-share of its turns run
+// out on purpose. Bots guess random numbers, or with --solver a random code
+// still consistent with the feedback so far.
+//
+// Without --server a server is started in this process on its own thread
+// (with --time-limit seconds per turn), and its CPU time is measured
+// directly; for an outside server, --server-pid reads it from /proc.
+//
+// Reported, as text and with --json as a file to diff between releases:
+//   move latency   from sending a move to receiving the update it caused
+//   timeout drift  from when a turn left to run out was due to expire (its
+//                  start plus timeLimitPerTurn) to receiving the expiry; the
+//                  start is only known to a server tick, so small negative
+//                  drifts are expected
+//   server CPU     per match played
+// NUMBRAINER_COMMIT, if set, is written to the JSON as well.
+
+#include "engine/candidate_set.h"
+#include "engine/game_clock.h"
+#include "engine/match_client.h"
+#include "engine/match_server.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace std;
+
+struct LoadOptions {
+    int matches = 1000;
+    double ramp = 5;
+    double duration = 30;
+    int turns = 10;
+    int timeLimit = 5;
+    double thinkMs = 300;
+    double timeoutShare = 0.05;
+    bool solver = false;
+    unsigned seed = 1;
+    const char* server = nullptr;       // In-process when not given
+    int serverPid = 0;
+    const char* jsonPath = nullptr;
+};
+
+struct Bot {
+    MatchClient client;
+    unsigned seed = 1;
+    int seat = 0;
+    bool inMatch = false;
+    GameState view;                     // The match as the updates describe it
+    CandidateSet candidates;            // Narrowed by this bot's guesses (--solver)
+    double moveSentAt = -1;             // Waiting for the update of this move
+    double expiryDue = -1;              // A turn left to run out, due then
+    uint32_t serial = 0;                // Bumped per update, so stale actions are dropped
+};
+
+struct Action {
+    double time;
+    int bot;
+    uint32_t serial;
+};
+
+struct LoadResults {
+    int botsConnected = 0;
+    int connectFailures = 0;
+    uint64_t matchesStarted = 0;
+    uint64_t matchesFinished = 0;
+    uint64_t moves = 0;
+    uint64_t rejected = 0;
+    uint64_t timeouts = 0;
+    vector<float> moveLatencyMs;
+    vector<float> timeoutDriftMs;
+    double serverCpu = -1;              // Seconds; -1 when unknown
+    double loadCpu = 0;
+};
+
+// Function to step a small generator (the same one the replay tool uses)
+static unsigned nextSeed(unsigned& seed) {
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 8;
+}
+
+// Function to draw a uniformly random valid number
+static PackedCode randomCode(unsigned& seed) {
+    return codeAt((CodeIndex)(nextSeed(seed) % CODE_COUNT));
+}
+
+// Function to draw a random code still in the set, scanning from a random start
+static PackedCode consistentCode(const CandidateSet& candidates, unsigned& seed) {
+    int start = (int)(nextSeed(seed) % CODE_COUNT);
+    for (int i = 0; i < CODE_COUNT; i++) {
+        CodeIndex index = (CodeIndex)((start + i) % CODE_COUNT);
+        if (candidates.contains(index)) return codeAt(index);
+    }
+    return randomCode(seed);
+}
+
+static bool laterAction(const Action& a, const Action& b) {
+    return a.time > b.time;
+}
+
+static double processCpuSeconds() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static double threadCpuSeconds() {
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Function to read a process's user plus system time from /proc (-1 if it cannot)
+static double pidCpuSeconds(int pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE* file = fopen(path, "r");
+    if (!file) return -1;
+    char line[1024];
+    size_t length = fread(line, 1, sizeof(line) - 1, file);
+    fclose(file);
+    line[length] = '\0';
+    // Fields after the command name, which is in parentheses and may hold spaces
+    const char* rest = strrchr(line, ')');
+    unsigned long long user = 0, system = 0;
+    if (!rest || sscanf(rest + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &user, &system) != 2) {
+        return -1;
+    }
+    return (double)(user + system) / sysconf(_SC_CLK_TCK);
+}
+
+static float percentile(const vector<float>& sorted, double share) {
+    if (sorted.empty()) return 0;
+    size_t index = min(sorted.size() - 1, (size_t)(share * sorted.size()));
+    return sorted[index];
+}
+
+class LoadRun {
+public:
+    LoadRun(const LoadOptions& options, const char* server) : options_(options), server_(server),
+        bots_(2 * options.matches) {}
+
+    bool run(LoadResults& results);
+
+private:
+    double now() const { return clock_.now(); }
+    void connectBot(int index);
+    void receive(int index);
+    void handleUpdate(int index, const MatchUpdate& update);
+    void planTurn(int index, double turnElapsed);
+    void schedule(int index);
+    void act(int index);
+    void requeue(int index);
+    bool isMyTurn(const Bot& bot) const;
+
+    const LoadOptions& options_;
+    const char* server_;
+    SteadyClock clock_;
+    vector<Bot> bots_;
+    vector<Action> actions_;            // Min-heap on time
+    int epoll_ = -1;
+    bool stopping_ = false;
+    LoadResults* results_ = nullptr;
+};
+
+bool LoadRun::isMyTurn(const Bot& bot) const {
+    if (!bot.inMatch || bot.view.phase == GamePhase::GameOver) return false;
+    if (bot.view.phase == GamePhase::SettingTurnLimit) return bot.seat == 0;
+    return bot.view.player1Turn == (bot.seat == 0);
+}
+
+void LoadRun::connectBot(int index) {
+    Bot& bot = bots_[index];
+    bot.seed = options_.seed * 7919u + (unsigned)index;
+    char name[NET_TEXT_BYTES];
+    snprintf(name, sizeof(name), "Bot %d", index + 1);
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u32 = (uint32_t)index;
+    if (!bot.client.connect(server_) || !bot.client.sendHello(name) ||
+        epoll_ctl(epoll_, EPOLL_CTL_ADD, (int)bot.client.handle(), &event) != 0) {
+        bot.client.close();
+        results_->connectFailures++;
+        return;
+    }
+    results_->botsConnected++;
+}
+
+void LoadRun::requeue(int index) {
+    Bot& bot = bots_[index];
+    bot.inMatch = false;
+    bot.moveSentAt = -1;
+    bot.expiryDue = -1;
+    bot.serial++;
+    if (stopping_) return;
+    char name[NET_TEXT_BYTES];
+    snprintf(name, sizeof(name), "Bot %d", index + 1);
+    bot.client.sendHello(name);
+}
+
+void LoadRun::receive(int index) {
+    Bot& bot = bots_[index];
+    NetMessage message;
+    while (bot.client.receive(message)) {
+        switch (message.type) {
+        case NetMessageType::Matched:
+            bot.seat = message.seat;
+            bot.inMatch = true;
+            bot.view = GameState();
+            bot.candidates.reset();
+            if (bot.seat == 0) results_->matchesStarted++;
+            break;
+        case NetMessageType::Update:
+            handleUpdate(index, message.update);
+            break;
+        case NetMessageType::Rejected:
+            results_->rejected++;
+            bot.moveSentAt = -1;
+            if (isMyTurn(bot)) schedule(index);
+            break;
+        case NetMessageType::OpponentLeft:
+            requeue(index);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void LoadRun::handleUpdate(int index, const MatchUpdate& update) {
+    Bot& bot = bots_[index];
+    double arrived = now();
+    bool mine = update.byPlayer1 == (bot.seat == 0);
+    if (update.outcome == StepOutcome::TimedOut) {
+        if (mine && bot.expiryDue >= 0) {
+            results_->timeoutDriftMs.push_back((float)((arrived - bot.expiryDue) * 1000));
+            bot.expiryDue = -1;
+        }
+        if (bot.seat == 0) results_->timeouts++;
+    }
+    else if (update.outcome != StepOutcome::Ignored && mine && bot.moveSentAt >= 0) {
+        results_->moveLatencyMs.push_back((float)((arrived - bot.moveSentAt) * 1000));
+        results_->moves++;
+        bot.moveSentAt = -1;
+    }
+    if (mine && update.outcome == StepOutcome::Scored && options_.solver) {
+        bot.candidates.applyGuess(update.code, makeFeedback(update.correctDigits, update.correctPositions));
+    }
+
+    applyUpdate(bot.view, update, arrived);
+    bot.serial++;
+    if (bot.view.phase == GamePhase::GameOver) {
+        if (bot.seat == 0) results_->matchesFinished++;
+        requeue(index);
+    }
+    else if (isMyTurn(bot)) {
+        planTurn(index, update.turnElapsed);
+    }
+}
+
+// Function to decide how to play a turn: a move after thinking, or, now and
+// then in the guessing phase, nothing at all until the server expires it
+void LoadRun::planTurn(int index, double turnElapsed) {
+    Bot& bot = bots_[index];
+    if (bot.view.phase == GamePhase::Guessing &&
+        nextSeed(bot.seed) % 10000 < (unsigned)(options_.timeoutShare * 10000)) {
+        bot.expiryDue = now() - turnElapsed + bot.view.timeLimitPerTurn;
+        return;
+    }
+    schedule(index);
+}
+
+void LoadRun::schedule(int index) {
+    Bot& bot = bots_[index];
+    double think = options_.thinkMs / 1000 * (0.5 + (nextSeed(bot.seed) % 1000) / 1000.0);
+    actions_.push_back({ now() + think, index, bot.serial });
+    push_heap(actions_.begin(), actions_.end(), laterAction);
+}
+
+void LoadRun::act(int index) {
+    Bot& bot = bots_[index];
+    if (!isMyTurn(bot) || stopping_) return;
+    char text[MAX_VARIANT_LENGTH + 1];
+    bool sent = false;
+    bot.moveSentAt = now();
+    switch (bot.view.phase) {
+    case GamePhase::SettingTurnLimit:
+        sent = bot.client.sendTurnLimit(options_.turns, GameVariant());
+        break;
+    case GamePhase::SettingNumbers:
+        unpackCode(randomCode(bot.seed), text);
+        sent = bot.client.sendNumber(NetMessageType::SetNumber, text);
+        break;
+    default:
+        unpackCode(options_.solver ? consistentCode(bot.candidates, bot.seed) : randomCode(bot.seed), text);
+        sent = bot.client.sendNumber(NetMessageType::Guess, text);
+        break;
+    }
+    if (!sent) bot.moveSentAt = -1;
+}
+
+bool LoadRun::run(LoadResults& results) {
+    results_ = &results;
+    epoll_ = epoll_create1(0);
+    if (epoll_ < 0) return false;
+
+    int botCount = (int)bots_.size();
+    int connected = 0;
+    double start = now();
+    double end = start + options_.duration;
+    epoll_event events[256];
+    while (now() < end) {
+        // Connections ramp up linearly; each bot queues as soon as it is in
+        double elapsed = now() - start;
+        int target = options_.ramp > 0 ? min(botCount, (int)(botCount * elapsed / options_.ramp) + 2) : botCount;
+        while (connected < target) connectBot(connected++);
+
+        int waitMs = 10;
+        if (!actions_.empty()) {
+            waitMs = max(0, min(waitMs, (int)((actions_.front().time - now()) * 1000)));
+        }
+        int count = epoll_wait(epoll_, events, 256, waitMs);
+        for (int i = 0; i < count; i++) {
+            receive((int)events[i].data.u32);
+        }
+
+        double time = now();
+        while (!actions_.empty() && actions_.front().time <= time) {
+            Action due = actions_.front();
+            pop_heap(actions_.begin(), actions_.end(), laterAction);
+            actions_.pop_back();
+            if (bots_[due.bot].serial == due.serial) act(due.bot);
+        }
+    }
+
+    stopping_ = true;
+    for (Bot& bot : bots_) bot.client.close();
+    ::close(epoll_);
+    return true;
+}
+
+static void printDistribution(const char* name, vector<float>& samples) {
+    sort(samples.begin(), samples.end());
+    printf("%-16s %8zu samples  p50 %8.3f  p90 %8.3f  p99 %8.3f  p99.9 %8.3f  max %8.3f ms\n", name,
+        samples.size(), percentile(samples, 0.5), percentile(samples, 0.9), percentile(samples, 0.99),
+        percentile(samples, 0.999), samples.empty() ? 0.0f : samples.back());
+}
+
+static void writeDistribution(FILE* file, const char* name, const vector<float>& sorted) {
+    fprintf(file, "    \"%s\": {\"count\": %zu, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"p999\": %.3f,"
+        " \"max\": %.3f}", name, sorted.size(), percentile(sorted, 0.5), percentile(sorted, 0.9),
+        percentile(sorted, 0.99), percentile(sorted, 0.999), sorted.empty() ? 0.0f : sorted.back());
+}
+
+// Function to write the options and results as JSON, one value per key so
+// two runs diff line by line
+static bool writeJson(const char* path, const LoadOptions& options, const LoadResults& results) {
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+    const char* commit = getenv("NUMBRAINER_COMMIT");
+    double cpuPerMatch = results.serverCpu >= 0 && results.matchesFinished > 0 ?
+        results.serverCpu * 1000 / results.matchesFinished : -1;
+    fprintf(file, "{\n  \"environment\": {\n");
+    fprintf(file, "    \"commit\": \"%s\",\n", commit ? commit : "");
+    fprintf(file, "    \"hardware_threads\": %u\n  },\n", thread::hardware_concurrency());
+    fprintf(file, "  \"options\": {\n");
+    fprintf(file, "    \"matches\": %d,\n    \"ramp_s\": %.3f,\n    \"duration_s\": %.3f,\n", options.matches,
+        options.ramp, options.duration);
+    fprintf(file, "    \"turns\": %d,\n    \"time_limit_s\": %d,\n    \"think_ms\": %.1f,\n", options.turns,
+        options.timeLimit, options.thinkMs);
+    fprintf(file, "    \"timeout_share\": %.4f,\n    \"solver\": %s,\n    \"seed\": %u,\n", options.timeoutShare,
+        options.solver ? "true" : "false", options.seed);
+    fprintf(file, "    \"server\": \"%s\"\n  },\n", options.server ? options.server : "in-process");
+    fprintf(file, "  \"results\": {\n");
+    fprintf(file, "    \"bots_connected\": %d,\n    \"connect_failures\": %d,\n", results.botsConnected,
+        results.connectFailures);
+    fprintf(file, "    \"matches_started\": %llu,\n    \"matches_finished\": %llu,\n",
+        (unsigned long long)results.matchesStarted, (unsigned long long)results.matchesFinished);
+    fprintf(file, "    \"moves\": %llu,\n    \"timeouts\": %llu,\n    \"rejected\": %llu,\n",
+        (unsigned long long)results.moves, (unsigned long long)results.timeouts,
+        (unsigned long long)results.rejected);
+    writeDistribution(file, "move_latency_ms", results.moveLatencyMs);
+    fprintf(file, ",\n");
+    writeDistribution(file, "timeout_drift_ms", results.timeoutDriftMs);
+    fprintf(file, ",\n    \"server_cpu_s\": %.4f,\n    \"server_cpu_ms_per_match\": %.4f,\n", results.serverCpu,
+        cpuPerMatch);
+    fprintf(file, "    \"loadgen_cpu_s\": %.4f\n  }\n}\n", results.loadCpu);
+    return fclose(file) == 0;
+}
+
+static void printUsage(const char* program) {
+    fprintf(stderr, "Usage: %s [--matches N] [--ramp SECONDS] [--duration SECONDS]\n"
+        "           [--turns N] [--time-limit SECONDS] [--think-ms MS] [--timeout-share F]\n"
+        "           [--solver] [--seed N] [--server HOST:PORT [--server-pid PID]] [--json FILE]\n", program);
+}
+
+int main(int argc, char** argv) {
+    LoadOptions options;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--matches") == 0 && hasValue) options.matches = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--ramp") == 0 && hasValue) options.ramp = atof(argv[++i]);
+        else if (strcmp(argv[i], "--duration") == 0 && hasValue) options.duration = atof(argv[++i]);
+        else if (strcmp(argv[i], "--turns") == 0 && hasValue) options.turns = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--time-limit") == 0 && hasValue) options.timeLimit = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--think-ms") == 0 && hasValue) options.thinkMs = atof(argv[++i]);
+        else if (strcmp(argv[i], "--timeout-share") == 0 && hasValue) options.timeoutShare = atof(argv[++i]);
+        else if (strcmp(argv[i], "--solver") == 0) options.solver = true;
+        else if (strcmp(argv[i], "--seed") == 0 && hasValue) options.seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--server") == 0 && hasValue) options.server = argv[++i];
+        else if (strcmp(argv[i], "--server-pid") == 0 && hasValue) options.serverPid = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--json") == 0 && hasValue) options.jsonPath = argv[++i];
+        else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.matches < 1 || options.turns < 1 || options.turns > 99) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    // Every bot is a socket, and so is its end on an in-process server
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    // The in-process server gets a thread of its own, as it would a core
+    SteadyClock serverClock;
+    MatchServer server(serverClock);
+    atomic<bool> serverStop(false);
+    double serverCpu = -1;
+    thread serverThread;
+    char address[64];
+    if (options.server) {
+        snprintf(address, sizeof(address), "%s", options.server);
+    }
+    else {
+        server.setTimeLimitPerTurn(options.timeLimit);
+        if (!server.listen("127.0.0.1", 0)) {
+            fprintf(stderr, "Error: cannot start the server\n");
+            return 1;
+        }
+        snprintf(address, sizeof(address), "127.0.0.1:%d", server.port());
+        serverThread = thread([&]() {
+            while (!serverStop.load(memory_order_relaxed)) server.poll(5);
+            serverCpu = threadCpuSeconds();
+        });
+    }
+    double serverCpuStart = options.serverPid > 0 ? pidCpuSeconds(options.serverPid) : -1;
+    double processCpuStart = processCpuSeconds();
+
+    LoadResults results;
+    LoadRun run(options, address);
+    bool ran = run.run(results);
+
+    if (serverThread.joinable()) {
+        serverStop = true;
+        serverThread.join();
+        results.serverCpu = serverCpu;
+    }
+    else if (serverCpuStart >= 0) {
+        double serverCpuEnd = pidCpuSeconds(options.serverPid);
+        if (serverCpuEnd >= 0) results.serverCpu = serverCpuEnd - serverCpuStart;
+    }
+    results.loadCpu = processCpuSeconds() - processCpuStart - (options.server ? 0 : max(serverCpu, 0.0));
+    if (!ran) {
+        fprintf(stderr, "Error: cannot set up the bots\n");
+        return 1;
+    }
+
+    printf("%s: %d of %d bots connected (%d failed), %.0f s\n", address, results.botsConnected,
+        2 * options.matches, results.connectFailures, options.duration);
+    printf("matches          %llu started, %llu finished; %llu moves, %llu timeouts, %llu rejected\n",
+        (unsigned long long)results.matchesStarted, (unsigned long long)results.matchesFinished,
+        (unsigned long long)results.moves, (unsigned long long)results.timeouts,
+        (unsigned long long)results.rejected);
+    printDistribution("move latency", results.moveLatencyMs);
+    printDistribution("timeout drift", results.timeoutDriftMs);
+    if (results.serverCpu >= 0) {
+        printf("server cpu       %.3f s, %.3f ms per finished match\n", results.serverCpu,
+            results.matchesFinished ? results.serverCpu * 1000 / results.matchesFinished : 0.0);
+    }
+    printf("loadgen cpu      %.3f s\n", results.loadCpu);
+
+    if (options.jsonPath && !writeJson(options.jsonPath, options, results)) {
+        fprintf(stderr, "Error: could not write %s\n", options.jsonPath);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,30 @@
+// Build step that writes the all-pairs feedback table (see engine/feedback_table.h).
+//
+// Usage: numbrainer_tablegen <output file> [--verify]
+
+#include "engine/feedback_table.h"
+
+#include <cstdio>
+#include <cstring>
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <output file> [--verify]\n", argv[0]);
+        return 2;
+    }
+    const char* path = argv[1];
+
+    if (!writeFeedbackTable(path)) {
+        fprintf(stderr, "Error: could not write %s\n", path);
+        return 1;
+    }
+
+    if (argc > 2 && strcmp(argv[2], "--verify") == 0) {
+        FeedbackTable table;
+        if (!table.open(path) || !verifyFeedbackTable(table)) {
+            fprintf(stderr, "Error: %s does not match the scoring rules\n", path);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+// Build step that writes the opening book (see engine/opening_book.h).
+//
+// Usage: numbrainer_bookgen <output file> [--verify] [--minimax]
+//                           [--width N] [--limit N]
+
+#include "engine/opening_book.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <output file> [--verify] [--minimax] [--width N] [--limit N]\n", argv[0]);
+        return 2;
+    }
+    const char* path = argv[1];
+
+    OpeningBookOptions options;
+    bool verify = false;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--verify") == 0) {
+            verify = true;
+        }
+        else if (strcmp(argv[i], "--minimax") == 0) {
+            options.mode = HintMode::Minimax;
+        }
+        else if (strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+            options.lookaheadWidth = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) {
+            options.lookaheadLimit = atoi(argv[++i]);
+        }
+        else {
+            fprintf(stderr, "Error: unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    if (!writeOpeningBook(path, options)) {
+        fprintf(stderr, "Error: could not write %s\n", path);
+        return 1;
+    }
+
+    OpeningBook book;
+    if (!book.open(path) || (verify && !verifyOpeningBook(book))) {
+        fprintf(stderr, "Error: %s does not solve every secret\n", path);
+        return 1;
+    }
+    printf("%s: %u nodes, %.4f guesses on average, at most %u\n", path, book.header().nodeCount,
+        (double)book.header().totalGuesses / CODE_COUNT, book.header().maxDepth);
+    return 0;
+}
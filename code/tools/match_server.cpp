@@ -0,0 +1,96 @@
+// Hosts online matches (see engine/match_server.h) until interrupted.
+//
+// Usage: numbrainer_server [--port N] [--bind ADDRESS] [--time-limit SECONDS] [--stats SECONDS]
+//            [--players LOG]
+//
+// Point the game at it with NUMBRAINER_SERVER=host:port. --stats prints a
+// line of counters every so often; the default port is 7878 on all
+// interfaces. --players keeps profiles and ratings in the player store LOG
+// (its index beside it, .nbp becoming .nbi) and pairs players by rating.
+
+#include "engine/match_server.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int) {
+    stopRequested = 1;
+}
+
+int main(int argc, char** argv) {
+    const char* address = "0.0.0.0";
+    int port = 7878;
+    int timeLimit = 30;
+    double statsInterval = 0;
+    const char* playersPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--bind") == 0 && i + 1 < argc) {
+            address = argv[++i];
+        }
+        else if (strcmp(argv[i], "--time-limit") == 0 && i + 1 < argc) {
+            timeLimit = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            statsInterval = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--players") == 0 && i + 1 < argc) {
+            playersPath = argv[++i];
+        }
+        else {
+            fprintf(stderr, "Usage: %s [--port N] [--bind ADDRESS] [--time-limit SECONDS] [--stats SECONDS]\n"
+                "           [--players LOG]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    SteadyClock clock;
+    MatchServer server(clock);
+    server.setTimeLimitPerTurn(timeLimit);
+    PlayerStore players;
+    if (playersPath) {
+        string indexPath = playersPath;
+        if (indexPath.size() > 4 && indexPath.compare(indexPath.size() - 4, 4, ".nbp") == 0) {
+            indexPath.resize(indexPath.size() - 4);
+        }
+        indexPath += ".nbi";
+        if (!players.open(playersPath, indexPath.c_str())) {
+            fprintf(stderr, "Error: %s is not a player log of this version\n", playersPath);
+            return 1;
+        }
+        server.setPlayerStore(&players);
+    }
+    if (!server.listen(address, port)) {
+        fprintf(stderr, "Error: cannot listen on %s:%d\n", address, port);
+        return 1;
+    }
+    printf("listening on %s:%d, %d s per turn\n", address, server.port(), timeLimit);
+    fflush(stdout);
+
+    signal(SIGINT, requestStop);
+    signal(SIGTERM, requestStop);
+    double nextStats = statsInterval;
+    while (!stopRequested) {
+        server.poll(250);
+        if (statsInterval > 0 && clock.now() >= nextStats) {
+            ServerStats stats = server.stats();
+            printf("%.1f s: %d connections, %d matches (%llu started, %llu finished), %d waiting, %llu moves, "
+                "%llu timeouts, %llu rejected\n", clock.now(), stats.connections, stats.matches,
+                (unsigned long long)stats.matchesStarted, (unsigned long long)stats.matchesFinished, stats.waiting,
+                (unsigned long long)stats.moves, (unsigned long long)stats.timeouts,
+                (unsigned long long)stats.rejected);
+            fflush(stdout);
+            nextStats += statsInterval;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,165 @@
+// Recomputes every player's rating from the full match history (see
+// engine/rating.h), on every core.
+//
+// Usage: numbrainer_ratings --record FILE [--formula elo|glicko2] [--period N]
+//            [--threads N] [--top N] [--write-players LOG]
+//        numbrainer_ratings --synthetic N [--players N] [--formula elo|glicko2]
+//            [--period N] [--threads N]
+//
+// With --record the game record is replayed and the top of the resulting
+// leaderboard printed. --write-players LOG then replaces the player store at
+// LOG (and its index beside it, .nbp becoming .nbi as the game names them)
+// with the rebuilt profiles: this is how a store moves to another formula,
+// or replaces a log of an older version.
+//
+// --synthetic rates N random matches among --players players (default
+// 100000) without touching the disk, to measure throughput.
+
+#include "engine/mapped_file.h"
+#include "engine/player_store.h"
+#include "engine/rating.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const size_t SYNTHETIC_CHUNK_MATCHES = 1 << 16;
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Function to derive the index path the way the game pairs them
+static string indexPathFor(const string& logPath) {
+    if (logPath.size() > 4 && logPath.compare(logPath.size() - 4, 4, ".nbp") == 0) {
+        return logPath.substr(0, logPath.size() - 4) + ".nbi";
+    }
+    return logPath + ".nbi";
+}
+
+// Function to write profiles into a fresh store beside LOG and swap it in
+static bool writePlayers(const string& logPath, const vector<PlayerProfile>& profiles) {
+    string indexPath = indexPathFor(logPath);
+    string tempLog = logPath + ".tmp";
+    string tempIndex = indexPath + ".tmp";
+    remove(tempLog.c_str());
+    remove(tempIndex.c_str());
+    {
+        PlayerStore store;
+        if (!store.open(tempLog.c_str(), tempIndex.c_str())) return false;
+        for (const PlayerProfile& profile : profiles) store.recordProfile(profile);
+        if (!store.saveIndex()) return false;
+    }
+    // rename() does not replace an existing file on Windows
+    remove(logPath.c_str());
+    remove(indexPath.c_str());
+    return rename(tempLog.c_str(), logPath.c_str()) == 0 && rename(tempIndex.c_str(), indexPath.c_str()) == 0;
+}
+
+// Function to rate random matches in chunks, as a replay would feed them
+static void rateSynthetic(long long matchCount, uint32_t playerCount, const RatingOptions& options, ThreadPool& pool) {
+    RatingBatch batch(options, pool);
+    vector<RatedMatch> chunk;
+    unsigned seed = 1;
+    auto start = chrono::steady_clock::now();
+    for (long long done = 0; done < matchCount; done += (long long)chunk.size()) {
+        chunk.clear();
+        while (chunk.size() < SYNTHETIC_CHUNK_MATCHES && done + (long long)chunk.size() < matchCount) {
+            seed = seed * 1103515245u + 12345u;
+            uint32_t player1 = (seed >> 4) % playerCount;
+            seed = seed * 1103515245u + 12345u;
+            uint32_t player2 = (seed >> 4) % playerCount;
+            chunk.push_back({ player1, player2, (GameResult)(1 + (seed >> 29) % 3) });
+        }
+        batch.add(chunk.data(), chunk.size());
+    }
+    batch.finish();
+    double seconds = secondsSince(start);
+    printf("%llu matches among %zu players in %.2f s (%.1f million a second)\n",
+        (unsigned long long)batch.matchesRated(), batch.ratings().size(), seconds,
+        batch.matchesRated() / max(seconds, 1e-9) / 1e6);
+}
+
+int main(int argc, char** argv) {
+    const char* recordPath = nullptr;
+    const char* playersPath = nullptr;
+    long long synthetic = 0;
+    long long playerCount = 100000;
+    int top = 20;
+    int threads = 0;
+    RatingOptions options;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--record") == 0 && hasValue) recordPath = argv[++i];
+        else if (strcmp(argv[i], "--formula") == 0 && hasValue && parseRatingFormula(argv[i + 1], options.formula)) i++;
+        else if (strcmp(argv[i], "--period") == 0 && hasValue) options.periodMatches = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--top") == 0 && hasValue) top = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--write-players") == 0 && hasValue) playersPath = argv[++i];
+        else if (strcmp(argv[i], "--synthetic") == 0 && hasValue) synthetic = atoll(argv[++i]);
+        else if (strcmp(argv[i], "--players") == 0 && hasValue) playerCount = atoll(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s --record FILE [--formula elo|glicko2] [--period N]\n"
+                "           [--threads N] [--top N] [--write-players LOG]\n"
+                "       %s --synthetic N [--players N] [--formula elo|glicko2]\n"
+                "           [--period N] [--threads N]\n", argv[0], argv[0]);
+            return 2;
+        }
+    }
+    if (!recordPath == !synthetic) {
+        fprintf(stderr, "Error: give one of --record and --synthetic\n");
+        return 2;
+    }
+    if (options.periodMatches < 1 || playerCount < 2 || playerCount > UINT32_MAX) {
+        fprintf(stderr, "Error: --period must be at least 1 and --players at least 2\n");
+        return 2;
+    }
+
+    // All of the hardware: nothing else runs in this process
+    ThreadPool pool(threads);
+    printf("%s, %d matches a period, %d threads\n", ratingFormulaName(options.formula), options.periodMatches,
+        pool.threadCount());
+    if (synthetic) {
+        rateSynthetic(synthetic, (uint32_t)playerCount, options, pool);
+        return 0;
+    }
+
+    MappedFile record;
+    if (!record.open(recordPath)) {
+        fprintf(stderr, "Error: could not open %s\n", recordPath);
+        return 1;
+    }
+    auto start = chrono::steady_clock::now();
+    vector<PlayerProfile> profiles;
+    if (!replayPlayerHistory(record.data(), record.size(), options, profiles, pool)) {
+        fprintf(stderr, "Error: %s is not a game record\n", recordPath);
+        return 1;
+    }
+    long long matches = 0;
+    for (const PlayerProfile& profile : profiles) matches += profile.matches;
+    printf("%lld matches among %zu players in %.2f s\n", matches / 2, profiles.size(), secondsSince(start));
+
+    printf("%5s %-31s %7s %5s %6s %6s %6s %6s\n", "rank", "name", "rating", "dev", "played", "won", "drawn", "lost");
+    for (size_t i = 0; i < profiles.size() && (int)i < top; i++) {
+        const PlayerProfile& profile = profiles[i];
+        printf("%5zu %-31s %7.1f ", i + 1, profile.name.c_str(), profile.rating.value);
+        if (options.formula == RatingFormula::Glicko2) printf("%5.1f ", profile.rating.deviation);
+        else printf("%5s ", "-");
+        printf("%6d %6d %6d %6d\n", profile.matches, profile.wins, profile.draws, profile.losses());
+    }
+
+    if (playersPath) {
+        if (!writePlayers(playersPath, profiles)) {
+            fprintf(stderr, "Error: could not write %s\n", playersPath);
+            return 1;
+        }
+        printf("wrote %zu players to %s\n", profiles.size(), playersPath);
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+// Replays recorded matches (see engine/game_record.h) headlessly, as fast as
+// the engine goes, and prints what happened in them.
+//
+// Usage: numbrainer_replay <record file> [--repeat N] [--matches]
+//        numbrainer_replay --generate <record file> <match count> [--seed N]
+//
+// --generate appends matches between two random guessers, timeouts included,
+// which makes a record of any size for regression and speed runs.
+
+#include "engine/game_record.h"
+#include "engine/mapped_file.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+// Function to step a small generator; the same sequence on every platform
+static unsigned nextSeed(unsigned& seed) {
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 8;
+}
+
+// Function to draw a uniformly random valid number
+static PackedCode randomNumber(unsigned& seed) {
+    int digits[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    for (int i = 0; i < CODE_LENGTH; i++) {
+        int j = i + (int)(nextSeed(seed) % (10 - i));
+        int swapped = digits[i];
+        digits[i] = digits[j];
+        digits[j] = swapped;
+    }
+    return packDigits(digits[0], digits[1], digits[2], digits[3]);
+}
+
+// Function to append random matches to a record; roughly one turn in eight
+// runs out of time instead of being guessed
+static bool generateRecord(const char* path, int matchCount, unsigned seed) {
+    GameRecordWriter writer;
+    if (!writer.open(path)) return false;
+    const int ticksPerSecond = 60;
+    long long tick = 0;
+    for (int match = 0; match < matchCount; match++) {
+        MatchInfo info;
+        info.player1Name = "Random 1";
+        info.player2Name = "Random 2";
+        info.startTime = (double)tick / ticksPerSecond;
+        writer.beginMatch(info);
+
+        GameState state;
+        GameEvent event;
+        event.type = GameEventType::SetTurnLimit;
+        event.time = info.startTime;
+        event.turnLimit = 10;
+        state = step(state, event);
+        writer.recordEvent(event);
+
+        event.type = GameEventType::SetNumber;
+        for (int player = 0; player < 2; player++) {
+            tick += 60 + nextSeed(seed) % 600;
+            event.time = (double)tick / ticksPerSecond;
+            event.code = randomNumber(seed);
+            state = step(state, event);
+            writer.recordEvent(event);
+        }
+
+        while (state.phase == GamePhase::Guessing) {
+            if (nextSeed(seed) % 8 == 0) {
+                tick += (long long)state.timeLimitPerTurn * ticksPerSecond;
+                event.type = GameEventType::Tick;
+            }
+            else {
+                tick += 30 + nextSeed(seed) % 900;
+                event.type = GameEventType::Guess;
+                event.code = randomNumber(seed);
+            }
+            event.time = (double)tick / ticksPerSecond;
+            state = step(state, event);
+            writer.recordEvent(event);
+        }
+        writer.endMatch(event.time, MatchEnd::Finished);
+    }
+    writer.close();
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 4 && strcmp(argv[1], "--generate") == 0) {
+        unsigned seed = 1;
+        if (argc >= 6 && strcmp(argv[4], "--seed") == 0) seed = (unsigned)strtoul(argv[5], nullptr, 10);
+        if (!generateRecord(argv[2], atoi(argv[3]), seed)) {
+            fprintf(stderr, "Error: could not write %s\n", argv[2]);
+            return 1;
+        }
+        return 0;
+    }
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <record file> [--repeat N] [--matches]\n"
+            "       %s --generate <record file> <match count> [--seed N]\n", argv[0], argv[0]);
+        return 2;
+    }
+    const char* path = argv[1];
+
+    int repeat = 1;
+    bool listMatches = false;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--matches") == 0) {
+            listMatches = true;
+        }
+        else {
+            fprintf(stderr, "Error: unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    MappedFile file;
+    if (!file.open(path) || !GameRecordReader(file.data(), file.size()).valid()) {
+        fprintf(stderr, "Error: %s is not a game record\n", path);
+        return 1;
+    }
+
+    // Timed over every repeat; the last run's summaries are reported
+    vector<MatchSummary> summaries;
+    auto start = chrono::steady_clock::now();
+    for (int run = 0; run < repeat; run++) {
+        summaries = replayRecord(file.data(), file.size());
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    long long events = 0;
+    int wins1 = 0, wins2 = 0, draws = 0, unfinished = 0;
+    for (size_t i = 0; i < summaries.size(); i++) {
+        const MatchSummary& summary = summaries[i];
+        events += summary.eventsApplied;
+        switch (summary.result) {
+        case GameResult::Player1Wins: wins1++; break;
+        case GameResult::Player2Wins: wins2++; break;
+        case GameResult::Draw: draws++; break;
+        default: unfinished++; break;
+        }
+        if (listMatches) {
+            printf("match %zu: result %d, turns %d/%d, %d events\n", i + 1, (int)summary.result,
+                summary.player1Turns, summary.player2Turns, summary.eventsApplied);
+        }
+    }
+
+    printf("%s: %zu matches, %lld events (%zu bytes)\n", path, summaries.size(), events, file.size());
+    printf("player 1 wins %d, player 2 wins %d, draws %d, unfinished %d\n", wins1, wins2, draws, unfinished);
+    if (seconds > 0) {
+        printf("replayed %d time(s) in %.3f s: %.2f million events/s\n", repeat, seconds,
+            events * (double)repeat / seconds / 1e6);
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+// Round-robin tournament between guessing strategies (see engine/tournament.h),
+// on every core, for tuning turn limits and computer difficulty.
+//
+// Usage: numbrainer_tournament [--strategies LIST] [--turns N] [--secrets N]
+//            [--seed N] [--threads N] [--fit-human RECORD]
+//
+// LIST is comma separated: random, minimax, entropy, book, human or
+// human:MISTAKES[:TIMEOUTS] (default: random,minimax,entropy,human). Every
+// secret is played unless --secrets samples fewer. --fit-human measures how
+// the players in a game record slip and time out and gives those rates to
+// every plain "human" strategy.
+
+#include "engine/mapped_file.h"
+#include "engine/tournament.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Function to split a comma separated list into strategies
+static bool parseStrategies(const char* list, vector<Strategy>& strategies) {
+    strategies.clear();
+    string text(list);
+    size_t begin = 0;
+    while (begin <= text.size()) {
+        size_t end = text.find(',', begin);
+        if (end == string::npos) end = text.size();
+        Strategy strategy;
+        if (!parseStrategy(text.substr(begin, end - begin), strategy)) return false;
+        strategies.push_back(strategy);
+        begin = end + 1;
+    }
+    return !strategies.empty();
+}
+
+static double percent(int count, int total) {
+    return total ? 100.0 * count / total : 0;
+}
+
+int main(int argc, char** argv) {
+    const char* list = "random,minimax,entropy,human";
+    const char* recordPath = nullptr;
+    TournamentOptions options;
+    int threads = 0;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--strategies") == 0 && hasValue) list = argv[++i];
+        else if (strcmp(argv[i], "--turns") == 0 && hasValue) options.turnLimit = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--secrets") == 0 && hasValue) options.secrets = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && hasValue) options.seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--fit-human") == 0 && hasValue) recordPath = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [--strategies LIST] [--turns N] [--secrets N]\n"
+                "           [--seed N] [--threads N] [--fit-human RECORD]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    vector<Strategy> strategies;
+    if (!parseStrategies(list, strategies)) {
+        fprintf(stderr, "Error: bad strategy list %s\n", list);
+        return 2;
+    }
+    if (options.turnLimit < 1 || options.turnLimit > MAX_TOURNAMENT_TURNS) {
+        fprintf(stderr, "Error: turns must be 1..%d\n", MAX_TOURNAMENT_TURNS);
+        return 2;
+    }
+
+    if (recordPath) {
+        MappedFile file;
+        if (!file.open(recordPath)) {
+            fprintf(stderr, "Error: cannot open %s\n", recordPath);
+            return 1;
+        }
+        HumanProfile profile = measureHumanPlay(file.data(), file.size());
+        printf("%s: %d matches, %d human turns, %.1f%% slips, %.1f%% timeouts\n", recordPath, profile.matches,
+            profile.turns, profile.mistakeRate() * 100, profile.timeoutRate() * 100);
+        if (profile.turns > 0) {
+            for (Strategy& strategy : strategies) {
+                if (strategy.name != "human") continue;
+                strategy.mistakeRate = profile.mistakeRate();
+                strategy.timeoutRate = profile.timeoutRate();
+            }
+        }
+    }
+
+    // All of the hardware: nothing else runs in this process
+    ThreadPool pool(threads);
+    TournamentResult result = runTournament(strategies, options, pool);
+
+    printf("%d strategies, %d secrets, %d turns per player, %d threads\n", (int)strategies.size(),
+        result.secretCount, options.turnLimit, pool.threadCount());
+    printf("plans %.3f s, matches %.3f s\n\n", result.planSeconds, result.matchSeconds);
+
+    // Each strategy alone: how many turns it needs for a secret
+    printf("%-16s %8s %7s %6s  turns to solve\n", "strategy", "solved", "mean", "worst");
+    for (size_t s = 0; s < strategies.size(); s++) {
+        const StrategyStats& stats = result.strategies[s];
+        printf("%-16s %7.2f%% %7.3f %6d ", strategies[s].name.c_str(),
+            percent(result.secretCount - stats.solvedIn[0], result.secretCount), stats.meanTurns, stats.worstTurns);
+        for (int t = 1; t <= options.turnLimit; t++) {
+            if (stats.solvedIn[t]) printf(" %d:%d", t, stats.solvedIn[t]);
+        }
+        if (stats.solvedIn[0]) printf(" unsolved:%d", stats.solvedIn[0]);
+        printf("\n");
+    }
+
+    printf("\n%-16s %-16s %8s %8s %8s %10s\n", "player 1", "player 2", "p1 wins", "p2 wins", "draws", "mean turns");
+    for (const PairingStats& pairing : result.pairings) {
+        printf("%-16s %-16s %7.2f%% %7.2f%% %7.2f%% %10.3f\n", strategies[pairing.player1].name.c_str(),
+            strategies[pairing.player2].name.c_str(), percent(pairing.player1Wins, pairing.matches),
+            percent(pairing.player2Wins, pairing.matches), percent(pairing.draws, pairing.matches),
+            pairing.matches ? (double)pairing.turns / pairing.matches : 0.0);
+    }
+    return 0;
+}